@@ -25,10 +25,6 @@
 #include <emmintrin.h>
 #endif
 
-#if _M_SSE >= 0x401
-#include <smmintrin.h>
-#endif
-
 inline u16 RGBA8888toRGB565(u32 px) {
 	return ((px >> 3) & 0x001F) | ((px >> 5) & 0x07E0) | ((px >> 8) & 0xF800);
 }
@@ -137,25 +133,22 @@ void convert5551_dx9(u16* data, u32* out, int width, int l, int u) {
 
 
 
-void ConvertBGRA8888ToRGBA8888(u32 *dst, const u32 *src, u32 numPixels) {
+void ConvertBGRA8888ToRGBA8888Basic(u32 *dst, const u32 *src, u32 numPixels) {
 #ifdef _M_SSE
 	const __m128i maskGA = _mm_set1_epi32(0xFF00FF00);
 
 	const __m128i *srcp = (const __m128i *)src;
 	__m128i *dstp = (__m128i *)dst;
-	u32 sseChunks = numPixels / 4;
-	if (((intptr_t)src & 0xF) || ((intptr_t)dst & 0xF)) {
-		sseChunks = 0;
-	}
+	const u32 sseChunks = numPixels / 4;
 	for (u32 i = 0; i < sseChunks; ++i) {
-		__m128i c = _mm_load_si128(&srcp[i]);
+		__m128i c = _mm_loadu_si128(&srcp[i]);
 		__m128i rb = _mm_andnot_si128(maskGA, c);
 		c = _mm_and_si128(c, maskGA);
 
 		__m128i b = _mm_srli_epi32(rb, 16);
 		__m128i r = _mm_slli_epi32(rb, 16);
 		c = _mm_or_si128(_mm_or_si128(c, r), b);
-		_mm_store_si128(&dstp[i], c);
+		_mm_storeu_si128(&dstp[i], c);
 	}
 	// The remainder starts right after those done via SSE.
 	u32 i = sseChunks * 4;
@@ -170,40 +163,159 @@ void ConvertBGRA8888ToRGBA8888(u32 *dst, const u32 *src, u32 numPixels) {
 	}
 }
 
-void ConvertRGBA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
-#if _M_SSE >= 0x401
-	const __m128i maskAG = _mm_set1_epi32(0x8000F800);
-	const __m128i maskRB = _mm_set1_epi32(0x00F800F8);
-	const __m128i mask = _mm_set1_epi32(0x0000FFFF);
+#ifdef _M_SSE
+// SSE2 has no unsigned 32 to 16-bit pack, but values that fit in 16 bits survive a signed
+// pack once they're sign extended.
+static inline __m128i PackLow16(__m128i lo, __m128i hi) {
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
 
-	const __m128i *srcp = (const __m128i *)src;
-	__m128i *dstp = (__m128i *)dst;
-	u32 sseChunks = (numPixels / 4) & ~1;
-	// SSE 4.1 required for _mm_packus_epi32.
-	if (((intptr_t)src & 0xF) || ((intptr_t)dst & 0xF) || !cpu_info.bSSE4_1) {
-		sseChunks = 0;
-	}
-	for (u32 i = 0; i < sseChunks; i += 2) {
-		__m128i c1 = _mm_load_si128(&srcp[i + 0]);
-		__m128i c2 = _mm_load_si128(&srcp[i + 1]);
-		__m128i ag, rb;
+// These take 4 pixels of 8888, and leave the 16-bit result in the low half of each lane.
+// Whatever ends up in the high half is discarded by PackLow16().
+static inline __m128i RGBA8888ToRGB565SSE(__m128i c) {
+	const __m128i rb = _mm_and_si128(c, _mm_set1_epi32(0x00F800F8));
+	const __m128i g = _mm_and_si128(c, _mm_set1_epi32(0x0000FC00));
+	return _mm_or_si128(_mm_or_si128(_mm_srli_epi32(rb, 3), _mm_srli_epi32(rb, 8)), _mm_srli_epi32(g, 5));
+}
+
+static inline __m128i RGBA8888ToRGBA5551SSE(__m128i c) {
+	const __m128i rb = _mm_and_si128(c, _mm_set1_epi32(0x00F800F8));
+	const __m128i ag = _mm_and_si128(c, _mm_set1_epi32(0x8000F800));
+	const __m128i r_b = _mm_or_si128(_mm_srli_epi32(rb, 3), _mm_srli_epi32(rb, 9));
+	const __m128i a_g = _mm_or_si128(_mm_srli_epi32(ag, 16), _mm_srli_epi32(ag, 6));
+	return _mm_or_si128(r_b, a_g);
+}
+
+static inline __m128i RGBA8888ToRGBA4444SSE(__m128i c) {
+	// Take the top 4 bits of each channel, then merge pairs into RG and BA bytes.
+	c = _mm_and_si128(_mm_srli_epi32(c, 4), _mm_set1_epi32(0x0F0F0F0F));
+	c = _mm_or_si128(c, _mm_srli_epi32(c, 4));
+	const __m128i rg = _mm_and_si128(c, _mm_set1_epi32(0x000000FF));
+	const __m128i ba = _mm_and_si128(_mm_srli_epi32(c, 8), _mm_set1_epi32(0x0000FF00));
+	return _mm_or_si128(rg, ba);
+}
+
+static inline __m128i BGRA8888ToRGB565SSE(__m128i c) {
+	const __m128i br = _mm_and_si128(c, _mm_set1_epi32(0x00F800F8));
+	const __m128i g = _mm_and_si128(c, _mm_set1_epi32(0x0000FC00));
+	return _mm_or_si128(_mm_or_si128(_mm_srli_epi32(br, 19), _mm_slli_epi32(br, 8)), _mm_srli_epi32(g, 5));
+}
 
-		ag = _mm_and_si128(c1, maskAG);
-		ag = _mm_or_si128(_mm_srli_epi32(ag, 16), _mm_srli_epi32(ag, 6));
-		rb = _mm_and_si128(c1, maskRB);
-		rb = _mm_or_si128(_mm_srli_epi32(rb, 3), _mm_srli_epi32(rb, 9));
-		c1 = _mm_and_si128(_mm_or_si128(ag, rb), mask);
+static inline __m128i BGRA8888ToRGBA5551SSE(__m128i c) {
+	const __m128i br = _mm_and_si128(c, _mm_set1_epi32(0x00F800F8));
+	const __m128i ag = _mm_and_si128(c, _mm_set1_epi32(0x8000F800));
+	const __m128i r_b = _mm_or_si128(_mm_srli_epi32(br, 19), _mm_slli_epi32(br, 7));
+	const __m128i a_g = _mm_or_si128(_mm_srli_epi32(ag, 16), _mm_srli_epi32(ag, 6));
+	return _mm_or_si128(r_b, a_g);
+}
 
-		ag = _mm_and_si128(c2, maskAG);
-		ag = _mm_or_si128(_mm_srli_epi32(ag, 16), _mm_srli_epi32(ag, 6));
-		rb = _mm_and_si128(c2, maskRB);
-		rb = _mm_or_si128(_mm_srli_epi32(rb, 3), _mm_srli_epi32(rb, 9));
-		c2 = _mm_and_si128(_mm_or_si128(ag, rb), mask);
+static inline __m128i BGRA8888ToRGBA4444SSE(__m128i c) {
+	const __m128i r = _mm_and_si128(_mm_srli_epi32(c, 20), _mm_set1_epi32(0x000F));
+	const __m128i g = _mm_and_si128(_mm_srli_epi32(c, 8), _mm_set1_epi32(0x00F0));
+	const __m128i b = _mm_and_si128(_mm_slli_epi32(c, 4), _mm_set1_epi32(0x0F00));
+	const __m128i a = _mm_and_si128(_mm_srli_epi32(c, 16), _mm_set1_epi32(0xF000));
+	return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+}
 
-		_mm_store_si128(&dstp[i / 2], _mm_packus_epi32(c1, c2));
+// Converts as many pixels as possible in groups of 8, and returns how many that was.
+template <__m128i (*Pack)(__m128i)>
+static u32 Convert8888To16SSE(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = numPixels & ~7;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const __m128i c1 = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i c2 = _mm_loadu_si128((const __m128i *)(src + i + 4));
+		_mm_storeu_si128((__m128i *)(dst + i), PackLow16(Pack(c1), Pack(c2)));
 	}
-	// The remainder starts right after those done via SSE.
-	u32 i = sseChunks * 4;
+	return simdable;
+}
+
+// These take 8 16-bit pixels, and produce RRGG and BBAA in each lane, ready to interleave.
+// With bgra, red and blue are swapped.
+template <bool bgra>
+static inline void RGB565ToRGBA8888SSE(__m128i c, __m128i &rg, __m128i &ba) {
+	const __m128i mask5 = _mm_set1_epi16(0x001f);
+	const __m128i mask6 = _mm_set1_epi16(0x003f);
+
+	// Swizzle, resulting in RR00 RR00.
+	__m128i r = _mm_and_si128(c, mask5);
+	r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+
+	// This one becomes 00GG 00GG.
+	__m128i g = _mm_and_si128(_mm_srli_epi16(c, 5), mask6);
+	g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+	g = _mm_slli_epi16(g, 8);
+
+	// Almost done, we aim for BB00 BB00 again here.
+	__m128i b = _mm_srli_epi16(c, 11);
+	b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+	// Always set to 00FF 00FF.
+	const __m128i a = _mm_slli_epi16(_mm_set1_epi16(0x00ff), 8);
+
+	rg = _mm_or_si128(bgra ? b : r, g);
+	ba = _mm_or_si128(bgra ? r : b, a);
+}
+
+template <bool bgra>
+static inline void RGBA5551ToRGBA8888SSE(__m128i c, __m128i &rg, __m128i &ba) {
+	const __m128i mask5 = _mm_set1_epi16(0x001f);
+
+	__m128i r = _mm_and_si128(c, mask5);
+	r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+
+	__m128i g = _mm_and_si128(_mm_srli_epi16(c, 5), mask5);
+	g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+	g = _mm_slli_epi16(g, 8);
+
+	__m128i b = _mm_and_si128(_mm_srli_epi16(c, 10), mask5);
+	b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+	// 1 bit A to 00AA 00AA.
+	__m128i a = _mm_srai_epi16(c, 15);
+	a = _mm_slli_epi16(a, 8);
+
+	rg = _mm_or_si128(bgra ? b : r, g);
+	ba = _mm_or_si128(bgra ? r : b, a);
+}
+
+template <bool bgra>
+static inline void RGBA4444ToRGBA8888SSE(__m128i c, __m128i &rg, __m128i &ba) {
+	const __m128i mask4 = _mm_set1_epi16(0x000f);
+
+	// Let's just grab R000 R000, without swizzling yet.
+	const __m128i r = _mm_and_si128(c, mask4);
+	// And then 00G0 00G0.
+	const __m128i g = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(c, 4), mask4), 8);
+	// Now B000 B000.
+	const __m128i b = _mm_and_si128(_mm_srli_epi16(c, 8), mask4);
+	// And lastly 00A0 00A0.  No mask needed, we have a wall.
+	const __m128i a = _mm_slli_epi16(_mm_srli_epi16(c, 12), 8);
+
+	// We swizzle after combining - R0G0 R0G0 and B0A0 B0A0 -> RRGG RRGG and BBAA BBAA.
+	rg = _mm_or_si128(bgra ? b : r, g);
+	ba = _mm_or_si128(bgra ? r : b, a);
+	rg = _mm_or_si128(rg, _mm_slli_epi16(rg, 4));
+	ba = _mm_or_si128(ba, _mm_slli_epi16(ba, 4));
+}
+
+template <void (*Expand)(__m128i, __m128i &, __m128i &)>
+static u32 Convert16To8888SSE(u32 *dst, const u16 *src, u32 numPixels) {
+	const u32 simdable = numPixels & ~7;
+	for (u32 i = 0; i < simdable; i += 8) {
+		__m128i rg, ba;
+		Expand(_mm_loadu_si128((const __m128i *)(src + i)), rg, ba);
+		_mm_storeu_si128((__m128i *)(dst + i + 0), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(rg, ba));
+	}
+	return simdable;
+}
+#endif
+
+void ConvertRGBA8888ToRGBA5551Basic(u16 *dst, const u32 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert8888To16SSE<&RGBA8888ToRGBA5551SSE>(dst, src, numPixels);
 #else
 	u32 i = 0;
 #endif
@@ -212,40 +324,9 @@ void ConvertRGBA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
 	}
 }
 
-void ConvertBGRA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
-#if _M_SSE >= 0x401
-	const __m128i maskAG = _mm_set1_epi32(0x8000F800);
-	const __m128i maskRB = _mm_set1_epi32(0x00F800F8);
-	const __m128i mask = _mm_set1_epi32(0x0000FFFF);
-
-	const __m128i *srcp = (const __m128i *)src;
-	__m128i *dstp = (__m128i *)dst;
-	u32 sseChunks = (numPixels / 4) & ~1;
-	// SSE 4.1 required for _mm_packus_epi32.
-	if (((intptr_t)src & 0xF) || ((intptr_t)dst & 0xF) || !cpu_info.bSSE4_1) {
-		sseChunks = 0;
-	}
-	for (u32 i = 0; i < sseChunks; i += 2) {
-		__m128i c1 = _mm_load_si128(&srcp[i + 0]);
-		__m128i c2 = _mm_load_si128(&srcp[i + 1]);
-		__m128i ag, rb;
-
-		ag = _mm_and_si128(c1, maskAG);
-		ag = _mm_or_si128(_mm_srli_epi32(ag, 16), _mm_srli_epi32(ag, 6));
-		rb = _mm_and_si128(c1, maskRB);
-		rb = _mm_or_si128(_mm_srli_epi32(rb, 19), _mm_slli_epi32(rb, 7));
-		c1 = _mm_and_si128(_mm_or_si128(ag, rb), mask);
-
-		ag = _mm_and_si128(c2, maskAG);
-		ag = _mm_or_si128(_mm_srli_epi32(ag, 16), _mm_srli_epi32(ag, 6));
-		rb = _mm_and_si128(c2, maskRB);
-		rb = _mm_or_si128(_mm_srli_epi32(rb, 19), _mm_slli_epi32(rb, 7));
-		c2 = _mm_and_si128(_mm_or_si128(ag, rb), mask);
-
-		_mm_store_si128(&dstp[i / 2], _mm_packus_epi32(c1, c2));
-	}
-	// The remainder starts right after those done via SSE.
-	u32 i = sseChunks * 4;
+void ConvertBGRA8888ToRGBA5551Basic(u16 *dst, const u32 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert8888To16SSE<&BGRA8888ToRGBA5551SSE>(dst, src, numPixels);
 #else
 	u32 i = 0;
 #endif
@@ -254,70 +335,53 @@ void ConvertBGRA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels) {
 	}
 }
 
-void ConvertBGRA8888ToRGB565(u16 *dst, const u32 *src, u32 numPixels) {
-	for (u32 i = 0; i < numPixels; i++) {
+void ConvertBGRA8888ToRGB565Basic(u16 *dst, const u32 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert8888To16SSE<&BGRA8888ToRGB565SSE>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
 		dst[i] = BGRA8888toRGB565(src[i]);
 	}
 }
 
-void ConvertBGRA8888ToRGBA4444(u16 *dst, const u32 *src, u32 numPixels) {
-	for (u32 i = 0; i < numPixels; i++) {
+void ConvertBGRA8888ToRGBA4444Basic(u16 *dst, const u32 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert8888To16SSE<&BGRA8888ToRGBA4444SSE>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
 		dst[i] = BGRA8888toRGBA4444(src[i]);
 	}
 }
 
-void ConvertRGBA8888ToRGB565(u16 *dst, const u32 *src, u32 numPixels) {
-	for (u32 x = 0; x < numPixels; ++x) {
-		dst[x] = RGBA8888toRGB565(src[x]);
+void ConvertRGBA8888ToRGB565Basic(u16 *dst, const u32 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert8888To16SSE<&RGBA8888ToRGB565SSE>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
+		dst[i] = RGBA8888toRGB565(src[i]);
 	}
 }
 
-void ConvertRGBA8888ToRGBA4444(u16 *dst, const u32 *src, u32 numPixels) {
-	for (u32 x = 0; x < numPixels; ++x) {
-		dst[x] = RGBA8888toRGBA4444(src[x]);
+void ConvertRGBA8888ToRGBA4444Basic(u16 *dst, const u32 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert8888To16SSE<&RGBA8888ToRGBA4444SSE>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
+		dst[i] = RGBA8888toRGBA4444(src[i]);
 	}
 }
 
-void ConvertRGBA565ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
+void ConvertRGBA565ToRGBA8888Basic(u32 *dst32, const u16 *src, u32 numPixels) {
 #ifdef _M_SSE
-	const __m128i mask5 = _mm_set1_epi16(0x001f);
-	const __m128i mask6 = _mm_set1_epi16(0x003f);
-	const __m128i mask8 = _mm_set1_epi16(0x00ff);
-
-	const __m128i *srcp = (const __m128i *)src;
-	__m128i *dstp = (__m128i *)dst32;
-	u32 sseChunks = numPixels / 8;
-	if (((intptr_t)src & 0xF) || ((intptr_t)dst32 & 0xF)) {
-		sseChunks = 0;
-	}
-	for (u32 i = 0; i < sseChunks; ++i) {
-		const __m128i c = _mm_load_si128(&srcp[i]);
-
-		// Swizzle, resulting in RR00 RR00.
-		__m128i r = _mm_and_si128(c, mask5);
-		r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
-		r = _mm_and_si128(r, mask8);
-
-		// This one becomes 00GG 00GG.
-		__m128i g = _mm_and_si128(_mm_srli_epi16(c, 5), mask6);
-		g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
-		g = _mm_slli_epi16(g, 8);
-
-		// Almost done, we aim for BB00 BB00 again here.
-		__m128i b = _mm_and_si128(_mm_srli_epi16(c, 11), mask5);
-		b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
-		b = _mm_and_si128(b, mask8);
-
-		// Always set to 00FF 00FF.
-		__m128i a = _mm_slli_epi16(mask8, 8);
-
-		// Now combine them, RRGG RRGG and BBAA BBAA, and then interleave.
-		const __m128i rg = _mm_or_si128(r, g);
-		const __m128i ba = _mm_or_si128(b, a);
-		_mm_store_si128(&dstp[i * 2 + 0], _mm_unpacklo_epi16(rg, ba));
-		_mm_store_si128(&dstp[i * 2 + 1], _mm_unpackhi_epi16(rg, ba));
-	}
-	u32 i = sseChunks * 8;
+	u32 i = Convert16To8888SSE<&RGB565ToRGBA8888SSE<false>>(dst32, src, numPixels);
 #else
 	u32 i = 0;
 #endif
@@ -332,46 +396,9 @@ void ConvertRGBA565ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 	}
 }
 
-void ConvertRGBA5551ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
+void ConvertRGBA5551ToRGBA8888Basic(u32 *dst32, const u16 *src, u32 numPixels) {
 #ifdef _M_SSE
-	const __m128i mask5 = _mm_set1_epi16(0x001f);
-	const __m128i mask8 = _mm_set1_epi16(0x00ff);
-
-	const __m128i *srcp = (const __m128i *)src;
-	__m128i *dstp = (__m128i *)dst32;
-	u32 sseChunks = numPixels / 8;
-	if (((intptr_t)src & 0xF) || ((intptr_t)dst32 & 0xF)) {
-		sseChunks = 0;
-	}
-	for (u32 i = 0; i < sseChunks; ++i) {
-		const __m128i c = _mm_load_si128(&srcp[i]);
-
-		// Swizzle, resulting in RR00 RR00.
-		__m128i r = _mm_and_si128(c, mask5);
-		r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
-		r = _mm_and_si128(r, mask8);
-
-		// This one becomes 00GG 00GG.
-		__m128i g = _mm_and_si128(_mm_srli_epi16(c, 5), mask5);
-		g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
-		g = _mm_slli_epi16(g, 8);
-
-		// Almost done, we aim for BB00 BB00 again here.
-		__m128i b = _mm_and_si128(_mm_srli_epi16(c, 10), mask5);
-		b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
-		b = _mm_and_si128(b, mask8);
-
-		// 1 bit A to 00AA 00AA.
-		__m128i a = _mm_srai_epi16(c, 15);
-		a = _mm_slli_epi16(a, 8);
-
-		// Now combine them, RRGG RRGG and BBAA BBAA, and then interleave.
-		const __m128i rg = _mm_or_si128(r, g);
-		const __m128i ba = _mm_or_si128(b, a);
-		_mm_store_si128(&dstp[i * 2 + 0], _mm_unpacklo_epi16(rg, ba));
-		_mm_store_si128(&dstp[i * 2 + 1], _mm_unpackhi_epi16(rg, ba));
-	}
-	u32 i = sseChunks * 8;
+	u32 i = Convert16To8888SSE<&RGBA5551ToRGBA8888SSE<false>>(dst32, src, numPixels);
 #else
 	u32 i = 0;
 #endif
@@ -386,41 +413,9 @@ void ConvertRGBA5551ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 	}
 }
 
-void ConvertRGBA4444ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
+void ConvertRGBA4444ToRGBA8888Basic(u32 *dst32, const u16 *src, u32 numPixels) {
 #ifdef _M_SSE
-	const __m128i mask4 = _mm_set1_epi16(0x000f);
-
-	const __m128i *srcp = (const __m128i *)src;
-	__m128i *dstp = (__m128i *)dst32;
-	u32 sseChunks = numPixels / 8;
-	if (((intptr_t)src & 0xF) || ((intptr_t)dst32 & 0xF)) {
-		sseChunks = 0;
-	}
-	for (u32 i = 0; i < sseChunks; ++i) {
-		const __m128i c = _mm_load_si128(&srcp[i]);
-
-		// Let's just grab R000 R000, without swizzling yet.
-		__m128i r = _mm_and_si128(c, mask4);
-		// And then 00G0 00G0.
-		__m128i g = _mm_and_si128(_mm_srli_epi16(c, 4), mask4);
-		g = _mm_slli_epi16(g, 8);
-		// Now B000 B000.
-		__m128i b = _mm_and_si128(_mm_srli_epi16(c, 8), mask4);
-		// And lastly 00A0 00A0.  No mask needed, we have a wall.
-		__m128i a = _mm_srli_epi16(c, 12);
-		a = _mm_slli_epi16(a, 8);
-
-		// We swizzle after combining - R0G0 R0G0 and B0A0 B0A0 -> RRGG RRGG and BBAA BBAA.
-		__m128i rg = _mm_or_si128(r, g);
-		__m128i ba = _mm_or_si128(b, a);
-		rg = _mm_or_si128(rg, _mm_slli_epi16(rg, 4));
-		ba = _mm_or_si128(ba, _mm_slli_epi16(ba, 4));
-
-		// And then we can store.
-		_mm_store_si128(&dstp[i * 2 + 0], _mm_unpacklo_epi16(rg, ba));
-		_mm_store_si128(&dstp[i * 2 + 1], _mm_unpackhi_epi16(rg, ba));
-	}
-	u32 i = sseChunks * 8;
+	u32 i = Convert16To8888SSE<&RGBA4444ToRGBA8888SSE<false>>(dst32, src, numPixels);
 #else
 	u32 i = 0;
 #endif
@@ -468,40 +463,40 @@ void ConvertABGR4444ToRGBA8888(u32 *dst32, const u16 *src, u32 numPixels) {
 	}
 }
 
-void ConvertRGBA4444ToBGRA8888(u32 *dst32, const u16 *src, u32 numPixels) {
-	u8 *dst = (u8 *)dst32;
-	for (u32 x = 0; x < numPixels; x++) {
-		u16 c = src[x];
-		u32 r = c & 0x000f;
-		u32 g = (c >> 4) & 0x000f;
-		u32 b = (c >> 8) & 0x000f;
-		u32 a = (c >> 12) & 0x000f;
+static inline u32 SwapRB(u32 c) {
+	return (c & 0xFF00FF00) | ((c >> 16) & 0x000000FF) | ((c << 16) & 0x00FF0000);
+}
 
-		dst[x] = (r << (16 + 4)) | (g << (8 + 4)) | (b << 4) | (a << (24 + 4));
+void ConvertRGBA4444ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
+#ifdef _M_SSE
+	u32 i = Convert16To8888SSE<&RGBA4444ToRGBA8888SSE<true>>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
+		dst[i] = SwapRB(RGBA4444ToRGBA8888(src[i]));
 	}
 }
 
 void ConvertRGBA5551ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
-	for (u32 x = 0; x < numPixels; x++) {
-		u16 c = src[x];
-		u32 r = c & 0x001f;
-		u32 g = (c >> 5) & 0x001f;
-		u32 b = (c >> 10) & 0x001f;
-		// We force an arithmetic shift to get the sign bits/
-		u32 a = ((s32)(s16)c) & 0xff000000;
-
-		dst[x] = (r << (16 + 3)) | (g << (8 + 3)) | (b << 3) | a;
+#ifdef _M_SSE
+	u32 i = Convert16To8888SSE<&RGBA5551ToRGBA8888SSE<true>>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
+		dst[i] = SwapRB(RGBA5551ToRGBA8888(src[i]));
 	}
 }
 
 void ConvertRGB565ToBGRA8888(u32 *dst, const u16 *src, u32 numPixels) {
-	for (u32 x = 0; x < numPixels; x++) {
-		u16 c = src[x];
-		u32 r = c & 0x001f;
-		u32 g = (c >> 5) & 0x003f;
-		u32 b = (c >> 11) & 0x001f;
-
-		dst[x] = (r << (16 + 3)) | (g << (8 + 2)) | (b << 3) | 0xFF000000;
+#ifdef _M_SSE
+	u32 i = Convert16To8888SSE<&RGB565ToRGBA8888SSE<true>>(dst, src, numPixels);
+#else
+	u32 i = 0;
+#endif
+	for (; i < numPixels; i++) {
+		dst[i] = SwapRB(RGB565ToRGBA8888(src[i]));
 	}
 }
 
@@ -642,12 +637,35 @@ Convert16bppTo16bppFunc ConvertRGBA5551ToABGR1555 = &ConvertRGBA5551ToABGR1555Ba
 Convert16bppTo16bppFunc ConvertRGB565ToBGR565 = &ConvertRGB565ToBGR565Basic;
 #endif
 
+#ifndef ConvertRGBA565ToRGBA8888
+Convert32bppTo32bppFunc ConvertBGRA8888ToRGBA8888 = &ConvertBGRA8888ToRGBA8888Basic;
+Convert32bppTo16bppFunc ConvertRGBA8888ToRGBA5551 = &ConvertRGBA8888ToRGBA5551Basic;
+Convert32bppTo16bppFunc ConvertRGBA8888ToRGB565 = &ConvertRGBA8888ToRGB565Basic;
+Convert32bppTo16bppFunc ConvertRGBA8888ToRGBA4444 = &ConvertRGBA8888ToRGBA4444Basic;
+Convert32bppTo16bppFunc ConvertBGRA8888ToRGBA5551 = &ConvertBGRA8888ToRGBA5551Basic;
+Convert32bppTo16bppFunc ConvertBGRA8888ToRGB565 = &ConvertBGRA8888ToRGB565Basic;
+Convert32bppTo16bppFunc ConvertBGRA8888ToRGBA4444 = &ConvertBGRA8888ToRGBA4444Basic;
+Convert16bppTo32bppFunc ConvertRGBA565ToRGBA8888 = &ConvertRGBA565ToRGBA8888Basic;
+Convert16bppTo32bppFunc ConvertRGBA5551ToRGBA8888 = &ConvertRGBA5551ToRGBA8888Basic;
+Convert16bppTo32bppFunc ConvertRGBA4444ToRGBA8888 = &ConvertRGBA4444ToRGBA8888Basic;
+#endif
+
 void SetupColorConv() {
 #if PPSSPP_ARCH(ARM_NEON) && !PPSSPP_ARCH(ARM64)
 	if (cpu_info.bNEON) {
 		ConvertRGBA4444ToABGR4444 = &ConvertRGBA4444ToABGR4444NEON;
 		ConvertRGBA5551ToABGR1555 = &ConvertRGBA5551ToABGR1555NEON;
 		ConvertRGB565ToBGR565 = &ConvertRGB565ToBGR565NEON;
+		ConvertBGRA8888ToRGBA8888 = &ConvertBGRA8888ToRGBA8888NEON;
+		ConvertRGBA8888ToRGBA5551 = &ConvertRGBA8888ToRGBA5551NEON;
+		ConvertRGBA8888ToRGB565 = &ConvertRGBA8888ToRGB565NEON;
+		ConvertRGBA8888ToRGBA4444 = &ConvertRGBA8888ToRGBA4444NEON;
+		ConvertBGRA8888ToRGBA5551 = &ConvertBGRA8888ToRGBA5551NEON;
+		ConvertBGRA8888ToRGB565 = &ConvertBGRA8888ToRGB565NEON;
+		ConvertBGRA8888ToRGBA4444 = &ConvertBGRA8888ToRGBA4444NEON;
+		ConvertRGBA565ToRGBA8888 = &ConvertRGBA565ToRGBA8888NEON;
+		ConvertRGBA5551ToRGBA8888 = &ConvertRGBA5551ToRGBA8888NEON;
+		ConvertRGBA4444ToRGBA8888 = &ConvertRGBA4444ToRGBA8888NEON;
 	}
 #endif
 }
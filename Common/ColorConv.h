@@ -112,20 +112,20 @@ typedef void (*Convert16bppTo32bppFunc)(u32 *dst, const u16 *src, u32 numPixels)
 typedef void (*Convert32bppTo16bppFunc)(u16 *dst, const u32 *src, u32 numPixels);
 typedef void (*Convert32bppTo32bppFunc)(u32 *dst, const u32 *src, u32 numPixels);
 
-void ConvertBGRA8888ToRGBA8888(u32 *dst, const u32 *src, u32 numPixels);
-#define ConvertRGBA8888ToBGRA8888 ConvertBGRA8888ToRGBA8888
+// These have SSE2 paths, and NEON versions below.
+void ConvertBGRA8888ToRGBA8888Basic(u32 *dst, const u32 *src, u32 numPixels);
 
-void ConvertRGBA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels);
-void ConvertRGBA8888ToRGB565(u16 *dst, const u32 *src, u32 numPixels);
-void ConvertRGBA8888ToRGBA4444(u16 *dst, const u32 *src, u32 numPixels);
+void ConvertRGBA8888ToRGBA5551Basic(u16 *dst, const u32 *src, u32 numPixels);
+void ConvertRGBA8888ToRGB565Basic(u16 *dst, const u32 *src, u32 numPixels);
+void ConvertRGBA8888ToRGBA4444Basic(u16 *dst, const u32 *src, u32 numPixels);
 
-void ConvertBGRA8888ToRGBA5551(u16 *dst, const u32 *src, u32 numPixels);
-void ConvertBGRA8888ToRGB565(u16 *dst, const u32 *src, u32 numPixels);
-void ConvertBGRA8888ToRGBA4444(u16 *dst, const u32 *src, u32 numPixels);
+void ConvertBGRA8888ToRGBA5551Basic(u16 *dst, const u32 *src, u32 numPixels);
+void ConvertBGRA8888ToRGB565Basic(u16 *dst, const u32 *src, u32 numPixels);
+void ConvertBGRA8888ToRGBA4444Basic(u16 *dst, const u32 *src, u32 numPixels);
 
-void ConvertRGBA565ToRGBA8888(u32 *dst, const u16 *src, u32 numPixels);
-void ConvertRGBA5551ToRGBA8888(u32 *dst, const u16 *src, u32 numPixels);
-void ConvertRGBA4444ToRGBA8888(u32 *dst, const u16 *src, u32 numPixels);
+void ConvertRGBA565ToRGBA8888Basic(u32 *dst, const u16 *src, u32 numPixels);
+void ConvertRGBA5551ToRGBA8888Basic(u32 *dst, const u16 *src, u32 numPixels);
+void ConvertRGBA4444ToRGBA8888Basic(u32 *dst, const u16 *src, u32 numPixels);
 
 void ConvertABGR565ToRGBA8888(u32 *dst, const u16 *src, u32 numPixels);
 void ConvertABGR1555ToRGBA8888(u32 *dst, const u16 *src, u32 numPixels);
@@ -162,3 +162,40 @@ extern Convert16bppTo16bppFunc ConvertRGBA5551ToABGR1555;
 #else
 extern Convert16bppTo16bppFunc ConvertRGB565ToBGR565;
 #endif
+
+#if PPSSPP_ARCH(ARM64)
+#define ConvertBGRA8888ToRGBA8888 ConvertBGRA8888ToRGBA8888NEON
+#define ConvertRGBA8888ToRGBA5551 ConvertRGBA8888ToRGBA5551NEON
+#define ConvertRGBA8888ToRGB565 ConvertRGBA8888ToRGB565NEON
+#define ConvertRGBA8888ToRGBA4444 ConvertRGBA8888ToRGBA4444NEON
+#define ConvertBGRA8888ToRGBA5551 ConvertBGRA8888ToRGBA5551NEON
+#define ConvertBGRA8888ToRGB565 ConvertBGRA8888ToRGB565NEON
+#define ConvertBGRA8888ToRGBA4444 ConvertBGRA8888ToRGBA4444NEON
+#define ConvertRGBA565ToRGBA8888 ConvertRGBA565ToRGBA8888NEON
+#define ConvertRGBA5551ToRGBA8888 ConvertRGBA5551ToRGBA8888NEON
+#define ConvertRGBA4444ToRGBA8888 ConvertRGBA4444ToRGBA8888NEON
+#elif !PPSSPP_ARCH(ARM)
+#define ConvertBGRA8888ToRGBA8888 ConvertBGRA8888ToRGBA8888Basic
+#define ConvertRGBA8888ToRGBA5551 ConvertRGBA8888ToRGBA5551Basic
+#define ConvertRGBA8888ToRGB565 ConvertRGBA8888ToRGB565Basic
+#define ConvertRGBA8888ToRGBA4444 ConvertRGBA8888ToRGBA4444Basic
+#define ConvertBGRA8888ToRGBA5551 ConvertBGRA8888ToRGBA5551Basic
+#define ConvertBGRA8888ToRGB565 ConvertBGRA8888ToRGB565Basic
+#define ConvertBGRA8888ToRGBA4444 ConvertBGRA8888ToRGBA4444Basic
+#define ConvertRGBA565ToRGBA8888 ConvertRGBA565ToRGBA8888Basic
+#define ConvertRGBA5551ToRGBA8888 ConvertRGBA5551ToRGBA8888Basic
+#define ConvertRGBA4444ToRGBA8888 ConvertRGBA4444ToRGBA8888Basic
+#else
+extern Convert32bppTo32bppFunc ConvertBGRA8888ToRGBA8888;
+extern Convert32bppTo16bppFunc ConvertRGBA8888ToRGBA5551;
+extern Convert32bppTo16bppFunc ConvertRGBA8888ToRGB565;
+extern Convert32bppTo16bppFunc ConvertRGBA8888ToRGBA4444;
+extern Convert32bppTo16bppFunc ConvertBGRA8888ToRGBA5551;
+extern Convert32bppTo16bppFunc ConvertBGRA8888ToRGB565;
+extern Convert32bppTo16bppFunc ConvertBGRA8888ToRGBA4444;
+extern Convert16bppTo32bppFunc ConvertRGBA565ToRGBA8888;
+extern Convert16bppTo32bppFunc ConvertRGBA5551ToRGBA8888;
+extern Convert16bppTo32bppFunc ConvertRGBA4444ToRGBA8888;
+#endif
+
+#define ConvertRGBA8888ToBGRA8888 ConvertBGRA8888ToRGBA8888
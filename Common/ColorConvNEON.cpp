@@ -23,8 +23,6 @@
 #include "Common.h"
 #include "CPUDetect.h"
 
-// TODO: More NEON color conversion funcs.
-
 void ConvertRGBA4444ToABGR4444NEON(u16 *dst, const u16 *src, u32 numPixels) {
 	const uint16x8_t mask0040 = vdupq_n_u16(0x00F0);
 
@@ -111,4 +109,190 @@ void ConvertRGB565ToBGR565NEON(u16 *dst, const u16 *src, u32 numPixels) {
 	}
 }
 
+// The 8888 conversions below use vld4/vst4, which split pixels into one register per channel
+// and don't care about alignment.
+
+void ConvertBGRA8888ToRGBA8888NEON(u32 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		const uint8x8_t r = c.val[2];
+		c.val[2] = c.val[0];
+		c.val[0] = r;
+		vst4_u8((u8 *)(dst + i), c);
+	}
+
+	if (numPixels > simdable) {
+		ConvertBGRA8888ToRGBA8888Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+static inline uint16x8_t PackRGB565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+	const uint16x8_t r16 = vmovl_u8(vshr_n_u8(r, 3));
+	const uint16x8_t g16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 2)), 5);
+	const uint16x8_t b16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(b, 3)), 11);
+	return vorrq_u16(vorrq_u16(r16, g16), b16);
+}
+
+static inline uint16x8_t PackRGBA5551(uint8x8_t r, uint8x8_t g, uint8x8_t b, uint8x8_t a) {
+	const uint16x8_t r16 = vmovl_u8(vshr_n_u8(r, 3));
+	const uint16x8_t g16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 3)), 5);
+	const uint16x8_t b16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(b, 3)), 10);
+	const uint16x8_t a16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(a, 7)), 15);
+	return vorrq_u16(vorrq_u16(r16, g16), vorrq_u16(b16, a16));
+}
+
+static inline uint16x8_t PackRGBA4444(uint8x8_t r, uint8x8_t g, uint8x8_t b, uint8x8_t a) {
+	const uint16x8_t r16 = vmovl_u8(vshr_n_u8(r, 4));
+	const uint16x8_t g16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 4)), 4);
+	const uint16x8_t b16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(b, 4)), 8);
+	const uint16x8_t a16 = vshlq_n_u16(vmovl_u8(vshr_n_u8(a, 4)), 12);
+	return vorrq_u16(vorrq_u16(r16, g16), vorrq_u16(b16, a16));
+}
+
+void ConvertRGBA8888ToRGBA5551NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		vst1q_u16(dst + i, PackRGBA5551(c.val[0], c.val[1], c.val[2], c.val[3]));
+	}
+
+	if (numPixels > simdable) {
+		ConvertRGBA8888ToRGBA5551Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertRGBA8888ToRGB565NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		vst1q_u16(dst + i, PackRGB565(c.val[0], c.val[1], c.val[2]));
+	}
+
+	if (numPixels > simdable) {
+		ConvertRGBA8888ToRGB565Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertRGBA8888ToRGBA4444NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		vst1q_u16(dst + i, PackRGBA4444(c.val[0], c.val[1], c.val[2], c.val[3]));
+	}
+
+	if (numPixels > simdable) {
+		ConvertRGBA8888ToRGBA4444Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertBGRA8888ToRGBA5551NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		vst1q_u16(dst + i, PackRGBA5551(c.val[2], c.val[1], c.val[0], c.val[3]));
+	}
+
+	if (numPixels > simdable) {
+		ConvertBGRA8888ToRGBA5551Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertBGRA8888ToRGB565NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		vst1q_u16(dst + i, PackRGB565(c.val[2], c.val[1], c.val[0]));
+	}
+
+	if (numPixels > simdable) {
+		ConvertBGRA8888ToRGB565Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertBGRA8888ToRGBA4444NEON(u16 *dst, const u32 *src, u32 numPixels) {
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint8x8x4_t c = vld4_u8((const u8 *)(src + i));
+		vst1q_u16(dst + i, PackRGBA4444(c.val[2], c.val[1], c.val[0], c.val[3]));
+	}
+
+	if (numPixels > simdable) {
+		ConvertBGRA8888ToRGBA4444Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+// Widens to 8 bits by repeating the top bits, like Convert5To8() etc.
+static inline uint8x8_t Expand5To8(uint16x8_t v) {
+	return vmovn_u16(vorrq_u16(vshlq_n_u16(v, 3), vshrq_n_u16(v, 2)));
+}
+
+static inline uint8x8_t Expand4To8(uint16x8_t v) {
+	return vmovn_u16(vorrq_u16(vshlq_n_u16(v, 4), v));
+}
+
+void ConvertRGBA565ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels) {
+	const uint16x8_t mask5 = vdupq_n_u16(0x001F);
+	const uint16x8_t mask6 = vdupq_n_u16(0x003F);
+
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint16x8_t c = vld1q_u16(src + i);
+		const uint16x8_t g = vandq_u16(vshrq_n_u16(c, 5), mask6);
+
+		uint8x8x4_t res;
+		res.val[0] = Expand5To8(vandq_u16(c, mask5));
+		res.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4)));
+		res.val[2] = Expand5To8(vshrq_n_u16(c, 11));
+		res.val[3] = vdup_n_u8(0xFF);
+		vst4_u8((u8 *)(dst + i), res);
+	}
+
+	if (numPixels > simdable) {
+		ConvertRGBA565ToRGBA8888Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertRGBA5551ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels) {
+	const uint16x8_t mask5 = vdupq_n_u16(0x001F);
+
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint16x8_t c = vld1q_u16(src + i);
+		// Sign extend the alpha bit to get 0 or 0xFFFF.
+		const uint16x8_t a = vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(c), 15));
+
+		uint8x8x4_t res;
+		res.val[0] = Expand5To8(vandq_u16(c, mask5));
+		res.val[1] = Expand5To8(vandq_u16(vshrq_n_u16(c, 5), mask5));
+		res.val[2] = Expand5To8(vandq_u16(vshrq_n_u16(c, 10), mask5));
+		res.val[3] = vmovn_u16(a);
+		vst4_u8((u8 *)(dst + i), res);
+	}
+
+	if (numPixels > simdable) {
+		ConvertRGBA5551ToRGBA8888Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
+void ConvertRGBA4444ToRGBA8888NEON(u32 *dst, const u16 *src, u32 numPixels) {
+	const uint16x8_t mask4 = vdupq_n_u16(0x000F);
+
+	const u32 simdable = (numPixels / 8) * 8;
+	for (u32 i = 0; i < simdable; i += 8) {
+		const uint16x8_t c = vld1q_u16(src + i);
+
+		uint8x8x4_t res;
+		res.val[0] = Expand4To8(vandq_u16(c, mask4));
+		res.val[1] = Expand4To8(vandq_u16(vshrq_n_u16(c, 4), mask4));
+		res.val[2] = Expand4To8(vandq_u16(vshrq_n_u16(c, 8), mask4));
+		res.val[3] = Expand4To8(vshrq_n_u16(c, 12));
+		vst4_u8((u8 *)(dst + i), res);
+	}
+
+	if (numPixels > simdable) {
+		ConvertRGBA4444ToRGBA8888Basic(dst + simdable, src + simdable, numPixels - simdable);
+	}
+}
+
 #endif // PPSSPP_ARCH(ARM_NEON)
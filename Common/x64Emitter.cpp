@@ -1419,17 +1419,31 @@ static int GetVEXpp(u8 opPrefix)
 }
 
 void XEmitter::WriteAVXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes)
+{
+	WriteAVXOp(128, opPrefix, op, regOp1, regOp2, arg, extrabytes);
+}
+
+void XEmitter::WriteAVXOp(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes)
 {
 	if (!cpu_info.bAVX)
 		PanicAlert("Trying to use AVX on a system that doesn't support it. Bad programmer.");
+	if (bits != 128 && bits != 256)
+		PanicAlert("AVX instructions only support 128-bit and 256-bit vectors!");
 	int mmmmm = GetVEXmmmmm(op);
 	int pp = GetVEXpp(opPrefix);
-	// FIXME: we currently don't support 256-bit instructions, and "size" is not the vector size here
-	arg.WriteVex(this, regOp1, regOp2, 0, pp, mmmmm);
+	arg.WriteVex(this, regOp1, regOp2, bits == 256 ? 1 : 0, pp, mmmmm);
 	Write8(op & 0xFF);
 	arg.WriteRest(this, extrabytes, regOp1);
 }
 
+// Integer ops only got 256-bit forms with AVX2.
+void XEmitter::WriteAVX2Op(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes)
+{
+	if (bits == 256 && !cpu_info.bAVX2)
+		PanicAlert("Trying to use AVX2 on a system that doesn't support it. Bad programmer.");
+	WriteAVXOp(bits, opPrefix, op, regOp1, regOp2, arg, extrabytes);
+}
+
 // Like the above, but more general; covers GPR-based VEX operations, like BMI1/2
 void XEmitter::WriteVEXOp(int size, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes)
 {
@@ -1876,6 +1890,33 @@ void XEmitter::VPANDN(X64Reg regOp1, X64Reg regOp2, OpArg arg)   { WriteAVXOp(0x
 void XEmitter::VPOR(X64Reg regOp1, X64Reg regOp2, OpArg arg)     { WriteAVXOp(0x66, 0xEB, regOp1, regOp2, arg); }
 void XEmitter::VPXOR(X64Reg regOp1, X64Reg regOp2, OpArg arg)    { WriteAVXOp(0x66, 0xEF, regOp1, regOp2, arg); }
 
+void XEmitter::VMOVD_xmm(X64Reg dest, OpArg arg)                  { WriteAVXOp(0x66, 0x6E, dest, arg); }
+void XEmitter::VMOVQ_xmm(X64Reg dest, OpArg arg)                  { WriteAVXOp(0xF3, 0x7E, dest, arg); }
+void XEmitter::VMOVQ_xmm(OpArg arg, X64Reg src)                   { WriteAVXOp(0x66, 0xD6, src, arg); }
+void XEmitter::VMOVHPS(X64Reg regOp1, X64Reg regOp2, OpArg arg)   { WriteAVXOp(0x00, sseMOVHPfromRM, regOp1, regOp2, arg); }
+void XEmitter::VMOVHPS(OpArg arg, X64Reg regOp)                   { WriteAVXOp(0x00, sseMOVHPtoRM, regOp, arg); }
+void XEmitter::VPINSRW(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 subreg) { WriteAVXOp(0x66, 0xC4, regOp1, regOp2, arg, 1); Write8(subreg); }
+void XEmitter::VPINSRD(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 subreg) { WriteAVXOp(0x66, 0x3A22, regOp1, regOp2, arg, 1); Write8(subreg); }
+void XEmitter::VPMINSW(X64Reg regOp1, X64Reg regOp2, OpArg arg)   { WriteAVXOp(0x66, 0xEA, regOp1, regOp2, arg); }
+void XEmitter::VPMAXSW(X64Reg regOp1, X64Reg regOp2, OpArg arg)   { WriteAVXOp(0x66, 0xEE, regOp1, regOp2, arg); }
+
+void XEmitter::VADDPS(int bits, X64Reg regOp1, X64Reg regOp2, OpArg arg) { WriteAVXOp(bits, 0x00, sseADD, regOp1, regOp2, arg); }
+void XEmitter::VMULPS(int bits, X64Reg regOp1, X64Reg regOp2, OpArg arg) { WriteAVXOp(bits, 0x00, sseMUL, regOp1, regOp2, arg); }
+void XEmitter::VCVTDQ2PS(int bits, X64Reg regOp1, OpArg arg)      { WriteAVXOp(bits, 0x00, 0x5B, regOp1, INVALID_REG, arg); }
+void XEmitter::VPMOVZXBD(int bits, X64Reg regOp1, OpArg arg)      { WriteAVX2Op(bits, 0x66, 0x3831, regOp1, INVALID_REG, arg); }
+void XEmitter::VPMOVZXWD(int bits, X64Reg regOp1, OpArg arg)      { WriteAVX2Op(bits, 0x66, 0x3833, regOp1, INVALID_REG, arg); }
+void XEmitter::VINSERTF128(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 subreg) { WriteAVXOp(256, 0x66, 0x3A18, regOp1, regOp2, arg, 1); Write8(subreg); }
+void XEmitter::VEXTRACTF128(OpArg arg, X64Reg regOp1, u8 subreg)  { WriteAVXOp(256, 0x66, 0x3A19, regOp1, INVALID_REG, arg, 1); Write8(subreg); }
+
+void XEmitter::VZEROUPPER()
+{
+	if (!cpu_info.bAVX)
+		PanicAlert("Trying to use AVX on a system that doesn't support it. Bad programmer.");
+	Write8(0xC5);
+	Write8(0xF8);
+	Write8(0x77);
+}
+
 void XEmitter::VFMADD132PS(X64Reg regOp1, X64Reg regOp2, OpArg arg)    { WriteAVXOp(0x66, 0x3898, regOp1, regOp2, arg); }
 void XEmitter::VFMADD213PS(X64Reg regOp1, X64Reg regOp2, OpArg arg)    { WriteAVXOp(0x66, 0x38A8, regOp1, regOp2, arg); }
 void XEmitter::VFMADD231PS(X64Reg regOp1, X64Reg regOp2, OpArg arg)    { WriteAVXOp(0x66, 0x38B8, regOp1, regOp2, arg); }
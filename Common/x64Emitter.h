@@ -352,6 +352,8 @@ class XEmitter
 	void WriteSSE41Op(u8 opPrefix, u16 op, X64Reg regOp, OpArg arg, int extrabytes = 0);
 	void WriteAVXOp(u8 opPrefix, u16 op, X64Reg regOp, OpArg arg, int extrabytes = 0);
 	void WriteAVXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes = 0);
+	void WriteAVXOp(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes = 0);
+	void WriteAVX2Op(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes = 0);
 	void WriteVEXOp(int size, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes = 0);
 	void WriteBMI1Op(int size, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes = 0);
 	void WriteBMI2Op(int size, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, OpArg arg, int extrabytes = 0);
@@ -915,6 +917,27 @@ class XEmitter
 	void VPOR(X64Reg regOp1, X64Reg regOp2, OpArg arg);
 	void VPXOR(X64Reg regOp1, X64Reg regOp2, OpArg arg);
 
+	// VEX encoded moves, to avoid SSE/AVX transition penalties while the upper halves are dirty.
+	void VMOVD_xmm(X64Reg dest, OpArg arg);
+	void VMOVQ_xmm(X64Reg dest, OpArg arg);
+	void VMOVQ_xmm(OpArg arg, X64Reg src);
+	void VMOVHPS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VMOVHPS(OpArg arg, X64Reg regOp);
+	void VPINSRW(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 subreg);
+	void VPINSRD(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 subreg);
+	void VPMINSW(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VPMAXSW(X64Reg regOp1, X64Reg regOp2, OpArg arg);
+
+	// 256-bit AVX / AVX2.  bits is the vector size, 128 or 256.
+	void VADDPS(int bits, X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VMULPS(int bits, X64Reg regOp1, X64Reg regOp2, OpArg arg);
+	void VCVTDQ2PS(int bits, X64Reg regOp1, OpArg arg);
+	void VPMOVZXBD(int bits, X64Reg regOp1, OpArg arg);
+	void VPMOVZXWD(int bits, X64Reg regOp1, OpArg arg);
+	void VINSERTF128(X64Reg regOp1, X64Reg regOp2, OpArg arg, u8 subreg);
+	void VEXTRACTF128(OpArg arg, X64Reg regOp1, u8 subreg);
+	void VZEROUPPER();
+
 	// FMA3
 	void VFMADD132PS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
 	void VFMADD213PS(X64Reg regOp1, X64Reg regOp2, OpArg arg);
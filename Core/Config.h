@@ -96,6 +96,7 @@ struct Config {
 
 	bool bSeparateSASThread;
 	bool bSeparateIOThread;
+	bool bSeparateGEThread;
 	int iIOTimingMethod;
 	int iLockedCPUSpeed;
 	bool bAutoSaveSymbolMap;
@@ -129,6 +130,7 @@ struct Config {
 	std::string sD3D11Device;
 #endif
 	bool bSoftwareRendering;
+	bool bSoftwareTextureCache;  // keep decoded textures around for the software renderer
 	bool bHardwareTransform; // only used in the GLES backend
 	bool bSoftwareSkinning;  // may speed up some games
 
@@ -16,8 +16,11 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstring>
+#include <thread>
 
 #include "base/stringutil.h"
+#include "thread/threadutil.h"
 #include "Common/Common.h"
 #include "Core/FileLoaders/HTTPFileLoader.h"
 
@@ -27,34 +30,32 @@ HTTPFileLoader::HTTPFileLoader(const std::string &filename)
 
 void HTTPFileLoader::Prepare() {
 	std::call_once(preparedFlag_, [this](){
-		if (!client_.Resolve(url_.Host().c_str(), url_.Port())) {
-			// TODO: Should probably set some flag?
-			return;
-		}
-
-		Connect();
-		if (!connected_) {
+		cancelConnect_ = false;
+		PooledClient *conn = AcquireClient();
+		if (!Connect(conn)) {
+			ReleaseClient(conn, false);
 			return;
 		}
 
-		int err = client_.SendRequest("HEAD", url_.Resource().c_str());
+		int err = conn->client.SendRequest("HEAD", url_.Resource().c_str());
 		if (err < 0) {
-			Disconnect();
+			ReleaseClient(conn, false);
 			return;
 		}
 
 		Buffer readbuf;
 		std::vector<std::string> responseHeaders;
-		int code = client_.ReadResponseHeaders(&readbuf, responseHeaders);
+		int code = conn->client.ReadResponseHeaders(&readbuf, responseHeaders);
 		if (code != 200) {
 			// Leave size at 0, invalid.
 			ERROR_LOG(LOADER, "HTTP request failed, got %03d for %s", code, filename_.c_str());
-			Disconnect();
+			ReleaseClient(conn, false);
 			return;
 		}
 
 		// TODO: Expire cache via ETag, etc.
 		bool acceptsRange = false;
+		bool keepAlive = true;
 		for (std::string header : responseHeaders) {
 			if (startsWithNoCase(header, "Content-Length:")) {
 				size_t size_pos = header.find_first_of(' ');
@@ -73,10 +74,15 @@ void HTTPFileLoader::Prepare() {
 					acceptsRange = true;
 				}
 			}
+			if (startsWithNoCase(header, "Connection:")) {
+				std::string lowerHeader = header;
+				std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
+				keepAlive = lowerHeader.find("close") == lowerHeader.npos;
+			}
 		}
 
-		// TODO: Keepalive instead.
-		Disconnect();
+		// HEAD has no entity, so the connection can be reused right away.
+		ReleaseClient(conn, keepAlive);
 
 		if (!acceptsRange) {
 			WARN_LOG(LOADER, "HTTP server did not advertise support for range requests.");
@@ -90,7 +96,19 @@ void HTTPFileLoader::Prepare() {
 }
 
 HTTPFileLoader::~HTTPFileLoader() {
-	Disconnect();
+	{
+		std::lock_guard<std::mutex> guard(rangeMutex_);
+		rangeWorkersExit_ = true;
+		rangeCond_.notify_all();
+	}
+	for (auto &thread : rangeWorkers_) {
+		thread.join();
+	}
+
+	std::lock_guard<std::mutex> guard(poolMutex_);
+	for (auto &conn : clients_) {
+		Disconnect(conn.get());
+	}
 }
 
 bool HTTPFileLoader::Exists() {
@@ -117,49 +135,157 @@ std::string HTTPFileLoader::Path() const {
 }
 
 size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags) {
+	cancelConnect_ = false;
 	Prepare();
-	std::lock_guard<std::mutex> guard(readAtMutex_);
 
-	s64 absoluteEnd = std::min(absolutePos + (s64)bytes, filesize_);
 	if (absolutePos >= filesize_ || bytes == 0) {
 		// Read outside of the file or no read at all, just fail immediately.
 		return 0;
 	}
+	bytes = (size_t)std::min((s64)bytes, filesize_ - absolutePos);
 
-	Connect();
-	if (!connected_) {
+	if (bytes >= PARALLEL_MIN_SIZE) {
+		return FetchRangeParallel(absolutePos, bytes, data);
+	}
+	if (bytes >= COALESCE_SIZE || (flags & Flags::HINT_UNCACHED) != 0) {
+		return FetchRange(absolutePos, bytes, data);
+	}
+
+	std::lock_guard<std::mutex> guard(coalesceMutex_);
+	size_t readBytes = ReadFromCoalesced(absolutePos, bytes, data);
+	if (readBytes == bytes) {
+		return readBytes;
+	}
+
+	// Small reads tend to be followed by adjacent ones, so grab a larger window in one request.
+	size_t windowSize = (size_t)std::min((s64)COALESCE_SIZE, filesize_ - absolutePos);
+	coalesced_.resize(windowSize);
+	coalescedPos_ = absolutePos;
+	coalesced_.resize(FetchRange(absolutePos, windowSize, &coalesced_[0]));
+	return ReadFromCoalesced(absolutePos, bytes, data);
+}
+
+size_t HTTPFileLoader::ReadFromCoalesced(s64 absolutePos, size_t bytes, void *data) {
+	s64 coalescedEnd = coalescedPos_ + (s64)coalesced_.size();
+	if (absolutePos < coalescedPos_ || absolutePos + (s64)bytes > coalescedEnd) {
 		return 0;
 	}
+	memcpy(data, &coalesced_[(size_t)(absolutePos - coalescedPos_)], bytes);
+	return bytes;
+}
+
+size_t HTTPFileLoader::FetchRangeParallel(s64 absolutePos, size_t bytes, void *data) {
+	size_t chunks = std::min((size_t)MAX_CONNECTIONS, (bytes + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE);
+	size_t chunkSize = (bytes + chunks - 1) / chunks;
+
+	std::vector<size_t> results(chunks, 0);
+	int pending = (int)chunks - 1;
+
+	// The first chunk runs on this thread, the rest in parallel on the workers' connections.
+	{
+		std::lock_guard<std::mutex> guard(rangeMutex_);
+		while (rangeWorkers_.size() < MAX_CONNECTIONS - 1) {
+			rangeWorkers_.push_back(std::thread(&HTTPFileLoader::RangeWorkerFunc, this));
+		}
+		for (size_t i = 1; i < chunks; ++i) {
+			size_t offset = i * chunkSize;
+			rangeTasks_.push_back({ absolutePos + (s64)offset, std::min(chunkSize, bytes - offset), (u8 *)data + offset, &results[i], &pending });
+		}
+		rangeCond_.notify_all();
+	}
+	results[0] = FetchRange(absolutePos, std::min(chunkSize, bytes), data);
+
+	{
+		std::unique_lock<std::mutex> guard(rangeMutex_);
+		while (pending > 0) {
+			rangeDoneCond_.wait(guard);
+		}
+	}
+
+	// Only report the data up to the first short read, like a single request would.
+	size_t readBytes = 0;
+	for (size_t i = 0; i < chunks; ++i) {
+		readBytes += results[i];
+		if (results[i] != std::min(chunkSize, bytes - i * chunkSize)) {
+			break;
+		}
+	}
+	return readBytes;
+}
+
+void HTTPFileLoader::RangeWorkerFunc() {
+	setCurrentThreadName("HTTPRangeRead");
+
+	std::unique_lock<std::mutex> guard(rangeMutex_);
+	while (true) {
+		while (rangeTasks_.empty() && !rangeWorkersExit_) {
+			rangeCond_.wait(guard);
+		}
+		if (rangeTasks_.empty()) {
+			break;
+		}
+
+		RangeTask task = rangeTasks_.front();
+		rangeTasks_.pop_front();
+		guard.unlock();
+		size_t result = FetchRange(task.absolutePos, task.bytes, task.data);
+		guard.lock();
+
+		*task.result = result;
+		--*task.pending;
+		rangeDoneCond_.notify_all();
+	}
+}
+
+size_t HTTPFileLoader::FetchRange(s64 absolutePos, size_t bytes, void *data) {
+	s64 absoluteEnd = absolutePos + (s64)bytes;
 
 	char requestHeaders[4096];
 	// Note that the Range header is *inclusive*.
 	snprintf(requestHeaders, sizeof(requestHeaders),
 		"Range: bytes=%lld-%lld\r\n", absolutePos, absoluteEnd - 1);
 
-	int err = client_.SendRequest("GET", url_.Resource().c_str(), requestHeaders, nullptr);
-	if (err < 0) {
-		Disconnect();
-		return 0;
-	}
-
+	PooledClient *conn = AcquireClient();
 	Buffer readbuf;
 	std::vector<std::string> responseHeaders;
-	int code = client_.ReadResponseHeaders(&readbuf, responseHeaders);
+	int code = -1;
+	// A kept-alive connection may have been closed by the server meanwhile, so retry once.
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		bool reused = conn->connected;
+		if (!Connect(conn)) {
+			ReleaseClient(conn, false);
+			return 0;
+		}
+
+		readbuf.clear();
+		responseHeaders.clear();
+		int err = conn->client.SendRequest("GET", url_.Resource().c_str(), requestHeaders, nullptr);
+		if (err >= 0) {
+			code = conn->client.ReadResponseHeaders(&readbuf, responseHeaders);
+		}
+		if ((err < 0 || code < 0) && reused) {
+			Disconnect(conn);
+			continue;
+		}
+		break;
+	}
+
 	if (code != 206) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with range, received code=%03d", code);
-		Disconnect();
+		ReleaseClient(conn, false);
 		return 0;
 	}
 
 	// TODO: Expire cache via ETag, etc.
 	// We don't support multipart/byteranges responses.
 	bool supportedResponse = false;
+	bool keepAlive = false;
 	for (std::string header : responseHeaders) {
+		std::string lowerHeader = header;
+		std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
 		if (startsWithNoCase(header, "Content-Range:")) {
 			// TODO: More correctness.  Whitespace can be missing or different.
 			s64 first = -1, last = -1, total = -1;
-			std::string lowerHeader = header;
-			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
 			if (sscanf(lowerHeader.c_str(), "content-range: bytes %lld-%lld/%lld", &first, &last, &total) >= 2) {
 				if (first == absolutePos && last == absoluteEnd - 1) {
 					supportedResponse = true;
@@ -170,34 +296,87 @@ size_t HTTPFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags f
 				ERROR_LOG(LOADER, "Unexpected HTTP range response: %s", header.c_str());
 			}
 		}
+		// Without a length, the entity ends when the server closes the connection.
+		if (startsWithNoCase(header, "Content-Length:")) {
+			keepAlive = true;
+		}
+	}
+	for (std::string header : responseHeaders) {
+		if (startsWithNoCase(header, "Connection:")) {
+			std::string lowerHeader = header;
+			std::transform(lowerHeader.begin(), lowerHeader.end(), lowerHeader.begin(), tolower);
+			if (lowerHeader.find("close") != lowerHeader.npos) {
+				keepAlive = false;
+			}
+		}
 	}
 
 	// TODO: Would be nice to read directly.
 	Buffer output;
-	int res = client_.ReadResponseEntity(&readbuf, responseHeaders, &output);
+	int res = conn->client.ReadResponseEntity(&readbuf, responseHeaders, &output);
 	if (res != 0) {
 		ERROR_LOG(LOADER, "Unable to read HTTP response entity: %d", res);
 		// Let's take anything we got anyway.  Not worse than returning nothing?
+		keepAlive = false;
 	}
 
-	// TODO: Keepalive instead.
-	Disconnect();
+	ReleaseClient(conn, keepAlive);
 
 	if (!supportedResponse) {
 		ERROR_LOG(LOADER, "HTTP server did not respond with the range we wanted.");
 		return 0;
 	}
 
-	size_t readBytes = output.size();
+	size_t readBytes = std::min(output.size(), bytes);
 	output.Take(readBytes, (char *)data);
-	filepos_ = absolutePos + readBytes;
 	return readBytes;
 }
 
-void HTTPFileLoader::Connect() {
-	if (!connected_) {
-		cancelConnect_ = false;
+HTTPFileLoader::PooledClient *HTTPFileLoader::AcquireClient() {
+	std::unique_lock<std::mutex> guard(poolMutex_);
+	while (idleClients_.empty() && clients_.size() >= MAX_CONNECTIONS) {
+		poolCond_.wait(guard);
+	}
+
+	if (!idleClients_.empty()) {
+		PooledClient *conn = idleClients_.back();
+		idleClients_.pop_back();
+		return conn;
+	}
+
+	clients_.push_back(std::unique_ptr<PooledClient>(new PooledClient()));
+	PooledClient *conn = clients_.back().get();
+	guard.unlock();
+
+	conn->client.SetKeepAlive(true);
+	if (!conn->client.Resolve(url_.Host().c_str(), url_.Port())) {
+		// Connect() will just fail on this one.
+		ERROR_LOG(LOADER, "Unable to resolve host for %s", filename_.c_str());
+	}
+	return conn;
+}
+
+void HTTPFileLoader::ReleaseClient(PooledClient *conn, bool keepConnected) {
+	if (!keepConnected) {
+		Disconnect(conn);
+	}
+
+	std::lock_guard<std::mutex> guard(poolMutex_);
+	idleClients_.push_back(conn);
+	poolCond_.notify_one();
+}
+
+bool HTTPFileLoader::Connect(PooledClient *conn) {
+	if (!conn->connected) {
 		// Latency is important here, so reduce the timeout.
-		connected_ = client_.Connect(3, 10.0, &cancelConnect_);
+		conn->connected = conn->client.Connect(3, 10.0, &cancelConnect_);
+	}
+	return conn->connected;
+}
+
+void HTTPFileLoader::Disconnect(PooledClient *conn) {
+	if (conn->connected) {
+		conn->client.Disconnect();
 	}
+	conn->connected = false;
 }
@@ -17,7 +17,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "net/http_client.h"
 #include "net/resolve.h"
@@ -49,25 +55,66 @@ class HTTPFileLoader : public FileLoader {
 	}
 
 private:
-	void Prepare();
+	// One connection in the pool.  Kept alive between requests when the server allows it.
+	struct PooledClient {
+		http::Client client;
+		bool connected = false;
+	};
 
-	void Connect();
+	void Prepare();
 
-	void Disconnect() {
-		if (connected_) {
-			client_.Disconnect();
-		}
-		connected_ = false;
-	}
+	PooledClient *AcquireClient();
+	void ReleaseClient(PooledClient *conn, bool keepConnected);
+	bool Connect(PooledClient *conn);
+	void Disconnect(PooledClient *conn);
+
+	// Performs a single range request on a pooled connection.
+	size_t FetchRange(s64 absolutePos, size_t bytes, void *data);
+	// Splits a large read into concurrent range requests.
+	size_t FetchRangeParallel(s64 absolutePos, size_t bytes, void *data);
+	void RangeWorkerFunc();
+	size_t ReadFromCoalesced(s64 absolutePos, size_t bytes, void *data);
+
+	enum {
+		// Small reads are rounded up to this, and the rest is kept for adjacent reads.
+		COALESCE_SIZE = 65536,
+		// Reads at least this large are split across several connections.
+		PARALLEL_MIN_SIZE = 262144,
+		PARALLEL_CHUNK_SIZE = 131072,
+		MAX_CONNECTIONS = 4,
+	};
 
 	s64 filesize_ = 0;
-	s64 filepos_ = 0;
 	Url url_;
-	http::Client client_;
 	std::string filename_;
-	bool connected_ = false;
-	bool cancelConnect_ = false;
+	// Cleared at the start of each read, so a cancel applies to all of its connections.
+	std::atomic<bool> cancelConnect_{ false };
 
 	std::once_flag preparedFlag_;
-	std::mutex readAtMutex_;
+
+	std::vector<std::unique_ptr<PooledClient>> clients_;
+	std::vector<PooledClient *> idleClients_;
+	std::mutex poolMutex_;
+	std::condition_variable poolCond_;
+
+	// A chunk of a parallel read, run by one of the range workers.
+	struct RangeTask {
+		s64 absolutePos;
+		size_t bytes;
+		void *data;
+		size_t *result;
+		int *pending;
+	};
+
+	// One worker per extra pooled connection, started on the first parallel read.
+	std::vector<std::thread> rangeWorkers_;
+	std::deque<RangeTask> rangeTasks_;
+	bool rangeWorkersExit_ = false;
+	std::mutex rangeMutex_;
+	std::condition_variable rangeCond_;
+	std::condition_variable rangeDoneCond_;
+
+	std::vector<u8> coalesced_;
+	s64 coalescedPos_ = 0;
+	std::mutex coalesceMutex_;
 };
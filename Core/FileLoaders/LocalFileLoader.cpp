@@ -26,6 +26,13 @@
 #include "Common/CommonWindows.h"
 #else
 #include <fcntl.h>
+#include <sys/mman.h>
+#if PPSSPP_PLATFORM(LINUX)
+#include <sys/vfs.h>
+#elif PPSSPP_PLATFORM(MAC) || PPSSPP_PLATFORM(IOS)
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
 #endif
 
 LocalFileLoader::LocalFileLoader(const std::string &filename)
@@ -47,6 +54,8 @@ LocalFileLoader::LocalFileLoader(const std::string &filename)
 	lseek(fd_, 0, SEEK_SET);
 #endif
 
+	MapFile();
+
 #else // !_WIN32
 
 	const DWORD access = GENERIC_READ, share = FILE_SHARE_READ, mode = OPEN_EXISTING, flags = FILE_ATTRIBUTE_NORMAL;
@@ -66,11 +75,14 @@ LocalFileLoader::LocalFileLoader(const std::string &filename)
 	filesize_ = end_offset.QuadPart;
 	SetFilePointerEx(handle_, zero, nullptr, FILE_BEGIN);
 
+	MapFile();
+
 #endif // !_WIN32
 
 }
 
 LocalFileLoader::~LocalFileLoader() {
+	UnmapFile();
 #ifndef _WIN32
 	if (fd_ != -1) {
 		close(fd_);
@@ -141,3 +153,127 @@ size_t LocalFileLoader::ReadAt(s64 absolutePos, size_t bytes, size_t count, void
 	return result == TRUE ? (size_t)read / bytes : -1;
 #endif
 }
+
+// A mapped file that shrinks or goes away faults on access instead of giving a short read.
+// That can't happen with the file on a fixed local disk, short of deleting the ISO mid-game.
+bool LocalFileLoader::IsOnFixedDisk() {
+#if PPSSPP_PLATFORM(LINUX)
+	struct statfs fs;
+	if (fstatfs(fd_, &fs) != 0) {
+		return false;
+	}
+	// Network, FUSE, and removable media (FAT, exFAT, sdcardfs...) aren't listed.
+	switch ((u32)fs.f_type) {
+	case 0xEF53:      // ext2/3/4
+	case 0x9123683E:  // btrfs
+	case 0x58465342:  // xfs
+	case 0xF2F52010:  // f2fs
+	case 0x01021994:  // tmpfs
+		return true;
+	default:
+		return false;
+	}
+#elif PPSSPP_PLATFORM(MAC) || PPSSPP_PLATFORM(IOS)
+	struct statfs fs;
+	if (fstatfs(fd_, &fs) != 0) {
+		return false;
+	}
+#ifdef MNT_REMOVABLE
+	if (fs.f_flags & MNT_REMOVABLE) {
+		return false;
+	}
+#endif
+	return (fs.f_flags & MNT_LOCAL) != 0;
+#elif defined(_WIN32) && !PPSSPP_PLATFORM(UWP)
+	wchar_t volume[MAX_PATH];
+	if (!GetVolumePathNameW(ConvertUTF8ToWString(filename_).c_str(), volume, MAX_PATH)) {
+		return false;
+	}
+	return GetDriveTypeW(volume) == DRIVE_FIXED;
+#else
+	return false;
+#endif
+}
+
+void LocalFileLoader::MapFile() {
+	// Mapping a whole ISO needs a lot of address space, so only do it on 64-bit.
+#if PPSSPP_ARCH(64BIT)
+	if (filesize_ == 0 || IsDirectory()) {
+		return;
+	}
+	if (!IsOnFixedDisk()) {
+		VERBOSE_LOG(LOADER, "Not mapping %s, not on a fixed local disk", filename_.c_str());
+		return;
+	}
+
+#ifndef _WIN32
+	void *ptr = mmap(nullptr, (size_t)filesize_, PROT_READ, MAP_SHARED, fd_, 0);
+	if (ptr == MAP_FAILED) {
+		WARN_LOG(LOADER, "Unable to map %s, falling back to reads", filename_.c_str());
+		return;
+	}
+	mapped_ = (u8 *)ptr;
+#elif !PPSSPP_PLATFORM(UWP)
+	mappingHandle_ = CreateFileMapping(handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle_ == nullptr) {
+		WARN_LOG(LOADER, "Unable to map %s, falling back to reads", filename_.c_str());
+		return;
+	}
+	mapped_ = (u8 *)MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0);
+	if (mapped_ == nullptr) {
+		CloseHandle(mappingHandle_);
+		mappingHandle_ = nullptr;
+	}
+#endif
+#endif
+}
+
+void LocalFileLoader::UnmapFile() {
+#ifndef _WIN32
+	if (mapped_) {
+		munmap(mapped_, (size_t)filesize_);
+	}
+#else
+	if (mapped_) {
+		UnmapViewOfFile(mapped_);
+	}
+	if (mappingHandle_) {
+		CloseHandle(mappingHandle_);
+		mappingHandle_ = nullptr;
+	}
+#endif
+	mapped_ = nullptr;
+}
+
+const u8 *LocalFileLoader::DataPointer(s64 absolutePos, size_t bytes) {
+	if (!mapped_ || absolutePos < 0 || absolutePos + (s64)bytes > (s64)filesize_) {
+		return nullptr;
+	}
+	return mapped_ + absolutePos;
+}
+
+void LocalFileLoader::SetAccessHint(AccessHint hint) {
+#ifndef _WIN32
+	int advice = MADV_NORMAL;
+	switch (hint) {
+	case AccessHint::SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+	case AccessHint::RANDOM: advice = MADV_RANDOM; break;
+	default: break;
+	}
+	if (mapped_) {
+		madvise(mapped_, (size_t)filesize_, advice);
+	}
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+	// Also affects readahead for plain reads.
+	int fadvice = POSIX_FADV_NORMAL;
+	if (hint == AccessHint::SEQUENTIAL)
+		fadvice = POSIX_FADV_SEQUENTIAL;
+	else if (hint == AccessHint::RANDOM)
+		fadvice = POSIX_FADV_RANDOM;
+	if (fd_ != -1) {
+		posix_fadvise(fd_, 0, 0, fadvice);
+	}
+#endif
+#endif
+}
@@ -35,12 +35,22 @@ class LocalFileLoader : public FileLoader {
 	virtual std::string Path() const override;
 	virtual size_t ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data, Flags flags = Flags::NONE) override;
 
+	const u8 *DataPointer(s64 absolutePos, size_t bytes) override;
+	void SetAccessHint(AccessHint hint) override;
+
 private:
+	bool IsOnFixedDisk();
+	void MapFile();
+	void UnmapFile();
+
 #ifndef _WIN32
 	int fd_;
 #else
 	HANDLE handle_;
+	HANDLE mappingHandle_ = nullptr;
 #endif
+	// Read-only view of the whole file, shared through the page cache.  Null if not mapped.
+	u8 *mapped_ = nullptr;
 	u64 filesize_;
 	std::string filename_;
 	std::mutex readLock_;
@@ -24,8 +24,21 @@
 #include "thread/threadutil.h"
 #include "Core/FileLoaders/RamCachingFileLoader.h"
 
+#include "Common/FileUtil.h"
 #include "Common/Log.h"
 
+static const char *TRACEFILE_MAGIC = "ppssppBT";
+static const u32 TRACEFILE_VERSION = 1;
+
+struct TraceFileHeader {
+	char magic[8];
+	u32 version;
+	u32 blockSize;
+	s64 filesize;
+	u32 count;
+	u32 reserved;
+};
+
 // Takes ownership of backend.
 RamCachingFileLoader::RamCachingFileLoader(FileLoader *backend)
 	: backend_(backend) {
@@ -74,6 +87,9 @@ std::string RamCachingFileLoader::Path() const {
 
 size_t RamCachingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags) {
 	size_t readSize = 0;
+	if (traceUntil_ != 0.0) {
+		TraceAccess(absolutePos, bytes);
+	}
 	if (cache_ == nullptr || (flags & Flags::HINT_UNCACHED) != 0) {
 		readSize = backend_->ReadAt(absolutePos, bytes, data, flags);
 	} else {
@@ -104,6 +120,8 @@ void RamCachingFileLoader::InitCache() {
 	}
 	aheadRemaining_ = blockCount;
 	blocks_.resize(blockCount);
+	// We'll be streaming the whole file in.
+	backend_->SetAccessHint(AccessHint::SEQUENTIAL);
 }
 
 void RamCachingFileLoader::ShutdownCache() {
@@ -257,6 +275,15 @@ void RamCachingFileLoader::StartReadAhead(s64 pos) {
 u32 RamCachingFileLoader::NextAheadBlock() {
 	std::lock_guard<std::mutex> guard(blocksMutex_);
 
+	// Predicted blocks go first, they'll probably be needed soon.
+	while (!prefetch_.empty()) {
+		u32 block = prefetch_.back();
+		prefetch_.pop_back();
+		if (block < blocks_.size() && blocks_[block] == 0) {
+			return block;
+		}
+	}
+
 	// If we had an aheadPos_ set, start reading from there and go forward.
 	u32 startFrom = (u32)(aheadPos_ >> BLOCK_SHIFT);
 	// But next time, start from the beginning again.
@@ -274,3 +301,105 @@ u32 RamCachingFileLoader::NextAheadBlock() {
 bool RamCachingFileLoader::IsRemote() {
 	return backend_->IsRemote();
 }
+
+void RamCachingFileLoader::StartAccessTrace(double seconds) {
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+	trace_.clear();
+	traced_.clear();
+	traced_.resize(blocks_.size());
+	traceUntil_ = time_now_d() + seconds;
+}
+
+void RamCachingFileLoader::TraceAccess(s64 pos, size_t bytes) {
+	if (bytes == 0 || pos >= filesize_) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(blocksMutex_);
+	if (traceUntil_ == 0.0) {
+		return;
+	}
+	if (time_now_d() > traceUntil_) {
+		traceUntil_ = 0.0;
+		return;
+	}
+
+	u32 startBlock = (u32)(pos >> BLOCK_SHIFT);
+	u32 endBlock = (u32)(std::min(pos + (s64)bytes - 1, filesize_ - 1) >> BLOCK_SHIFT);
+	for (u32 i = startBlock; i <= endBlock && i < traced_.size(); ++i) {
+		if (!traced_[i]) {
+			traced_[i] = true;
+			trace_.push_back(i);
+		}
+	}
+}
+
+void RamCachingFileLoader::Prefetch(const std::vector<u32> &blocks) {
+	if (cache_ == nullptr) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(blocksMutex_);
+		prefetch_.assign(blocks.rbegin(), blocks.rend());
+	}
+	StartReadAhead(0);
+}
+
+bool RamCachingFileLoader::SaveAccessTrace(const std::string &filename) {
+	std::vector<u32> trace;
+	{
+		std::lock_guard<std::mutex> guard(blocksMutex_);
+		trace = trace_;
+	}
+	if (trace.empty()) {
+		return false;
+	}
+
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f) {
+		return false;
+	}
+
+	TraceFileHeader header{};
+	memcpy(header.magic, TRACEFILE_MAGIC, sizeof(header.magic));
+	header.version = TRACEFILE_VERSION;
+	header.blockSize = BLOCK_SIZE;
+	header.filesize = filesize_;
+	header.count = (u32)trace.size();
+
+	bool success = fwrite(&header, sizeof(header), 1, f) == 1;
+	success = success && fwrite(&trace[0], sizeof(u32), trace.size(), f) == trace.size();
+	fclose(f);
+	return success;
+}
+
+bool RamCachingFileLoader::LoadAccessTrace(const std::string &filename) {
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f) {
+		return false;
+	}
+
+	TraceFileHeader header;
+	bool valid = fread(&header, sizeof(header), 1, f) == 1;
+	// If the file changed, the trace is probably meaningless.
+	valid = valid && memcmp(header.magic, TRACEFILE_MAGIC, sizeof(header.magic)) == 0;
+	valid = valid && header.version == TRACEFILE_VERSION && header.blockSize == BLOCK_SIZE;
+	valid = valid && header.filesize == filesize_ && header.count <= blocks_.size();
+
+	std::vector<u32> trace;
+	if (valid) {
+		trace.resize(header.count);
+		valid = header.count == 0 || fread(&trace[0], sizeof(u32), header.count, f) == header.count;
+	}
+	fclose(f);
+
+	if (!valid) {
+		WARN_LOG(LOADER, "Ignoring stale or invalid access trace %s", filename.c_str());
+		return false;
+	}
+
+	INFO_LOG(LOADER, "Prefetching %d blocks from previous boot", (int)trace.size());
+	Prefetch(trace);
+	return true;
+}
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <mutex>
 
@@ -42,6 +43,15 @@ class RamCachingFileLoader : public FileLoader {
 
 	void Cancel() override;
 
+	// Records which blocks are read during the next few seconds, in first access order.
+	void StartAccessTrace(double seconds);
+	// Reads these blocks in the background before the usual linear readahead.
+	void Prefetch(const std::vector<u32> &blocks);
+
+	// Persist the recorded trace, or load one and start prefetching it.
+	bool SaveAccessTrace(const std::string &filename);
+	bool LoadAccessTrace(const std::string &filename);
+
 private:
 	void InitCache();
 	void ShutdownCache();
@@ -50,6 +60,7 @@ class RamCachingFileLoader : public FileLoader {
 	void SaveIntoCache(s64 pos, size_t bytes, Flags flags);
 	void StartReadAhead(s64 pos);
 	u32 NextAheadBlock();
+	void TraceAccess(s64 pos, size_t bytes);
 
 	enum {
 		BLOCK_SIZE = 65536,
@@ -70,4 +81,11 @@ class RamCachingFileLoader : public FileLoader {
 	s64 aheadPos_;
 	bool aheadThread_ = false;
 	bool aheadCancel_ = false;
+
+	// Blocks to read ahead first, in reverse order.
+	std::vector<u32> prefetch_;
+	std::vector<u32> trace_;
+	std::vector<bool> traced_;
+	// Checked on every read without the lock, only changed with blocksMutex_ held.
+	std::atomic<double> traceUntil_{ 0.0 };
 };
@@ -89,6 +89,10 @@ bool FileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
 	return true;
 }
 
+const u8 *FileBlockDevice::BlockPointer(u32 blockNumber) {
+	return fileLoader_->DataPointer((u64)blockNumber * (u64)GetBlockSize(), GetBlockSize());
+}
+
 bool FileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 	if (fileLoader_->ReadAt((u64)minBlock * (u64)GetBlockSize(), 2048, count, outPtr) != (size_t)count) {
 		ERROR_LOG(FILESYS, "Could not read %d bytes from block", 2048 * count);
@@ -247,7 +251,13 @@ bool CISOFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached)
 	}
 	else
 	{
-		const u32 readSize = (u32)fileLoader_->ReadAt(compressedReadPos, 1, compressedReadSize, readBuffer, flags);
+		// Inflate straight from the file when it's mapped.
+		const u8 *compressed = fileLoader_->DataPointer(compressedReadPos, compressedReadSize);
+		u32 readSize = (u32)compressedReadSize;
+		if (!compressed) {
+			readSize = (u32)fileLoader_->ReadAt(compressedReadPos, 1, compressedReadSize, readBuffer, flags);
+			compressed = readBuffer;
+		}
 
 		z.zalloc = Z_NULL;
 		z.zfree = Z_NULL;
@@ -260,7 +270,7 @@ bool CISOFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached)
 		z.avail_in = readSize;
 		z.next_out = frameSize == (u32)GetBlockSize() ? outPtr : zlibBuffer;
 		z.avail_out = frameSize;
-		z.next_in = readBuffer;
+		z.next_in = (Bytef *)compressed;
 
 		int status = inflate(&z, Z_FINISH);
 		if (status != Z_STREAM_END) {
@@ -316,6 +326,10 @@ bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 		return false;
 	}
 
+	// When the file is mapped, read the whole range in place.
+	const u64 totalReadStart = (u64)(index[minFrameNumber] & 0x7FFFFFFF) << indexShift;
+	const u8 *mapped = fileLoader_->DataPointer(totalReadStart, (size_t)(totalReadEnd - totalReadStart));
+
 	u64 readBufferStart = 0;
 	u64 readBufferEnd = 0;
 	u32 block = minBlock;
@@ -331,7 +345,10 @@ bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 		const u32 frameBlockOffset = block & ((1 << blockShift) - 1);
 		const u32 frameBlocks = std::min(lastBlock - block + 1, blocksPerFrame - frameBlockOffset);
 
-		if (frameReadEnd > readBufferEnd) {
+		const u8 *rawBuffer;
+		if (mapped) {
+			rawBuffer = mapped + (frameReadPos - totalReadStart);
+		} else if (frameReadEnd > readBufferEnd) {
 			const s64 maxNeeded = totalReadEnd - frameReadPos;
 			const size_t chunkSize = (size_t)std::min(maxNeeded, (s64)std::max(frameReadSize, CSO_READ_BUFFER_SIZE));
 
@@ -342,9 +359,10 @@ bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 
 			readBufferStart = frameReadPos;
 			readBufferEnd = frameReadPos + readSize;
+			rawBuffer = readBuffer;
+		} else {
+			rawBuffer = &readBuffer[frameReadPos - readBufferStart];
 		}
-
-		u8 *rawBuffer = &readBuffer[frameReadPos - readBufferStart];
 		const int plain = idx & 0x80000000;
 		if (plain) {
 			memcpy(outPtr, rawBuffer + frameBlockOffset * GetBlockSize(), frameBlocks * GetBlockSize());
@@ -352,7 +370,7 @@ bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 			z.avail_in = frameReadSize;
 			z.next_out = frameBlocks == blocksPerFrame ? outPtr : zlibBuffer;
 			z.avail_out = frameSize;
-			z.next_in = rawBuffer;
+			z.next_in = (Bytef *)rawBuffer;
 
 			int status = inflate(&z, Z_FINISH);
 			if (status != Z_STREAM_END) {
@@ -43,6 +43,11 @@ class BlockDevice {
 		}
 		return true;
 	}
+	// Returns a pointer to the block's data without copying, if the device is memory mapped.
+	// Otherwise nullptr, and ReadBlock() must be used.
+	virtual const u8 *BlockPointer(u32 blockNumber) {
+		return nullptr;
+	}
 	int GetBlockSize() const { return 2048;}  // forced, it cannot be changed by subclasses
 	virtual u32 GetNumBlocks() = 0;
 
@@ -81,6 +86,7 @@ class FileBlockDevice : public BlockDevice {
 	~FileBlockDevice();
 	bool ReadBlock(int blockNumber, u8 *outPtr, bool uncached = false) override;
 	bool ReadBlocks(u32 minBlock, int count, u8 *outPtr) override;
+	const u8 *BlockPointer(u32 blockNumber) override;
 	u32 GetNumBlocks() override {return (u32)(filesize_ / GetBlockSize());}
 
 private:
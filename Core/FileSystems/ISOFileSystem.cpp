@@ -202,17 +202,21 @@ ISOFileSystem::~ISOFileSystem() {
 
 void ISOFileSystem::ReadDirectory(TreeEntry *root) {
 	for (u32 secnum = root->startsector, endsector = root->startsector + (root->dirsize + 2047) / 2048; secnum < endsector; ++secnum) {
-		u8 theSector[2048];
-		if (!blockDevice->ReadBlock(secnum, theSector)) {
-			blockDevice->NotifyReadError();
-			ERROR_LOG(FILESYS, "Error reading block for directory %s - skipping", root->name.c_str());
-			root->valid = true;  // Prevents re-reading
-			return;
+		u8 sectorBuffer[2048];
+		const u8 *theSector = blockDevice->BlockPointer(secnum);
+		if (!theSector) {
+			if (!blockDevice->ReadBlock(secnum, sectorBuffer)) {
+				blockDevice->NotifyReadError();
+				ERROR_LOG(FILESYS, "Error reading block for directory %s - skipping", root->name.c_str());
+				root->valid = true;  // Prevents re-reading
+				return;
+			}
+			theSector = sectorBuffer;
 		}
 		lastReadBlock_ = secnum;  // Hm, this could affect timing... but lazy loading is probably more realistic.
 
 		for (int offset = 0; offset < 2048; ) {
-			DirectoryEntry &dir = *(DirectoryEntry *)&theSector[offset];
+			const DirectoryEntry &dir = *(const DirectoryEntry *)&theSector[offset];
 			u8 sz = theSector[offset];
 
 			// Nothing left in this sector.  There might be more in the next one.
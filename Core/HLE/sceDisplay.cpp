@@ -669,6 +669,9 @@ void hleEnterVblank(u64 userdata, int cyclesLate) {
 	numVBlanks++;
 	numVBlanksSinceFlip++;
 
+	// Anything drawn this frame has to be done before it's shown.
+	gpu->SyncThread();
+
 	// TODO: Should this be done here or in hleLeaveVblank?
 	if (framebufIsLatched) {
 		DEBUG_LOG(SCEDISPLAY, "Setting latched framebuffer %08x (prev: %08x)", latchedFramebuf.topaddr, framebuf.topaddr);
@@ -763,6 +766,7 @@ void __DisplayFlip(int cyclesLate) {
 }
 
 void hleAfterFlip(u64 userdata, int cyclesLate) {
+	gpu->SyncThread();
 	gpu->BeginFrame();  // doesn't really matter if begin or end of frame.
 
 	// This seems like as good a time as any to check if the config changed.
@@ -848,6 +852,7 @@ static u32 sceDisplaySetMode(int displayMode, int displayWidth, int displayHeigh
 	}
 
 	if (!hasSetMode) {
+		gpu->SyncThread();
 		gpu->InitClear();
 		hasSetMode = true;
 	}
@@ -869,6 +874,7 @@ void __DisplaySetFramebuf(u32 topaddr, int linesize, int pixelFormat, int sync)
 	if (sync == PSP_DISPLAY_SETBUF_IMMEDIATE) {
 		// Write immediately to the current framebuffer parameters.
 		framebuf = fbstate;
+		gpu->SyncThread();
 		gpu->SetDisplayFramebuffer(framebuf.topaddr, framebuf.stride, framebuf.fmt);
 		// IMMEDIATE means that the buffer is fine. We can just flip immediately.
 		// Doing it in non-buffered though creates problems (black screen) on occasion though
@@ -52,10 +52,22 @@ struct GeInterruptData {
 	u32 cmd;
 };
 
+struct GeQueuedTrigger {
+	bool interrupt;
+	GPUSyncType type;
+	GeInterruptData intrdata;
+	u64 atTicks;
+};
+
 static ThreadSafeList<GeInterruptData> ge_pending_cb;
 static int geSyncEvent;
 static int geInterruptEvent;
 static int geCycleEvent;
+static int geQueuedTriggersEvent;
+
+// Triggers from the GE thread, waiting for the emu thread.
+static std::mutex geQueuedTriggersLock;
+static std::vector<GeQueuedTrigger> geQueuedTriggers;
 
 class GeIntrHandler : public IntrHandler {
 public:
@@ -193,6 +205,10 @@ static void __GeCheckCycles(u64 userdata, int cyclesLate) {
 	// Deprecated
 }
 
+static void __GeExecuteQueuedTriggers(u64 userdata, int cyclesLate) {
+	__GeRunQueuedTriggers();
+}
+
 void __GeInit() {
 	memset(&ge_used_callbacks, 0, sizeof(ge_used_callbacks));
 	memset(&ge_callback_data, 0, sizeof(ge_callback_data));
@@ -204,6 +220,10 @@ void __GeInit() {
 
 	// Deprecated
 	geCycleEvent = CoreTiming::RegisterEvent("GeCycleEvent", &__GeCheckCycles);
+	geQueuedTriggersEvent = CoreTiming::RegisterEvent("GeQueuedTriggers", &__GeExecuteQueuedTriggers);
+
+	std::lock_guard<std::mutex> guard(geQueuedTriggersLock);
+	geQueuedTriggers.clear();
 
 	listWaitingThreads.clear();
 	drawWaitingThreads.clear();
@@ -215,7 +235,7 @@ struct GeInterruptData_v1 {
 };
 
 void __GeDoState(PointerWrap &p) {
-	auto s = p.Section("sceGe", 1, 2);
+	auto s = p.Section("sceGe", 1, 3);
 	if (!s)
 		return;
 
@@ -241,6 +261,12 @@ void __GeDoState(PointerWrap &p) {
 	CoreTiming::RestoreRegisterEvent(geInterruptEvent, "GeInterruptEvent", &__GeExecuteInterrupt);
 	p.Do(geCycleEvent);
 	CoreTiming::RestoreRegisterEvent(geCycleEvent, "GeCycleEvent", &__GeCheckCycles);
+	if (s >= 3) {
+		p.Do(geQueuedTriggersEvent);
+		CoreTiming::RestoreRegisterEvent(geQueuedTriggersEvent, "GeQueuedTriggers", &__GeExecuteQueuedTriggers);
+	} else {
+		geQueuedTriggersEvent = CoreTiming::RegisterEvent("GeQueuedTriggers", &__GeExecuteQueuedTriggers);
+	}
 
 	p.Do(listWaitingThreads);
 	p.Do(drawWaitingThreads);
@@ -249,6 +275,8 @@ void __GeDoState(PointerWrap &p) {
 }
 
 void __GeShutdown() {
+	std::lock_guard<std::mutex> guard(geQueuedTriggersLock);
+	geQueuedTriggers.clear();
 }
 
 bool __GeTriggerSync(GPUSyncType type, int id, u64 atTicks) {
@@ -263,19 +291,68 @@ bool __GeTriggerSync(GPUSyncType type, int id, u64 atTicks) {
 	return true;
 }
 
+static void __GeScheduleInterrupt(const GeInterruptData &intrdata, u64 atTicks) {
+	ge_pending_cb.push_back(intrdata);
+
+	u64 userdata = (u64)intrdata.listid << 32 | (u64)intrdata.pc;
+	CoreTiming::ScheduleEvent(atTicks - CoreTiming::GetTicks(), geInterruptEvent, userdata);
+}
+
 bool __GeTriggerInterrupt(int listid, u32 pc, u64 atTicks) {
 	GeInterruptData intrdata;
 	intrdata.listid = listid;
 	intrdata.pc = pc;
 	intrdata.cmd = Memory::ReadUnchecked_U32(pc - 4) >> 24;
 
-	ge_pending_cb.push_back(intrdata);
+	__GeScheduleInterrupt(intrdata, atTicks);
+	return true;
+}
 
-	u64 userdata = (u64)listid << 32 | (u64) pc;
-	CoreTiming::ScheduleEvent(atTicks - CoreTiming::GetTicks(), geInterruptEvent, userdata);
+static void __GeQueueTrigger(const GeQueuedTrigger &trigger) {
+	std::lock_guard<std::mutex> guard(geQueuedTriggersLock);
+	// One poke is enough to run everything queued until it fires.
+	if (geQueuedTriggers.empty())
+		CoreTiming::ScheduleEvent_Threadsafe_Immediate(geQueuedTriggersEvent);
+	geQueuedTriggers.push_back(trigger);
+}
+
+void __GeQueueTriggerSync(GPUSyncType type, int id, u64 atTicks) {
+	GeQueuedTrigger trigger{};
+	trigger.interrupt = false;
+	trigger.type = type;
+	trigger.intrdata.listid = id;
+	trigger.atTicks = atTicks;
+	__GeQueueTrigger(trigger);
+}
+
+bool __GeQueueTriggerInterrupt(int listid, u32 pc, u64 atTicks) {
+	GeQueuedTrigger trigger{};
+	trigger.interrupt = true;
+	trigger.intrdata.listid = listid;
+	trigger.intrdata.pc = pc;
+	// Read now, the list may be rewritten by the time this runs.
+	trigger.intrdata.cmd = Memory::ReadUnchecked_U32(pc - 4) >> 24;
+	trigger.atTicks = atTicks;
+	__GeQueueTrigger(trigger);
 	return true;
 }
 
+void __GeRunQueuedTriggers() {
+	std::vector<GeQueuedTrigger> triggers;
+	{
+		std::lock_guard<std::mutex> guard(geQueuedTriggersLock);
+		triggers.swap(geQueuedTriggers);
+	}
+
+	// Ticks already in the past just fire as soon as possible, same as a late event.
+	for (const GeQueuedTrigger &trigger : triggers) {
+		if (trigger.interrupt)
+			__GeScheduleInterrupt(trigger.intrdata, trigger.atTicks);
+		else
+			__GeTriggerSync(trigger.type, trigger.intrdata.listid, trigger.atTicks);
+	}
+}
+
 void __GeWaitCurrentThread(GPUSyncType type, SceUID waitId, const char *reason) {
 	WaitType waitType;
 	if (type == GPU_SYNC_DRAW) {
@@ -529,6 +606,7 @@ static int sceGeGetMtx(int type, u32 matrixPtr) {
 	}
 
 	INFO_LOG(SCEGE, "sceGeGetMtx(%d, %08x)", type, matrixPtr);
+	gpu->SyncThread();
 	switch (type) {
 	case GE_MTX_BONE0:
 	case GE_MTX_BONE1:
@@ -563,6 +641,7 @@ static int sceGeGetMtx(int type, u32 matrixPtr) {
 
 static u32 sceGeGetCmd(int cmd) {
 	INFO_LOG(SCEGE, "sceGeGetCmd(%i)", cmd);
+	gpu->SyncThread();
 	if (cmd >= 0 && cmd < (int)ARRAY_SIZE(gstate.cmdmem)) {
 		return gstate.cmdmem[cmd];  // Does not mask away the high bits.
 	} else {
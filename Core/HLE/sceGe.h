@@ -53,6 +53,10 @@ void __GeDoState(PointerWrap &p);
 void __GeShutdown();
 bool __GeTriggerSync(GPUSyncType waitType, int id, u64 atTicks);
 bool __GeTriggerInterrupt(int listid, u32 pc, u64 atTicks);
+// For lists processed on the GE thread, which can't touch CoreTiming.  Run later on the emu thread.
+void __GeQueueTriggerSync(GPUSyncType waitType, int id, u64 atTicks);
+bool __GeQueueTriggerInterrupt(int listid, u32 pc, u64 atTicks);
+void __GeRunQueuedTriggers();
 void __GeWaitCurrentThread(GPUSyncType type, SceUID waitId, const char *reason);
 bool __GeTriggerWait(GPUSyncType type, SceUID waitId);
 
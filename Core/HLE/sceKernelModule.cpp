@@ -1564,6 +1564,9 @@ u32 __KernelGetModuleGP(SceUID uid)
 void __KernelLoadReset() {
 	// Wipe kernel here, loadexec should reset the entire system
 	if (__KernelIsRunning()) {
+		// Lists may still be running on the GE thread, and would outlive the kernel they trigger.
+		gpu->SyncThread();
+
 		u32 error;
 		while (!loadedModules.empty()) {
 			SceUID moduleID = *loadedModules.begin();
@@ -64,6 +64,12 @@ class FileLoader {
 		HINT_UNCACHED,
 	};
 
+	enum class AccessHint {
+		NORMAL,
+		SEQUENTIAL,
+		RANDOM,
+	};
+
 	virtual ~FileLoader() {}
 
 	virtual bool IsRemote() {
@@ -93,6 +99,17 @@ class FileLoader {
 	// Cancel any operations that might block, if possible.
 	virtual void Cancel() {
 	}
+
+	// Returns a read-only view of the file contents, valid for the lifetime of the loader.
+	// Only available when the file is memory mapped, which is limited to files on fixed local
+	// disks where the view can't go away underneath us.  Otherwise returns nullptr, use ReadAt().
+	virtual const u8 *DataPointer(s64 absolutePos, size_t bytes) {
+		return nullptr;
+	}
+
+	// Lets the OS know how the file will be read.  Only a hint.
+	virtual void SetAccessHint(AccessHint hint) {
+	}
 };
 
 inline u32 operator & (const FileLoader::Flags &a, const FileLoader::Flags &b) {
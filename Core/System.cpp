@@ -82,6 +82,11 @@ ParamSFOData g_paramSFO;
 static GlobalUIState globalUIState;
 static CoreParameter coreParameter;
 static FileLoader *loadedFile;
+// Set when loadedFile is a RAM cache, so we can record and replay boot reads.
+static RamCachingFileLoader *ramCachedFile;
+static std::string bootTraceFilename;
+// How long after boot to record reads for prefetching next time.
+static const double BOOT_TRACE_SECONDS = 30.0;
 static std::mutex loadingReasonLock;
 static std::string loadingReason;
 
@@ -190,7 +195,9 @@ void CPU_Init() {
 	loadedFile = ResolveFileLoaderTarget(ConstructFileLoader(filename));
 #ifdef _M_X64
 	if (g_Config.bCacheFullIsoInRam) {
-		loadedFile = new RamCachingFileLoader(loadedFile);
+		ramCachedFile = new RamCachingFileLoader(loadedFile);
+		ramCachedFile->StartAccessTrace(BOOT_TRACE_SECONDS);
+		loadedFile = ramCachedFile;
 	}
 #endif
 	IdentifiedFileType type = Identify_File(loadedFile);
@@ -225,6 +232,13 @@ void CPU_Init() {
 	std::string discID = g_paramSFO.GetDiscID();
 	coreParameter.compat.Load(discID);
 
+	// Boot reads are very predictable, so start pulling in what the last boot needed.
+	bootTraceFilename.clear();
+	if (ramCachedFile && !discID.empty()) {
+		bootTraceFilename = GetSysDirectory(DIRECTORY_APP_CACHE) + "boottrace_" + discID + ".dat";
+		ramCachedFile->LoadAccessTrace(bootTraceFilename);
+	}
+
 	Memory::Init();
 	mipsr4k.Reset();
 
@@ -243,7 +257,12 @@ void CPU_Init() {
 
 	// If they shut down early, we'll catch it when load completes.
 	// Note: this may return before init is complete, which is checked if CPU_IsReady().
-	if (!LoadFile(&loadedFile, &coreParameter.errorString)) {
+	bool loaded = LoadFile(&loadedFile, &coreParameter.errorString);
+	// LoadFile() may have swapped out the loader.
+	if (loadedFile != ramCachedFile) {
+		ramCachedFile = nullptr;
+	}
+	if (!loaded) {
 		CPU_Shutdown();
 		coreParameter.fileToStart = "";
 		return;
@@ -272,6 +291,11 @@ void CPU_Shutdown() {
 	mipsr4k.Shutdown();
 	Memory::Shutdown();
 
+	if (ramCachedFile && !bootTraceFilename.empty()) {
+		ramCachedFile->SaveAccessTrace(bootTraceFilename);
+	}
+	ramCachedFile = nullptr;
+
 	delete loadedFile;
 	loadedFile = nullptr;
 
@@ -284,6 +308,9 @@ void CPU_Shutdown() {
 
 // TODO: Maybe loadedFile doesn't even belong here...
 void UpdateLoadedFile(FileLoader *fileLoader) {
+	if (loadedFile == ramCachedFile) {
+		ramCachedFile = nullptr;
+	}
 	delete loadedFile;
 	loadedFile = fileLoader;
 }
@@ -465,6 +492,8 @@ void PSP_RunLoopUntil(u64 globalticks) {
 	}
 
 	mipsr4k.RunLoopUntil(globalticks);
+	// The UI, savestates, and the debugger may all look at the GPU before the next run.
+	gpu->SyncThread();
 	gpu->CleanupBeforeUI();
 }
 
@@ -21,10 +21,17 @@
 #include <libpng17/png.h>
 #endif
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 #include <algorithm>
+#include <mutex>
 #include "i18n/i18n.h"
 #include "ext/xxhash.h"
+#include "file/file_util.h"
 #include "file/ini_file.h"
+#include "thread/prioritizedworkqueue.h"
 #include "Common/ColorConv.h"
 #include "Common/FileUtil.h"
 #include "Core/Config.h"
@@ -36,14 +43,176 @@
 
 static const std::string INI_FILENAME = "textures.ini";
 static const std::string NEW_TEXTURE_DIR = "new/";
+static const std::string PACK_FILENAME = "textures.pack";
+static const std::string NEW_PACK_FILENAME = "textures.pack.new";
+static const char PACK_MAGIC[4] = { 'P', 'P', 'T', 'P' };
+static const u32 PACK_VERSION = 1;
+static const u64 PACK_ALIGNMENT = 16;
 static const int VERSION = 1;
 static const int MAX_MIP_LEVELS = 12;  // 12 should be plenty, 8 is the max mip levels supported by the PSP.
+// Decoded replacements are kept around up to this size, in case the texture cache needs them again.
+static const size_t MAX_LOADED_REPLACEMENT_BYTES = 256 * 1024 * 1024;
+// PNG decoding is mostly CPU bound, leave some cores for the emulator.
+static const int LOAD_WORKER_THREADS = 2;
+// Textures waiting to be saved, beyond this new ones are skipped until the queue catches up.
+static const size_t MAX_PENDING_SAVE_BYTES = 128 * 1024 * 1024;
+
+class ReplacementPack {
+public:
+	~ReplacementPack() {
+#ifndef _WIN32
+		if (base_) {
+			munmap((void *)base_, (size_t)size_);
+		}
+#endif
+	}
+
+	bool Open(const std::string &filename) {
+		if (!file_.Open(filename, "rb")) {
+			return false;
+		}
+
+		size_ = file_.GetSize();
+		ReplacementPackHeader header;
+		if (!file_.ReadBytes(&header, sizeof(header)) || memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+			ERROR_LOG(G3D, "Not a texture pack: %s", filename.c_str());
+			return false;
+		}
+		if (header.version != PACK_VERSION) {
+			ERROR_LOG(G3D, "Unsupported texture pack version %d: %s", (int)header.version, filename.c_str());
+			return false;
+		}
+		if (header.indexOffset + (u64)header.numEntries * sizeof(ReplacementPackEntry) > size_) {
+			ERROR_LOG(G3D, "Texture pack truncated: %s", filename.c_str());
+			return false;
+		}
+		numEntries_ = header.numEntries;
+
+#ifndef _WIN32
+		void *base = mmap(nullptr, (size_t)size_, PROT_READ, MAP_SHARED, fileno(file_.GetHandle()), 0);
+		if (base != MAP_FAILED) {
+			base_ = (const u8 *)base;
+			entries_ = (const ReplacementPackEntry *)(base_ + header.indexOffset);
+			return true;
+		}
+#endif
+
+		// Couldn't map it, so keep just the index in memory and read images as needed.
+		index_.resize(numEntries_);
+		if (!file_.Seek(header.indexOffset, SEEK_SET) || !file_.ReadArray(index_.data(), index_.size())) {
+			ERROR_LOG(G3D, "Could not read texture pack index: %s", filename.c_str());
+			return false;
+		}
+		entries_ = index_.data();
+		return true;
+	}
+
+	const ReplacementPackEntry *Entries() const {
+		return entries_;
+	}
+
+	size_t NumEntries() const {
+		return numEntries_;
+	}
+
+	// Called from the load workers, so must be thread safe.
+	bool Read(const ReplacementPackEntry &entry, void *out, int rowPitch) {
+		const u32 srcPitch = entry.w * 4;
+		if (entry.format != (u32)ReplacementPackFormat::RGBA8888 || entry.size != (u64)srcPitch * entry.h || entry.offset + entry.size > size_) {
+			return false;
+		}
+
+		if (base_) {
+			const u8 *src = base_ + entry.offset;
+			for (u32 y = 0; y < entry.h; ++y) {
+				memcpy((u8 *)out + rowPitch * y, src + srcPitch * y, srcPitch);
+			}
+			return true;
+		}
+
+		std::lock_guard<std::mutex> guard(lock_);
+		file_.Clear();
+		if (!file_.Seek(entry.offset, SEEK_SET)) {
+			return false;
+		}
+		if ((u32)rowPitch == srcPitch) {
+			return file_.ReadBytes(out, (size_t)entry.size);
+		}
+		for (u32 y = 0; y < entry.h; ++y) {
+			if (!file_.ReadBytes((u8 *)out + rowPitch * y, srcPitch)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	File::IOFile file_;
+	std::mutex lock_;
+	u64 size_ = 0;
+	const u8 *base_ = nullptr;
+	const ReplacementPackEntry *entries_ = nullptr;
+	size_t numEntries_ = 0;
+	std::vector<ReplacementPackEntry> index_;
+};
+
+class ReplacedTextureLoadTask : public PrioritizedWorkQueueItem {
+public:
+	ReplacedTextureLoadTask(const std::vector<ReplacedTextureLevel> &levels, const std::shared_ptr<ReplacedTextureData> &data)
+		: levels_(levels), data_(data) {
+	}
+
+	void run() override {
+		ReplacedTextureAlpha alphaStatus = ReplacedTextureAlpha::UNKNOWN;
+		data_->levels.resize(levels_.size());
+		for (size_t i = 0; i < levels_.size() && !data_->cancelled; ++i) {
+			const ReplacedTextureLevel &info = levels_[i];
+			std::vector<u8> &out = data_->levels[i];
+			out.resize(info.w * info.h * 4);
+			ReplacedTexture::LoadLevelFromFile(info, (int)i, out.data(), info.w * 4, alphaStatus);
+			data_->bytes += out.size();
+		}
+		data_->alphaStatus = alphaStatus;
+		data_->done = true;
+	}
+
+	// Oldest first, the queue ages them.
+	float priority() override {
+		return 0.0f;
+	}
+
+	bool stale() override {
+		return data_->cancelled;
+	}
+
+private:
+	std::vector<ReplacedTextureLevel> levels_;
+	std::shared_ptr<ReplacedTextureData> data_;
+};
 
 TextureReplacer::TextureReplacer() {
 	none_.alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
 }
 
 TextureReplacer::~TextureReplacer() {
+	if (saveQueue_) {
+		// Finish writing anything already dumped.
+		saveQueue_->WaitUntilDone(true);
+		StopProcessingWorkQueue(saveQueue_);
+		delete saveQueue_;
+		saveQueue_ = nullptr;
+	}
+	if (loadQueue_) {
+		for (auto &it : cache_) {
+			if (it.second.data_) {
+				it.second.data_->cancelled = true;
+			}
+		}
+		StopProcessingWorkQueue(loadQueue_);
+		loadQueue_->Flush();
+		delete loadQueue_;
+		loadQueue_ = nullptr;
+	}
 }
 
 void TextureReplacer::Init() {
@@ -69,6 +238,9 @@ void TextureReplacer::NotifyConfigChanged() {
 	if (enabled_) {
 		enabled_ = LoadIni();
 	}
+	if (enabled_) {
+		LoadPack();
+	}
 }
 
 bool TextureReplacer::LoadIni() {
@@ -156,6 +328,67 @@ bool TextureReplacer::LoadIni() {
 	return true;
 }
 
+void TextureReplacer::LoadPack() {
+	const std::string filename = basePath_ + PACK_FILENAME;
+	const std::string newFilename = basePath_ + NEW_PACK_FILENAME;
+	if (File::Exists(newFilename)) {
+		// A pack was generated while the old one may have been open.  Let go of it before replacing it.
+		ReleasePack();
+		if (File::Exists(filename))
+			File::Delete(filename);
+		if (!File::Rename(newFilename, filename)) {
+			ERROR_LOG(G3D, "Could not replace texture pack: %s", filename.c_str());
+		}
+	}
+
+	pack_.reset();
+	packAliases_.clear();
+	packFiles_.clear();
+
+	if (!g_Config.bReplaceTextures || !File::Exists(filename)) {
+		return;
+	}
+
+	std::shared_ptr<ReplacementPack> pack = std::make_shared<ReplacementPack>();
+	if (!pack->Open(filename)) {
+		// Fall back to the loose files.
+		return;
+	}
+
+	const ReplacementPackEntry *entries = pack->Entries();
+	for (size_t i = 0; i < pack->NumEntries(); ++i) {
+		const ReplacementPackEntry &entry = entries[i];
+		ReplacementAliasKey key(entry.cachekey, entry.hash, entry.level);
+		if (entry.flags & PACK_ENTRY_ALIAS) {
+			packAliases_[key] = &entry;
+		} else {
+			packFiles_[key] = &entry;
+		}
+	}
+	pack_ = pack;
+	INFO_LOG(G3D, "Using texture pack %s with %d images", filename.c_str(), (int)pack->NumEntries());
+}
+
+void TextureReplacer::ReleasePack() {
+	// Loaded and pending replacements all hold on to the pack, so they have to go too.
+	if (loadQueue_) {
+		for (auto &it : cache_) {
+			if (it.second.data_) {
+				it.second.data_->cancelled = true;
+			}
+		}
+		loadQueue_->Flush();
+		loadQueue_->WaitUntilDone(true);
+	}
+	cache_.clear();
+	loadedLRU_.clear();
+	loadedBytes_ = 0;
+
+	pack_.reset();
+	packAliases_.clear();
+	packFiles_.clear();
+}
+
 void TextureReplacer::ParseHashRange(const std::string &key, const std::string &value) {
 	std::vector<std::string> keyParts;
 	SplitString(key, ',', keyParts);
@@ -274,10 +507,44 @@ ReplacedTexture &TextureReplacer::FindReplacement(u64 cachekey, u32 hash, int w,
 	// Okay, let's construct the result.
 	ReplacedTexture &result = cache_[replacementKey];
 	result.alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
+	result.replacer_ = this;
 	PopulateReplacement(&result, cachekey, hash, w, h);
 	return result;
 }
 
+void TextureReplacer::QueueLoad(ReplacedTexture *texture) {
+	if (!loadQueue_) {
+		loadQueue_ = new PrioritizedWorkQueue();
+		ProcessWorkQueueOnThreadWhile(loadQueue_, LOAD_WORKER_THREADS);
+	}
+
+	texture->data_ = std::make_shared<ReplacedTextureData>();
+	loadQueue_->Add(new ReplacedTextureLoadTask(texture->levels_, texture->data_));
+}
+
+void TextureReplacer::TouchLoaded(ReplacedTexture *texture) {
+	if (texture->inLRU_) {
+		loadedLRU_.splice(loadedLRU_.begin(), loadedLRU_, texture->lruPos_);
+		return;
+	}
+
+	// Just finished loading, now it counts against the budget.
+	texture->alphaStatus_ = texture->data_->alphaStatus;
+	loadedLRU_.push_front(texture);
+	texture->lruPos_ = loadedLRU_.begin();
+	texture->inLRU_ = true;
+	loadedBytes_ += texture->data_->bytes;
+
+	// Drop the least recently used.  If they're needed again, they'll just load again.
+	while (loadedBytes_ > MAX_LOADED_REPLACEMENT_BYTES && loadedLRU_.size() > 1) {
+		ReplacedTexture *oldest = loadedLRU_.back();
+		loadedLRU_.pop_back();
+		loadedBytes_ -= oldest->data_->bytes;
+		oldest->data_.reset();
+		oldest->inLRU_ = false;
+	}
+}
+
 void TextureReplacer::PopulateReplacement(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h) {
 	int newW = w;
 	int newH = h;
@@ -288,48 +555,63 @@ void TextureReplacer::PopulateReplacement(ReplacedTexture *result, u64 cachekey,
 	}
 
 	for (int i = 0; i < MAX_MIP_LEVELS; ++i) {
-		const std::string hashfile = LookupHashFile(cachekey, hash, i);
-		const std::string filename = basePath_ + hashfile;
-		if (hashfile.empty() || !File::Exists(filename)) {
-			// Out of valid mip levels.  Bail out.
-			break;
-		}
-
 		bool good = false;
 		ReplacedTextureLevel level;
 		level.fmt = ReplacedTextureFormat::F_8888;
-		level.file = filename;
 
-#ifdef USING_QT_UI
-		QImage image(filename.c_str(), "PNG");
-		if (image.isNull()) {
-			ERROR_LOG(G3D, "Could not load texture replacement info: %s", filename.c_str());
-		} else {
-			level.w = (image.width() * w) / newW;
-			level.h = (image.height() * h) / newH;
-			good = true;
-		}
-#else
-		png_image png = {};
-		png.version = PNG_IMAGE_VERSION;
-		FILE *fp = File::OpenCFile(filename, "rb");
-		if (png_image_begin_read_from_stdio(&png, fp)) {
-			// We pad files that have been hashrange'd so they are the same texture size.
-			level.w = (png.width * w) / newW;
-			level.h = (png.height * h) / newH;
+		if (pack_) {
+			const ReplacementPackEntry *packed = LookupPacked(cachekey, hash, i);
+			if (!packed) {
+				// Out of valid mip levels.  Bail out.
+				break;
+			}
+
+			// Same padding as below for hashranges.
+			level.w = ((int)packed->w * w) / newW;
+			level.h = ((int)packed->h * h) / newH;
+			level.pack = pack_;
+			level.packEntry = packed;
 			good = true;
 		} else {
-			ERROR_LOG(G3D, "Could not load texture replacement info: %s - %s", filename.c_str(), png.message);
-		}
-		fclose(fp);
+			const std::string hashfile = LookupHashFile(cachekey, hash, i);
+			const std::string filename = basePath_ + hashfile;
+			if (hashfile.empty() || !File::Exists(filename)) {
+				// Out of valid mip levels.  Bail out.
+				break;
+			}
 
-		png_image_free(&png);
+			level.file = filename;
+#ifdef USING_QT_UI
+			QImage image(filename.c_str(), "PNG");
+			if (image.isNull()) {
+				ERROR_LOG(G3D, "Could not load texture replacement info: %s", filename.c_str());
+			} else {
+				level.w = (image.width() * w) / newW;
+				level.h = (image.height() * h) / newH;
+				good = true;
+			}
+#else
+			png_image png = {};
+			png.version = PNG_IMAGE_VERSION;
+			FILE *fp = File::OpenCFile(filename, "rb");
+			if (png_image_begin_read_from_stdio(&png, fp)) {
+				// We pad files that have been hashrange'd so they are the same texture size.
+				level.w = (png.width * w) / newW;
+				level.h = (png.height * h) / newH;
+				good = true;
+			} else {
+				ERROR_LOG(G3D, "Could not load texture replacement info: %s - %s", filename.c_str(), png.message);
+			}
+			fclose(fp);
+
+			png_image_free(&png);
 #endif
+		}
 
 		if (good && i != 0) {
 			// Check that the mipmap size is correct.  Can't load mips of the wrong size.
 			if (level.w != (result->levels_[0].w >> i) || level.h != (result->levels_[0].h >> i)) {
-				 WARN_LOG(G3D, "Replacement mipmap invalid: size=%dx%d, expected=%dx%d (level %d, '%s')", level.w, level.h, result->levels_[0].w >> i, result->levels_[0].h >> i, i, filename.c_str());
+				 WARN_LOG(G3D, "Replacement mipmap invalid: size=%dx%d, expected=%dx%d (level %d, '%s')", level.w, level.h, result->levels_[0].w >> i, result->levels_[0].h >> i, i, level.file.c_str());
 				 good = false;
 			}
 		}
@@ -367,6 +649,107 @@ static bool WriteTextureToPNG(png_imagep image, const std::string &filename, int
 }
 #endif
 
+class ReplacedTextureSaveTask : public PrioritizedWorkQueueItem {
+public:
+	ReplacedTextureSaveTask(const ReplacedTextureDecodeInfo &replacedInfo, const void *data, int pitch, int w, int h, const std::string &filename, const std::string &saveFilename, const std::string &saveDirectory, std::atomic<size_t> &pendingBytes)
+		: replacedInfo_(replacedInfo), data_((const u8 *)data, (const u8 *)data + (size_t)pitch * h), pitch_(pitch), w_(w), h_(h),
+		  filename_(filename), saveFilename_(saveFilename), saveDirectory_(saveDirectory), pendingBytes_(pendingBytes) {
+	}
+	~ReplacedTextureSaveTask() {
+		pendingBytes_ -= data_.size();
+	}
+
+	void run() override {
+		if (File::Exists(filename_)) {
+			// If it exists, must've been decoded and saved as a new texture already.
+			return;
+		}
+
+		if (!saveDirectory_.empty() && !File::Exists(saveDirectory_)) {
+			File::CreateFullPath(saveDirectory_);
+			File::CreateEmptyFile(saveDirectory_ + "/.nomedia");
+		}
+
+		const ReplacedTextureDecodeInfo &replacedInfo = replacedInfo_;
+		const void *data = data_.data();
+		int pitch = pitch_;
+		int w = w_;
+		int h = h_;
+
+#ifdef USING_QT_UI
+		ERROR_LOG(G3D, "Replacement texture saving not implemented for Qt");
+#else
+		if (replacedInfo.fmt != ReplacedTextureFormat::F_8888) {
+			saveBuf.resize((pitch * h) / sizeof(u16));
+			switch (replacedInfo.fmt) {
+			case ReplacedTextureFormat::F_5650:
+				ConvertRGBA565ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
+				break;
+			case ReplacedTextureFormat::F_5551:
+				ConvertRGBA5551ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
+				break;
+			case ReplacedTextureFormat::F_4444:
+				ConvertRGBA4444ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
+				break;
+			case ReplacedTextureFormat::F_0565_ABGR:
+				ConvertABGR565ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
+				break;
+			case ReplacedTextureFormat::F_1555_ABGR:
+				ConvertABGR1555ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
+				break;
+			case ReplacedTextureFormat::F_4444_ABGR:
+				ConvertABGR4444ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
+				break;
+			case ReplacedTextureFormat::F_8888_BGRA:
+				ConvertBGRA8888ToRGBA8888(saveBuf.data(), (const u32 *)data, (pitch * h) / sizeof(u32));
+				break;
+			case ReplacedTextureFormat::F_8888:
+				// Impossible.  Just so we can get warnings on other missed formats.
+				break;
+			}
+
+			data = saveBuf.data();
+			if (replacedInfo.fmt != ReplacedTextureFormat::F_8888_BGRA) {
+				// We doubled our pitch.
+				pitch *= 2;
+			}
+		}
+
+		png_image png;
+		memset(&png, 0, sizeof(png));
+		png.version = PNG_IMAGE_VERSION;
+		png.format = PNG_FORMAT_RGBA;
+		png.width = w;
+		png.height = h;
+		bool success = WriteTextureToPNG(&png, saveFilename_, 0, data, pitch, nullptr);
+		png_image_free(&png);
+
+		if (png.warning_or_error >= 2) {
+			ERROR_LOG(COMMON, "Saving screenshot to PNG produced errors.");
+		} else if (success) {
+			NOTICE_LOG(G3D, "Saving texture for replacement: %08x / %dx%d", replacedInfo.hash, w, h);
+		}
+#endif
+	}
+
+	// Oldest first, the queue ages them.
+	float priority() override {
+		return 0.0f;
+	}
+
+private:
+	ReplacedTextureDecodeInfo replacedInfo_;
+	std::vector<u8> data_;
+	int pitch_;
+	int w_;
+	int h_;
+	std::string filename_;
+	std::string saveFilename_;
+	std::string saveDirectory_;
+	std::atomic<size_t> &pendingBytes_;
+	SimpleBuf<u32> saveBuf;
+};
+
 void TextureReplacer::NotifyTextureDecoded(const ReplacedTextureDecodeInfo &replacedInfo, const void *data, int pitch, int level, int w, int h) {
 	_assert_msg_(G3D, enabled_, "Replacement not enabled");
 	if (!g_Config.bSaveNewTextures) {
@@ -390,32 +773,29 @@ void TextureReplacer::NotifyTextureDecoded(const ReplacedTextureDecodeInfo &repl
 	const std::string saveFilename = basePath_ + NEW_TEXTURE_DIR + hashfile;
 
 	// If it's empty, it's an ignored hash, we intentionally don't save.
-	if (hashfile.empty() || File::Exists(filename)) {
-		// If it exists, must've been decoded and saved as a new texture already.
+	if (hashfile.empty()) {
 		return;
 	}
 
+	// This only checks what we queued, so we don't need to touch the disk on every decode.
 	ReplacementCacheKey replacementKey(cachekey, replacedInfo.hash);
 	auto it = savedCache_.find(replacementKey);
-	if (it != savedCache_.end() && File::Exists(saveFilename)) {
+	if (it != savedCache_.end()) {
 		// We've already saved this texture.  Let's only save if it's bigger (e.g. scaled now.)
 		if (it->second.w >= w && it->second.h >= h) {
 			return;
 		}
 	}
 
+	std::string saveDirectory;
 #ifdef _WIN32
 	size_t slash = hashfile.find_last_of("/\\");
 #else
 	size_t slash = hashfile.find_last_of("/");
 #endif
 	if (slash != hashfile.npos) {
-		// Create any directory structure as needed.
-		const std::string saveDirectory = basePath_ + NEW_TEXTURE_DIR + hashfile.substr(0, slash);
-		if (!File::Exists(saveDirectory)) {
-			File::CreateFullPath(saveDirectory);
-			File::CreateEmptyFile(saveDirectory + "/.nomedia");
-		}
+		// The save thread will create any directory structure as needed.
+		saveDirectory = basePath_ + NEW_TEXTURE_DIR + hashfile.substr(0, slash);
 	}
 
 	// Only save the hashed portion of the PNG.
@@ -426,60 +806,19 @@ void TextureReplacer::NotifyTextureDecoded(const ReplacedTextureDecodeInfo &repl
 		h = lookupH * replacedInfo.scaleFactor;
 	}
 
-#ifdef USING_QT_UI
-	ERROR_LOG(G3D, "Replacement texture saving not implemented for Qt");
-#else
-	if (replacedInfo.fmt != ReplacedTextureFormat::F_8888) {
-		saveBuf.resize((pitch * h) / sizeof(u16));
-		switch (replacedInfo.fmt) {
-		case ReplacedTextureFormat::F_5650:
-			ConvertRGBA565ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
-			break;
-		case ReplacedTextureFormat::F_5551:
-			ConvertRGBA5551ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
-			break;
-		case ReplacedTextureFormat::F_4444:
-			ConvertRGBA4444ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
-			break;
-		case ReplacedTextureFormat::F_0565_ABGR:
-			ConvertABGR565ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
-			break;
-		case ReplacedTextureFormat::F_1555_ABGR:
-			ConvertABGR1555ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
-			break;
-		case ReplacedTextureFormat::F_4444_ABGR:
-			ConvertABGR4444ToRGBA8888(saveBuf.data(), (const u16 *)data, (pitch * h) / sizeof(u16));
-			break;
-		case ReplacedTextureFormat::F_8888_BGRA:
-			ConvertBGRA8888ToRGBA8888(saveBuf.data(), (const u32 *)data, (pitch * h) / sizeof(u32));
-			break;
-		case ReplacedTextureFormat::F_8888:
-			// Impossible.  Just so we can get warnings on other missed formats.
-			break;
-		}
-
-		data = saveBuf.data();
-		if (replacedInfo.fmt != ReplacedTextureFormat::F_8888_BGRA) {
-			// We doubled our pitch.
-			pitch *= 2;
-		}
+	const size_t bytes = (size_t)pitch * h;
+	if (pendingSaveBytes_ + bytes > MAX_PENDING_SAVE_BYTES) {
+		// Too far behind, skip it for now.  We'll see it again next time it's decoded.
+		DEBUG_LOG(G3D, "Texture save queue full, skipping %08x", replacedInfo.hash);
+		return;
 	}
 
-	png_image png;
-	memset(&png, 0, sizeof(png));
-	png.version = PNG_IMAGE_VERSION;
-	png.format = PNG_FORMAT_RGBA;
-	png.width = w;
-	png.height = h;
-	bool success = WriteTextureToPNG(&png, saveFilename, 0, data, pitch, nullptr);
-	png_image_free(&png);
-
-	if (png.warning_or_error >= 2) {
-		ERROR_LOG(COMMON, "Saving screenshot to PNG produced errors.");
-	} else if (success) {
-		NOTICE_LOG(G3D, "Saving texture for replacement: %08x / %dx%d", replacedInfo.hash, w, h);
+	if (!saveQueue_) {
+		saveQueue_ = new PrioritizedWorkQueue();
+		ProcessWorkQueueOnThreadWhile(saveQueue_, 1);
 	}
-#endif
+	pendingSaveBytes_ += bytes;
+	saveQueue_->Add(new ReplacedTextureSaveTask(replacedInfo, data, pitch, w, h, filename, saveFilename, saveDirectory, pendingSaveBytes_));
 
 	// Remember that we've saved this for next time.
 	ReplacedTextureLevel saved;
@@ -490,45 +829,51 @@ void TextureReplacer::NotifyTextureDecoded(const ReplacedTextureDecodeInfo &repl
 	savedCache_[replacementKey] = saved;
 }
 
-std::string TextureReplacer::LookupHashFile(u64 cachekey, u32 hash, int level) {
+template <typename T>
+typename T::const_iterator TextureReplacer::LookupAlias(const T &aliases, u64 cachekey, u32 hash, int level) {
 	ReplacementAliasKey key(cachekey, hash, level);
-	auto alias = aliases_.find(key);
-	if (alias == aliases_.end()) {
+	auto alias = aliases.find(key);
+	if (alias == aliases.end()) {
 		// Also check for a few more aliases with zeroed portions:
 		// Only clut hash (very dangerous in theory, in practice not more than missing "just" data hash)
 		key.cachekey = cachekey & 0xFFFFFFFFULL;
 		key.hash = 0;
-		alias = aliases_.find(key);
+		alias = aliases.find(key);
 
-		if (!ignoreAddress_ && alias == aliases_.end()) {
+		if (!ignoreAddress_ && alias == aliases.end()) {
 			// No data hash.
 			key.cachekey = cachekey;
 			key.hash = 0;
-			alias = aliases_.find(key);
+			alias = aliases.find(key);
 		}
 
-		if (alias == aliases_.end()) {
+		if (alias == aliases.end()) {
 			// No address.
 			key.cachekey = cachekey & 0xFFFFFFFFULL;
 			key.hash = hash;
-			alias = aliases_.find(key);
+			alias = aliases.find(key);
 		}
 
-		if (!ignoreAddress_ && alias == aliases_.end()) {
+		if (!ignoreAddress_ && alias == aliases.end()) {
 			// Address, but not clut hash (in case of garbage clut data.)
 			key.cachekey = cachekey & ~0xFFFFFFFFULL;
 			key.hash = hash;
-			alias = aliases_.find(key);
+			alias = aliases.find(key);
 		}
 
-		if (alias == aliases_.end()) {
+		if (alias == aliases.end()) {
 			// Anything with this data hash (a little dangerous.)
 			key.cachekey = 0;
 			key.hash = hash;
-			alias = aliases_.find(key);
+			alias = aliases.find(key);
 		}
 	}
 
+	return alias;
+}
+
+std::string TextureReplacer::LookupHashFile(u64 cachekey, u32 hash, int level) {
+	auto alias = LookupAlias(aliases_, cachekey, hash, level);
 	if (alias != aliases_.end()) {
 		// Note: this will be blank if explicitly ignored.
 		return alias->second;
@@ -537,6 +882,16 @@ std::string TextureReplacer::LookupHashFile(u64 cachekey, u32 hash, int level) {
 	return HashName(cachekey, hash, level) + ".png";
 }
 
+const ReplacementPackEntry *TextureReplacer::LookupPacked(u64 cachekey, u32 hash, int level) {
+	auto alias = LookupAlias(packAliases_, cachekey, hash, level);
+	if (alias != packAliases_.end()) {
+		return (alias->second->flags & PACK_ENTRY_IGNORED) ? nullptr : alias->second;
+	}
+
+	auto file = packFiles_.find(ReplacementAliasKey(cachekey, hash, level));
+	return file != packFiles_.end() ? file->second : nullptr;
+}
+
 std::string TextureReplacer::HashName(u64 cachekey, u32 hash, int level) {
 	char hashname[16 + 8 + 1 + 11 + 1] = {};
 	if (level > 0) {
@@ -561,11 +916,56 @@ bool TextureReplacer::LookupHashRange(u32 addr, int &w, int &h) {
 	return false;
 }
 
+bool ReplacedTexture::IsReady() {
+	// Nothing to load.
+	if (levels_.empty() || !replacer_) {
+		return true;
+	}
+
+	if (!data_) {
+		replacer_->QueueLoad(this);
+		return false;
+	}
+	if (!data_->done) {
+		return false;
+	}
+
+	replacer_->TouchLoaded(this);
+	return true;
+}
+
 void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 	_assert_msg_(G3D, (size_t)level < levels_.size(), "Invalid miplevel");
 	_assert_msg_(G3D, out != nullptr && rowPitch > 0, "Invalid out/pitch");
 
 	const ReplacedTextureLevel &info = levels_[level];
+	if (data_ && data_->done) {
+		const std::vector<u8> &pixels = data_->levels[level];
+		if (!pixels.empty()) {
+			for (int y = 0; y < info.h; ++y) {
+				memcpy((u8 *)out + rowPitch * y, pixels.data() + info.w * 4 * y, info.w * 4);
+			}
+		}
+		return;
+	}
+
+	// Wasn't loaded ahead of time (or got dropped since), so do it now.
+	LoadLevelFromFile(info, level, out, rowPitch, alphaStatus_);
+}
+
+void ReplacedTexture::LoadLevelFromFile(const ReplacedTextureLevel &info, int level, void *out, int rowPitch, ReplacedTextureAlpha &alphaStatus) {
+	if (info.packEntry) {
+		if (!info.pack->Read(*info.packEntry, out, rowPitch)) {
+			ERROR_LOG(G3D, "Could not load texture replacement from pack: %016llx%08x_%d", (u64)info.packEntry->cachekey, (u32)info.packEntry->hash, level);
+			return;
+		}
+		// Already checked when packing.
+		ReplacedTextureAlpha res = ReplacedTextureAlpha(info.packEntry->alphaStatus);
+		if (res == ReplacedTextureAlpha::UNKNOWN || level == 0) {
+			alphaStatus = res;
+		}
+		return;
+	}
 
 #ifdef USING_QT_UI
 	QImage image(info.file.c_str(), "PNG");
@@ -592,15 +992,20 @@ void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 	}
 
 	if (level == 0 || !alphaFull) {
-		alphaStatus_ = alphaFull ? ReplacedTextureAlpha::FULL : ReplacedTextureAlpha::UNKNOWN;
+		alphaStatus = alphaFull ? ReplacedTextureAlpha::FULL : ReplacedTextureAlpha::UNKNOWN;
 	}
 #else
 	png_image png = {};
 	png.version = PNG_IMAGE_VERSION;
 
 	FILE *fp = File::OpenCFile(info.file, "rb");
+	if (!fp) {
+		ERROR_LOG(G3D, "Could not open texture replacement: %s", info.file.c_str());
+		return;
+	}
 	if (!png_image_begin_read_from_stdio(&png, fp)) {
 		ERROR_LOG(G3D, "Could not load texture replacement info: %s - %s", info.file.c_str(), png.message);
+		fclose(fp);
 		return;
 	}
 
@@ -608,7 +1013,7 @@ void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 	if ((png.format & PNG_FORMAT_FLAG_ALPHA) == 0) {
 		// Well, we know for sure it doesn't have alpha.
 		if (level == 0) {
-			alphaStatus_ = ReplacedTextureAlpha::FULL;
+			alphaStatus = ReplacedTextureAlpha::FULL;
 		}
 		checkedAlpha = true;
 	}
@@ -616,6 +1021,8 @@ void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 
 	if (!png_image_finish_read(&png, nullptr, out, rowPitch, nullptr)) {
 		ERROR_LOG(G3D, "Could not load texture replacement: %s - %s", info.file.c_str(), png.message);
+		fclose(fp);
+		png_image_free(&png);
 		return;
 	}
 
@@ -623,7 +1030,7 @@ void ReplacedTexture::Load(int level, void *out, int rowPitch) {
 		// This will only check the hashed bits.
 		CheckAlphaResult res = CheckAlphaRGBA8888Basic((u32 *)out, rowPitch / sizeof(u32), png.width, png.height);
 		if (res == CHECKALPHA_ANY || level == 0) {
-			alphaStatus_ = ReplacedTextureAlpha(res);
+			alphaStatus = ReplacedTextureAlpha(res);
 		}
 	}
 
@@ -670,3 +1077,204 @@ bool TextureReplacer::GenerateIni(const std::string &gameID, std::string *genera
 	}
 	return File::Exists(texturesDirectory + INI_FILENAME);
 }
+
+// Decodes a whole image for the pack, and checks its alpha like ReplacedTexture::Load() would.
+static bool DecodeReplacementForPack(const std::string &filename, std::vector<u8> &pixels, int &w, int &h, ReplacedTextureAlpha &alphaStatus) {
+#ifdef USING_QT_UI
+	QImage image(filename.c_str(), "PNG");
+	if (image.isNull()) {
+		return false;
+	}
+
+	image = image.convertToFormat(QImage::Format_ARGB32);
+	w = image.width();
+	h = image.height();
+	pixels.resize(w * h * 4);
+	for (int y = 0; y < h; ++y) {
+		const QRgb *src = (const QRgb *)image.constScanLine(y);
+		u8 *outLine = &pixels[y * w * 4];
+		for (int x = 0; x < w; ++x) {
+			outLine[x * 4 + 0] = qRed(src[x]);
+			outLine[x * 4 + 1] = qGreen(src[x]);
+			outLine[x * 4 + 2] = qBlue(src[x]);
+			outLine[x * 4 + 3] = qAlpha(src[x]);
+		}
+	}
+	bool hasAlpha = true;
+#else
+	png_image png = {};
+	png.version = PNG_IMAGE_VERSION;
+
+	FILE *fp = File::OpenCFile(filename, "rb");
+	if (!fp) {
+		return false;
+	}
+	if (!png_image_begin_read_from_stdio(&png, fp)) {
+		fclose(fp);
+		return false;
+	}
+
+	bool hasAlpha = (png.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+	png.format = PNG_FORMAT_RGBA;
+	w = png.width;
+	h = png.height;
+	pixels.resize(w * h * 4);
+	bool success = png_image_finish_read(&png, nullptr, pixels.data(), w * 4, nullptr) != 0;
+	fclose(fp);
+	png_image_free(&png);
+	if (!success) {
+		return false;
+	}
+#endif
+
+	if (hasAlpha) {
+		alphaStatus = ReplacedTextureAlpha(CheckAlphaRGBA8888Basic((const u32 *)pixels.data(), w, w, h));
+	} else {
+		alphaStatus = ReplacedTextureAlpha::FULL;
+	}
+	return true;
+}
+
+bool TextureReplacer::GeneratePack(const std::string &gameID, std::string *generatedFilename) {
+	if (gameID.empty())
+		return false;
+
+	// Use a separate replacer, so we get the same aliases without touching the active one.
+	TextureReplacer replacer;
+	replacer.basePath_ = GetSysDirectory(DIRECTORY_TEXTURES) + gameID + "/";
+	if (!File::IsDirectory(replacer.basePath_) || !replacer.LoadIni())
+		return false;
+
+	std::vector<ReplacementPackEntry> entries;
+	std::vector<std::string> filenames;
+	auto addEntry = [&](u64 cachekey, u32 hash, int level, u8 flags, const std::string &filename) {
+		ReplacementPackEntry entry{};
+		entry.cachekey = cachekey;
+		entry.hash = hash;
+		entry.level = (u16)level;
+		entry.flags = flags;
+		entries.push_back(entry);
+		filenames.push_back(filename);
+	};
+
+	for (const auto &alias : replacer.aliases_) {
+		const ReplacementAliasKey &key = alias.first;
+		if (alias.second.empty()) {
+			addEntry(key.cachekey, key.hash, key.level, PACK_ENTRY_ALIAS | PACK_ENTRY_IGNORED, "");
+		} else {
+			addEntry(key.cachekey, key.hash, key.level, PACK_ENTRY_ALIAS, replacer.basePath_ + alias.second);
+		}
+	}
+
+	// Files using the default names don't need to be in textures.ini.
+	std::vector<FileInfo> files;
+	getFilesInDir(replacer.basePath_.c_str(), &files, "png");
+	for (const FileInfo &file : files) {
+		u64 cachekey = 0;
+		u32 hash = 0;
+		int level = 0;
+		if (sscanf(file.name.c_str(), "%16llx%8x_%d", &cachekey, &hash, &level) < 2 || level < 0 || level >= MAX_MIP_LEVELS)
+			continue;
+		if (replacer.HashName(cachekey, hash, level) + ".png" != file.name)
+			continue;
+		addEntry(cachekey, hash, level, 0, file.fullName);
+	}
+
+	if (entries.empty()) {
+		ERROR_LOG(G3D, "No texture replacements to pack in %s", replacer.basePath_.c_str());
+		return false;
+	}
+
+	// The running game may have the current pack open, so it swaps this in when it next loads the pack.
+	const std::string packFilename = replacer.basePath_ + NEW_PACK_FILENAME;
+	const std::string tempFilename = packFilename + ".tmp";
+	File::IOFile out(tempFilename, "wb");
+	if (!out.IsOpen()) {
+		ERROR_LOG(G3D, "Could not create texture pack: %s", tempFilename.c_str());
+		return false;
+	}
+
+	ReplacementPackHeader header{};
+	memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+	header.version = PACK_VERSION;
+	header.numEntries = (u32)entries.size();
+	header.indexOffset = sizeof(ReplacementPackHeader);
+
+	// Images go after the index, each aligned.  Aliases often share a file, so share the data too.
+	u64 offset = header.indexOffset + entries.size() * sizeof(ReplacementPackEntry);
+	std::map<std::string, size_t> written;
+	std::vector<u8> pixels;
+	std::vector<ReplacementPackEntry> index;
+	out.Seek(offset, SEEK_SET);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		ReplacementPackEntry &entry = entries[i];
+		const std::string &filename = filenames[i];
+		if (!filename.empty()) {
+			auto prev = written.find(filename);
+			if (prev != written.end()) {
+				const ReplacementPackEntry &other = index[prev->second];
+				entry.w = other.w;
+				entry.h = other.h;
+				entry.alphaStatus = other.alphaStatus;
+				entry.offset = other.offset;
+				entry.size = other.size;
+			} else {
+				int w, h;
+				ReplacedTextureAlpha alphaStatus;
+				if (!DecodeReplacementForPack(filename, pixels, w, h, alphaStatus)) {
+					WARN_LOG(G3D, "Skipping texture replacement that could not be loaded: %s", filename.c_str());
+					continue;
+				}
+
+				static const u8 zeros[PACK_ALIGNMENT] = {};
+				const u64 padding = (PACK_ALIGNMENT - (offset & (PACK_ALIGNMENT - 1))) & (PACK_ALIGNMENT - 1);
+				out.WriteBytes(zeros, (size_t)padding);
+				offset += padding;
+
+				entry.w = w;
+				entry.h = h;
+				entry.alphaStatus = (u8)alphaStatus;
+				entry.offset = offset;
+				entry.size = pixels.size();
+				out.WriteBytes(pixels.data(), pixels.size());
+				offset += pixels.size();
+				written[filename] = index.size();
+			}
+		}
+		entry.format = (u32)ReplacementPackFormat::RGBA8888;
+		index.push_back(entry);
+	}
+
+	// Sorted, so the index could be searched directly.
+	std::sort(index.begin(), index.end(), [](const ReplacementPackEntry &a, const ReplacementPackEntry &b) {
+		if (a.cachekey != b.cachekey)
+			return a.cachekey < b.cachekey;
+		if (a.hash != b.hash)
+			return a.hash < b.hash;
+		return a.level < b.level;
+	});
+	header.numEntries = (u32)index.size();
+
+	out.Seek(0, SEEK_SET);
+	out.WriteBytes(&header, sizeof(header));
+	out.WriteArray(index.data(), index.size());
+	bool success = out.IsGood();
+	out.Close();
+
+	if (success) {
+		// Only hand over the new pack once it's complete.
+		if (File::Exists(packFilename))
+			File::Delete(packFilename);
+		success = File::Rename(tempFilename, packFilename);
+	}
+	if (!success) {
+		ERROR_LOG(G3D, "Could not write texture pack: %s", packFilename.c_str());
+		File::Delete(tempFilename);
+		return false;
+	}
+
+	if (generatedFilename)
+		*generatedFilename = replacer.basePath_ + PACK_FILENAME;
+	INFO_LOG(G3D, "Wrote %d texture replacements to %s", (int)index.size(), packFilename.c_str());
+	return true;
+}
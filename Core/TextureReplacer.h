@@ -17,14 +17,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "Common/Common.h"
 #include "Common/MemoryUtil.h"
+#include "Common/Swap.h"
 #include "GPU/ge_constants.h"
 
+class PrioritizedWorkQueue;
+class ReplacementPack;
 class TextureCacheCommon;
 class TextureReplacer;
 
@@ -53,11 +59,61 @@ enum class ReplacedTextureHash {
 	XXH64,
 };
 
+// Layout of textures.pack, which holds already decoded images of a whole replacement folder.
+// The index follows the header, and payloads are aligned so the file can simply be mapped.
+struct ReplacementPackHeader {
+	char magic[4];
+	u32_le version;
+	u32_le numEntries;
+	u32_le flags;
+	u64_le indexOffset;
+	u64_le reserved;
+};
+
+enum ReplacementPackEntryFlags {
+	// Came from [hashes] in textures.ini, so uses the same fallbacks.  Otherwise an exact name.
+	PACK_ENTRY_ALIAS = 0x01,
+	// Explicitly ignored in textures.ini, has no data.
+	PACK_ENTRY_IGNORED = 0x02,
+};
+
+enum class ReplacementPackFormat {
+	RGBA8888 = 0,
+};
+
+struct ReplacementPackEntry {
+	u64_le cachekey;
+	u32_le hash;
+	u16_le level;
+	u8 flags;
+	// A ReplacedTextureAlpha value.
+	u8 alphaStatus;
+	u32_le w;
+	u32_le h;
+	u32_le format;
+	u32_le reserved;
+	u64_le offset;
+	u64_le size;
+};
+
 struct ReplacedTextureLevel {
 	int w;
 	int h;
 	ReplacedTextureFormat fmt;
 	std::string file;
+	// Used instead of file when loading from textures.pack.
+	std::shared_ptr<ReplacementPack> pack;
+	const ReplacementPackEntry *packEntry = nullptr;
+};
+
+// Decoded images of all levels of a replacement, filled in by a worker.
+struct ReplacedTextureData {
+	// Each level is packed at the size of the corresponding ReplacedTextureLevel.
+	std::vector<std::vector<u8>> levels;
+	ReplacedTextureAlpha alphaStatus = ReplacedTextureAlpha::UNKNOWN;
+	size_t bytes = 0;
+	std::atomic<bool> done{ false };
+	std::atomic<bool> cancelled{ false };
 };
 
 struct ReplacementCacheKey {
@@ -149,13 +205,24 @@ struct ReplacedTexture {
 		return (u8)alphaStatus_;
 	}
 
+	// False while the images are still loading in the background.  Starts loading them if needed.
+	bool IsReady();
 	void Load(int level, void *out, int rowPitch);
 
 protected:
+	static void LoadLevelFromFile(const ReplacedTextureLevel &info, int level, void *out, int rowPitch, ReplacedTextureAlpha &alphaStatus);
+
 	std::vector<ReplacedTextureLevel> levels_;
-	ReplacedTextureAlpha alphaStatus_;
+	ReplacedTextureAlpha alphaStatus_ = ReplacedTextureAlpha::UNKNOWN;
+
+	TextureReplacer *replacer_ = nullptr;
+	std::shared_ptr<ReplacedTextureData> data_;
+	// Where we are in the replacer's LRU list, while data_ counts against its budget.
+	std::list<ReplacedTexture *>::iterator lruPos_;
+	bool inLRU_ = false;
 
 	friend TextureReplacer;
+	friend class ReplacedTextureLoadTask;
 };
 
 struct ReplacedTextureDecodeInfo {
@@ -183,20 +250,32 @@ class TextureReplacer {
 	u32 ComputeHash(u32 addr, int bufw, int w, int h, GETextureFormat fmt, u16 maxSeenV);
 
 	ReplacedTexture &FindReplacement(u64 cachekey, u32 hash, int w, int h);
+	// An invalid replacement, to use while the real one is loading.
+	ReplacedTexture &NoReplacement() {
+		return none_;
+	}
 
 	void NotifyTextureDecoded(const ReplacedTextureDecodeInfo &replacedInfo, const void *data, int pitch, int level, int w, int h);
 
 	static bool GenerateIni(const std::string &gameID, std::string *generatedFilename);
+	// Converts the replacement folder (textures.ini and all its images) to a textures.pack.
+	static bool GeneratePack(const std::string &gameID, std::string *generatedFilename);
 
 protected:
 	bool LoadIni();
+	void LoadPack();
+	void ReleasePack();
 	void ParseHashRange(const std::string &key, const std::string &value);
 	bool LookupHashRange(u32 addr, int &w, int &h);
+	template <typename T>
+	typename T::const_iterator LookupAlias(const T &aliases, u64 cachekey, u32 hash, int level);
 	std::string LookupHashFile(u64 cachekey, u32 hash, int level);
+	const ReplacementPackEntry *LookupPacked(u64 cachekey, u32 hash, int level);
 	std::string HashName(u64 cachekey, u32 hash, int level);
 	void PopulateReplacement(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h);
+	void QueueLoad(ReplacedTexture *texture);
+	void TouchLoaded(ReplacedTexture *texture);
 
-	SimpleBuf<u32> saveBuf;
 	bool enabled_ = false;
 	bool allowVideo_ = false;
 	bool ignoreAddress_ = false;
@@ -207,8 +286,21 @@ class TextureReplacer {
 	typedef std::pair<int, int> WidthHeightPair;
 	std::unordered_map<u64, WidthHeightPair> hashranges_;
 	std::unordered_map<ReplacementAliasKey, std::string> aliases_;
+	std::shared_ptr<ReplacementPack> pack_;
+	std::unordered_map<ReplacementAliasKey, const ReplacementPackEntry *> packAliases_;
+	std::unordered_map<ReplacementAliasKey, const ReplacementPackEntry *> packFiles_;
 
 	ReplacedTexture none_;
 	std::unordered_map<ReplacementCacheKey, ReplacedTexture> cache_;
 	std::unordered_map<ReplacementCacheKey, ReplacedTextureLevel> savedCache_;
+
+	PrioritizedWorkQueue *loadQueue_ = nullptr;
+	// Most recently used first.
+	std::list<ReplacedTexture *> loadedLRU_;
+	size_t loadedBytes_ = 0;
+
+	PrioritizedWorkQueue *saveQueue_ = nullptr;
+	std::atomic<size_t> pendingSaveBytes_{ 0 };
+
+	friend ReplacedTexture;
 };
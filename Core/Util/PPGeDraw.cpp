@@ -286,6 +286,9 @@ void PPGeBegin()
 	if (!dlPtr)
 		return;
 
+	// The last list may still be running on the GE thread.
+	gpu->SyncThread();
+
 	// Reset write pointers to start of command and data buffers.
 	dlWritePtr = dlPtr;
 	dataWritePtr = dataPtr;
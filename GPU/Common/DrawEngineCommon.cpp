@@ -33,7 +33,16 @@ enum {
 	TRANSFORMED_VERTEX_BUFFER_SIZE = VERTEX_BUFFER_MAX * sizeof(TransformedVertex)
 };
 
-DrawEngineCommon::DrawEngineCommon() : decoderMap_(16) {
+#define VERTEXCACHE_DECIMATION_INTERVAL 17
+
+enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
+
+// Full hashes back off exponentially with the number of frames seen, up to this many draws apart.
+static const int VAI_MAX_DRAWS_BETWEEN_FULL_HASH = 24;
+// Uploaded vertex data beyond this gets evicted, least recently drawn first.
+static const size_t VERTEXCACHE_MAX_BYTES = 32 * 1024 * 1024;
+
+DrawEngineCommon::DrawEngineCommon() : decoderMap_(16), vai_(256) {
 	quadIndices_ = new u16[6 * QUAD_INDICES_MAX];
 	decJitCache_ = new VertexDecoderJitCache();
 	transformed = (TransformedVertex *)AllocateMemoryPages(TRANSFORMED_VERTEX_BUFFER_SIZE, MEM_PROT_READ | MEM_PROT_WRITE);
@@ -48,6 +57,166 @@ DrawEngineCommon::~DrawEngineCommon() {
 	decoderMap_.Iterate([&](const uint32_t vtype, VertexDecoder *decoder) {
 		delete decoder;
 	});
+	// Backends free their buffers with ClearTrackedVertexArrays() before we get here.
+	vai_.Iterate([&](uint32_t hash, VertexArrayInfo *vai) {
+		delete vai;
+	});
+}
+
+void DrawEngineCommon::ClearTrackedVertexArrays() {
+	vai_.Iterate([&](uint32_t hash, VertexArrayInfo *vai) {
+		FreeVertexArray(vai);
+		delete vai;
+	});
+	vai_.Clear();
+	vaiLRU_.clear();
+	vaiCachedBytes_ = 0;
+}
+
+void DrawEngineCommon::DecimateTrackedVertexArrays() {
+	// Evict the least recently drawn uploads until we're within budget.  These stay tracked,
+	// and get uploaded again if they're drawn again.
+	while (vaiCachedBytes_ > VERTEXCACHE_MAX_BYTES && !vaiLRU_.empty()) {
+		VertexArrayInfo *vai = vaiLRU_.back();
+		if (vai->lastFrame == gpuStats.numFlips) {
+			// Everything left is in use this frame.
+			break;
+		}
+		EvictVertexArray(vai);
+		gpuStats.numVertexCacheEvictions++;
+	}
+
+	if (--decimationCounter_ <= 0) {
+		decimationCounter_ = VERTEXCACHE_DECIMATION_INTERVAL;
+	} else {
+		return;
+	}
+
+	const int threshold = gpuStats.numFlips - VAI_KILL_AGE;
+	const int unreliableThreshold = gpuStats.numFlips - VAI_UNRELIABLE_KILL_AGE;
+	int unreliableLeft = VAI_UNRELIABLE_KILL_MAX;
+	vai_.Iterate([&](uint32_t hash, VertexArrayInfo *vai) {
+		bool kill;
+		if (vai->status == VertexArrayInfo::VAI_UNRELIABLE) {
+			// We limit killing unreliable so we don't rehash too often.
+			kill = vai->lastFrame < unreliableThreshold && --unreliableLeft >= 0;
+		} else {
+			kill = vai->lastFrame < threshold;
+		}
+		if (kill) {
+			EvictVertexArray(vai);
+			delete vai;
+			vai_.Remove(hash);
+		}
+	});
+	vai_.Maintain();
+}
+
+void DrawEngineCommon::EvictVertexArray(VertexArrayInfo *vai) {
+	FreeVertexArray(vai);
+	if (vai->cachedBytes != 0) {
+		vaiLRU_.erase(vai->lruPos);
+		vaiCachedBytes_ -= vai->cachedBytes;
+		vai->cachedBytes = 0;
+	}
+	// Make sure it's fully validated before it's uploaded again.
+	vai->drawsUntilNextFullHash = 0;
+}
+
+void DrawEngineCommon::MarkUnreliable(VertexArrayInfo *vai) {
+	vai->status = VertexArrayInfo::VAI_UNRELIABLE;
+	EvictVertexArray(vai);
+}
+
+VertexCacheAction DrawEngineCommon::LookupVertexCache(VertexArrayInfo **result) {
+	u32 id = dcid_ ^ gstate.getUVGenMode();  // This can have an effect on which UV decoder we need to use! And hence what the decoded data will look like. See #9263
+	VertexArrayInfo *vai = vai_.Get(id);
+	if (!vai) {
+		vai = CreateVertexArray();
+		vai_.Insert(id, vai);
+	}
+	*result = vai;
+
+	if (vai->status != VertexArrayInfo::VAI_NEW) {
+		vai->numDraws++;
+		if (vai->lastFrame != gpuStats.numFlips) {
+			vai->numFrames++;
+		}
+	}
+	vai->lastFrame = gpuStats.numFlips;
+
+	VertexCacheAction action = VertexCacheAction::DECODE;
+	switch (vai->status) {
+	case VertexArrayInfo::VAI_NEW:
+		// Haven't seen this one before.  We don't actually upload the vertex data yet.
+		vai->hash = ComputeHash();
+		vai->minihash = ComputeMiniHash();
+		vai->status = VertexArrayInfo::VAI_HASHING;
+		vai->drawsUntilNextFullHash = 0;
+		break;
+
+	// Hashing - still gaining confidence about the buffer.
+	// But if we get this far it's likely to be worth uploading the data.
+	case VertexArrayInfo::VAI_HASHING:
+		if (vai->drawsUntilNextFullHash == 0) {
+			// Let's try to skip a full hash if mini would fail.
+			const u32 newMiniHash = ComputeMiniHash();
+			if (newMiniHash != vai->minihash || ComputeHash() != vai->hash) {
+				MarkUnreliable(vai);
+				break;
+			}
+			if (vertexCountInDrawCalls_ > 64) {
+				// exponential backoff up to 16 draws, then every 24
+				vai->drawsUntilNextFullHash = std::min(VAI_MAX_DRAWS_BETWEEN_FULL_HASH, vai->numFrames);
+			} else {
+				// Lower numbers seem much more likely to change.
+				vai->drawsUntilNextFullHash = 0;
+			}
+		} else {
+			vai->drawsUntilNextFullHash--;
+			if (ComputeMiniHash() != vai->minihash) {
+				MarkUnreliable(vai);
+				break;
+			}
+		}
+		action = vai->cachedBytes != 0 ? VertexCacheAction::DRAW_CACHED : VertexCacheAction::UPLOAD;
+		break;
+
+	// Reliable - we don't even bother hashing anymore. Right now we don't go here until after a very long time.
+	case VertexArrayInfo::VAI_RELIABLE:
+		action = vai->cachedBytes != 0 ? VertexCacheAction::DRAW_CACHED : VertexCacheAction::UPLOAD;
+		break;
+
+	case VertexArrayInfo::VAI_UNRELIABLE:
+		break;
+	}
+
+	if (action == VertexCacheAction::DRAW_CACHED) {
+		gpuStats.numCachedDrawCalls++;
+		gpuStats.numCachedVertsDrawn += vai->numVerts;
+		gstate_c.vertexFullAlpha = (vai->flags & VAI_FLAG_VERTEXFULLALPHA) != 0;
+		vaiLRU_.splice(vaiLRU_.begin(), vaiLRU_, vai->lruPos);
+	} else if (action == VertexCacheAction::DECODE) {
+		gpuStats.numVertexCacheMisses++;
+	}
+	return action;
+}
+
+void DrawEngineCommon::StoreVertexArrayDrawInfo(VertexArrayInfo *vai) {
+	vai->numVerts = indexGen.VertexCount();
+	vai->prim = indexGen.Prim();
+	vai->maxIndex = indexGen.MaxIndex();
+	vai->flags = gstate_c.vertexFullAlpha ? VAI_FLAG_VERTEXFULLALPHA : 0;
+}
+
+void DrawEngineCommon::NotifyVertexArrayUploaded(VertexArrayInfo *vai, u32 bytes) {
+	_dbg_assert_msg_(G3D, vai->cachedBytes == 0, "Vertex array uploaded twice");
+	// Count at least something, so cachedBytes != 0 means it has buffers.
+	vai->cachedBytes = std::max(bytes, 1U);
+	vaiLRU_.push_front(vai);
+	vai->lruPos = vaiLRU_.begin();
+	vaiCachedBytes_ += vai->cachedBytes;
+	gpuStats.numVertexCacheUploads++;
 }
 
 VertexDecoder *DrawEngineCommon::GetVertexDecoder(u32 vtype) {
@@ -704,6 +873,10 @@ void DrawEngineCommon::SubmitPrim(void *verts, void *inds, GEPrimitiveType prim,
 		dhash = __rotl(dhash ^ (u32)(uintptr_t)inds, 13);
 		dhash = __rotl(dhash ^ (u32)vertTypeID, 13);
 		dhash = __rotl(dhash ^ (u32)vertexCount, 13);
+		// The indices only depend on whether the winding gets flipped at flush, not the mode itself.
+		// gstate's cull mode can't change before that without a flush.
+		const bool flipWinding = cullMode != -1 && cullMode != gstate.getCullMode();
+		dhash = __rotl(dhash ^ (u32)flipWinding, 13);
 		dcid_ = dhash ^ (u32)prim;
 	}
 
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <list>
 #include <vector>
 #include <unordered_map>
 
@@ -50,6 +51,89 @@ inline uint32_t GetVertTypeID(uint32_t vertType, int uvGenMode) {
 	return (vertType & 0xFFFFFF) | (uvGenMode << 24);
 }
 
+enum {
+	VAI_FLAG_VERTEXFULLALPHA = 1,
+};
+
+// Tracks how often the vertex data behind a draw changes, to decide whether to keep it decoded
+// in a buffer.  Backends derive from this to hold the buffers they uploaded it to.
+class VertexArrayInfo {
+public:
+	VertexArrayInfo() {
+		lastFrame = gpuStats.numFlips;
+	}
+	virtual ~VertexArrayInfo() {}
+
+	enum VAIStatus : uint8_t {
+		VAI_NEW,
+		VAI_HASHING,
+		VAI_RELIABLE,  // cache, don't hash
+		VAI_UNRELIABLE,  // never cache
+	};
+
+	ReliableHashType hash = 0;
+	u32 minihash = 0;
+
+	// Precalculated parameters for drawing from the uploaded buffers.
+	u16 numVerts = 0;
+	u16 maxIndex = 0;
+	s8 prim = GE_PRIM_INVALID;
+	VAIStatus status = VAI_NEW;
+
+	// ID information
+	int numDraws = 0;
+	int numFrames = 0;
+	int lastFrame;  // So that we can forget.
+	u16 drawsUntilNextFullHash = 0;
+	u8 flags = 0;
+
+	// Size of the uploaded buffers, 0 if there are none.  Counts against the cache budget.
+	u32 cachedBytes = 0;
+	std::list<VertexArrayInfo *>::iterator lruPos;
+};
+
+// Identifies the output of software spline/bezier tessellation.  All u32, so there's no padding to hash.
+struct TessellationCacheKey {
+	// The control points after NormalizeVertices(), and the indices.
+	ReliableHashType dataHash;
+	u32 origVertType;
+	u32 tess_u;
+	u32 tess_v;
+	u32 count_u;
+	u32 count_v;
+	u32 type_u;
+	u32 type_v;
+	u32 primType;
+	u32 computeNormals;
+	u32 patchFacing;
+	u32 quality;
+	u32 bezier;
+};
+
+struct TessellationCacheEntry {
+	TessellationCacheKey key;
+	int lastFrame = 0;
+	int uses = 0;
+	// Only filled in once the same patch is seen again, so animated ones aren't copied for nothing.
+	bool stored = false;
+	int count = 0;
+	std::vector<u8> verts;
+	std::vector<u16> inds;
+
+	size_t Bytes() const {
+		return verts.size() + inds.size() * sizeof(u16);
+	}
+};
+
+enum class VertexCacheAction {
+	// Decode as usual, it's not cacheable (yet.)
+	DECODE,
+	// Decode and upload to buffers owned by the VertexArrayInfo, then call NotifyVertexArrayUploaded().
+	UPLOAD,
+	// Draw straight from the VertexArrayInfo's buffers.
+	DRAW_CACHED,
+};
+
 class DrawEngineCommon {
 public:
 	DrawEngineCommon();
@@ -90,8 +174,24 @@ class DrawEngineCommon {
 
 	VertexDecoder *GetVertexDecoder(u32 vtype);
 
+	void ClearTrackedVertexArrays();
+	// Forgets old vertex arrays and evicts uploads over budget, call once per frame.
+	void DecimateTrackedVertexArrays();
+
 protected:
-	virtual void ClearTrackedVertexArrays() {}
+	// Backends create their own subclass, and free its buffers (but not the info itself.)
+	virtual VertexArrayInfo *CreateVertexArray() {
+		return new VertexArrayInfo();
+	}
+	virtual void FreeVertexArray(VertexArrayInfo *vai) {}
+
+	// Validates the current draw calls against the vertex cache, and says what to do with them.
+	VertexCacheAction LookupVertexCache(VertexArrayInfo **result);
+	// After decoding for UPLOAD, remembers the indexGen results so they can be drawn from the cache.
+	void StoreVertexArrayDrawInfo(VertexArrayInfo *vai);
+	void NotifyVertexArrayUploaded(VertexArrayInfo *vai, u32 bytes);
+	void MarkUnreliable(VertexArrayInfo *vai);
+	void EvictVertexArray(VertexArrayInfo *vai);
 
 	int ComputeNumVertsToDecode() const;
 	void DecodeVerts(u8 *dest);
@@ -99,6 +199,12 @@ class DrawEngineCommon {
 	// Preprocessing for spline/bezier
 	u32 NormalizeVertices(u8 *outPtr, u8 *bufPtr, const u8 *inPtr, int lowerBound, int upperBound, u32 vertType, int *vertexSize = nullptr);
 
+	// Returns the entry for this patch, which has the tessellated result if it's stored.
+	TessellationCacheEntry *LookupTessellation(const TessellationCacheKey &key);
+	// Call after tessellating on a lookup miss, it's up to the cache whether to keep it.
+	void StoreTessellation(TessellationCacheEntry *entry, const u8 *verts, size_t vertsSize, const u16 *inds, int count);
+	void DecimateTessellationCache();
+
 	// Utility for vertex caching
 	u32 ComputeMiniHash();
 	ReliableHashType ComputeHash();
@@ -155,6 +261,12 @@ class DrawEngineCommon {
 	int decodeCounter_ = 0;
 	u32 dcid_ = 0;
 
+	// Vertex cache
+	PrehashMap<VertexArrayInfo *, nullptr> vai_;
+	// Only arrays with uploaded buffers, most recently drawn first.
+	std::list<VertexArrayInfo *> vaiLRU_;
+	size_t vaiCachedBytes_ = 0;
+
 	// Vertex collector state
 	IndexGenerator indexGen;
 	int decodedVerts_ = 0;
@@ -163,6 +275,12 @@ class DrawEngineCommon {
 	// Fixed index buffer for easy quad generation from spline/bezier
 	u16 *quadIndices_ = nullptr;
 
+	// Software tessellated splines/beziers, by hash of their TessellationCacheKey.
+	std::unordered_map<ReliableHashType, TessellationCacheEntry> tessCache_;
+	size_t tessCacheBytes_ = 0;
+	int tessCacheFrame_ = -1;
+	int tessDecimationCounter_ = 0;
+
 	// Shader blending state
 	bool fboTexNeedBind_ = false;
 	bool fboTexBound_ = false;
@@ -20,6 +20,10 @@
 
 #include "Common/Common.h"
 
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+
 // Points don't need indexing...
 const u8 IndexGenerator::indexedPrimitiveType[7] = {
 	GE_PRIM_POINTS,
@@ -31,6 +35,83 @@ const u8 IndexGenerator::indexedPrimitiveType[7] = {
 	GE_PRIM_RECTANGLES,
 };
 
+#if defined(_M_SSE)
+// Index patterns for whole groups of primitives.  Each group is N vectors of 8 indices, and
+// the pattern advances by the matching step after every group.
+alignas(16) static const u16 seqPattern[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+alignas(16) static const u16 seqStep[8] = { 8, 8, 8, 8, 8, 8, 8, 8 };
+alignas(16) static const u16 seqStep3[24] = {
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+};
+
+// 8 triangles each.
+alignas(16) static const u16 listCCWPattern[24] = {
+	0, 2, 1, 3, 5, 4, 6, 8, 7, 9, 11, 10, 12, 14, 13, 15, 17, 16, 18, 20, 19, 21, 23, 22,
+};
+alignas(16) static const u16 listCCWStep[24] = {
+	24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+};
+alignas(16) static const u16 stripPattern[2][24] = {
+	{ 0, 2, 1, 1, 2, 3, 2, 4, 3, 3, 4, 5, 4, 6, 5, 5, 6, 7, 6, 8, 7, 7, 8, 9 },
+	{ 0, 1, 2, 1, 3, 2, 2, 3, 4, 3, 5, 4, 4, 5, 6, 5, 7, 6, 6, 7, 8, 7, 9, 8 },
+};
+alignas(16) static const u16 fanPattern[2][24] = {
+	{ 0, 2, 1, 0, 3, 2, 0, 4, 3, 0, 5, 4, 0, 6, 5, 0, 7, 6, 0, 8, 7, 0, 9, 8 },
+	{ 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5, 0, 5, 6, 0, 6, 7, 0, 7, 8, 0, 8, 9 },
+};
+alignas(16) static const u16 fanStep[24] = {
+	0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8, 0, 8, 8,
+};
+
+// 8 lines.
+alignas(16) static const u16 lineStripPattern[16] = { 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8 };
+
+template <int N>
+static u16 *GeneratePattern(u16 *out, int groups, int base, const u16 *pattern, const u16 *step) {
+	const __m128i baseVec = _mm_set1_epi16((short)base);
+	__m128i cur[N], inc[N];
+	for (int v = 0; v < N; ++v) {
+		cur[v] = _mm_add_epi16(_mm_load_si128((const __m128i *)pattern + v), baseVec);
+		inc[v] = _mm_load_si128((const __m128i *)step + v);
+	}
+	for (int g = 0; g < groups; ++g) {
+		for (int v = 0; v < N; ++v) {
+			_mm_storeu_si128((__m128i *)out + v, cur[v]);
+			cur[v] = _mm_add_epi16(cur[v], inc[v]);
+		}
+		out += N * 8;
+	}
+	return out;
+}
+
+// Adds offset to count indices, in blocks of 8.  Returns how many were translated.
+template <class ITypeLE>
+static inline int TranslateIndicesSSE(u16 *out, const ITypeLE *inds, int count, int offset) {
+	return 0;
+}
+
+static inline int TranslateIndicesSSE(u16 *out, const u8 *inds, int count, int offset) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offsetVec = _mm_set1_epi16((short)offset);
+	count = count / 8 * 8;
+	for (int i = 0; i < count; i += 8) {
+		const __m128i in = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(inds + i)), zero);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_add_epi16(in, offsetVec));
+	}
+	return count;
+}
+
+static inline int TranslateIndicesSSE(u16 *out, const u16_le *inds, int count, int offset) {
+	const __m128i offsetVec = _mm_set1_epi16((short)offset);
+	count = count / 8 * 8;
+	for (int i = 0; i < count; i += 8) {
+		const __m128i in = _mm_loadu_si128((const __m128i *)(inds + i));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_add_epi16(in, offsetVec));
+	}
+	return count;
+}
+#endif
+
 void IndexGenerator::Setup(u16 *inds) {
 	this->indsBase_ = inds;
 	Reset();
@@ -51,7 +132,12 @@ void IndexGenerator::AddPrim(int prim, int vertexCount, bool clockwise) {
 void IndexGenerator::AddPoints(int numVerts) {
 	u16 *outInds = inds_;
 	const int startIndex = index_;
-	for (int i = 0; i < numVerts; i++)
+	int i = 0;
+#if defined(_M_SSE)
+	outInds = GeneratePattern<1>(outInds, numVerts / 8, startIndex, seqPattern, seqStep);
+	i = numVerts / 8 * 8;
+#endif
+	for (; i < numVerts; i++)
 		*outInds++ = startIndex + i;
 	inds_ = outInds;
 	// ignore overflow verts
@@ -66,7 +152,17 @@ void IndexGenerator::AddList(int numVerts, bool clockwise) {
 	const int startIndex = index_;
 	const int v1 = clockwise ? 1 : 2;
 	const int v2 = clockwise ? 2 : 1;
-	for (int i = 0; i < numVerts; i += 3) {
+	int i = 0;
+#if defined(_M_SSE)
+	// Clockwise lists are just sequential.
+	const int groups = numVerts / 24;
+	if (clockwise)
+		outInds = GeneratePattern<1>(outInds, groups * 3, startIndex, seqPattern, seqStep);
+	else
+		outInds = GeneratePattern<3>(outInds, groups, startIndex, listCCWPattern, listCCWStep);
+	i = groups * 24;
+#endif
+	for (; i < numVerts; i += 3) {
 		*outInds++ = startIndex + i;
 		*outInds++ = startIndex + i + v1;
 		*outInds++ = startIndex + i + v2;
@@ -76,7 +172,7 @@ void IndexGenerator::AddList(int numVerts, bool clockwise) {
 	index_ += numVerts;
 	count_ += numVerts;
 	prim_ = GE_PRIM_TRIANGLES;
-	seenPrims_ |= 1 << GE_PRIM_TRIANGLES;
+	seenPrims_ |= (1 << GE_PRIM_TRIANGLES) | (clockwise ? 0 : SEEN_REVERSED);
 }
 
 void IndexGenerator::AddStrip(int numVerts, bool clockwise) {
@@ -84,7 +180,16 @@ void IndexGenerator::AddStrip(int numVerts, bool clockwise) {
 	const int numTris = numVerts - 2;
 	u16 *outInds = inds_;
 	int ibase = index_;
-	for (int i = 0; i < numTris; i++) {
+	int i = 0;
+#if defined(_M_SSE)
+	// Groups of 8 triangles end with the winding they started with.
+	if (numTris >= 8) {
+		outInds = GeneratePattern<3>(outInds, numTris / 8, ibase, stripPattern[clockwise ? 1 : 0], seqStep3);
+		i = numTris & ~7;
+		ibase += i;
+	}
+#endif
+	for (; i < numTris; i++) {
 		*outInds++ = ibase;
 		*outInds++ = ibase + wind;
 		wind ^= 3;  // toggle between 1 and 2
@@ -96,7 +201,7 @@ void IndexGenerator::AddStrip(int numVerts, bool clockwise) {
 	if (numTris > 0)
 		count_ += numTris * 3;
 	// This is so we can detect one single strip by just looking at seenPrims_.
-	if (!seenPrims_) {
+	if (!seenPrims_ && clockwise) {
 		seenPrims_ = 1 << GE_PRIM_TRIANGLE_STRIP;
 		prim_ = GE_PRIM_TRIANGLE_STRIP;
 		pureCount_ = numVerts;
@@ -113,7 +218,14 @@ void IndexGenerator::AddFan(int numVerts, bool clockwise) {
 	const int startIndex = index_;
 	const int v1 = clockwise ? 1 : 2;
 	const int v2 = clockwise ? 2 : 1;
-	for (int i = 0; i < numTris; i++) {
+	int i = 0;
+#if defined(_M_SSE)
+	if (numTris >= 8) {
+		outInds = GeneratePattern<3>(outInds, numTris / 8, startIndex, fanPattern[clockwise ? 1 : 0], fanStep);
+		i = numTris & ~7;
+	}
+#endif
+	for (; i < numTris; i++) {
 		*outInds++ = startIndex;
 		*outInds++ = startIndex + i + v1;
 		*outInds++ = startIndex + i + v2;
@@ -129,7 +241,12 @@ void IndexGenerator::AddFan(int numVerts, bool clockwise) {
 void IndexGenerator::AddLineList(int numVerts) {
 	u16 *outInds = inds_;
 	const int startIndex = index_;
-	for (int i = 0; i < numVerts; i += 2) {
+	int i = 0;
+#if defined(_M_SSE)
+	outInds = GeneratePattern<1>(outInds, numVerts / 8, startIndex, seqPattern, seqStep);
+	i = numVerts / 8 * 8;
+#endif
+	for (; i < numVerts; i += 2) {
 		*outInds++ = startIndex + i;
 		*outInds++ = startIndex + i + 1;
 	}
@@ -144,7 +261,14 @@ void IndexGenerator::AddLineStrip(int numVerts) {
 	const int numLines = numVerts - 1;
 	u16 *outInds = inds_;
 	const int startIndex = index_;
-	for (int i = 0; i < numLines; i++) {
+	int i = 0;
+#if defined(_M_SSE)
+	if (numLines >= 8) {
+		outInds = GeneratePattern<2>(outInds, numLines / 8, startIndex, lineStripPattern, seqStep3);
+		i = numLines & ~7;
+	}
+#endif
+	for (; i < numLines; i++) {
 		*outInds++ = startIndex + i;
 		*outInds++ = startIndex + i + 1;
 	}
@@ -160,7 +284,12 @@ void IndexGenerator::AddRectangles(int numVerts) {
 	const int startIndex = index_;
 	//rectangles always need 2 vertices, disregard the last one if there's an odd number
 	numVerts = numVerts & ~1;
-	for (int i = 0; i < numVerts; i += 2) {
+	int i = 0;
+#if defined(_M_SSE)
+	outInds = GeneratePattern<1>(outInds, numVerts / 8, startIndex, seqPattern, seqStep);
+	i = numVerts / 8 * 8;
+#endif
+	for (; i < numVerts; i += 2) {
 		*outInds++ = startIndex + i;
 		*outInds++ = startIndex + i + 1;
 	}
@@ -175,7 +304,12 @@ template <class ITypeLE, int flag>
 void IndexGenerator::TranslatePoints(int numInds, const ITypeLE *inds, int indexOffset) {
 	indexOffset = index_ - indexOffset;
 	u16 *outInds = inds_;
-	for (int i = 0; i < numInds; i++)
+	int i = 0;
+#if defined(_M_SSE)
+	i = TranslateIndicesSSE(outInds, inds, numInds, indexOffset);
+	outInds += i;
+#endif
+	for (; i < numInds; i++)
 		*outInds++ = indexOffset + inds[i];
 	inds_ = outInds;
 	count_ += numInds;
@@ -188,7 +322,12 @@ void IndexGenerator::TranslateLineList(int numInds, const ITypeLE *inds, int ind
 	indexOffset = index_ - indexOffset;
 	u16 *outInds = inds_;
 	numInds = numInds & ~1;
-	for (int i = 0; i < numInds; i += 2) {
+	int i = 0;
+#if defined(_M_SSE)
+	i = TranslateIndicesSSE(outInds, inds, numInds, indexOffset);
+	outInds += i;
+#endif
+	for (; i < numInds; i += 2) {
 		*outInds++ = indexOffset + inds[i];
 		*outInds++ = indexOffset + inds[i + 1];
 	}
@@ -218,7 +357,7 @@ void IndexGenerator::TranslateList(int numInds, const ITypeLE *inds, int indexOf
 	indexOffset = index_ - indexOffset;
 	// We only bother doing this minor optimization in triangle list, since it's by far the most
 	// common operation that can benefit.
-	if (sizeof(ITypeLE) == sizeof(inds_[0]) && indexOffset == 0) {
+	if (sizeof(ITypeLE) == sizeof(inds_[0]) && indexOffset == 0 && clockwise) {
 		memcpy(inds_, inds, numInds * sizeof(ITypeLE));
 		inds_ += numInds;
 		count_ += numInds;
@@ -228,7 +367,15 @@ void IndexGenerator::TranslateList(int numInds, const ITypeLE *inds, int indexOf
 		numInds = numTris * 3;
 		const int v1 = clockwise ? 1 : 2;
 		const int v2 = clockwise ? 2 : 1;
-		for (int i = 0; i < numInds; i += 3) {
+		int i = 0;
+#if defined(_M_SSE)
+		// In whole triangles, so the rest can pick up where this left off.
+		if (clockwise) {
+			i = TranslateIndicesSSE(outInds, inds, numInds - numInds % 24, indexOffset);
+			outInds += i;
+		}
+#endif
+		for (; i < numInds; i += 3) {
 			*outInds++ = indexOffset + inds[i];
 			*outInds++ = indexOffset + inds[i + v1];
 			*outInds++ = indexOffset + inds[i + v2];
@@ -283,7 +430,12 @@ inline void IndexGenerator::TranslateRectangles(int numInds, const ITypeLE *inds
 	u16 *outInds = inds_;
 	//rectangles always need 2 vertices, disregard the last one if there's an odd number
 	numInds = numInds & ~1;
-	for (int i = 0; i < numInds; i += 2) {
+	int i = 0;
+#if defined(_M_SSE)
+	i = TranslateIndicesSSE(outInds, inds, numInds, indexOffset);
+	outInds += i;
+#endif
+	for (; i < numInds; i += 2) {
 		*outInds++ = indexOffset + inds[i];
 		*outInds++ = indexOffset + inds[i+1];
 	}
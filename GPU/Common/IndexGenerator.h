@@ -106,6 +106,8 @@ class IndexGenerator {
 		SEEN_INDEX8 = 1 << 16,
 		SEEN_INDEX16 = 1 << 17,
 		SEEN_INDEX32 = 1 << 18,
+		// Triangles were wound the other way, so they can't be drawn without the indices.
+		SEEN_REVERSED = 1 << 19,
 	};
 
 	u16 *indsBase_;
@@ -22,11 +22,13 @@
 
 #include "Common/CPUDetect.h"
 #include "Common/MemoryUtil.h"
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 
 #include "GPU/Common/GPUStateUtils.h"
 #include "GPU/Common/SplineCommon.h"
 #include "GPU/Common/DrawEngineCommon.h"
+#include "GPU/Common/TextureDecoder.h"  // for ReliableHash
 #include "GPU/ge_constants.h"
 #include "GPU/GPUState.h"  // only needed for UVScale stuff
 
@@ -78,6 +80,12 @@ inline __m128 SSENormalizeMultiplier(bool useSSE4, __m128 v)
 #define START_OPEN 1
 #define END_OPEN 2
 
+// Tessellating more vertices than this at once is split across threads.
+static const int MIN_THREADED_TESS_VERTICES = 4096;
+
+enum { TESSCACHE_KILL_AGE = 60, TESSCACHE_DECIMATION_INTERVAL = 13 };
+// Tessellated patches beyond this just aren't stored, until older ones are forgotten.
+static const size_t TESSCACHE_MAX_BYTES = 16 * 1024 * 1024;
 
 
 static void CopyQuad(u8 *&dest, const SimpleVertex *v1, const SimpleVertex *v2, const SimpleVertex *v3, const SimpleVertex *v4) {
@@ -125,30 +133,41 @@ inline float bern2deriv(float x) { return 3 * (2 - 3 * x) * x; }
 inline float bern3deriv(float x) { return 3 * x * x; }
 
 // http://en.wikipedia.org/wiki/Bernstein_polynomial
-static Math3D::Vec2f Bernstein3D(const Math3D::Vec2f& p0, const Math3D::Vec2f& p1, const Math3D::Vec2f& p2, const Math3D::Vec2f& p3, float x) {
-	if (x == 0) return p0;
-	else if (x == 1) return p3;
-	return p0 * bern0(x) + p1 * bern1(x) + p2 * bern2(x) + p3 * bern3(x);
+// All four basis functions at once, for evaluating many curves at the same x.
+static inline Vec4f BernsteinWeights(float x) {
+	return Vec4f(bern0(x), bern1(x), bern2(x), bern3(x));
 }
 
-static Vec3f Bernstein3D(const Vec3f& p0, const Vec3f& p1, const Vec3f& p2, const Vec3f& p3, float x) {
-	if (x == 0) return p0;
-	else if (x == 1) return p3;
-	return p0 * bern0(x) + p1 * bern1(x) + p2 * bern2(x) + p3 * bern3(x);
+static inline Vec4f BernsteinDerivativeWeights(float x) {
+	return Vec4f(bern0deriv(x), bern1deriv(x), bern2deriv(x), bern3deriv(x));
 }
 
-static Vec4f Bernstein3D(const Vec4f& p0, const Vec4f& p1, const Vec4f& p2, const Vec4f& p3, float x) {
-	if (x == 0) return p0;
-	else if (x == 1) return p3;
-	return p0 * bern0(x) + p1 * bern1(x) + p2 * bern2(x) + p3 * bern3(x);
+static inline Math3D::Vec2f WeightedSum(const Math3D::Vec2f &p0, const Math3D::Vec2f &p1, const Math3D::Vec2f &p2, const Math3D::Vec2f &p3, const Vec4f &w) {
+	return p0 * w.x + p1 * w.y + p2 * w.z + p3 * w.w;
 }
 
-static Vec4f Bernstein3D(const u32& p0, const u32& p1, const u32& p2, const u32& p3, float x) {
-	return Bernstein3D(Vec4f::FromRGBA(p0), Vec4f::FromRGBA(p1), Vec4f::FromRGBA(p2), Vec4f::FromRGBA(p3), x);
+static inline Vec3f WeightedSum(const Vec3f &p0, const Vec3f &p1, const Vec3f &p2, const Vec3f &p3, const Vec4f &w) {
+#ifdef _M_SSE
+	__m128 sum = _mm_mul_ps(p0.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(0, 0, 0, 0)));
+	sum = _mm_add_ps(sum, _mm_mul_ps(p1.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(1, 1, 1, 1))));
+	sum = _mm_add_ps(sum, _mm_mul_ps(p2.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(2, 2, 2, 2))));
+	sum = _mm_add_ps(sum, _mm_mul_ps(p3.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(3, 3, 3, 3))));
+	return Vec3f(sum);
+#else
+	return p0 * w.x + p1 * w.y + p2 * w.z + p3 * w.w;
+#endif
 }
 
-static Vec3f Bernstein3DDerivative(const Vec3f& p0, const Vec3f& p1, const Vec3f& p2, const Vec3f& p3, float x) {
-	return p0 * bern0deriv(x) + p1 * bern1deriv(x) + p2 * bern2deriv(x) + p3 * bern3deriv(x);
+static inline Vec4f WeightedSum(const Vec4f &p0, const Vec4f &p1, const Vec4f &p2, const Vec4f &p3, const Vec4f &w) {
+#ifdef _M_SSE
+	__m128 sum = _mm_mul_ps(p0.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(0, 0, 0, 0)));
+	sum = _mm_add_ps(sum, _mm_mul_ps(p1.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(1, 1, 1, 1))));
+	sum = _mm_add_ps(sum, _mm_mul_ps(p2.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(2, 2, 2, 2))));
+	sum = _mm_add_ps(sum, _mm_mul_ps(p3.vec, _mm_shuffle_ps(w.vec, w.vec, _MM_SHUFFLE(3, 3, 3, 3))));
+	return Vec4f(sum);
+#else
+	return p0 * w.x + p1 * w.y + p2 * w.z + p3 * w.w;
+#endif
 }
 
 static void spline_n_4(int i, float t, float *knot, float *splineVal) {
@@ -224,6 +243,41 @@ static void spline_knot(int n, int type, float *knot) {
 	}
 }
 
+// Where one tessellated row or column falls in the spline, and its basis function weights.
+struct SplineSpan {
+	// The first control point with an influence.
+	int index;
+	// How many do, less than 4 at the end of degenerate patches.
+	int count;
+	float weights[4];
+};
+
+// The weights only depend on the position along one direction, so they're shared by each row or column.
+static void ComputeSplineSpans(SplineSpan *spans, int divs, int count, int type) {
+	float *knot = new float[count + 4];
+	spline_knot(count - 1, type, knot);
+
+	const float one_over_divs = 1.0f / (float)divs;
+	for (int tile = 0; tile < divs + 1; tile++) {
+		float t = (float)tile * (float)(count - 3) * one_over_divs;
+		if (t < 0.0f)
+			t = 0.0f;
+
+		int i = (int)t;
+		// TODO: Would really like to fix the surrounding logic somehow to get rid of these but I can't quite get it right..
+		// Without the previous epsilons and with large count_u, we will end up doing an out of bounds access later without these.
+		if (i >= count - 3)
+			i = count - 4;
+
+		spline_n_4(i, t, knot, spans[tile].weights);
+		spans[tile].index = i;
+		// Handle degenerate patches. without this, spatch.points[] may read outside the number of initialized points.
+		spans[tile].count = std::min(count - i, 4);
+	}
+
+	delete[] knot;
+}
+
 bool CanUseHardwareTessellation(GEPatchPrimType prim) {
 	if (g_Config.bHardwareTessellation && !g_Config.bSoftwareRendering) {
 		return CanUseHardwareTransform(PatchPrimToPrim(prim));
@@ -357,11 +411,6 @@ static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const Sp
 	// Full (mostly) correct tessellation of spline patches.
 	// Not very fast.
 
-	float *knot_u = new float[spatch.count_u + 4];
-	float *knot_v = new float[spatch.count_v + 4];
-	spline_knot(spatch.count_u - 1, spatch.type_u, knot_u);
-	spline_knot(spatch.count_v - 1, spatch.type_v, knot_v);
-
 	// Increase tessellation based on the size. Should be approximately right?
 	int patch_div_s = (spatch.count_u - 3) * spatch.tess_u;
 	int patch_div_t = (spatch.count_v - 3) * spatch.tess_v;
@@ -384,133 +433,105 @@ static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const Sp
 	if (patch_div_s < 1) patch_div_s = 1;
 	if (patch_div_t < 1) patch_div_t = 1;
 
+	std::vector<SplineSpan> spans_u(patch_div_s + 1);
+	std::vector<SplineSpan> spans_v(patch_div_t + 1);
+	ComputeSplineSpans(spans_u.data(), patch_div_s, spatch.count_u, spatch.type_u);
+	ComputeSplineSpans(spans_v.data(), patch_div_t, spatch.count_v, spatch.type_v);
+
 	// First compute all the vertices and put them in an array
-	SimpleVertex *&vertices = (SimpleVertex*&)dest;
+	SimpleVertex *vertices = (SimpleVertex *)dest;
+	const int numVertices = (patch_div_s + 1) * (patch_div_t + 1);
 
 	float tu_width = (float)spatch.count_u - 3.0f;
 	float tv_height = (float)spatch.count_v - 3.0f;
 
-	// int max_idx = spatch.count_u * spatch.count_v;
-
 	bool computeNormals = spatch.computeNormals;
 
 	float one_over_patch_div_s = 1.0f / (float)(patch_div_s);
 	float one_over_patch_div_t = 1.0f / (float)(patch_div_t);
 
-	for (int tile_v = 0; tile_v < patch_div_t + 1; tile_v++) {
-		float v = (float)tile_v * (float)(spatch.count_v - 3) * one_over_patch_div_t;
-		if (v < 0.0f)
-			v = 0.0f;
-		for (int tile_u = 0; tile_u < patch_div_s + 1; tile_u++) {
-			float u = (float)tile_u * (float)(spatch.count_u - 3) * one_over_patch_div_s;
-			if (u < 0.0f)
-				u = 0.0f;
-			SimpleVertex *vert = &vertices[tile_v * (patch_div_s + 1) + tile_u];
-			Vec4f vert_color(0, 0, 0, 0);
-			Vec3f vert_pos;
-			vert_pos.SetZero();
-			Vec3f vert_nrm;
-			if (origNrm) {
-				vert_nrm.SetZero();
-			}
-			if (origCol) {
-				vert_color.SetZero();
-			} else {
-				memcpy(vert->color, spatch.points[0]->color, 4);
-			}
-			if (origTc) {
-				vert->uv[0] = 0.0f;
-				vert->uv[1] = 0.0f;
-			} else {
-				vert->uv[0] = tu_width * ((float)tile_u * one_over_patch_div_s);
-				vert->uv[1] = tv_height * ((float)tile_v * one_over_patch_div_t);
-			}
-
-
-			// Collect influences from surrounding control points.
-			float u_weights[4];
-			float v_weights[4];
-
-			int iu = (int)u;
-			int iv = (int)v;
-
-			// TODO: Would really like to fix the surrounding logic somehow to get rid of these but I can't quite get it right..
-			// Without the previous epsilons and with large count_u, we will end up doing an out of bounds access later without these.
-			if (iu >= spatch.count_u - 3) iu = spatch.count_u - 4;
-			if (iv >= spatch.count_v - 3) iv = spatch.count_v - 4;
-
-			spline_n_4(iu, u, knot_u, u_weights);
-			spline_n_4(iv, v, knot_v, v_weights);
-
-			// Handle degenerate patches. without this, spatch.points[] may read outside the number of initialized points.
-			int patch_w = std::min(spatch.count_u - iu, 4);
-			int patch_h = std::min(spatch.count_v - iv, 4);
+	// Each vertex only depends on the control points, so rows can be done in any order.
+	auto evaluateRows = [&](int lower, int upper) {
+		for (int tile_v = lower; tile_v < upper; tile_v++) {
+			const SplineSpan &span_v = spans_v[tile_v];
+			for (int tile_u = 0; tile_u < patch_div_s + 1; tile_u++) {
+				const SplineSpan &span_u = spans_u[tile_u];
+				SimpleVertex *vert = &vertices[tile_v * (patch_div_s + 1) + tile_u];
+				Vec4f vert_color(0, 0, 0, 0);
+				Vec3f vert_pos;
+				vert_pos.SetZero();
+				Vec3f vert_nrm;
+				if (origNrm) {
+					vert_nrm.SetZero();
+				}
+				if (origCol) {
+					vert_color.SetZero();
+				} else {
+					memcpy(vert->color, spatch.points[0]->color, 4);
+				}
+				if (origTc) {
+					vert->uv[0] = 0.0f;
+					vert->uv[1] = 0.0f;
+				} else {
+					vert->uv[0] = tu_width * ((float)tile_u * one_over_patch_div_s);
+					vert->uv[1] = tv_height * ((float)tile_v * one_over_patch_div_t);
+				}
 
-			for (int ii = 0; ii < patch_w; ++ii) {
-				for (int jj = 0; jj < patch_h; ++jj) {
-					float u_spline = u_weights[ii];
-					float v_spline = v_weights[jj];
-					float f = u_spline * v_spline;
+				// Collect influences from surrounding control points.
+				for (int ii = 0; ii < span_u.count; ++ii) {
+					for (int jj = 0; jj < span_v.count; ++jj) {
+						float f = span_u.weights[ii] * span_v.weights[jj];
 
-					if (f > 0.0f) {
+						if (f > 0.0f) {
 #ifdef _M_SSE
-						Vec4f fv(_mm_set_ps1(f));
+							Vec4f fv(_mm_set_ps1(f));
 #else
-						Vec4f fv = Vec4f::AssignToAll(f);
+							Vec4f fv = Vec4f::AssignToAll(f);
 #endif
-						int idx = spatch.count_u * (iv + jj) + (iu + ii);
-						/*
-						if (idx >= max_idx) {
-							char temp[512];
-							snprintf(temp, sizeof(temp), "count_u: %d count_v: %d patch_w: %d patch_h: %d  ii: %d  jj: %d  iu: %d  iv: %d  patch_div_s: %d  patch_div_t: %d\n", spatch.count_u, spatch.count_v, patch_w, patch_h, ii, jj, iu, iv, patch_div_s, patch_div_t);
-							OutputDebugStringA(temp);
-							Crash();
-						}*/
-						const SimpleVertex *a = spatch.points[idx];
-						AccumulateWeighted(vert_pos, a->pos, fv);
-						if (origTc) {
-							vert->uv[0] += a->uv[0] * f;
-							vert->uv[1] += a->uv[1] * f;
-						}
-						if (origCol) {
-							Vec4f a_color = Vec4f::FromRGBA(a->color_32);
-							AccumulateWeighted(vert_color, a_color, fv);
-						}
-						if (origNrm) {
-							AccumulateWeighted(vert_nrm, a->nrm, fv);
+							int idx = spatch.count_u * (span_v.index + jj) + (span_u.index + ii);
+							const SimpleVertex *a = spatch.points[idx];
+							AccumulateWeighted(vert_pos, a->pos, fv);
+							if (origTc) {
+								vert->uv[0] += a->uv[0] * f;
+								vert->uv[1] += a->uv[1] * f;
+							}
+							if (origCol) {
+								Vec4f a_color = Vec4f::FromRGBA(a->color_32);
+								AccumulateWeighted(vert_color, a_color, fv);
+							}
+							if (origNrm) {
+								AccumulateWeighted(vert_nrm, a->nrm, fv);
+							}
 						}
 					}
 				}
-			}
-			vert->pos = vert_pos;
-			if (origNrm) {
+				vert->pos = vert_pos;
+				if (origNrm) {
 #ifdef _M_SSE
-				const __m128 normalize = SSENormalizeMultiplier(useSSE4, vert_nrm.vec);
-				vert_nrm.vec = _mm_mul_ps(vert_nrm.vec, normalize);
+					const __m128 normalize = SSENormalizeMultiplier(useSSE4, vert_nrm.vec);
+					vert_nrm.vec = _mm_mul_ps(vert_nrm.vec, normalize);
 #else
-				vert_nrm.Normalize();
+					vert_nrm.Normalize();
 #endif
-				vert->nrm = vert_nrm;
-			} else {
-				vert->nrm.SetZero();
-				vert->nrm.z = 1.0f;
-			}
-			if (origCol) {
-				vert->color_32 = vert_color.ToRGBA();
+					vert->nrm = vert_nrm;
+				} else {
+					vert->nrm.SetZero();
+					vert->nrm.z = 1.0f;
+				}
+				if (origCol) {
+					vert->color_32 = vert_color.ToRGBA();
+				}
 			}
 		}
-	}
-
-	delete[] knot_u;
-	delete[] knot_v;
+	};
 
 	// Hacky normal generation through central difference.
-	if (computeNormals && !origNrm) {
+	auto computeNormalRows = [&](int lower, int upper) {
 #ifdef _M_SSE
 		const __m128 facing = spatch.patchFacing ? _mm_set_ps1(-1.0f) : _mm_set_ps1(1.0f);
 #endif
 
-		for (int v = 0; v < patch_div_t + 1; v++) {
+		for (int v = lower; v < upper; v++) {
 			Vec3f vl_pos = vertices[v * (patch_div_s + 1)].pos;
 			Vec3f vc_pos = vertices[v * (patch_div_s + 1)].pos;
 
@@ -548,6 +569,22 @@ static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const Sp
 				vc_pos = vr_pos;
 			}
 		}
+	};
+
+	const bool threaded = numVertices >= MIN_THREADED_TESS_VERTICES;
+	if (threaded) {
+		GlobalThreadPool::Loop(evaluateRows, 0, patch_div_t + 1);
+	} else {
+		evaluateRows(0, patch_div_t + 1);
+	}
+
+	// This needs every position, so it can only start after they're all done.
+	if (computeNormals && !origNrm) {
+		if (threaded) {
+			GlobalThreadPool::Loop(computeNormalRows, 0, patch_div_t + 1);
+		} else {
+			computeNormalRows(0, patch_div_t + 1);
+		}
 	}
 
 	GEPatchPrimType prim_type = spatch.primType;
@@ -563,6 +600,7 @@ static void SplinePatchFullQuality(u8 *&dest, u16 *indices, int &count, const Sp
 			count += 6;
 		}
 	}
+	dest += numVertices * sizeof(SimpleVertex);
 }
 
 template <bool origNrm, bool origCol, bool origTc>
@@ -688,12 +726,9 @@ struct PrecomputedCurves {
 		FreeAlignedMemory(horiz1);
 	}
 
-	T Bernstein3D(int u, float bv) {
-		return ::Bernstein3D(horiz1[u], horiz2[u], horiz3[u], horiz4[u], bv);
-	}
-
-	T Bernstein3DDerivative(int u, float bv) {
-		return ::Bernstein3DDerivative(horiz1[u], horiz2[u], horiz3[u], horiz4[u], bv);
+	// Weights from BernsteinWeights() or BernsteinDerivativeWeights().
+	T Evaluate(int u, const Vec4f &weights) {
+		return WeightedSum(horiz1[u], horiz2[u], horiz3[u], horiz4[u], weights);
 	}
 
 	T *horiz1;
@@ -717,47 +752,63 @@ static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int te
 	const bool sampleColors = (origVertType & GE_VTYPE_COL_MASK) != 0;
 	const bool sampleTexcoords = (origVertType & GE_VTYPE_TC_MASK) != 0;
 
+	// Unpack the control points once, rather than for each curve.
+	Vec3f pos[16];
+	Vec4f col[16];
+	Math3D::Vec2f tex[16];
+	for (int i = 0; i < 16; ++i) {
+		pos[i] = Vec3f(patch.points[i]->pos);
+		if (sampleColors)
+			col[i] = Vec4f::FromRGBA(patch.points[i]->color_32);
+		if (sampleTexcoords)
+			tex[i] = Math3D::Vec2f(patch.points[i]->uv);
+	}
+
 	// Precompute the horizontal curves to we only have to evaluate the vertical ones.
 	for (int i = 0; i < tess_u + 1; i++) {
-		float u = ((float)i / (float)tess_u);
-		prepos.horiz1[i] = Bernstein3D(patch.points[0]->pos, patch.points[1]->pos, patch.points[2]->pos, patch.points[3]->pos, u);
-		prepos.horiz2[i] = Bernstein3D(patch.points[4]->pos, patch.points[5]->pos, patch.points[6]->pos, patch.points[7]->pos, u);
-		prepos.horiz3[i] = Bernstein3D(patch.points[8]->pos, patch.points[9]->pos, patch.points[10]->pos, patch.points[11]->pos, u);
-		prepos.horiz4[i] = Bernstein3D(patch.points[12]->pos, patch.points[13]->pos, patch.points[14]->pos, patch.points[15]->pos, u);
+		const Vec4f weights = BernsteinWeights((float)i / (float)tess_u);
+		prepos.horiz1[i] = WeightedSum(pos[0], pos[1], pos[2], pos[3], weights);
+		prepos.horiz2[i] = WeightedSum(pos[4], pos[5], pos[6], pos[7], weights);
+		prepos.horiz3[i] = WeightedSum(pos[8], pos[9], pos[10], pos[11], weights);
+		prepos.horiz4[i] = WeightedSum(pos[12], pos[13], pos[14], pos[15], weights);
 
 		if (sampleColors) {
-			precol.horiz1[i] = Bernstein3D(patch.points[0]->color_32, patch.points[1]->color_32, patch.points[2]->color_32, patch.points[3]->color_32, u);
-			precol.horiz2[i] = Bernstein3D(patch.points[4]->color_32, patch.points[5]->color_32, patch.points[6]->color_32, patch.points[7]->color_32, u);
-			precol.horiz3[i] = Bernstein3D(patch.points[8]->color_32, patch.points[9]->color_32, patch.points[10]->color_32, patch.points[11]->color_32, u);
-			precol.horiz4[i] = Bernstein3D(patch.points[12]->color_32, patch.points[13]->color_32, patch.points[14]->color_32, patch.points[15]->color_32, u);
+			precol.horiz1[i] = WeightedSum(col[0], col[1], col[2], col[3], weights);
+			precol.horiz2[i] = WeightedSum(col[4], col[5], col[6], col[7], weights);
+			precol.horiz3[i] = WeightedSum(col[8], col[9], col[10], col[11], weights);
+			precol.horiz4[i] = WeightedSum(col[12], col[13], col[14], col[15], weights);
 		}
 		if (sampleTexcoords) {
-			pretex.horiz1[i] = Bernstein3D(Math3D::Vec2f(patch.points[0]->uv), Math3D::Vec2f(patch.points[1]->uv), Math3D::Vec2f(patch.points[2]->uv), Math3D::Vec2f(patch.points[3]->uv), u);
-			pretex.horiz2[i] = Bernstein3D(Math3D::Vec2f(patch.points[4]->uv), Math3D::Vec2f(patch.points[5]->uv), Math3D::Vec2f(patch.points[6]->uv), Math3D::Vec2f(patch.points[7]->uv), u);
-			pretex.horiz3[i] = Bernstein3D(Math3D::Vec2f(patch.points[8]->uv), Math3D::Vec2f(patch.points[9]->uv), Math3D::Vec2f(patch.points[10]->uv), Math3D::Vec2f(patch.points[11]->uv), u);
-			pretex.horiz4[i] = Bernstein3D(Math3D::Vec2f(patch.points[12]->uv), Math3D::Vec2f(patch.points[13]->uv), Math3D::Vec2f(patch.points[14]->uv), Math3D::Vec2f(patch.points[15]->uv), u);
+			pretex.horiz1[i] = WeightedSum(tex[0], tex[1], tex[2], tex[3], weights);
+			pretex.horiz2[i] = WeightedSum(tex[4], tex[5], tex[6], tex[7], weights);
+			pretex.horiz3[i] = WeightedSum(tex[8], tex[9], tex[10], tex[11], weights);
+			pretex.horiz4[i] = WeightedSum(tex[12], tex[13], tex[14], tex[15], weights);
 		}
 
 		if (computeNormals) {
-			prederivU.horiz1[i] = Bernstein3DDerivative(patch.points[0]->pos, patch.points[1]->pos, patch.points[2]->pos, patch.points[3]->pos, u);
-			prederivU.horiz2[i] = Bernstein3DDerivative(patch.points[4]->pos, patch.points[5]->pos, patch.points[6]->pos, patch.points[7]->pos, u);
-			prederivU.horiz3[i] = Bernstein3DDerivative(patch.points[8]->pos, patch.points[9]->pos, patch.points[10]->pos, patch.points[11]->pos, u);
-			prederivU.horiz4[i] = Bernstein3DDerivative(patch.points[12]->pos, patch.points[13]->pos, patch.points[14]->pos, patch.points[15]->pos, u);
+			const Vec4f derivWeights = BernsteinDerivativeWeights((float)i / (float)tess_u);
+			prederivU.horiz1[i] = WeightedSum(pos[0], pos[1], pos[2], pos[3], derivWeights);
+			prederivU.horiz2[i] = WeightedSum(pos[4], pos[5], pos[6], pos[7], derivWeights);
+			prederivU.horiz3[i] = WeightedSum(pos[8], pos[9], pos[10], pos[11], derivWeights);
+			prederivU.horiz4[i] = WeightedSum(pos[12], pos[13], pos[14], pos[15], derivWeights);
 		}
 	}
 
 
 	for (int tile_v = 0; tile_v < tess_v + 1; ++tile_v) {
+		float v = ((float)tile_v / (float)tess_v);
+		// The same for the whole row.
+		const Vec4f weights = BernsteinWeights(v);
+		const Vec4f derivWeights = BernsteinDerivativeWeights(v);
+
 		for (int tile_u = 0; tile_u < tess_u + 1; ++tile_u) {
 			float u = ((float)tile_u / (float)tess_u);
-			float v = ((float)tile_v / (float)tess_v);
-			float bv = v;
 
 			SimpleVertex &vert = vertices[tile_v * (tess_u + 1) + tile_u];
 
 			if (computeNormals) {
-				const Vec3f derivU = prederivU.Bernstein3D(tile_u, bv);
-				const Vec3f derivV = prepos.Bernstein3DDerivative(tile_u, bv);
+				const Vec3f derivU = prederivU.Evaluate(tile_u, weights);
+				const Vec3f derivV = prepos.Evaluate(tile_u, derivWeights);
 
 				vert.nrm = Cross(derivU, derivV).Normalized();
 				if (patch.patchFacing)
@@ -766,7 +817,7 @@ static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int te
 				vert.nrm.SetZero();
 			}
 
-			vert.pos = prepos.Bernstein3D(tile_u, bv);
+			vert.pos = prepos.Evaluate(tile_u, weights);
 
 			if (!sampleTexcoords) {
 				// Generate texcoord
@@ -774,13 +825,13 @@ static void _BezierPatchHighQuality(u8 *&dest, u16 *&indices, int &count, int te
 				vert.uv[1] = v + patch.v_index * third;
 			} else {
 				// Sample UV from control points
-				const Math3D::Vec2f res = pretex.Bernstein3D(tile_u, bv);
+				const Math3D::Vec2f res = pretex.Evaluate(tile_u, weights);
 				vert.uv[0] = res.x;
 				vert.uv[1] = res.y;
 			} 
 
 			if (sampleColors) {
-				vert.color_32 = precol.Bernstein3D(tile_u, bv).ToRGBA();
+				vert.color_32 = precol.Evaluate(tile_u, weights).ToRGBA();
 			} else {
 				memcpy(vert.color, patch.points[0]->color, 4);
 			}
@@ -849,6 +900,89 @@ void TessellateBezierPatch(u8 *&dest, u16 *&indices, int &count, int tess_u, int
 	}
 }
 
+// TessellateBezierPatch() outputs the same amount for each patch, so they can be done in parallel.
+static void GetBezierPatchSize(int tess_u, int tess_v, int &numVertices, int &numIndices) {
+	switch (g_Config.iSplineBezierQuality) {
+	case LOW_QUALITY:
+		// 3x3 tiles, each a separate quad.
+		numVertices = 3 * 3 * 4;
+		numIndices = 3 * 3 * 6;
+		break;
+	case MEDIUM_QUALITY:
+		numVertices = (std::max(tess_u / 2, 1) + 1) * (std::max(tess_v / 2, 1) + 1);
+		numIndices = std::max(tess_u / 2, 1) * std::max(tess_v / 2, 1) * 6;
+		break;
+	case HIGH_QUALITY:
+		numVertices = (tess_u + 1) * (tess_v + 1);
+		numIndices = tess_u * tess_v * 6;
+		break;
+	default:
+		numVertices = 0;
+		numIndices = 0;
+		break;
+	}
+}
+
+static ReliableHashType HashControlPoints(const SimpleVertex *points, int lowerBound, int upperBound, const void *indices, int indicesSize) {
+	ReliableHashType hash = DoReliableHash((const char *)(points + lowerBound), (upperBound - lowerBound + 1) * sizeof(SimpleVertex), 0x5A3C91E7);
+	if (indices)
+		hash += DoReliableHash((const char *)indices, indicesSize, 0x1D0B4B6F);
+	return hash;
+}
+
+TessellationCacheEntry *DrawEngineCommon::LookupTessellation(const TessellationCacheKey &key) {
+	if (tessCacheFrame_ != gpuStats.numFlips) {
+		tessCacheFrame_ = gpuStats.numFlips;
+		DecimateTessellationCache();
+	}
+
+	const ReliableHashType id = DoReliableHash((const char *)&key, sizeof(key), 0x7E55CA4E);
+	TessellationCacheEntry &entry = tessCache_[id];
+	if (entry.uses == 0 || memcmp(&entry.key, &key, sizeof(key)) != 0) {
+		// New, or a hash collision.  Either way, start over.
+		tessCacheBytes_ -= entry.Bytes();
+		entry = TessellationCacheEntry();
+		entry.key = key;
+	}
+	entry.uses++;
+	entry.lastFrame = gpuStats.numFlips;
+	return &entry;
+}
+
+void DrawEngineCommon::StoreTessellation(TessellationCacheEntry *entry, const u8 *verts, size_t vertsSize, const u16 *inds, int count) {
+	// Animated patches would never be drawn from the cache, and only cost a copy.
+	if (entry->stored || entry->uses < 2)
+		return;
+
+	const size_t bytes = vertsSize + count * sizeof(u16);
+	if (tessCacheBytes_ + bytes > TESSCACHE_MAX_BYTES)
+		return;
+
+	entry->verts.assign(verts, verts + vertsSize);
+	entry->inds.assign(inds, inds + count);
+	entry->count = count;
+	entry->stored = true;
+	tessCacheBytes_ += bytes;
+}
+
+void DrawEngineCommon::DecimateTessellationCache() {
+	if (--tessDecimationCounter_ <= 0) {
+		tessDecimationCounter_ = TESSCACHE_DECIMATION_INTERVAL;
+	} else {
+		return;
+	}
+
+	const int threshold = gpuStats.numFlips - TESSCACHE_KILL_AGE;
+	for (auto it = tessCache_.begin(); it != tessCache_.end(); ) {
+		if (it->second.lastFrame < threshold) {
+			tessCacheBytes_ -= it->second.Bytes();
+			it = tessCache_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
 void DrawEngineCommon::SubmitSpline(const void *control_points, const void *indices, int tess_u, int tess_v, int count_u, int count_v, int type_u, int type_v, GEPatchPrimType prim_type, bool computeNormals, bool patchFacing, u32 vertType, int *bytesRead) {
 	PROFILE_THIS_SCOPE("spline");
 	DispatchFlush();
@@ -892,6 +1026,8 @@ void DrawEngineCommon::SubmitSpline(const void *control_points, const void *indi
 	int count = 0;
 
 	u8 *dest = splineBuffer;
+	void *drawVerts = splineBuffer;
+	void *drawInds = quadIndices_;
 
 	SplinePatchLocal patch;
 	patch.tess_u = tess_u;
@@ -936,8 +1072,31 @@ void DrawEngineCommon::SubmitSpline(const void *control_points, const void *indi
 		TessellateSplinePatchHardware(dest, quadIndices_, count, patch);
 		numPatches = (count_u - 3) * (count_v - 3);
 	} else {
-		int maxVertexCount = SPLINE_BUFFER_SIZE / vertexSize;
-		TessellateSplinePatch(dest, quadIndices_, count, patch, origVertType, maxVertexCount);
+		TessellationCacheKey key;
+		key.dataHash = HashControlPoints(simplified_control_points, index_lower_bound, index_upper_bound, indices, count_u * count_v * IndexSize(origVertType));
+		key.origVertType = origVertType;
+		key.tess_u = tess_u;
+		key.tess_v = tess_v;
+		key.count_u = count_u;
+		key.count_v = count_v;
+		key.type_u = type_u;
+		key.type_v = type_v;
+		key.primType = prim_type;
+		key.computeNormals = computeNormals;
+		key.patchFacing = patchFacing;
+		key.quality = g_Config.iSplineBezierQuality;
+		key.bezier = false;
+
+		TessellationCacheEntry *cached = LookupTessellation(key);
+		if (cached->stored) {
+			drawVerts = cached->verts.data();
+			drawInds = cached->inds.data();
+			count = cached->count;
+		} else {
+			int maxVertexCount = SPLINE_BUFFER_SIZE / vertexSize;
+			TessellateSplinePatch(dest, quadIndices_, count, patch, origVertType, maxVertexCount);
+			StoreTessellation(cached, splineBuffer, dest - splineBuffer, quadIndices_, count);
+		}
 	}
 	delete[] points;
 
@@ -956,7 +1115,7 @@ void DrawEngineCommon::SubmitSpline(const void *control_points, const void *indi
 	uint32_t vertTypeID = GetVertTypeID(vertTypeWithIndex16, gstate.getUVGenMode());
 
 	int generatedBytesRead;
-	DispatchSubmitPrim(splineBuffer, quadIndices_, PatchPrimToPrim(prim_type), count, vertTypeID, &generatedBytesRead);
+	DispatchSubmitPrim(drawVerts, drawInds, PatchPrimToPrim(prim_type), count, vertTypeID, &generatedBytesRead);
 
 	DispatchFlush();
 
@@ -1009,7 +1168,23 @@ void DrawEngineCommon::SubmitBezier(const void *control_points, const void *indi
 	// Bezier patches share less control points than spline patches. Otherwise they are pretty much the same (except bezier don't support the open/close thing)
 	int num_patches_u = (count_u - 1) / 3;
 	int num_patches_v = (count_v - 1) / 3;
-	BezierPatch *patches = nullptr;
+
+	int count = 0;
+	u8 *dest = splineBuffer;
+	void *drawVerts = splineBuffer;
+	void *drawInds = quadIndices_;
+
+	// We shouldn't really split up into separate 4x4 patches, instead we should do something that works
+	// like the splines, so we subdivide across the whole "mega-patch".
+
+	// If specified as 0, uses 1.
+	if (tess_u < 1) {
+		tess_u = 1;
+	}
+	if (tess_v < 1) {
+		tess_v = 1;
+	}
+
 	if (CanUseHardwareTessellation(prim_type)) {
 		int posStride, texStride, colStride;
 		tessDataTransfer->PrepareBuffers(pos, tex, col, posStride, texStride, colStride, count_u * count_v, hasColor, hasTexCoords);
@@ -1033,43 +1208,9 @@ void DrawEngineCommon::SubmitBezier(const void *control_points, const void *indi
 			const SimpleVertex *point = simplified_control_points + (indices ? idxConv.convert(0) : 0);
 			memcpy(col, Vec4f::FromRGBA(point->color_32).AsArray(), 4 * sizeof(float));
 		}
-	} else {
-		patches = new BezierPatch[num_patches_u * num_patches_v];
-		for (int patch_u = 0; patch_u < num_patches_u; patch_u++) {
-			for (int patch_v = 0; patch_v < num_patches_v; patch_v++) {
-				BezierPatch& patch = patches[patch_u + patch_v * num_patches_u];
-				for (int point = 0; point < 16; ++point) {
-					int idx = (patch_u * 3 + point % 4) + (patch_v * 3 + point / 4) * count_u;
-					patch.points[point] = simplified_control_points + (indices ? idxConv.convert(idx) : idx);
-				}
-				patch.u_index = patch_u * 3;
-				patch.v_index = patch_v * 3;
-				patch.index = patch_v * num_patches_u + patch_u;
-				patch.primType = prim_type;
-				patch.computeNormals = computeNormals;
-				patch.patchFacing = patchFacing;
-			}
-		}
-	}
-
-	int count = 0;
-	u8 *dest = splineBuffer;
-
-	// We shouldn't really split up into separate 4x4 patches, instead we should do something that works
-	// like the splines, so we subdivide across the whole "mega-patch".
-
-	// If specified as 0, uses 1.
-	if (tess_u < 1) {
-		tess_u = 1;
-	}
-	if (tess_v < 1) {
-		tess_v = 1;
-	}
 
-	u16 *inds = quadIndices_;
-	if (CanUseHardwareTessellation(prim_type)) {
 		tessDataTransfer->SendDataToShader(pos, tex, col, count_u * count_v, hasColor, hasTexCoords);
-		TessellateBezierPatchHardware(dest, inds, count, tess_u, tess_v, prim_type);
+		TessellateBezierPatchHardware(dest, quadIndices_, count, tess_u, tess_v, prim_type);
 		numPatches = num_patches_u * num_patches_v;
 	} else {
 		int maxVertices = SPLINE_BUFFER_SIZE / vertexSize;
@@ -1078,11 +1219,67 @@ void DrawEngineCommon::SubmitBezier(const void *control_points, const void *indi
 			tess_u /= 2;
 			tess_v /= 2;
 		}
-		for (int patch_idx = 0; patch_idx < num_patches_u*num_patches_v; ++patch_idx) {
-			const BezierPatch &patch = patches[patch_idx];
-			TessellateBezierPatch(dest, inds, count, tess_u, tess_v, patch, origVertType);
+
+		TessellationCacheKey key;
+		key.dataHash = HashControlPoints(simplified_control_points, index_lower_bound, index_upper_bound, indices, count_u * count_v * IndexSize(origVertType));
+		key.origVertType = origVertType;
+		key.tess_u = tess_u;
+		key.tess_v = tess_v;
+		key.count_u = count_u;
+		key.count_v = count_v;
+		key.type_u = 0;
+		key.type_v = 0;
+		key.primType = prim_type;
+		key.computeNormals = computeNormals;
+		key.patchFacing = patchFacing;
+		key.quality = g_Config.iSplineBezierQuality;
+		key.bezier = true;
+
+		TessellationCacheEntry *cached = LookupTessellation(key);
+		if (cached->stored) {
+			drawVerts = cached->verts.data();
+			drawInds = cached->inds.data();
+			count = cached->count;
+		} else {
+			const int totalPatches = num_patches_u * num_patches_v;
+			BezierPatch *patches = new BezierPatch[totalPatches];
+			for (int patch_u = 0; patch_u < num_patches_u; patch_u++) {
+				for (int patch_v = 0; patch_v < num_patches_v; patch_v++) {
+					BezierPatch& patch = patches[patch_u + patch_v * num_patches_u];
+					for (int point = 0; point < 16; ++point) {
+						int idx = (patch_u * 3 + point % 4) + (patch_v * 3 + point / 4) * count_u;
+						patch.points[point] = simplified_control_points + (indices ? idxConv.convert(idx) : idx);
+					}
+					patch.u_index = patch_u * 3;
+					patch.v_index = patch_v * 3;
+					patch.index = patch_v * num_patches_u + patch_u;
+					patch.primType = prim_type;
+					patch.computeNormals = computeNormals;
+					patch.patchFacing = patchFacing;
+				}
+			}
+
+			int patchVertices, patchIndices;
+			GetBezierPatchSize(tess_u, tess_v, patchVertices, patchIndices);
+			auto tessellatePatches = [&](int lower, int upper) {
+				for (int patch_idx = lower; patch_idx < upper; ++patch_idx) {
+					u8 *patchDest = splineBuffer + patch_idx * patchVertices * sizeof(SimpleVertex);
+					u16 *patchInds = quadIndices_ + patch_idx * patchIndices;
+					int patchCount = 0;
+					TessellateBezierPatch(patchDest, patchInds, patchCount, tess_u, tess_v, patches[patch_idx], origVertType);
+				}
+			};
+			if (totalPatches * patchVertices >= MIN_THREADED_TESS_VERTICES) {
+				GlobalThreadPool::Loop(tessellatePatches, 0, totalPatches);
+			} else {
+				tessellatePatches(0, totalPatches);
+			}
+			delete[] patches;
+
+			count = totalPatches * patchIndices;
+			dest = splineBuffer + totalPatches * patchVertices * sizeof(SimpleVertex);
+			StoreTessellation(cached, splineBuffer, dest - splineBuffer, quadIndices_, count);
 		}
-		delete[] patches;
 	}
 
 	u32 vertTypeWithIndex16 = (vertType & ~GE_VTYPE_IDX_MASK) | GE_VTYPE_IDX_16BIT;
@@ -1099,7 +1296,7 @@ void DrawEngineCommon::SubmitBezier(const void *control_points, const void *indi
 
 	uint32_t vertTypeID = GetVertTypeID(vertTypeWithIndex16, gstate.getUVGenMode());
 	int generatedBytesRead;
-	DispatchSubmitPrim(splineBuffer, quadIndices_, PatchPrimToPrim(prim_type), count, vertTypeID, &generatedBytesRead);
+	DispatchSubmitPrim(drawVerts, drawInds, PatchPrimToPrim(prim_type), count, vertTypeID, &generatedBytesRead);
 
 	DispatchFlush();
 
@@ -19,6 +19,7 @@
 #include "profiler/profiler.h"
 #include "Common/ColorConv.h"
 #include "Common/MemoryUtil.h"
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
@@ -57,6 +58,13 @@
 #define TEXCACHE_MIN_PRESSURE 16 * 1024 * 1024  // Total in VRAM
 #define TEXCACHE_SECOND_MIN_PRESSURE 4 * 1024 * 1024
 
+// After this many rehashes that only covered reported writes, hash everything again
+// to catch writes we weren't told about (like the CPU drawing into the texture.)
+#define TEXCACHE_MAX_INCREMENTAL_HASHES 4
+
+// Levels with at least this many pixels are decoded on the global thread pool.
+#define TEXCACHE_PARALLEL_DECODE_MIN_PIXELS (256 * 256)
+
 // Just for reference
 
 // PSP Color formats:
@@ -354,8 +362,7 @@ void TextureCacheCommon::SetTexture(bool force) {
 
 	u32 texhash = MiniHash((const u32 *)Memory::GetPointerUnchecked(texaddr));
 
-	TexCache::iterator iter = cache_.find(cachekey);
-	TexCacheEntry *entry = nullptr;
+	TexCacheEntry *entry = cache_.Get(cachekey);
 
 	// Note: It's necessary to reset needshadertexclamp, for otherwise DIRTY_TEXCLAMP won't get set later.
 	// Should probably revisit how this works..
@@ -366,8 +373,7 @@ void TextureCacheCommon::SetTexture(bool force) {
 	}
 	gstate_c.bgraTexture = isBgraBackend_;
 
-	if (iter != cache_.end()) {
-		entry = iter->second.get();
+	if (entry) {
 		// Validate the texture still matches the cache entry.
 		bool match = entry->Matches(dim, format, maxLevel);
 		const char *reason = "different params";
@@ -441,6 +447,15 @@ void TextureCacheCommon::SetTexture(bool force) {
 			}
 		}
 
+		if (match && (entry->status & TexCacheEntry::STATUS_TO_REPLACE)) {
+			int w = gstate.getTextureWidth(0);
+			int h = gstate.getTextureHeight(0);
+			if (replacer_.FindReplacement(entry->CacheKey(), entry->fullhash, w, h).IsReady()) {
+				match = false;
+				reason = "replacing";
+			}
+		}
+
 		if (match) {
 			// TODO: Mark the entry reliable if it's been safe for long enough?
 			//got one!
@@ -468,7 +483,7 @@ void TextureCacheCommon::SetTexture(bool force) {
 	} else {
 		VERBOSE_LOG(G3D, "No texture in cache, decoding...");
 		TexCacheEntry *entryNew = new TexCacheEntry{};
-		cache_[cachekey].reset(entryNew);
+		cache_.Insert(cachekey, entryNew);
 
 		if (hasClut && clutRenderAddress_ != 0xFFFFFFFF) {
 			WARN_LOG_REPORT_ONCE(clutUseRender, G3D, "Using texture with rendered CLUT: texfmt=%d, clutfmt=%d", gstate.getTextureFormat(), gstate.getClutPaletteFormat());
@@ -597,6 +612,108 @@ void TextureCacheCommon::DecimateVideos() {
 	}
 }
 
+ReplacedTexture &TextureCacheCommon::FindReplacement(TexCacheEntry *entry, int w, int h) {
+	if (!replacer_.Enabled()) {
+		entry->status &= ~TexCacheEntry::STATUS_TO_REPLACE;
+		return replacer_.NoReplacement();
+	}
+
+	ReplacedTexture &replaced = replacer_.FindReplacement(entry->CacheKey(), entry->fullhash, w, h);
+	if (replaced.IsReady()) {
+		entry->status &= ~TexCacheEntry::STATUS_TO_REPLACE;
+		return replaced;
+	}
+
+	// Still loading in the background, SetTexture() will rebuild once it's done.
+	entry->status |= TexCacheEntry::STATUS_TO_REPLACE;
+	return replacer_.NoReplacement();
+}
+
+int TextureCacheCommon::ThrottleScaleFactor(TexCacheEntry *entry, int scaleFactor, int w, int h) {
+	asyncScaleFactor_ = 0;
+	if (scaleFactor == 1) {
+		return 1;
+	}
+
+	// Fake mipmaps only upload a single level, not necessarily level 0, so just scale those right away.
+	if (!IsFakeMipmapChange()) {
+		if (!asyncScaler_) {
+			asyncScaler_.reset(new AsyncTextureScaler(CreateScaler(), TEXCACHE_ASYNC_SCALE_BUDGET));
+		}
+
+		switch (asyncScaler_->GetState(entry->CacheKey(), entry->fullhash)) {
+		case AsyncTextureScaler::State::READY:
+			// ScaleLevel() will pick it up.
+			entry->status &= ~(TexCacheEntry::STATUS_TO_SCALE | TexCacheEntry::STATUS_SCALING_ASYNC);
+			entry->status |= TexCacheEntry::STATUS_IS_SCALED;
+			return scaleFactor;
+
+		case AsyncTextureScaler::State::PENDING:
+			entry->status &= ~TexCacheEntry::STATUS_TO_SCALE;
+			entry->status |= TexCacheEntry::STATUS_SCALING_ASYNC;
+			return 1;
+
+		case AsyncTextureScaler::State::NONE:
+			if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED) {
+				break;
+			}
+			// Build unscaled for now, and have QueueAsyncScale() grab the decoded pixels.
+			entry->status &= ~TexCacheEntry::STATUS_TO_SCALE;
+			entry->status |= TexCacheEntry::STATUS_SCALING_ASYNC;
+			texelsScaledThisFrame_ += w * h;
+			asyncScaleFactor_ = scaleFactor;
+			return 1;
+		}
+	}
+
+	if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED) {
+		entry->status |= TexCacheEntry::STATUS_TO_SCALE;
+		return 1;
+	}
+	entry->status &= ~TexCacheEntry::STATUS_TO_SCALE;
+	entry->status |= TexCacheEntry::STATUS_IS_SCALED;
+	texelsScaledThisFrame_ += w * h;
+	return scaleFactor;
+}
+
+void TextureCacheCommon::QueueAsyncScale(TexCacheEntry *entry, int level, const void *pixels, int pitch, int bpp, u32 fmt, int w, int h) {
+	if (asyncScaleFactor_ <= 1 || level != 0) {
+		return;
+	}
+
+	if (!asyncScaler_->Queue(entry->CacheKey(), entry->fullhash, (const u8 *)pixels, pitch, bpp, fmt, w, h, asyncScaleFactor_)) {
+		// Too much in flight already.  Retry in a later frame, but not again this frame.
+		entry->status &= ~TexCacheEntry::STATUS_SCALING_ASYNC;
+		entry->status |= TexCacheEntry::STATUS_TO_SCALE;
+		texelsScaledThisFrame_ = TEXCACHE_MAX_TEXELS_SCALED;
+	}
+	asyncScaleFactor_ = 0;
+}
+
+void TextureCacheCommon::ScaleLevel(TextureScalerCommon &scaler, TexCacheEntry *entry, u32 *out, u32 *src, u32 &dstFmt, int &w, int &h, int factor) {
+	if (asyncScaler_ && asyncScaler_->Take(entry->CacheKey(), entry->fullhash, out, dstFmt, w, h, factor)) {
+		return;
+	}
+	scaler.ScaleAlways(out, src, dstFmt, w, h, factor);
+}
+
+void TextureCacheCommon::ProcessScaledTextures() {
+	if (!asyncScaler_) {
+		return;
+	}
+
+	std::vector<u64> finished;
+	asyncScaler_->PollFinished(finished);
+	for (u64 key : finished) {
+		TexCacheEntry *entry = cache_.Get(key);
+		if (entry && (entry->status & TexCacheEntry::STATUS_SCALING_ASYNC)) {
+			// SetTexture() will now rebuild it, and the build swaps in the scaled result.
+			entry->status &= ~TexCacheEntry::STATUS_SCALING_ASYNC;
+			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
+		}
+	}
+}
+
 void TextureCacheCommon::HandleTextureChange(TexCacheEntry *const entry, const char *reason, bool initialMatch, bool doDelete) {
 	cacheSizeEstimate_ -= EstimateTexMemoryUsage(entry);
 	entry->numInvalidated++;
@@ -678,7 +795,10 @@ void TextureCacheCommon::NotifyFramebuffer(u32 address, VirtualFramebuffer *fram
 			// We might erase, so move to the next one already (which won't become invalid.)
 			++it;
 
-			DetachFramebuffer(cache_[cachekey].get(), addr, framebuffer);
+			TexCacheEntry *entry = cache_.Get(cachekey);
+			if (entry) {
+				DetachFramebuffer(entry, addr, framebuffer);
+			}
 		}
 		break;
 	}
@@ -911,11 +1031,10 @@ bool TextureCacheCommon::SetOffsetTexture(u32 offset) {
 
 	const u16 dim = gstate.getTextureDimension(0);
 	u64 cachekey = TexCacheEntry::CacheKey(texaddr, gstate.getTextureFormat(), dim, 0);
-	TexCache::iterator iter = cache_.find(cachekey);
-	if (iter == cache_.end()) {
+	TexCacheEntry *entry = cache_.Get(cachekey);
+	if (!entry) {
 		return false;
 	}
-	TexCacheEntry *entry = iter->second.get();
 
 	bool success = false;
 	for (size_t i = 0, n = fbCache_.size(); i < n; ++i) {
@@ -1085,7 +1204,14 @@ void TextureCacheCommon::UnswizzleFromMem(u32 *dest, u32 destPitch, const u8 *te
 	// The height is not always aligned to 8, but rounds up.
 	int byc = (height + 7) / 8;
 
-	DoUnswizzleTex16(texptr, dest, bxc, byc, destPitch);
+	if ((rowWidth / 4) * height >= TEXCACHE_PARALLEL_DECODE_MIN_PIXELS) {
+		// Each row of blocks is independent: 8 rows of the destination from bxc * 128 bytes of source.
+		GlobalThreadPool::Loop([&](int lower, int upper) {
+			DoUnswizzleTex16(texptr + lower * bxc * 128, dest + lower * 8 * (destPitch / 4), bxc, upper - lower, destPitch);
+		}, 0, byc);
+	} else {
+		DoUnswizzleTex16(texptr, dest, bxc, byc, destPitch);
+	}
 }
 
 bool TextureCacheCommon::GetCurrentClutBuffer(GPUDebugBuffer &buffer) {
@@ -1177,6 +1303,22 @@ static inline void ConvertFormatToRGBA8888(GEPaletteFormat format, u32 *dst, con
 	ConvertFormatToRGBA8888(GETextureFormat(format), dst, src, numPixels);
 }
 
+// Splits a per-row decode across the global thread pool if the level is big enough to be worth it.
+template <typename F>
+static void DecodeRows(int w, int h, F func) {
+	if (w * h >= TEXCACHE_PARALLEL_DECODE_MIN_PIXELS) {
+		GlobalThreadPool::Loop([&](int lower, int upper) {
+			for (int y = lower; y < upper; ++y) {
+				func(y);
+			}
+		}, 0, h);
+	} else {
+		for (int y = 0; y < h; ++y) {
+			func(y);
+		}
+	}
+}
+
 void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureFormat format, GEPaletteFormat clutformat, uint32_t texaddr, int level, int bufw, bool reverseColors, bool useBGRA, bool expandTo32bit) {
 	bool swizzled = gstate.isTextureSwizzled();
 	if ((texaddr & 0x00600000) != 0 && Memory::IsVRAMAddress(texaddr)) {
@@ -1214,25 +1356,25 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 			if (clutAlphaLinear_ && mipmapShareClut && !expandTo32bit) {
 				// Here, reverseColors means the CLUT is already reversed.
 				if (reverseColors) {
-					for (int y = 0; y < h; ++y) {
+					DecodeRows(w, h, [&](int y) {
 						DeIndexTexture4Optimal((u16 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clutAlphaLinearColor_);
-					}
+					});
 				} else {
-					for (int y = 0; y < h; ++y) {
+					DecodeRows(w, h, [&](int y) {
 						DeIndexTexture4OptimalRev((u16 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clutAlphaLinearColor_);
-					}
+					});
 				}
 			} else {
 				if (expandTo32bit && !reverseColors) {
 					// We simply expand the CLUT to 32-bit, then we deindex as usual. Probably the fastest way.
 					ConvertFormatToRGBA8888(clutformat, expandClut_, clut, 16);
-					for (int y = 0; y < h; ++y) {
+					DecodeRows(w, h, [&](int y) {
 						DeIndexTexture4((u32 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, expandClut_);
-					}
+					});
 				} else {
-					for (int y = 0; y < h; ++y) {
+					DecodeRows(w, h, [&](int y) {
 						DeIndexTexture4((u16 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clut);
-					}
+					});
 				}
 			}
 		}
@@ -1241,9 +1383,9 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 		case GE_CMODE_32BIT_ABGR8888:
 		{
 			const u32 *clut = GetCurrentClut<u32>() + clutSharingOffset;
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture4((u32 *)(out + outPitch * y), texptr + (bufw * y) / 2, w, clut);
-			}
+			});
 		}
 		break;
 
@@ -1272,13 +1414,13 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 		if (!swizzled) {
 			// Just a simple copy, we swizzle the color format.
 			if (reverseColors) {
-				for (int y = 0; y < h; ++y) {
+				DecodeRows(w, h, [&](int y) {
 					ReverseColors(out + outPitch * y, texptr + bufw * sizeof(u16) * y, format, w, useBGRA);
-				}
+				});
 			} else if (expandTo32bit) {
-				for (int y = 0; y < h; ++y) {
+				DecodeRows(w, h, [&](int y) {
 					ConvertFormatToRGBA8888(format, (u32 *)(out + outPitch * y), (const u16 *)texptr + bufw * y, w);
-				}
+				});
 			} else {
 				for (int y = 0; y < h; ++y) {
 					memcpy(out + outPitch * y, texptr + bufw * sizeof(u16) * y, w * sizeof(u16));
@@ -1297,13 +1439,13 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 			const u8 *unswizzled = (u8 *)tmpTexBuf32_.data();
 
 			if (reverseColors) {
-				for (int y = 0; y < h; ++y) {
+				DecodeRows(w, h, [&](int y) {
 					ReverseColors(out + outPitch * y, unswizzled + bufw * sizeof(u16) * y, format, w, useBGRA);
-				}
+				});
 			} else if (expandTo32bit) {
-				for (int y = 0; y < h; ++y) {
+				DecodeRows(w, h, [&](int y) {
 					ConvertFormatToRGBA8888(format, (u32 *)(out + outPitch * y), (const u16 *)unswizzled + bufw * y, w);
-				}
+				});
 			} else {
 				for (int y = 0; y < h; ++y) {
 					memcpy(out + outPitch * y, unswizzled + bufw * sizeof(u16) * y, w * sizeof(u16));
@@ -1315,9 +1457,9 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 	case GE_TFMT_8888:
 		if (!swizzled) {
 			if (reverseColors) {
-				for (int y = 0; y < h; ++y) {
+				DecodeRows(w, h, [&](int y) {
 					ReverseColors(out + outPitch * y, texptr + bufw * sizeof(u32) * y, format, w, useBGRA);
-				}
+				});
 			} else {
 				for (int y = 0; y < h; ++y) {
 					memcpy(out + outPitch * y, texptr + bufw * sizeof(u32) * y, w * sizeof(u32));
@@ -1335,9 +1477,9 @@ void TextureCacheCommon::DecodeTextureLevel(u8 *out, int outPitch, GETextureForm
 			const u8 *unswizzled = (u8 *)tmpTexBuf32_.data();
 
 			if (reverseColors) {
-				for (int y = 0; y < h; ++y) {
+				DecodeRows(w, h, [&](int y) {
 					ReverseColors(out + outPitch * y, unswizzled + bufw * sizeof(u32) * y, format, w, useBGRA);
-				}
+				});
 			} else {
 				for (int y = 0; y < h; ++y) {
 					memcpy(out + outPitch * y, unswizzled + bufw * sizeof(u32) * y, w * sizeof(u32));
@@ -1446,21 +1588,21 @@ void TextureCacheCommon::ReadIndexedTex(u8 *out, int outPitch, int level, const
 	{
 		switch (bytesPerIndex) {
 		case 1:
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture((u16 *)(out + outPitch * y), (const u8 *)texptr + bufw * y, w, clut16);
-			}
+			});
 			break;
 
 		case 2:
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture((u16 *)(out + outPitch * y), (const u16_le *)texptr + bufw * y, w, clut16);
-			}
+			});
 			break;
 
 		case 4:
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture((u16 *)(out + outPitch * y), (const u32_le *)texptr + bufw * y, w, clut16);
-			}
+			});
 			break;
 		}
 	}
@@ -1470,21 +1612,21 @@ void TextureCacheCommon::ReadIndexedTex(u8 *out, int outPitch, int level, const
 	{
 		switch (bytesPerIndex) {
 		case 1:
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture((u32 *)(out + outPitch * y), (const u8 *)texptr + bufw * y, w, clut32);
-			}
+			});
 			break;
 
 		case 2:
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture((u32 *)(out + outPitch * y), (const u16_le *)texptr + bufw * y, w, clut32);
-			}
+			});
 			break;
 
 		case 4:
-			for (int y = 0; y < h; ++y) {
+			DecodeRows(w, h, [&](int y) {
 				DeIndexTexture((u32 *)(out + outPitch * y), (const u32_le *)texptr + bufw * y, w, clut32);
-			}
+			});
 			break;
 		}
 	}
@@ -1576,9 +1718,15 @@ void TextureCacheCommon::Clear(bool delete_them) {
 	}
 	fbTexInfo_.clear();
 	videos_.clear();
+	if (asyncScaler_) {
+		asyncScaler_->CancelAll();
+	}
 }
 
 void TextureCacheCommon::DeleteTexture(TexCache::iterator it) {
+	if (asyncScaler_ && (it->second->status & TexCacheEntry::STATUS_SCALING_ASYNC)) {
+		asyncScaler_->Cancel(it->second->CacheKey());
+	}
 	ReleaseTexture(it->second.get(), true);
 	auto fbInfo = fbTexInfo_.find(it->first);
 	if (fbInfo != fbTexInfo_.end()) {
@@ -1588,6 +1736,32 @@ void TextureCacheCommon::DeleteTexture(TexCache::iterator it) {
 	cache_.erase(it);
 }
 
+u32 TextureCacheCommon::QuickTexHashPaged(TexCacheEntry *entry, const u8 *checkp, u32 sizeInRAM) {
+	const u32 pages = (sizeInRAM + TEXCACHE_HASH_PAGE_SIZE - 1) / TEXCACHE_HASH_PAGE_SIZE;
+	u32 firstPage = 0;
+	u32 endPage = pages;
+
+	// If only GE-side writes were reported since last time, just rehash the pages they touched.
+	bool incremental = entry->pageHashes.size() == pages && entry->dirtyStart < entry->dirtyEnd;
+	if (incremental && entry->numIncrementalHashes < TEXCACHE_MAX_INCREMENTAL_HASHES) {
+		firstPage = entry->dirtyStart / TEXCACHE_HASH_PAGE_SIZE;
+		endPage = std::min(pages, (u32)(((u64)entry->dirtyEnd + TEXCACHE_HASH_PAGE_SIZE - 1) / TEXCACHE_HASH_PAGE_SIZE));
+		entry->numIncrementalHashes = firstPage == 0 && endPage == pages ? 0 : entry->numIncrementalHashes + 1;
+	} else {
+		entry->pageHashes.resize(pages);
+		entry->numIncrementalHashes = 0;
+	}
+
+	for (u32 i = firstPage; i < endPage; ++i) {
+		const u32 offset = i * TEXCACHE_HASH_PAGE_SIZE;
+		entry->pageHashes[i] = DoQuickTexHash(checkp + offset, std::min((u32)TEXCACHE_HASH_PAGE_SIZE, sizeInRAM - offset));
+	}
+	entry->dirtyStart = 0;
+	entry->dirtyEnd = 0;
+
+	return DoReliableHash32(entry->pageHashes.data(), pages * sizeof(u32), 0xBB7A6E5D);
+}
+
 bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 	int w = gstate.getTextureWidth(0);
 	int h = gstate.getTextureHeight(0);
@@ -1621,10 +1795,9 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 		if (entry->numInvalidated > 2 && entry->numInvalidated < 128 && !lowMemoryMode_) {
 			// We have a new hash: look for that hash in the secondary cache.
 			u64 secondKey = fullhash | (u64)entry->cluthash << 32;
-			TexCache::iterator secondIter = secondCache_.find(secondKey);
-			if (secondIter != secondCache_.end()) {
+			TexCacheEntry *secondEntry = secondCache_.Get(secondKey);
+			if (secondEntry) {
 				// Found it, but does it match our current params?  If not, abort.
-				TexCacheEntry *secondEntry = secondIter->second.get();
 				if (secondEntry->Matches(entry->dim, entry->format, entry->maxLevel)) {
 					// Reset the numInvalidated value lower, we got a match.
 					if (entry->numInvalidated > 8) {
@@ -1642,14 +1815,17 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 				secondCacheSizeEstimate_ += EstimateTexMemoryUsage(entry);
 
 				// If the entry already exists in the secondary texture cache, drop it nicely.
-				auto oldIter = secondCache_.find(secondKey);
-				if (oldIter != secondCache_.end()) {
-					ReleaseTexture(oldIter->second.get(), true);
+				TexCacheEntry *oldEntry = secondCache_.Get(secondKey);
+				if (oldEntry) {
+					ReleaseTexture(oldEntry, true);
 				}
 
 				// Archive the entire texture entry as is, since we'll use its params if it is seen again.
 				// We keep parameters on the current entry, since we are STILL building a new texture here.
-				secondCache_[secondKey].reset(new TexCacheEntry(*entry));
+				TexCacheEntry *archived = new TexCacheEntry(*entry);
+				// The page hashes were already updated for the new contents.
+				archived->pageHashes.clear();
+				secondCache_.Insert(secondKey, archived);
 
 				// Make sure we don't delete the texture we just archived.
 				entry->texturePtr = nullptr;
@@ -1701,6 +1877,23 @@ void TextureCacheCommon::Invalidate(u32 addr, int size, GPUInvalidationType type
 				iter->second->SetHashStatus(TexCacheEntry::STATUS_HASHING);
 			}
 			if (type != GPU_INVALIDATE_ALL) {
+				TexCacheEntry *entry = iter->second.get();
+				const u32 dirtyStart = std::max(addr, texAddr) - texAddr;
+				const u32 dirtyEnd = std::min(addr_end, texEnd) - texAddr;
+				if (entry->dirtyStart < entry->dirtyEnd) {
+					entry->dirtyStart = std::min(entry->dirtyStart, dirtyStart);
+					entry->dirtyEnd = std::max(entry->dirtyEnd, dirtyEnd);
+				} else {
+					entry->dirtyStart = dirtyStart;
+					entry->dirtyEnd = dirtyEnd;
+				}
+				if (asyncScaler_ && (entry->status & TexCacheEntry::STATUS_SCALING_ASYNC)) {
+					// The result would likely be stale, so scale again after the next rebuild.
+					asyncScaler_->Cancel(entry->CacheKey());
+					entry->status &= ~TexCacheEntry::STATUS_SCALING_ASYNC;
+					entry->status |= TexCacheEntry::STATUS_TO_SCALE;
+				}
+
 				gpuStats.numTextureInvalidations++;
 				// Start it over from 0 (unless it's safe.)
 				iter->second->numFrames = type == GPU_INVALIDATE_SAFE ? 256 : 0;
@@ -1714,6 +1907,9 @@ void TextureCacheCommon::Invalidate(u32 addr, int size, GPUInvalidationType type
 				iter->second->framesUntilNextFullHash = 0;
 			} else if (!iter->second->framebuffer) {
 				iter->second->invalidHint++;
+				// We don't know what was written, so the next hash has to look at everything.
+				iter->second->dirtyStart = 0;
+				iter->second->dirtyEnd = 0xFFFFFFFF;
 			}
 		}
 	}
@@ -1736,6 +1932,8 @@ void TextureCacheCommon::InvalidateAll(GPUInvalidationType /*unused*/) {
 		}
 		if (!iter->second->framebuffer) {
 			iter->second->invalidHint++;
+			iter->second->dirtyStart = 0;
+			iter->second->dirtyEnd = 0xFFFFFFFF;
 		}
 	}
 }
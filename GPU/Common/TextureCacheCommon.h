@@ -22,11 +22,13 @@
 #include <memory>
 
 #include "Common/CommonTypes.h"
+#include "Common/Hashmaps.h"
 #include "Common/MemoryUtil.h"
 #include "Core/TextureReplacer.h"
 #include "Core/System.h"
 #include "GPU/Common/GPUDebugInterface.h"
 #include "GPU/Common/TextureDecoder.h"
+#include "GPU/Common/TextureScalerCommon.h"
 
 enum TextureFiltering {
 	TEX_FILTER_AUTO = 1,
@@ -47,6 +49,12 @@ enum FramebufferNotification {
 #define TEXCACHE_FRAME_CHANGE_FREQUENT_REGAIN_TRUST 33
 
 #define TEXCACHE_MAX_TEXELS_SCALED (256*256)  // Per frame
+// Max memory for source and scaled pixels of textures being upscaled in the background.
+#define TEXCACHE_ASYNC_SCALE_BUDGET (64 * 1024 * 1024)
+
+// Textures at least this large keep a hash per page (see QuickTexHashPaged.)
+#define TEXCACHE_HASH_PAGE_SIZE 4096
+#define TEXCACHE_MIN_PAGED_HASH_SIZE (TEXCACHE_HASH_PAGE_SIZE * 8)
 
 struct VirtualFramebuffer;
 
@@ -88,7 +96,6 @@ struct SamplerCacheKey {
 class GLRTexture;
 class VulkanTexture;
 
-// TODO: Shrink this struct. There is some fluff.
 struct TexCacheEntry {
 	~TexCacheEntry() {
 		if (texturePtr || textureName || vkTex)
@@ -119,34 +126,46 @@ struct TexCacheEntry {
 		STATUS_FREE_CHANGE = 0x200,    // Allow one change before marking "frequent".
 
 		STATUS_BAD_MIPS = 0x400,       // Has bad or unusable mipmap levels.
+		STATUS_SCALING_ASYNC = 0x800,  // Using the unscaled texture until the background scale is done.
+		STATUS_TO_REPLACE = 0x1000,    // Using the original texture until the replacement has loaded.
 	};
 
+	// Fields are ordered so that what SetTexture() reads on a cache hit sits at the front,
+	// within the first cache line. The rest is only touched on rehash or invalidation.
 	// Status, but int so we can zero initialize.
 	int status;
 	u32 addr;
 	u32 hash;
+	u32 cluthash;
 	VirtualFramebuffer *framebuffer;  // if null, not sourced from an FBO. TODO: Collapse into texturePtr
-	u32 sizeInRAM;  // Could be computed
-	u8 format;
-	u8 maxLevel;
-	u16 dim;
-	u16 bufw;
 	union {
 		GLRTexture *textureName;
 		void *texturePtr;
 		VulkanTexture *vkTex;
 	};
-#ifdef _WIN32
-	void *textureView;  // Used by D3D11 only for the shader resource view.
-#endif
 	int invalidHint;
 	int lastFrame;
 	int numFrames;
-	int numInvalidated;
 	u32 framesUntilNextFullHash;
-	u32 fullhash;
-	u32 cluthash;
+	u16 dim;
+	u16 bufw;
 	u16 maxSeenV;
+	u8 format;
+	u8 maxLevel;
+
+	// Cold.
+	u32 sizeInRAM;  // Could be computed
+	int numInvalidated;
+	u32 fullhash;
+	// Byte range (relative to addr) reported written through Invalidate() since the last hash.
+	u32 dirtyStart;
+	u32 dirtyEnd;
+	int numIncrementalHashes;
+	// Large textures are hashed per page, so that the dirty range can be rehashed alone.
+	std::vector<u32> pageHashes;
+#ifdef _WIN32
+	void *textureView;  // Used by D3D11 only for the shader resource view.
+#endif
 
 	TexStatus GetHashStatus() {
 		return TexStatus(status & STATUS_MASK);
@@ -173,9 +192,52 @@ struct TexCacheEntry {
 };
 
 class FramebufferManagerCommon;
-// Can't be unordered_map, we use lower_bound ... although for some reason that compiles on MSVC.
-// Would really like to replace this with DenseHashMap but can't as long as we need lower_bound.
-typedef std::map<u64, std::unique_ptr<TexCacheEntry>> TexCache;
+
+// Texture cache index. Entries are owned by an address-sorted map (the key has the address
+// in the upper 32 bits), which serves the lower_bound range scans of Invalidate() and
+// NotifyFramebuffer(). The exact lookup done on every SetTexture() goes through a
+// DenseHashMap instead, so it doesn't have to chase tree nodes all over memory.
+class TexCache {
+public:
+	typedef std::map<u64, std::unique_ptr<TexCacheEntry>> Storage;
+	typedef Storage::iterator iterator;
+
+	TexCache() : index_(1024) {}
+
+	// Returns nullptr if no entry was found.
+	TexCacheEntry *Get(u64 key) {
+		return index_.Get(key);
+	}
+	// Takes ownership. Any existing entry with the same key is deleted, so it must have
+	// been released already.
+	void Insert(u64 key, TexCacheEntry *entry) {
+		std::unique_ptr<TexCacheEntry> &slot = storage_[key];
+		if (slot) {
+			index_.Remove(key);
+		}
+		slot.reset(entry);
+		index_.Insert(key, entry);
+	}
+	iterator erase(iterator it) {
+		index_.Remove(it->first);
+		index_.Maintain();
+		return storage_.erase(it);
+	}
+	void clear() {
+		storage_.clear();
+		index_.Clear();
+	}
+
+	size_t size() const { return storage_.size(); }
+	iterator begin() { return storage_.begin(); }
+	iterator end() { return storage_.end(); }
+	iterator lower_bound(u64 key) { return storage_.lower_bound(key); }
+	iterator upper_bound(u64 key) { return storage_.upper_bound(key); }
+
+private:
+	Storage storage_;
+	DenseHashMap<u64, TexCacheEntry *, nullptr> index_;
+};
 
 class TextureCacheCommon {
 public:
@@ -226,6 +288,8 @@ class TextureCacheCommon {
 	void HandleTextureChange(TexCacheEntry *const entry, const char *reason, bool initialMatch, bool doDelete);
 	virtual void BuildTexture(TexCacheEntry *const entry) = 0;
 	virtual void UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBase, bool clutIndexIsSimple) = 0;
+	// A new scaler for the background thread, which owns it.
+	virtual TextureScalerCommon *CreateScaler() = 0;
 	bool CheckFullHash(TexCacheEntry *entry, bool &doDelete);
 
 	// Separate to keep main texture cache size down.
@@ -257,7 +321,18 @@ class TextureCacheCommon {
 
 	void DecimateVideos();
 
-	inline u32 QuickTexHash(TextureReplacer &replacer, u32 addr, int bufw, int w, int h, GETextureFormat format, TexCacheEntry *entry) const {
+	// Called from BuildTexture(), returns the factor to build with now (may be 1 while scaling in the background.)
+	int ThrottleScaleFactor(TexCacheEntry *entry, int scaleFactor, int w, int h);
+	// Returns the replacement only once it has loaded, otherwise marks the entry to be rebuilt later.
+	ReplacedTexture &FindReplacement(TexCacheEntry *entry, int w, int h);
+	// Hands the decoded pixels to the background scaler, if ThrottleScaleFactor() asked for it.
+	void QueueAsyncScale(TexCacheEntry *entry, int level, const void *pixels, int pitch, int bpp, u32 fmt, int w, int h);
+	// Uses the background result if it's ready, otherwise scales right away.
+	void ScaleLevel(TextureScalerCommon &scaler, TexCacheEntry *entry, u32 *out, u32 *src, u32 &dstFmt, int &w, int &h, int factor);
+	// Once per frame, marks textures with finished background scales for rebuild.
+	void ProcessScaledTextures();
+
+	inline u32 QuickTexHash(TextureReplacer &replacer, u32 addr, int bufw, int w, int h, GETextureFormat format, TexCacheEntry *entry) {
 		if (replacer.Enabled()) {
 			return replacer.ComputeHash(addr, bufw, w, h, format, entry->maxSeenV);
 		}
@@ -270,12 +345,17 @@ class TextureCacheCommon {
 		const u32 *checkp = (const u32 *)Memory::GetPointer(addr);
 
 		if (Memory::IsValidAddress(addr + sizeInRAM)) {
+			if (sizeInRAM >= TEXCACHE_MIN_PAGED_HASH_SIZE) {
+				return QuickTexHashPaged(entry, (const u8 *)checkp, sizeInRAM);
+			}
 			return DoQuickTexHash(checkp, sizeInRAM);
 		} else {
 			return 0;
 		}
 	}
 
+	u32 QuickTexHashPaged(TexCacheEntry *entry, const u8 *checkp, u32 sizeInRAM);
+
 	static inline u32 MiniHash(const u32 *ptr) {
 		return ptr[0];
 	}
@@ -325,6 +405,9 @@ class TextureCacheCommon {
 	u16 clutAlphaLinearColor_;
 
 	int standardScaleFactor_;
+	std::unique_ptr<AsyncTextureScaler> asyncScaler_;
+	// Set by ThrottleScaleFactor() during BuildTexture() when the level should be queued.
+	int asyncScaleFactor_ = 0;
 
 	const char *nextChangeReason_;
 	bool nextNeedsRehash_;
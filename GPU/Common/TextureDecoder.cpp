@@ -65,6 +65,151 @@ u32 QuickTexHashSSE2(const void *checkp, u32 size) {
 
 	return check;
 }
+
+#if defined(__GNUC__) || defined(_MSC_VER)
+#include <immintrin.h>
+// Code for newer instruction sets is compiled in regardless, and picked at runtime using cpu_info.
+#define TEXDECODER_RUNTIME_SIMD
+#if defined(__GNUC__)
+#define SIMD_TARGET(x) __attribute__((target(x)))
+#else
+#define SIMD_TARGET(x)
+#endif
+
+// Same idea as QuickTexHashSSE2, but twice as wide, so the result is NOT the same.
+// Only used for DoQuickTexHash, which never leaves the current run.
+SIMD_TARGET("avx2")
+static u32 QuickTexHashAVX2(const void *checkp, u32 size) {
+	if (((intptr_t)checkp & 0xf) != 0 || (size & 0x7f) != 0) {
+		return QuickTexHashSSE2(checkp, size);
+	}
+
+	__m256i cursor = _mm256_setzero_si256();
+	__m256i cursor2 = _mm256_set_epi16(
+		0x0001U, 0x0083U, 0x4309U, 0x4d9bU, 0xb651U, 0x4b73U, 0x9bd9U, 0xc00bU,
+		0x2456U, 0x24d8U, 0x675eU, 0x71f0U, 0xdaa6U, 0x6fc8U, 0xc02eU, 0xe460U);
+	__m256i update = _mm256_set1_epi16(0x2455U);
+	const __m256i *p = (const __m256i *)checkp;
+	for (u32 i = 0; i < size / 32; i += 4) {
+		__m256i chunk = _mm256_mullo_epi16(_mm256_loadu_si256(&p[i]), cursor2);
+		cursor = _mm256_add_epi16(cursor, chunk);
+		cursor = _mm256_xor_si256(cursor, _mm256_loadu_si256(&p[i + 1]));
+		cursor = _mm256_add_epi32(cursor, _mm256_loadu_si256(&p[i + 2]));
+		chunk = _mm256_mullo_epi16(_mm256_loadu_si256(&p[i + 3]), cursor2);
+		cursor = _mm256_xor_si256(cursor, chunk);
+		cursor2 = _mm256_add_epi16(cursor2, update);
+	}
+	cursor = _mm256_add_epi32(cursor, cursor2);
+	// Fold the two halves, then add the four parts into the low i32.
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(cursor), _mm256_extracti128_si256(cursor, 1));
+	sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+	sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+	return _mm_cvtsi128_si32(sum);
+}
+
+// Splits the 16 CLUT entries into byte planes, so that pshufb can do the lookups.
+template <typename ClutT>
+static inline void SplitClut4Planes(u8 planes[sizeof(ClutT)][16], const ClutT *clut) {
+	for (int i = 0; i < 16; ++i) {
+		for (int b = 0; b < (int)sizeof(ClutT); ++b) {
+			planes[b][i] = (u8)(clut[i] >> (b * 8));
+		}
+	}
+}
+
+SIMD_TARGET("ssse3")
+static inline __m128i LoadIndices4SSSE3(const u8 *indexed) {
+	const __m128i in = _mm_loadl_epi64((const __m128i *)indexed);
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	// Each byte has the first pixel in the low nibble.
+	return _mm_unpacklo_epi8(_mm_and_si128(in, mask), _mm_and_si128(_mm_srli_epi16(in, 4), mask));
+}
+
+SIMD_TARGET("ssse3")
+static void DeIndexTexture4SSSE3(u16 *dest, const u8 *indexed, int length, const u16 *clut) {
+	alignas(16) u8 planes[2][16];
+	SplitClut4Planes(planes, clut);
+	const __m128i lo = _mm_load_si128((const __m128i *)planes[0]);
+	const __m128i hi = _mm_load_si128((const __m128i *)planes[1]);
+
+	int i = 0;
+	for (; i + 16 <= length; i += 16) {
+		const __m128i index = LoadIndices4SSSE3(indexed + i / 2);
+		const __m128i l = _mm_shuffle_epi8(lo, index);
+		const __m128i h = _mm_shuffle_epi8(hi, index);
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_unpacklo_epi8(l, h));
+		_mm_storeu_si128((__m128i *)(dest + i + 8), _mm_unpackhi_epi8(l, h));
+	}
+	for (; i < length; i += 2) {
+		u8 index = indexed[i / 2];
+		dest[i + 0] = clut[(index >> 0) & 0xf];
+		dest[i + 1] = clut[(index >> 4) & 0xf];
+	}
+}
+
+SIMD_TARGET("ssse3")
+static void DeIndexTexture4SSSE3(u32 *dest, const u8 *indexed, int length, const u32 *clut) {
+	alignas(16) u8 planes[4][16];
+	SplitClut4Planes(planes, clut);
+	const __m128i p0 = _mm_load_si128((const __m128i *)planes[0]);
+	const __m128i p1 = _mm_load_si128((const __m128i *)planes[1]);
+	const __m128i p2 = _mm_load_si128((const __m128i *)planes[2]);
+	const __m128i p3 = _mm_load_si128((const __m128i *)planes[3]);
+
+	int i = 0;
+	for (; i + 16 <= length; i += 16) {
+		const __m128i index = LoadIndices4SSSE3(indexed + i / 2);
+		const __m128i b0 = _mm_shuffle_epi8(p0, index);
+		const __m128i b1 = _mm_shuffle_epi8(p1, index);
+		const __m128i b2 = _mm_shuffle_epi8(p2, index);
+		const __m128i b3 = _mm_shuffle_epi8(p3, index);
+		const __m128i lo01 = _mm_unpacklo_epi8(b0, b1);
+		const __m128i hi01 = _mm_unpackhi_epi8(b0, b1);
+		const __m128i lo23 = _mm_unpacklo_epi8(b2, b3);
+		const __m128i hi23 = _mm_unpackhi_epi8(b2, b3);
+		_mm_storeu_si128((__m128i *)(dest + i + 0), _mm_unpacklo_epi16(lo01, lo23));
+		_mm_storeu_si128((__m128i *)(dest + i + 4), _mm_unpackhi_epi16(lo01, lo23));
+		_mm_storeu_si128((__m128i *)(dest + i + 8), _mm_unpacklo_epi16(hi01, hi23));
+		_mm_storeu_si128((__m128i *)(dest + i + 12), _mm_unpackhi_epi16(hi01, hi23));
+	}
+	for (; i < length; i += 2) {
+		u8 index = indexed[i / 2];
+		dest[i + 0] = clut[(index >> 0) & 0xf];
+		dest[i + 1] = clut[(index >> 4) & 0xf];
+	}
+}
+
+// Note: reads 2 bytes past the last 16-bit CLUT entry used, the CLUT buffers are much larger.
+SIMD_TARGET("avx2")
+static void DeIndexTexture8AVX2(u16 *dest, const u8 *indexed, int length, const u16 *clut) {
+	const __m256i mask = _mm256_set1_epi32(0xFFFF);
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(indexed + i)));
+		const __m256i colors = _mm256_and_si256(_mm256_i32gather_epi32((const int *)clut, index, 2), mask);
+		// packus works within each 128-bit lane, so gather the two useful quarters afterward.
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(colors, colors), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128((__m128i *)(dest + i), _mm256_castsi256_si128(packed));
+	}
+	for (; i < length; ++i) {
+		dest[i] = clut[indexed[i]];
+	}
+}
+
+SIMD_TARGET("avx2")
+static void DeIndexTexture8AVX2(u32 *dest, const u8 *indexed, int length, const u32 *clut) {
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(indexed + i)));
+		_mm256_storeu_si256((__m256i *)(dest + i), _mm256_i32gather_epi32((const int *)clut, index, 4));
+	}
+	for (; i < length; ++i) {
+		dest[i] = clut[indexed[i]];
+	}
+}
+#endif
+
+QuickTexHashFunc DoQuickTexHash = &QuickTexHashSSE2;
 #endif
 
 // Masks to downalign bufw to 16 bytes, and wrap at 2048.
@@ -315,8 +460,75 @@ ReliableHash32Func DoReliableHash32 = &XXH32;
 ReliableHash64Func DoReliableHash64 = &XXH64;
 #endif
 
+template <typename ClutT>
+static void DeIndexTexture4Basic(ClutT *dest, const u8 *indexed, int length, const ClutT *clut) {
+	for (int i = 0; i < length; i += 2) {
+		u8 index = *indexed++;
+		dest[i + 0] = clut[(index >> 0) & 0xf];
+		dest[i + 1] = clut[(index >> 4) & 0xf];
+	}
+}
+
+template <typename ClutT>
+static void DeIndexTexture8Basic(ClutT *dest, const u8 *indexed, int length, const ClutT *clut) {
+	for (int i = 0; i < length; ++i) {
+		*dest++ = clut[*indexed++];
+	}
+}
+
+template <typename ClutT>
+static inline void DeIndexTexture4NakedImpl(ClutT *dest, const u8 *indexed, int length, const ClutT *clut) {
+#if defined(TEXDECODER_RUNTIME_SIMD)
+	if (cpu_info.bSSSE3) {
+		DeIndexTexture4SSSE3(dest, indexed, length, clut);
+		return;
+	}
+#elif PPSSPP_ARCH(ARM64)
+	DeIndexTexture4NEON(dest, indexed, length, clut);
+	return;
+#elif PPSSPP_ARCH(ARM_NEON)
+	if (cpu_info.bNEON) {
+		DeIndexTexture4NEON(dest, indexed, length, clut);
+		return;
+	}
+#endif
+	DeIndexTexture4Basic(dest, indexed, length, clut);
+}
+
+template <typename ClutT>
+static inline void DeIndexTexture8NakedImpl(ClutT *dest, const u8 *indexed, int length, const ClutT *clut) {
+#if defined(TEXDECODER_RUNTIME_SIMD)
+	if (cpu_info.bAVX2) {
+		DeIndexTexture8AVX2(dest, indexed, length, clut);
+		return;
+	}
+#endif
+	DeIndexTexture8Basic(dest, indexed, length, clut);
+}
+
+void DeIndexTexture4Naked(u16 *dest, const u8 *indexed, int length, const u16 *clut) {
+	DeIndexTexture4NakedImpl(dest, indexed, length, clut);
+}
+
+void DeIndexTexture4Naked(u32 *dest, const u8 *indexed, int length, const u32 *clut) {
+	DeIndexTexture4NakedImpl(dest, indexed, length, clut);
+}
+
+void DeIndexTexture8Naked(u16 *dest, const u8 *indexed, int length, const u16 *clut) {
+	DeIndexTexture8NakedImpl(dest, indexed, length, clut);
+}
+
+void DeIndexTexture8Naked(u32 *dest, const u8 *indexed, int length, const u32 *clut) {
+	DeIndexTexture8NakedImpl(dest, indexed, length, clut);
+}
+
 // This has to be done after CPUDetect has done its magic.
 void SetupTextureDecoder() {
+#if defined(TEXDECODER_RUNTIME_SIMD)
+	if (cpu_info.bAVX2) {
+		DoQuickTexHash = &QuickTexHashAVX2;
+	}
+#endif
 #if PPSSPP_ARCH(ARM_NEON) && !PPSSPP_ARCH(ARM64)
 	if (cpu_info.bNEON) {
 		DoQuickTexHash = &QuickTexHashNEON;
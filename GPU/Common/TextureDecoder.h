@@ -38,7 +38,10 @@ void DoSwizzleTex16(const u32 *ysrcp, u8 *texptr, int bxc, int byc, u32 pitch);
 // For SSE, we statically link the SSE2 algorithms.
 #if defined(_M_SSE)
 u32 QuickTexHashSSE2(const void *checkp, u32 size);
-#define DoQuickTexHash QuickTexHashSSE2
+// Switched to a wider AVX2 version by SetupTextureDecoder() when available. Its results
+// differ from the SSE2 version, so use StableQuickTexHash for anything that is saved.
+typedef u32 (*QuickTexHashFunc)(const void *checkp, u32 size);
+extern QuickTexHashFunc DoQuickTexHash;
 #define StableQuickTexHash QuickTexHashSSE2
 
 // Pitch must be aligned to 16 bytes (as is the case on a PSP)
@@ -140,6 +143,13 @@ static const u8 textureBitsPerPixel[16] = {
 
 u32 GetTextureBufw(int level, u32 texaddr, GETextureFormat format);
 
+// CLUT lookups for the common case of no index shift, mask, or offset.
+// These pick a SIMD version at runtime when the CPU has one.
+void DeIndexTexture4Naked(u16 *dest, const u8 *indexed, int length, const u16 *clut);
+void DeIndexTexture4Naked(u32 *dest, const u8 *indexed, int length, const u32 *clut);
+void DeIndexTexture8Naked(u16 *dest, const u8 *indexed, int length, const u16 *clut);
+void DeIndexTexture8Naked(u32 *dest, const u8 *indexed, int length, const u32 *clut);
+
 template <typename IndexT, typename ClutT>
 inline void DeIndexTexture(ClutT *dest, const IndexT *indexed, int length, const ClutT *clut) {
 	// Usually, there is no special offset, mask, or shift.
@@ -147,9 +157,7 @@ inline void DeIndexTexture(ClutT *dest, const IndexT *indexed, int length, const
 
 	if (nakedIndex) {
 		if (sizeof(IndexT) == 1) {
-			for (int i = 0; i < length; ++i) {
-				*dest++ = clut[*indexed++];
-			}
+			DeIndexTexture8Naked(dest, (const u8 *)indexed, length, clut);
 		} else {
 			for (int i = 0; i < length; ++i) {
 				*dest++ = clut[(*indexed++) & 0xFF];
@@ -174,11 +182,7 @@ inline void DeIndexTexture4(ClutT *dest, const u8 *indexed, int length, const Cl
 	const bool nakedIndex = gstate.isClutIndexSimple();
 
 	if (nakedIndex) {
-		for (int i = 0; i < length; i += 2) {
-			u8 index = *indexed++;
-			dest[i + 0] = clut[(index >> 0) & 0xf];
-			dest[i + 1] = clut[(index >> 4) & 0xf];
-		}
+		DeIndexTexture4Naked(dest, indexed, length, clut);
 	} else {
 		for (int i = 0; i < length; i += 2) {
 			u8 index = *indexed++;
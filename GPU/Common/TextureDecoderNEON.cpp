@@ -386,4 +386,58 @@ CheckAlphaResult CheckAlphaRGBA5551NEON(const u32 *pixelData, int stride, int w,
 	return CHECKALPHA_FULL;
 }
 
+void DeIndexTexture4NEON(u16 *dest, const u8 *indexed, int length, const u16 *clut) {
+	// Split the 16 CLUT entries into byte planes, so vtbl can do the lookups.
+	const uint8x16x2_t planes = vld2q_u8((const u8 *)clut);
+	const uint8x8x2_t lo = { { vget_low_u8(planes.val[0]), vget_high_u8(planes.val[0]) } };
+	const uint8x8x2_t hi = { { vget_low_u8(planes.val[1]), vget_high_u8(planes.val[1]) } };
+	const uint8x8_t mask = vdup_n_u8(0x0F);
+
+	int i = 0;
+	for (; i + 16 <= length; i += 16) {
+		const uint8x8_t in = vld1_u8(indexed + i / 2);
+		// Each byte has the first pixel in the low nibble.
+		const uint8x8x2_t index = vzip_u8(vand_u8(in, mask), vshr_n_u8(in, 4));
+		for (int n = 0; n < 2; ++n) {
+			uint8x8x2_t out;
+			out.val[0] = vtbl2_u8(lo, index.val[n]);
+			out.val[1] = vtbl2_u8(hi, index.val[n]);
+			vst2_u8((u8 *)(dest + i + n * 8), out);
+		}
+	}
+	for (; i < length; i += 2) {
+		u8 index = indexed[i / 2];
+		dest[i + 0] = clut[(index >> 0) & 0xf];
+		dest[i + 1] = clut[(index >> 4) & 0xf];
+	}
+}
+
+void DeIndexTexture4NEON(u32 *dest, const u8 *indexed, int length, const u32 *clut) {
+	const uint8x16x4_t planes = vld4q_u8((const u8 *)clut);
+	uint8x8x2_t tables[4];
+	for (int b = 0; b < 4; ++b) {
+		tables[b].val[0] = vget_low_u8(planes.val[b]);
+		tables[b].val[1] = vget_high_u8(planes.val[b]);
+	}
+	const uint8x8_t mask = vdup_n_u8(0x0F);
+
+	int i = 0;
+	for (; i + 16 <= length; i += 16) {
+		const uint8x8_t in = vld1_u8(indexed + i / 2);
+		const uint8x8x2_t index = vzip_u8(vand_u8(in, mask), vshr_n_u8(in, 4));
+		for (int n = 0; n < 2; ++n) {
+			uint8x8x4_t out;
+			for (int b = 0; b < 4; ++b) {
+				out.val[b] = vtbl2_u8(tables[b], index.val[n]);
+			}
+			vst4_u8((u8 *)(dest + i + n * 8), out);
+		}
+	}
+	for (; i < length; i += 2) {
+		u8 index = indexed[i / 2];
+		dest[i + 0] = clut[(index >> 0) & 0xf];
+		dest[i + 1] = clut[(index >> 4) & 0xf];
+	}
+}
+
 #endif
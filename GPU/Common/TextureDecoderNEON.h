@@ -20,6 +20,8 @@
 u32 QuickTexHashNEON(const void *checkp, u32 size);
 void DoUnswizzleTex16NEON(const u8 *texptr, u32 *ydestp, int bxc, int byc, u32 pitch);
 u32 ReliableHash32NEON(const void *input, size_t len, u32 seed);
+void DeIndexTexture4NEON(u16 *dest, const u8 *indexed, int length, const u16 *clut);
+void DeIndexTexture4NEON(u32 *dest, const u8 *indexed, int length, const u32 *clut);
 
 CheckAlphaResult CheckAlphaRGBA8888NEON(const u32 *pixelData, int stride, int w, int h);
 CheckAlphaResult CheckAlphaABGR4444NEON(const u32 *pixelData, int stride, int w, int h);
@@ -36,9 +36,24 @@
 #include "Common/ThreadPools.h"
 #include "Common/CPUDetect.h"
 #include "ext/xbrz/xbrz.h"
+#include "thread/threadpool.h"
+#include "thread/threadutil.h"
 
-#if _M_SSE >= 0x401
-#include <smmintrin.h>
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#include <immintrin.h>
+// SSE4.1 and AVX2 code is compiled in regardless, and picked at runtime using cpu_info.
+#define TEXSCALER_RUNTIME_SIMD
+#if defined(__GNUC__)
+#define SIMD_TARGET(x) __attribute__((target(x)))
+#else
+#define SIMD_TARGET(x)
+#endif
+#endif
+#endif
+#if PPSSPP_ARCH(ARM_NEON)
+#include <arm_neon.h>
 #endif
 
 // Report the time and throughput for each larger scaling operation in the log
@@ -152,50 +167,255 @@ void deposterizeV(u32* data, u32* out, int w, int h, int l, int u) {
 	}
 }
 
+// distance of a single pixel to its 8 neighbours, see generateDistanceMask
+inline u32 distanceMaskPixel(const u32* data, int width, int height, int x, int y) {
+	const u32 center = data[y*width + x];
+	u32 dist = 0;
+	for (int yoff = -1; yoff <= 1; ++yoff) {
+		int yy = y + yoff;
+		if (yy == height || yy == -1) {
+			dist += 1200; // assume distance at borders, usually makes for better result
+			continue;
+		}
+		for (int xoff = -1; xoff <= 1; ++xoff) {
+			if (yoff == 0 && xoff == 0) continue;
+			int xx = x + xoff;
+			if (xx == width || xx == -1) {
+				dist += 400; // assume distance at borders, usually makes for better result
+				continue;
+			}
+			dist += DISTANCE(data[yy*width + xx], center);
+		}
+	}
+	return dist;
+}
+
 // generates a distance mask value for each pixel in data
 // higher values -> larger distance to the surrounding pixels
-void generateDistanceMask(u32* data, u32* out, int width, int height, int l, int u) {
+void generateDistanceMaskT(u32* data, u32* out, int width, int height, int l, int u) {
 	for (int yb = 0; yb < (u - l) / BLOCK_SIZE + 1; ++yb) {
 		for (int xb = 0; xb < width / BLOCK_SIZE + 1; ++xb) {
 			for (int y = l + yb*BLOCK_SIZE; y < l + (yb + 1)*BLOCK_SIZE && y < u; ++y) {
 				for (int x = xb*BLOCK_SIZE; x < (xb + 1)*BLOCK_SIZE && x < width; ++x) {
-					const u32 center = data[y*width + x];
-					u32 dist = 0;
-					for (int yoff = -1; yoff <= 1; ++yoff) {
-						int yy = y + yoff;
-						if (yy == height || yy == -1) {
-							dist += 1200; // assume distance at borders, usually makes for better result
-							continue;
-						}
-						for (int xoff = -1; xoff <= 1; ++xoff) {
-							if (yoff == 0 && xoff == 0) continue;
-							int xx = x + xoff;
-							if (xx == width || xx == -1) {
-								dist += 400; // assume distance at borders, usually makes for better result
-								continue;
-							}
-							dist += DISTANCE(data[yy*width + xx], center);
-						}
-					}
-					out[y*width + x] = dist;
+					out[y*width + x] = distanceMaskPixel(data, width, height, x, y);
 				}
 			}
 		}
 	}
 }
 
+// The SIMD versions do 4 pixels at a time, but leave the border pixels to distanceMaskPixel.
+// Per channel differences fit in 16 bits even after adding all 8 neighbours (8 * 2 * 255.)
+#if defined(_M_SSE)
+inline __m128i absDiffPairsSSE2(__m128i a, __m128i b) {
+	const __m128i diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+	return _mm_add_epi16(_mm_and_si128(diff, _mm_set1_epi16(0x00FF)), _mm_srli_epi16(diff, 8));
+}
+
+void generateDistanceMaskSSE2(u32* data, u32* out, int width, int height, int l, int u) {
+	for (int y = l; y < u; ++y) {
+		int x = 0;
+		if (y > 0 && y < height - 1) {
+			out[y*width] = distanceMaskPixel(data, width, height, 0, y);
+			for (x = 1; x + 4 < width; x += 4) {
+				const u32 *above = data + (y - 1)*width + x;
+				const u32 *row = data + y*width + x;
+				const u32 *below = data + (y + 1)*width + x;
+				const __m128i center = _mm_loadu_si128((const __m128i *)row);
+
+				__m128i sum = absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)(above - 1)), center);
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)above), center));
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)(above + 1)), center));
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)(row - 1)), center));
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)(row + 1)), center));
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)(below - 1)), center));
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)below), center));
+				sum = _mm_add_epi16(sum, absDiffPairsSSE2(_mm_loadu_si128((const __m128i *)(below + 1)), center));
+				_mm_storeu_si128((__m128i *)(out + y*width + x), _mm_madd_epi16(sum, _mm_set1_epi16(1)));
+			}
+		}
+		for (; x < width; ++x) {
+			out[y*width + x] = distanceMaskPixel(data, width, height, x, y);
+		}
+	}
+}
+#endif
+
+#if PPSSPP_ARCH(ARM_NEON)
+inline uint16x8_t absDiffPairsNEON(uint32x4_t a, uint32x4_t b) {
+	return vpaddlq_u8(vabdq_u8(vreinterpretq_u8_u32(a), vreinterpretq_u8_u32(b)));
+}
+
+void generateDistanceMaskNEON(u32* data, u32* out, int width, int height, int l, int u) {
+	for (int y = l; y < u; ++y) {
+		int x = 0;
+		if (y > 0 && y < height - 1) {
+			out[y*width] = distanceMaskPixel(data, width, height, 0, y);
+			for (x = 1; x + 4 < width; x += 4) {
+				const u32 *above = data + (y - 1)*width + x;
+				const u32 *row = data + y*width + x;
+				const u32 *below = data + (y + 1)*width + x;
+				const uint32x4_t center = vld1q_u32(row);
+
+				uint16x8_t sum = absDiffPairsNEON(vld1q_u32(above - 1), center);
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(above), center));
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(above + 1), center));
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(row - 1), center));
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(row + 1), center));
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(below - 1), center));
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(below), center));
+				sum = vaddq_u16(sum, absDiffPairsNEON(vld1q_u32(below + 1), center));
+				vst1q_u32(out + y*width + x, vpaddlq_u16(sum));
+			}
+		}
+		for (; x < width; ++x) {
+			out[y*width + x] = distanceMaskPixel(data, width, height, x, y);
+		}
+	}
+}
+#endif
+
+void generateDistanceMask(u32* data, u32* out, int width, int height, int l, int u) {
+#if defined(_M_SSE)
+	if (cpu_info.bSSE2) {
+		generateDistanceMaskSSE2(data, out, width, height, l, u);
+		return;
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	if (cpu_info.bNEON) {
+		generateDistanceMaskNEON(data, out, width, height, l, u);
+		return;
+	}
+#endif
+	generateDistanceMaskT(data, out, width, height, l, u);
+}
+
+// mix two pixels based on a mask value, see mix
+inline u32 mixPixel(u32 data, u32 source, u32 mask, u32 maskmax) {
+	u8 mixFactors[2] = { 0, static_cast<u8>((std::min(mask, maskmax) * 255) / maskmax) };
+	mixFactors[0] = 255 - mixFactors[1];
+	u32 result = MIX_PIXELS(data, source, mixFactors);
+	if (A(source) == 0) result = result & 0x00FFFFFF; // xBRZ always does a better job with hard alpha
+	return result;
+}
+
 // mix two images based on a mask
-void mix(u32* data, u32* source, u32* mask, u32 maskmax, int width, int l, int u) {
+void mixT(u32* data, u32* source, u32* mask, u32 maskmax, int width, int l, int u) {
 	for (int y = l; y < u; ++y) {
 		for (int x = 0; x < width; ++x) {
 			int pos = y*width + x;
-			u8 mixFactors[2] = { 0, static_cast<u8>((std::min(mask[pos], maskmax) * 255) / maskmax) };
-			mixFactors[0] = 255 - mixFactors[1];
-			data[pos] = MIX_PIXELS(data[pos], source[pos], mixFactors);
-			if (A(source[pos]) == 0) data[pos] = data[pos] & 0x00FFFFFF; // xBRZ always does a better job with hard alpha
+			data[pos] = mixPixel(data[pos], source[pos], mask[pos], maskmax);
+		}
+	}
+}
+
+// The SIMD versions blend in 16 bits, since d * (255 - f) + s * f <= 255 * 255.
+// x / 255 == (x + 1 + (x >> 8)) >> 8 for all of those.
+#if defined(_M_SSE)
+inline __m128i mixChannelsSSE2(__m128i d, __m128i s, __m128i f1) {
+	const __m128i f0 = _mm_sub_epi16(_mm_set1_epi16(255), f1);
+	__m128i v = _mm_add_epi16(_mm_mullo_epi16(d, f0), _mm_mullo_epi16(s, f1));
+	v = _mm_add_epi16(_mm_add_epi16(v, _mm_set1_epi16(1)), _mm_srli_epi16(v, 8));
+	return _mm_srli_epi16(v, 8);
+}
+
+void mixSSE2(u32* data, u32* source, u32* mask, u32 maskmax, int width, int l, int u) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+	const __m128i signBit = _mm_set1_epi32(0x80000000);
+	const __m128i maxv = _mm_set1_epi32(maskmax);
+	const __m128i maxvBiased = _mm_xor_si128(maxv, signBit);
+	const __m128 maxf = _mm_set1_ps((float)maskmax);
+
+	for (int y = l; y < u; ++y) {
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			const int pos = y*width + x;
+			// Unsigned min(mask, maskmax).
+			__m128i m = _mm_loadu_si128((const __m128i *)(mask + pos));
+			const __m128i over = _mm_cmpgt_epi32(_mm_xor_si128(m, signBit), maxvBiased);
+			m = _mm_or_si128(_mm_and_si128(over, maxv), _mm_andnot_si128(over, m));
+			// (m * 255) / maskmax, which float gets exactly right as long as maskmax < 65536.
+			const __m128i m255 = _mm_sub_epi32(_mm_slli_epi32(m, 8), m);
+			__m128i f1 = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(m255), maxf));
+			// Now spread it to all 4 channels.
+			f1 = _mm_or_si128(f1, _mm_slli_epi32(f1, 8));
+			f1 = _mm_or_si128(f1, _mm_slli_epi32(f1, 16));
+
+			const __m128i d = _mm_loadu_si128((const __m128i *)(data + pos));
+			const __m128i s = _mm_loadu_si128((const __m128i *)(source + pos));
+			const __m128i lo = mixChannelsSSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(f1, zero));
+			const __m128i hi = mixChannelsSSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(f1, zero));
+			__m128i result = _mm_packus_epi16(lo, hi);
+
+			// xBRZ always does a better job with hard alpha
+			const __m128i hardAlpha = _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), zero);
+			result = _mm_andnot_si128(_mm_and_si128(hardAlpha, alphaMask), result);
+			_mm_storeu_si128((__m128i *)(data + pos), result);
+		}
+		for (; x < width; ++x) {
+			const int pos = y*width + x;
+			data[pos] = mixPixel(data[pos], source[pos], mask[pos], maskmax);
 		}
 	}
 }
+#endif
+
+#if PPSSPP_ARCH(ARM_NEON)
+inline uint8x8_t mixChannelsNEON(uint8x8_t d, uint8x8_t s, uint8x8_t f1) {
+	uint16x8_t v = vmull_u8(d, vsub_u8(vdup_n_u8(255), f1));
+	v = vmlal_u8(v, s, f1);
+	v = vaddq_u16(vaddq_u16(v, vdupq_n_u16(1)), vshrq_n_u16(v, 8));
+	return vshrn_n_u16(v, 8);
+}
+
+void mixNEON(u32* data, u32* source, u32* mask, u32 maskmax, int width, int l, int u) {
+	const uint32x4_t alphaMask = vdupq_n_u32(0xFF000000);
+	for (int y = l; y < u; ++y) {
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			const int pos = y*width + x;
+			// No vector divide on ARMv7, so the factors are scalar.  Spread to all 4 channels.
+			u32 factors[4];
+			for (int i = 0; i < 4; ++i) {
+				factors[i] = ((std::min(mask[pos + i], maskmax) * 255) / maskmax) * 0x01010101;
+			}
+
+			const uint8x16_t d = vreinterpretq_u8_u32(vld1q_u32(data + pos));
+			const uint32x4_t s32 = vld1q_u32(source + pos);
+			const uint8x16_t s = vreinterpretq_u8_u32(s32);
+			const uint8x16_t f1 = vreinterpretq_u8_u32(vld1q_u32(factors));
+			const uint8x8_t lo = mixChannelsNEON(vget_low_u8(d), vget_low_u8(s), vget_low_u8(f1));
+			const uint8x8_t hi = mixChannelsNEON(vget_high_u8(d), vget_high_u8(s), vget_high_u8(f1));
+			uint32x4_t result = vreinterpretq_u32_u8(vcombine_u8(lo, hi));
+
+			// xBRZ always does a better job with hard alpha
+			const uint32x4_t hardAlpha = vceqq_u32(vandq_u32(s32, alphaMask), vdupq_n_u32(0));
+			result = vbicq_u32(result, vandq_u32(hardAlpha, alphaMask));
+			vst1q_u32(data + pos, result);
+		}
+		for (; x < width; ++x) {
+			const int pos = y*width + x;
+			data[pos] = mixPixel(data[pos], source[pos], mask[pos], maskmax);
+		}
+	}
+}
+#endif
+
+void mix(u32* data, u32* source, u32* mask, u32 maskmax, int width, int l, int u) {
+#if defined(_M_SSE)
+	if (cpu_info.bSSE2 && maskmax < 65536) {
+		mixSSE2(data, source, mask, maskmax, width, l, u);
+		return;
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	if (cpu_info.bNEON) {
+		mixNEON(data, source, mask, maskmax, width, l, u);
+		return;
+	}
+#endif
+	mixT(data, source, mask, maskmax, width, l, u);
+}
 
 //////////////////////////////////////////////////////////////////// Bicubic scaling
 
@@ -285,38 +505,130 @@ void scaleBicubicT(u32* data, u32* out, int w, int h, int l, int u) {
 		}
 	}
 }
-#if _M_SSE >= 0x401
+// The SIMD versions do exactly the same float math as scaleBicubicT, in the same order, so the output matches.
+// Skipping zero weights makes no difference, adding 0 leaves the sums unchanged.
+#ifdef TEXSCALER_RUNTIME_SIMD
 template<int f, int T>
+SIMD_TARGET("sse4.1")
+inline u32 bicubicPixelSSE41(const u32* data, int w, int h, int x, int y) {
+	__m128 result = _mm_set1_ps(0.0f);
+	int cx = x / f, cy = y / f;
+	// sample supporting pixels in original image
+	for (int sx = -2; sx <= 2; ++sx) {
+		for (int sy = -2; sy <= 2; ++sy) {
+			float weight = bicubicWeights[T][f - 2][x%f][y%f][sx + 2][sy + 2];
+			if (weight != 0.0f) {
+				// clamp pixel locations
+				int csy = std::max(std::min(sy + cy, h - 1), 0);
+				int csx = std::max(std::min(sx + cx, w - 1), 0);
+				// sample & add weighted components
+				__m128i sample = _mm_cvtsi32_si128(data[csy*w + csx]);
+				sample = _mm_cvtepu8_epi32(sample);
+				__m128 col = _mm_cvtepi32_ps(sample);
+				col = _mm_mul_ps(col, _mm_set1_ps(weight));
+				result = _mm_add_ps(result, col);
+			}
+		}
+	}
+	// generate and write result, rounding up like ceilf
+	result = _mm_ceil_ps(_mm_mul_ps(result, _mm_set1_ps(bicubicInvSums[T][f - 2][x%f][y%f])));
+	__m128i pixel = _mm_cvttps_epi32(result);
+	pixel = _mm_packs_epi32(pixel, pixel);
+	pixel = _mm_packus_epi16(pixel, pixel);
+	return _mm_cvtsi128_si32(pixel);
+}
+
+template<int f, int T>
+SIMD_TARGET("sse4.1")
 void scaleBicubicTSSE41(u32* data, u32* out, int w, int h, int l, int u) {
 	int outw = w*f;
 	for (int yb = 0; yb < (u - l)*f / BLOCK_SIZE + 1; ++yb) {
 		for (int xb = 0; xb < w*f / BLOCK_SIZE + 1; ++xb) {
 			for (int y = l*f + yb*BLOCK_SIZE; y < l*f + (yb + 1)*BLOCK_SIZE && y < u*f; ++y) {
 				for (int x = xb*BLOCK_SIZE; x < (xb + 1)*BLOCK_SIZE && x < w*f; ++x) {
-					__m128 result = _mm_set1_ps(0.0f);
+					out[y*outw + x] = bicubicPixelSSE41<f, T>(data, w, h, x, y);
+				}
+			}
+		}
+	}
+}
+
+// Two output pixels at a time, one per 128-bit lane.
+template<int f, int T>
+SIMD_TARGET("avx2")
+void scaleBicubicTAVX2(u32* data, u32* out, int w, int h, int l, int u) {
+	int outw = w*f;
+	for (int yb = 0; yb < (u - l)*f / BLOCK_SIZE + 1; ++yb) {
+		for (int xb = 0; xb < w*f / BLOCK_SIZE + 1; ++xb) {
+			for (int y = l*f + yb*BLOCK_SIZE; y < l*f + (yb + 1)*BLOCK_SIZE && y < u*f; ++y) {
+				const int xEnd = std::min((xb + 1)*BLOCK_SIZE, w*f);
+				int x = xb*BLOCK_SIZE;
+				for (; x + 1 < xEnd; x += 2) {
+					__m256 result = _mm256_setzero_ps();
+					int cx0 = x / f, cx1 = (x + 1) / f, cy = y / f;
+					const float (*weights0)[5] = bicubicWeights[T][f - 2][x%f][y%f];
+					const float (*weights1)[5] = bicubicWeights[T][f - 2][(x + 1)%f][y%f];
+					for (int sx = -2; sx <= 2; ++sx) {
+						for (int sy = -2; sy <= 2; ++sy) {
+							float weight0 = weights0[sx + 2][sy + 2];
+							float weight1 = weights1[sx + 2][sy + 2];
+							if (weight0 != 0.0f || weight1 != 0.0f) {
+								int csy = std::max(std::min(sy + cy, h - 1), 0);
+								int csx0 = std::max(std::min(sx + cx0, w - 1), 0);
+								int csx1 = std::max(std::min(sx + cx1, w - 1), 0);
+								__m128i samples = _mm_unpacklo_epi32(_mm_cvtsi32_si128(data[csy*w + csx0]), _mm_cvtsi32_si128(data[csy*w + csx1]));
+								__m256 col = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(samples));
+								col = _mm256_mul_ps(col, _mm256_setr_ps(weight0, weight0, weight0, weight0, weight1, weight1, weight1, weight1));
+								result = _mm256_add_ps(result, col);
+							}
+						}
+					}
+					float invSum0 = bicubicInvSums[T][f - 2][x%f][y%f];
+					float invSum1 = bicubicInvSums[T][f - 2][(x + 1)%f][y%f];
+					result = _mm256_ceil_ps(_mm256_mul_ps(result, _mm256_setr_ps(invSum0, invSum0, invSum0, invSum0, invSum1, invSum1, invSum1, invSum1)));
+					// Packing stays within each lane, so the pixels end up in the low dword of each.
+					__m256i pixels = _mm256_cvttps_epi32(result);
+					pixels = _mm256_packs_epi32(pixels, pixels);
+					pixels = _mm256_packus_epi16(pixels, pixels);
+					out[y*outw + x] = _mm_cvtsi128_si32(_mm256_castsi256_si128(pixels));
+					out[y*outw + x + 1] = _mm_cvtsi128_si32(_mm256_extracti128_si256(pixels, 1));
+				}
+				if (x < xEnd) {
+					out[y*outw + x] = bicubicPixelSSE41<f, T>(data, w, h, x, y);
+				}
+			}
+		}
+	}
+}
+#endif
+
+#if PPSSPP_ARCH(ARM64)
+template<int f, int T>
+void scaleBicubicTNEON(u32* data, u32* out, int w, int h, int l, int u) {
+	int outw = w*f;
+	for (int yb = 0; yb < (u - l)*f / BLOCK_SIZE + 1; ++yb) {
+		for (int xb = 0; xb < w*f / BLOCK_SIZE + 1; ++xb) {
+			for (int y = l*f + yb*BLOCK_SIZE; y < l*f + (yb + 1)*BLOCK_SIZE && y < u*f; ++y) {
+				for (int x = xb*BLOCK_SIZE; x < (xb + 1)*BLOCK_SIZE && x < w*f; ++x) {
+					float32x4_t result = vdupq_n_f32(0.0f);
 					int cx = x / f, cy = y / f;
-					// sample supporting pixels in original image
 					for (int sx = -2; sx <= 2; ++sx) {
 						for (int sy = -2; sy <= 2; ++sy) {
 							float weight = bicubicWeights[T][f - 2][x%f][y%f][sx + 2][sy + 2];
 							if (weight != 0.0f) {
-								// clamp pixel locations
 								int csy = std::max(std::min(sy + cy, h - 1), 0);
 								int csx = std::max(std::min(sx + cx, w - 1), 0);
-								// sample & add weighted components
-								__m128i sample = _mm_cvtsi32_si128(data[csy*w + csx]);
-								sample = _mm_cvtepu8_epi32(sample);
-								__m128 col = _mm_cvtepi32_ps(sample);
-								col = _mm_mul_ps(col, _mm_set1_ps(weight));
-								result = _mm_add_ps(result, col);
+								uint8x8_t sample = vreinterpret_u8_u32(vdup_n_u32(data[csy*w + csx]));
+								float32x4_t col = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(sample))));
+								// ARM64 compilers contract the scalar "r += weight*R" into a fused multiply-add.
+								result = vfmaq_n_f32(result, col, weight);
 							}
 						}
 					}
-					// generate and write result
-					__m128i pixel = _mm_cvtps_epi32(_mm_mul_ps(result, _mm_set1_ps(bicubicInvSums[T][f - 2][x%f][y%f])));
-					pixel = _mm_packs_epi32(pixel, pixel);
-					pixel = _mm_packus_epi16(pixel, pixel);
-					out[y*outw + x] = _mm_cvtsi128_si32(pixel);
+					result = vrndpq_f32(vmulq_n_f32(result, bicubicInvSums[T][f - 2][x%f][y%f]));
+					int16x4_t pixel16 = vqmovn_s32(vcvtq_s32_f32(result));
+					uint8x8_t pixel = vqmovun_s16(vcombine_s16(pixel16, pixel16));
+					out[y*outw + x] = vget_lane_u32(vreinterpret_u32_u8(pixel), 0);
 				}
 			}
 		}
@@ -324,52 +636,45 @@ void scaleBicubicTSSE41(u32* data, u32* out, int w, int h, int l, int u) {
 }
 #endif
 
-void scaleBicubicBSpline(int factor, u32* data, u32* out, int w, int h, int l, int u) {
-#if _M_SSE >= 0x401
+// picks the fastest available implementation of scaleBicubicT
+template<int f, int T>
+void scaleBicubicBest(u32* data, u32* out, int w, int h, int l, int u) {
+#ifdef TEXSCALER_RUNTIME_SIMD
+	if (cpu_info.bAVX2) {
+		scaleBicubicTAVX2<f, T>(data, out, w, h, l, u);
+		return;
+	}
 	if (cpu_info.bSSE4_1) {
-		switch (factor) {
-		case 2: scaleBicubicTSSE41<2, 0>(data, out, w, h, l, u); break; // when I first tested this, 
-		case 3: scaleBicubicTSSE41<3, 0>(data, out, w, h, l, u); break; // it was even slower than I had expected
-		case 4: scaleBicubicTSSE41<4, 0>(data, out, w, h, l, u); break; // turns out I had not included
-		case 5: scaleBicubicTSSE41<5, 0>(data, out, w, h, l, u); break; // any of these break statements
-		default: ERROR_LOG(G3D, "Bicubic upsampling only implemented for factors 2 to 5");
-		}
-	} else {
-#endif
-		switch (factor) {
-		case 2: scaleBicubicT<2, 0>(data, out, w, h, l, u); break; // when I first tested this, 
-		case 3: scaleBicubicT<3, 0>(data, out, w, h, l, u); break; // it was even slower than I had expected
-		case 4: scaleBicubicT<4, 0>(data, out, w, h, l, u); break; // turns out I had not included
-		case 5: scaleBicubicT<5, 0>(data, out, w, h, l, u); break; // any of these break statements
-		default: ERROR_LOG(G3D, "Bicubic upsampling only implemented for factors 2 to 5");
-		}
-#if _M_SSE >= 0x401
+		scaleBicubicTSSE41<f, T>(data, out, w, h, l, u);
+		return;
+	}
+#elif PPSSPP_ARCH(ARM64)
+	if (cpu_info.bNEON) {
+		scaleBicubicTNEON<f, T>(data, out, w, h, l, u);
+		return;
 	}
 #endif
+	scaleBicubicT<f, T>(data, out, w, h, l, u);
+}
+
+void scaleBicubicBSpline(int factor, u32* data, u32* out, int w, int h, int l, int u) {
+	switch (factor) {
+	case 2: scaleBicubicBest<2, 0>(data, out, w, h, l, u); break; // when I first tested this, 
+	case 3: scaleBicubicBest<3, 0>(data, out, w, h, l, u); break; // it was even slower than I had expected
+	case 4: scaleBicubicBest<4, 0>(data, out, w, h, l, u); break; // turns out I had not included
+	case 5: scaleBicubicBest<5, 0>(data, out, w, h, l, u); break; // any of these break statements
+	default: ERROR_LOG(G3D, "Bicubic upsampling only implemented for factors 2 to 5");
+	}
 }
 
 void scaleBicubicMitchell(int factor, u32* data, u32* out, int w, int h, int l, int u) {
-#if _M_SSE >= 0x401
-	if (cpu_info.bSSE4_1) {
-		switch (factor) {
-		case 2: scaleBicubicTSSE41<2, 1>(data, out, w, h, l, u); break;
-		case 3: scaleBicubicTSSE41<3, 1>(data, out, w, h, l, u); break;
-		case 4: scaleBicubicTSSE41<4, 1>(data, out, w, h, l, u); break;
-		case 5: scaleBicubicTSSE41<5, 1>(data, out, w, h, l, u); break;
-		default: ERROR_LOG(G3D, "Bicubic upsampling only implemented for factors 2 to 5");
-		}
-	} else {
-#endif
-		switch (factor) {
-		case 2: scaleBicubicT<2, 1>(data, out, w, h, l, u); break;
-		case 3: scaleBicubicT<3, 1>(data, out, w, h, l, u); break;
-		case 4: scaleBicubicT<4, 1>(data, out, w, h, l, u); break;
-		case 5: scaleBicubicT<5, 1>(data, out, w, h, l, u); break;
-		default: ERROR_LOG(G3D, "Bicubic upsampling only implemented for factors 2 to 5");
-		}
-#if _M_SSE >= 0x401
+	switch (factor) {
+	case 2: scaleBicubicBest<2, 1>(data, out, w, h, l, u); break;
+	case 3: scaleBicubicBest<3, 1>(data, out, w, h, l, u); break;
+	case 4: scaleBicubicBest<4, 1>(data, out, w, h, l, u); break;
+	case 5: scaleBicubicBest<5, 1>(data, out, w, h, l, u); break;
+	default: ERROR_LOG(G3D, "Bicubic upsampling only implemented for factors 2 to 5");
 	}
-#endif
 }
 
 //////////////////////////////////////////////////////////////////// Bilinear scaling
@@ -494,6 +799,14 @@ TextureScalerCommon::TextureScalerCommon() {
 TextureScalerCommon::~TextureScalerCommon() {
 }
 
+void TextureScalerCommon::ParallelLoop(const std::function<void(int, int)> &loop, int lower, int upper) {
+	if (pool_) {
+		pool_->ParallelLoop(loop, lower, upper);
+	} else {
+		GlobalThreadPool::Loop(loop, lower, upper);
+	}
+}
+
 bool TextureScalerCommon::IsEmptyOrFlat(u32* data, int pixels, int fmt) {
 	int pixelsPerWord = 4 / BytesPerPixel(fmt);
 	u32 ref = data[0];
@@ -607,22 +920,25 @@ bool TextureScalerCommon::Scale(u32* &data, u32 &dstFmt, int &width, int &height
 
 void TextureScalerCommon::ScaleXBRZ(int factor, u32* source, u32* dest, int width, int height) {
 	xbrz::ScalerCfg cfg;
-	GlobalThreadPool::Loop(std::bind(&xbrz::scale, factor, source, dest, width, height, xbrz::ColorFormat::ARGB, cfg, std::placeholders::_1, std::placeholders::_2), 0, height);
+	// Shares color distances between neighbouring kernels, computed with SSE2 when xBRZ is built with it.
+	// That's decided at compile time, and sharing helps either way, so always enable it.  The output is the same.
+	cfg.vectorize = true;
+	ParallelLoop(std::bind(&xbrz::scale, factor, source, dest, width, height, xbrz::ColorFormat::ARGB, cfg, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleBilinear(int factor, u32* source, u32* dest, int width, int height) {
 	bufTmp1.resize(width*height*factor);
 	u32 *tmpBuf = bufTmp1.data();
-	GlobalThreadPool::Loop(std::bind(&bilinearH, factor, source, tmpBuf, width, std::placeholders::_1, std::placeholders::_2), 0, height);
-	GlobalThreadPool::Loop(std::bind(&bilinearV, factor, tmpBuf, dest, width, 0, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&bilinearH, factor, source, tmpBuf, width, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&bilinearV, factor, tmpBuf, dest, width, 0, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleBicubicBSpline(int factor, u32* source, u32* dest, int width, int height) {
-	GlobalThreadPool::Loop(std::bind(&scaleBicubicBSpline, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&scaleBicubicBSpline, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleBicubicMitchell(int factor, u32* source, u32* dest, int width, int height) {
-	GlobalThreadPool::Loop(std::bind(&scaleBicubicMitchell, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&scaleBicubicMitchell, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleHybrid(int factor, u32* source, u32* dest, int width, int height, bool bicubic) {
@@ -638,8 +954,8 @@ void TextureScalerCommon::ScaleHybrid(int factor, u32* source, u32* dest, int wi
 	bufTmp1.resize(width*height);
 	bufTmp2.resize(width*height*factor*factor);
 	bufTmp3.resize(width*height*factor*factor);
-	GlobalThreadPool::Loop(std::bind(&generateDistanceMask, source, bufTmp1.data(), width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
-	GlobalThreadPool::Loop(std::bind(&convolve3x3, bufTmp1.data(), bufTmp2.data(), KERNEL_SPLAT, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&generateDistanceMask, source, bufTmp1.data(), width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&convolve3x3, bufTmp1.data(), bufTmp2.data(), KERNEL_SPLAT, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 	ScaleBilinear(factor, bufTmp2.data(), bufTmp3.data(), width, height);
 	// mask C is now in bufTmp3
 
@@ -652,13 +968,227 @@ void TextureScalerCommon::ScaleHybrid(int factor, u32* source, u32* dest, int wi
 
 	// Now we can mix it all together
 	// The factor 8192 was found through practical testing on a variety of textures
-	GlobalThreadPool::Loop(std::bind(&mix, dest, bufTmp2.data(), bufTmp3.data(), 8192, width*factor, std::placeholders::_1, std::placeholders::_2), 0, height*factor);
+	ParallelLoop(std::bind(&mix, dest, bufTmp2.data(), bufTmp3.data(), 8192, width*factor, std::placeholders::_1, std::placeholders::_2), 0, height*factor);
 }
 
 void TextureScalerCommon::DePosterize(u32* source, u32* dest, int width, int height) {
 	bufTmp3.resize(width*height);
-	GlobalThreadPool::Loop(std::bind(&deposterizeH, source, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height);
-	GlobalThreadPool::Loop(std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
-	GlobalThreadPool::Loop(std::bind(&deposterizeH, dest, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height);
-	GlobalThreadPool::Loop(std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&deposterizeH, source, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&deposterizeH, dest, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height);
+	ParallelLoop(std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+}
+
+/////////////////////////////////////// Async Texture Scaler
+
+// How many PollFinished() calls (frames) a finished result is kept around for if not taken.
+#define ASYNC_SCALER_MAX_POLLS_UNTAKEN 120
+
+AsyncTextureScaler::AsyncTextureScaler(TextureScalerCommon *scaler, size_t budget)
+	: scaler_(scaler), budget_(budget) {
+	// A separate pool, so parallel loops on the GPU thread don't wait behind a big scale.
+	pool_.reset(new ThreadPool(g_Config.iNumWorkerThreads));
+	scaler_->SetThreadPool(pool_.get());
+	thread_ = std::thread(std::bind(&AsyncTextureScaler::WorkFunc, this));
+}
+
+AsyncTextureScaler::~AsyncTextureScaler() {
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		exiting_ = true;
+		cond_.notify_one();
+	}
+	thread_.join();
+
+	for (auto it : jobs_) {
+		delete it.second;
+	}
+	jobs_.clear();
+	queue_.clear();
+}
+
+void AsyncTextureScaler::WorkFunc() {
+	setCurrentThreadName("TextureScaler");
+
+	std::unique_lock<std::mutex> guard(mutex_);
+	while (true) {
+		while (queue_.empty() && !exiting_) {
+			cond_.wait(guard);
+		}
+		if (exiting_) {
+			break;
+		}
+
+		Job *job = queue_.front();
+		queue_.pop_front();
+		job->running = true;
+		guard.unlock();
+
+		// Nothing else touches src/dst while running, so no need to hold the lock.
+		u32 fmt = job->fmt;
+		int w = job->w;
+		int h = job->h;
+		scaler_->ScaleAlways(job->dst.data(), job->src.data(), fmt, w, h, job->factor);
+
+		guard.lock();
+		job->running = false;
+		job->fmt = fmt;
+		job->src.clear();
+		if (job->cancelled) {
+			// Already removed from jobs_.
+			FreeJob(job);
+		} else {
+			job->done = true;
+		}
+	}
+}
+
+void AsyncTextureScaler::FreeJob(Job *job) {
+	used_ -= job->bytes;
+	delete job;
+}
+
+// Call with the lock held, after removing the job from jobs_.
+void AsyncTextureScaler::DropJob(Job *job) {
+	if (job->running) {
+		// The worker frees it once it's done.
+		job->cancelled = true;
+	} else {
+		queue_.erase(std::remove(queue_.begin(), queue_.end(), job), queue_.end());
+		FreeJob(job);
+	}
+}
+
+bool AsyncTextureScaler::Queue(u64 key, u32 hash, const u8 *src, int pitch, int bpp, u32 fmt, int w, int h, int factor) {
+	const size_t srcWords = (w * h * bpp + 3) / 4;
+	const size_t bytes = srcWords * sizeof(u32) + (size_t)(w * factor) * (h * factor) * sizeof(u32);
+
+	std::lock_guard<std::mutex> guard(mutex_);
+	auto it = jobs_.find(key);
+	if (it != jobs_.end()) {
+		if (it->second->hash == hash && it->second->factor == factor) {
+			// Already on it.
+			return true;
+		}
+	}
+	if (used_ + bytes > budget_) {
+		return false;
+	}
+
+	if (it != jobs_.end()) {
+		Job *old = it->second;
+		jobs_.erase(it);
+		DropJob(old);
+	}
+
+	Job *job = new Job();
+	job->key = key;
+	job->hash = hash;
+	job->fmt = fmt;
+	job->w = w;
+	job->h = h;
+	job->factor = factor;
+	job->src.resize(srcWords);
+	job->dst.resize((w * factor) * (h * factor));
+	job->bytes = bytes;
+	job->running = false;
+	job->done = false;
+	job->cancelled = false;
+	job->reported = false;
+	job->pollsSinceDone = 0;
+
+	// The scaler wants a packed image.
+	u8 *dst = (u8 *)job->src.data();
+	for (int y = 0; y < h; ++y) {
+		memcpy(dst + w * bpp * y, src + pitch * y, w * bpp);
+	}
+
+	used_ += bytes;
+	jobs_[key] = job;
+	queue_.push_back(job);
+	cond_.notify_one();
+	return true;
+}
+
+AsyncTextureScaler::State AsyncTextureScaler::GetState(u64 key, u32 hash) {
+	std::lock_guard<std::mutex> guard(mutex_);
+	auto it = jobs_.find(key);
+	if (it == jobs_.end()) {
+		return State::NONE;
+	}
+
+	Job *job = it->second;
+	if (job->hash != hash) {
+		jobs_.erase(it);
+		DropJob(job);
+		return State::NONE;
+	}
+	return job->done ? State::READY : State::PENDING;
+}
+
+bool AsyncTextureScaler::Take(u64 key, u32 hash, u32 *out, u32 &dstFmt, int &w, int &h, int factor) {
+	std::lock_guard<std::mutex> guard(mutex_);
+	auto it = jobs_.find(key);
+	if (it == jobs_.end()) {
+		return false;
+	}
+
+	Job *job = it->second;
+	if (!job->done || job->hash != hash || job->w != w || job->h != h || job->factor != factor) {
+		return false;
+	}
+
+	memcpy(out, job->dst.data(), job->dst.size() * sizeof(u32));
+	dstFmt = job->fmt;
+	w *= factor;
+	h *= factor;
+
+	jobs_.erase(it);
+	FreeJob(job);
+	return true;
+}
+
+void AsyncTextureScaler::Cancel(u64 key) {
+	std::lock_guard<std::mutex> guard(mutex_);
+	auto it = jobs_.find(key);
+	if (it == jobs_.end()) {
+		return;
+	}
+
+	Job *job = it->second;
+	jobs_.erase(it);
+	DropJob(job);
+}
+
+void AsyncTextureScaler::CancelAll() {
+	std::lock_guard<std::mutex> guard(mutex_);
+	for (auto it : jobs_) {
+		Job *job = it.second;
+		if (job->running) {
+			job->cancelled = true;
+		} else {
+			FreeJob(job);
+		}
+	}
+	jobs_.clear();
+	queue_.clear();
+}
+
+void AsyncTextureScaler::PollFinished(std::vector<u64> &finished) {
+	std::lock_guard<std::mutex> guard(mutex_);
+	for (auto it = jobs_.begin(); it != jobs_.end(); ) {
+		Job *job = it->second;
+		if (!job->done) {
+			++it;
+		} else if (!job->reported) {
+			job->reported = true;
+			finished.push_back(it->first);
+			++it;
+		} else if (++job->pollsSinceDone > ASYNC_SCALER_MAX_POLLS_UNTAKEN) {
+			FreeJob(job);
+			it = jobs_.erase(it);
+		} else {
+			++it;
+		}
+	}
 }
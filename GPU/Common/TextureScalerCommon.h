@@ -20,12 +20,21 @@
 #include "Common/CommonTypes.h"
 #include "Common/MemoryUtil.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+class ThreadPool;
+
 class TextureScalerCommon {
 public:
 	TextureScalerCommon();
-	~TextureScalerCommon();
+	virtual ~TextureScalerCommon();
 
 	void ScaleAlways(u32 *out, u32 *src, u32 &dstFmt, int &width, int &height, int factor);
 	bool Scale(u32 *&data, u32 &dstfmt, int &width, int &height, int factor);
@@ -33,7 +42,12 @@ class TextureScalerCommon {
 
 	enum { XBRZ = 0, HYBRID = 1, BICUBIC = 2, HYBRID_BICUBIC = 3 };
 
+	// Run the parallel parts of scaling on this pool instead of the global one.
+	void SetThreadPool(ThreadPool *pool) { pool_ = pool; }
+
 protected:
+	void ParallelLoop(const std::function<void(int, int)> &loop, int lower, int upper);
+
 	virtual void ConvertTo8888(u32 format, u32 *source, u32 *&dest, int width, int height) = 0;
 	virtual int BytesPerPixel(u32 format) = 0;
 	virtual u32 Get8888Format() = 0;
@@ -52,4 +66,68 @@ class TextureScalerCommon {
 	// maximum is (100 MB total for a 512 by 512 texture with scaling factor 5 and hybrid scaling)
 	// of course, scaling factor 5 is totally silly anyway
 	SimpleBuf<u32> bufInput, bufDeposter, bufOutput, bufTmp1, bufTmp2, bufTmp3;
+
+	ThreadPool *pool_ = nullptr;
+};
+
+// Scales textures on a background thread, so the texture cache can keep using the
+// unscaled texture and swap in the scaled one once it's done.
+// Jobs are identified by texture cache key, and the hash of the contents they were queued with.
+class AsyncTextureScaler {
+public:
+	// Takes ownership of scaler.  budget is the max bytes of queued source and result data.
+	AsyncTextureScaler(TextureScalerCommon *scaler, size_t budget);
+	~AsyncTextureScaler();
+
+	enum class State {
+		NONE,
+		PENDING,
+		READY,
+	};
+
+	// Copies the source pixels (which are in dstFmt, as decoded), returns false if over budget.
+	bool Queue(u64 key, u32 hash, const u8 *src, int pitch, int bpp, u32 fmt, int w, int h, int factor);
+	// If the job has a different hash, it's stale and gets cancelled.
+	State GetState(u64 key, u32 hash);
+	// Copies a finished result into out (packed, w * factor by h * factor) and frees the job.
+	bool Take(u64 key, u32 hash, u32 *out, u32 &dstFmt, int &w, int &h, int factor);
+	void Cancel(u64 key);
+	void CancelAll();
+
+	// Call once per frame.  Adds the keys of newly finished jobs to finished.
+	// Results nobody takes are dropped after a while.
+	void PollFinished(std::vector<u64> &finished);
+
+private:
+	struct Job {
+		u64 key;
+		u32 hash;
+		u32 fmt;
+		int w;
+		int h;
+		int factor;
+		std::vector<u32> src;
+		std::vector<u32> dst;
+		size_t bytes;
+		bool running;
+		bool done;
+		bool cancelled;
+		bool reported;
+		int pollsSinceDone;
+	};
+
+	void WorkFunc();
+	void FreeJob(Job *job);
+	void DropJob(Job *job);
+
+	std::unique_ptr<TextureScalerCommon> scaler_;
+	std::unique_ptr<ThreadPool> pool_;
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::map<u64, Job *> jobs_;
+	std::deque<Job *> queue_;
+	size_t budget_;
+	size_t used_ = 0;
+	bool exiting_ = false;
 };
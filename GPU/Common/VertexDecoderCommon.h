@@ -619,6 +619,11 @@ class VertexDecoderJitCache : public FakeGen::FakeXCodeBlock {
 	JittedVertexDecoder Compile(const VertexDecoder &dec, int32_t *jittedSize);
 	void Clear();
 
+	// Allows decoding several vertices per loop iteration with wider SIMD, where the CPU supports it.
+	void SetBatchDecoding(bool enable) {
+		batchDecoding_ = enable;
+	}
+
 	void Jit_WeightsU8();
 	void Jit_WeightsU16();
 	void Jit_WeightsU8ToFloat();
@@ -699,7 +704,15 @@ class VertexDecoderJitCache : public FakeGen::FakeXCodeBlock {
 	void Jit_AnyS16Morph(int srcoff, int dstoff);
 	void Jit_AnyFloatMorph(int srcoff, int dstoff);
 
+	bool IsBatchStep(const VertexDecoder &dec, int step) const;
+	bool CanCompileBatch(const VertexDecoder &dec) const;
+	void CompileBatchStep(const VertexDecoder &dec, int step);
+	void Jit_BatchTcLoad(int bits);
+	void Jit_BatchTcStore();
+	void Jit_BatchColor8888();
+
 	const VertexDecoder *dec_;
+	bool batchDecoding_ = true;
 #if PPSSPP_ARCH(ARM64)
 	Arm64Gen::ARM64FloatEmitter fp;
 #endif
@@ -53,6 +53,15 @@ alignas(16) static const float by16384[4] = {
 	1.0f / 16384.0f, 1.0f / 16384.0f, 1.0f / 16384.0f, 1.0f / 16384.0f,
 };
 
+alignas(32) static const float by128_8[8] = {
+	1.0f / 128.0f, 1.0f / 128.0f, 1.0f / 128.0f, 1.0f / 128.0f,
+	1.0f / 128.0f, 1.0f / 128.0f, 1.0f / 128.0f, 1.0f / 128.0f,
+};
+alignas(32) static const float by32768_8[8] = {
+	1.0f / 32768.0f, 1.0f / 32768.0f, 1.0f / 32768.0f, 1.0f / 32768.0f,
+	1.0f / 32768.0f, 1.0f / 32768.0f, 1.0f / 32768.0f, 1.0f / 32768.0f,
+};
+
 #ifdef _M_X64
 #ifdef _WIN32
 static const X64Reg tempReg1 = RAX;
@@ -90,6 +99,25 @@ static const X64Reg fpScratchReg4 = XMM4;
 // We're gonna keep the current skinning matrix in 4 XMM regs. Fortunately we easily
 // have space for that now.
 
+// The batch loop decodes this many vertices per iteration (x64 with AVX2 only.)
+// Texcoords are converted for all of them at once in YMM regs, everything else is unrolled.
+static const int BATCH_SIZE = 4;
+// Running min/max of through mode texcoords, reduced and stored after the loop.
+static const X64Reg boundsMinReg = XMM10;
+static const X64Reg boundsMaxReg = XMM11;
+// AND of all 8888 colors, to check alpha once after the loop.
+static const X64Reg alphaAndReg = R11;
+
+// Stack layout: saved XMM4-XMM7, then for the batch loop XMM10-XMM11 and the texcoord scale/offset
+// repeated for 4 vertices.
+enum {
+	STACK_SIZE = 64,
+	BATCH_STACK_SAVE_XMM10 = 64,
+	BATCH_STACK_UV_SCALE = 96,
+	BATCH_STACK_UV_OFFSET = 128,
+	BATCH_STACK_SIZE = 160,
+};
+
 // To debug, just comment them out one at a time until it works. We fall back
 // on the interpreter if the compiler fails.
 
@@ -181,14 +209,21 @@ JittedVertexDecoder VertexDecoderJitCache::Compile(const VertexDecoder &dec, int
 	MOV(32, R(counterReg), MDisp(ESP, 16 + offset + 8));
 #endif
 
+	const bool batch = CanCompileBatch(dec);
+	const int stackSize = batch ? BATCH_STACK_SIZE : STACK_SIZE;
+
 	// Save XMM4/XMM5 which apparently can be problematic?
 	// Actually, if they are, it must be a compiler bug because they SHOULD be ok.
 	// So I won't bother.
-	SUB(PTRBITS, R(ESP), Imm8(64));
+	SUB(PTRBITS, R(ESP), Imm32(stackSize));
 	MOVUPS(MDisp(ESP, 0), XMM4);
 	MOVUPS(MDisp(ESP, 16), XMM5);
 	MOVUPS(MDisp(ESP, 32), XMM6);
 	MOVUPS(MDisp(ESP, 48), XMM7);
+	if (batch) {
+		MOVUPS(MDisp(ESP, BATCH_STACK_SAVE_XMM10), XMM10);
+		MOVUPS(MDisp(ESP, BATCH_STACK_SAVE_XMM10 + 16), XMM11);
+	}
 
 	bool prescaleStep = false;
 	// Look for prescaled texcoord steps
@@ -245,6 +280,71 @@ JittedVertexDecoder VertexDecoderJitCache::Compile(const VertexDecoder &dec, int
 		}
 	}
 
+	bool boundsStep = false;
+	bool colorStep = false;
+	FixupBranch skipRemainder;
+	if (batch) {
+		for (int i = 0; i < dec.numSteps_; i++) {
+			if (dec.steps_[i] == &VertexDecoder::Step_TcU16ThroughToFloat)
+				boundsStep = true;
+			if (dec.steps_[i] == &VertexDecoder::Step_Color8888)
+				colorStep = true;
+		}
+
+		if (prescaleStep) {
+			// Repeat the scale and offset for each vertex in a YMM, as they're interleaved.
+			MOVAPS(fpScratchReg, R(fpScaleOffsetReg));
+			SHUFPS(fpScratchReg, R(fpScratchReg), _MM_SHUFFLE(1, 0, 1, 0));
+			MOVUPS(MDisp(ESP, BATCH_STACK_UV_SCALE), fpScratchReg);
+			MOVUPS(MDisp(ESP, BATCH_STACK_UV_SCALE + 16), fpScratchReg);
+			MOVAPS(fpScratchReg, R(fpScaleOffsetReg));
+			SHUFPS(fpScratchReg, R(fpScratchReg), _MM_SHUFFLE(3, 2, 3, 2));
+			MOVUPS(MDisp(ESP, BATCH_STACK_UV_OFFSET), fpScratchReg);
+			MOVUPS(MDisp(ESP, BATCH_STACK_UV_OFFSET + 16), fpScratchReg);
+		}
+		if (boundsStep) {
+			// 0x7FFF and 0x8000 in each lane, so they never win.
+			PCMPEQW(boundsMinReg, R(boundsMinReg));
+			PSRLW(boundsMinReg, 1);
+			PCMPEQW(boundsMaxReg, R(boundsMaxReg));
+			PSLLW(boundsMaxReg, 15);
+		}
+		if (colorStep) {
+			MOV(32, R(alphaAndReg), Imm32(0xFFFFFFFF));
+		}
+
+		CMP(32, R(counterReg), Imm8(BATCH_SIZE));
+		FixupBranch skipBatch = J_CC(CC_B, true);
+
+		JumpTarget batchStart = GetCodePtr();
+		for (int v = 0; v < BATCH_SIZE; v++) {
+			for (int i = 0; i < dec.numSteps_; i++) {
+				if (!IsBatchStep(dec, i) && !CompileStep(dec, i)) {
+					EndWrite();
+					SetCodePtr(const_cast<u8 *>(start));
+					return 0;
+				}
+			}
+			ADD(PTRBITS, R(srcReg), Imm32(dec.VertexSize()));
+			ADD(PTRBITS, R(dstReg), Imm32(dec.decFmt.stride));
+		}
+		// Some steps store past their output into the next vertex, so the batched ones go last.
+		// The pointers are now past the batch, so these use negative offsets.
+		for (int i = 0; i < dec.numSteps_; i++) {
+			if (IsBatchStep(dec, i))
+				CompileBatchStep(dec, i);
+		}
+		// The rest of the steps use SSE, avoid the transition penalty.
+		VZEROUPPER();
+		SUB(32, R(counterReg), Imm8(BATCH_SIZE));
+		CMP(32, R(counterReg), Imm8(BATCH_SIZE));
+		J_CC(CC_AE, batchStart, true);
+
+		SetJumpTarget(skipBatch);
+		TEST(32, R(counterReg), R(counterReg));
+		skipRemainder = J_CC(CC_Z, true);
+	}
+
 	// Let's not bother with a proper stack frame. We just grab the arguments and go.
 	JumpTarget loopStart = GetCodePtr();
 	for (int i = 0; i < dec.numSteps_; i++) {
@@ -261,11 +361,60 @@ JittedVertexDecoder VertexDecoderJitCache::Compile(const VertexDecoder &dec, int
 	SUB(32, R(counterReg), Imm8(1));
 	J_CC(CC_NZ, loopStart, true);
 
+	if (batch) {
+		SetJumpTarget(skipRemainder);
+
+		if (boundsStep) {
+			// Reduce the four (u, v) pairs to one, then merge with the bounds so far.
+			PSHUFD(fpScratchReg, R(boundsMinReg), _MM_SHUFFLE(1, 0, 3, 2));
+			PMINSW(boundsMinReg, R(fpScratchReg));
+			PSHUFD(fpScratchReg, R(boundsMinReg), _MM_SHUFFLE(2, 3, 0, 1));
+			PMINSW(boundsMinReg, R(fpScratchReg));
+			PSHUFD(fpScratchReg, R(boundsMaxReg), _MM_SHUFFLE(1, 0, 3, 2));
+			PMAXSW(boundsMaxReg, R(fpScratchReg));
+			PSHUFD(fpScratchReg, R(boundsMaxReg), _MM_SHUFFLE(2, 3, 0, 1));
+			PMAXSW(boundsMaxReg, R(fpScratchReg));
+
+			MOV(PTRBITS, R(tempReg3), ImmPtr(&gstate_c.vertBounds));
+			auto updateSide = [&](X64Reg r, CCFlags skipCC, int offset) {
+				CMP(16, R(r), MDisp(tempReg3, offset));
+				FixupBranch skip = J_CC(skipCC);
+				MOV(16, MDisp(tempReg3, offset), R(r));
+				SetJumpTarget(skip);
+			};
+			MOVD_xmm(R(tempReg1), boundsMinReg);
+			MOV(32, R(tempReg2), R(tempReg1));
+			SHR(32, R(tempReg2), Imm8(16));
+			updateSide(tempReg1, CC_GE, offsetof(KnownVertexBounds, minU));
+			updateSide(tempReg2, CC_GE, offsetof(KnownVertexBounds, minV));
+			MOVD_xmm(R(tempReg1), boundsMaxReg);
+			MOV(32, R(tempReg2), R(tempReg1));
+			SHR(32, R(tempReg2), Imm8(16));
+			updateSide(tempReg1, CC_LE, offsetof(KnownVertexBounds, maxU));
+			updateSide(tempReg2, CC_LE, offsetof(KnownVertexBounds, maxV));
+		}
+
+		if (colorStep) {
+			CMP(32, R(alphaAndReg), Imm32(0xFF000000));
+			FixupBranch skip = J_CC(CC_AE, false);
+			if (RipAccessible(&gstate_c.vertexFullAlpha)) {
+				MOV(8, M(&gstate_c.vertexFullAlpha), Imm8(0));  // rip accessible
+			} else {
+				MOV(PTRBITS, R(tempReg1), ImmPtr(&gstate_c.vertexFullAlpha));
+				MOV(8, MatR(tempReg1), Imm8(0));
+			}
+			SetJumpTarget(skip);
+		}
+
+		MOVUPS(XMM10, MDisp(ESP, BATCH_STACK_SAVE_XMM10));
+		MOVUPS(XMM11, MDisp(ESP, BATCH_STACK_SAVE_XMM10 + 16));
+	}
+
 	MOVUPS(XMM4, MDisp(ESP, 0));
 	MOVUPS(XMM5, MDisp(ESP, 16));
 	MOVUPS(XMM6, MDisp(ESP, 32));
 	MOVUPS(XMM7, MDisp(ESP, 48));
-	ADD(PTRBITS, R(ESP), Imm8(64));
+	ADD(PTRBITS, R(ESP), Imm32(stackSize));
 
 #ifdef _M_IX86
 	// Restore register values
@@ -1647,6 +1796,111 @@ void VertexDecoderJitCache::Jit_NormalFloatMorph() {
 	Jit_AnyFloatMorph(dec_->nrmoff, dec_->decFmt.nrmoff);
 }
 
+bool VertexDecoderJitCache::IsBatchStep(const VertexDecoder &dec, int step) const {
+	const auto func = dec.steps_[step];
+	return func == &VertexDecoder::Step_TcU8ToFloat ||
+		func == &VertexDecoder::Step_TcU16ToFloat ||
+		func == &VertexDecoder::Step_TcU8Prescale ||
+		func == &VertexDecoder::Step_TcU16Prescale ||
+		func == &VertexDecoder::Step_TcFloatPrescale ||
+		func == &VertexDecoder::Step_TcU16ThroughToFloat ||
+		func == &VertexDecoder::Step_Color8888;
+}
+
+bool VertexDecoderJitCache::CanCompileBatch(const VertexDecoder &dec) const {
+#ifdef _M_X64
+	if (!batchDecoding_ || !cpu_info.bAVX2)
+		return false;
+	// Only worth it if something actually gets batched, the rest is just unrolled.
+	for (int i = 0; i < dec.numSteps_; i++) {
+		if (IsBatchStep(dec, i))
+			return true;
+	}
+#endif
+	return false;
+}
+
+void VertexDecoderJitCache::CompileBatchStep(const VertexDecoder &dec, int step) {
+	const auto func = dec.steps_[step];
+	if (func == &VertexDecoder::Step_Color8888) {
+		Jit_BatchColor8888();
+		return;
+	}
+
+	if (func == &VertexDecoder::Step_TcU8ToFloat || func == &VertexDecoder::Step_TcU8Prescale) {
+		Jit_BatchTcLoad(8);
+	} else if (func == &VertexDecoder::Step_TcFloatPrescale) {
+		Jit_BatchTcLoad(32);
+	} else {
+		Jit_BatchTcLoad(16);
+	}
+
+	if (func == &VertexDecoder::Step_TcU8ToFloat || func == &VertexDecoder::Step_TcU16ToFloat) {
+		const float *scale = func == &VertexDecoder::Step_TcU8ToFloat ? by128_8 : by32768_8;
+		if (RipAccessible(scale)) {
+			VMULPS(256, fpScratchReg, fpScratchReg, M(scale));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(tempReg1), ImmPtr(scale));
+			VMULPS(256, fpScratchReg, fpScratchReg, MatR(tempReg1));
+		}
+	} else if (func != &VertexDecoder::Step_TcU16ThroughToFloat) {
+		// The scale takes into account the u8/u16 normalization.
+		VMULPS(256, fpScratchReg, fpScratchReg, MDisp(ESP, BATCH_STACK_UV_SCALE));
+		VADDPS(256, fpScratchReg, fpScratchReg, MDisp(ESP, BATCH_STACK_UV_OFFSET));
+	}
+	Jit_BatchTcStore();
+}
+
+// Loads the texcoords of BATCH_SIZE vertices into fpScratchReg as 8 floats, u and v interleaved.
+// The batch steps run after srcReg/dstReg have been advanced past the batch.
+void VertexDecoderJitCache::Jit_BatchTcLoad(int bits) {
+	const int srcStride = dec_->VertexSize();
+	const int tcoff = dec_->tcoff - srcStride * BATCH_SIZE;
+	if (bits == 8) {
+		MOVZX(32, 16, tempReg1, MDisp(srcReg, tcoff));
+		VMOVD_xmm(fpScratchReg, R(tempReg1));
+		for (int v = 1; v < BATCH_SIZE; v++)
+			VPINSRW(fpScratchReg, fpScratchReg, MDisp(srcReg, srcStride * v + tcoff), v);
+		VPMOVZXBD(256, fpScratchReg, R(fpScratchReg));
+		VCVTDQ2PS(256, fpScratchReg, R(fpScratchReg));
+	} else if (bits == 16) {
+		VMOVD_xmm(fpScratchReg, MDisp(srcReg, tcoff));
+		for (int v = 1; v < BATCH_SIZE; v++)
+			VPINSRD(fpScratchReg, fpScratchReg, MDisp(srcReg, srcStride * v + tcoff), v);
+		if (dec_->throughmode) {
+			VPMINSW(boundsMinReg, boundsMinReg, R(fpScratchReg));
+			VPMAXSW(boundsMaxReg, boundsMaxReg, R(fpScratchReg));
+		}
+		VPMOVZXWD(256, fpScratchReg, R(fpScratchReg));
+		VCVTDQ2PS(256, fpScratchReg, R(fpScratchReg));
+	} else {
+		VMOVQ_xmm(fpScratchReg, MDisp(srcReg, tcoff));
+		VMOVHPS(fpScratchReg, fpScratchReg, MDisp(srcReg, srcStride + tcoff));
+		VMOVQ_xmm(fpScratchReg2, MDisp(srcReg, srcStride * 2 + tcoff));
+		VMOVHPS(fpScratchReg2, fpScratchReg2, MDisp(srcReg, srcStride * 3 + tcoff));
+		VINSERTF128(fpScratchReg, fpScratchReg, R(fpScratchReg2), 1);
+	}
+}
+
+void VertexDecoderJitCache::Jit_BatchTcStore() {
+	const int dstStride = dec_->decFmt.stride;
+	const int uvoff = dec_->decFmt.uvoff - dstStride * BATCH_SIZE;
+	VMOVQ_xmm(MDisp(dstReg, uvoff), fpScratchReg);
+	VMOVHPS(MDisp(dstReg, dstStride + uvoff), fpScratchReg);
+	VEXTRACTF128(R(fpScratchReg), fpScratchReg, 1);
+	VMOVQ_xmm(MDisp(dstReg, dstStride * 2 + uvoff), fpScratchReg);
+	VMOVHPS(MDisp(dstReg, dstStride * 3 + uvoff), fpScratchReg);
+}
+
+void VertexDecoderJitCache::Jit_BatchColor8888() {
+	// Just copies, but we only check the alpha once after the loop.
+	for (int v = -BATCH_SIZE; v < 0; v++) {
+		MOV(32, R(tempReg1), MDisp(srcReg, dec_->VertexSize() * v + dec_->coloff));
+		MOV(32, MDisp(dstReg, dec_->decFmt.stride * v + dec_->decFmt.c0off), R(tempReg1));
+		AND(32, R(alphaAndReg), R(tempReg1));
+	}
+}
+
 bool VertexDecoderJitCache::CompileStep(const VertexDecoder &dec, int step) {
 	// See if we find a matching JIT function
 	for (size_t i = 0; i < ARRAY_SIZE(jitLookup); i++) {
@@ -53,9 +53,6 @@ const D3D11_PRIMITIVE_TOPOLOGY d3d11prim[8] = {
 	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST,  // Need expansion - though we could do it with geom shaders in most cases
 };
 
-#define VERTEXCACHE_DECIMATION_INTERVAL 17
-
-enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
 enum {
 	VERTEX_PUSH_SIZE = 1024 * 1024 * 16,
 	INDEX_PUSH_SIZE = 1024 * 1024 * 4,
@@ -72,7 +69,6 @@ DrawEngineD3D11::DrawEngineD3D11(Draw::DrawContext *draw, ID3D11Device *device,
 	: draw_(draw),
 		device_(device),
 		context_(context),
-		vai_(256),
 		inputLayoutMap_(32),
 		blendCache_(32),
 		blendCache1_(32),
@@ -83,7 +79,6 @@ DrawEngineD3D11::DrawEngineD3D11(Draw::DrawContext *draw, ID3D11Device *device,
 	decOptions_.expandAllWeightsToFloat = true;
 	decOptions_.expand8BitNormalsToFloat = true;
 
-	decimationCounter_ = VERTEXCACHE_DECIMATION_INTERVAL;
 	// Allocate nicely aligned memory. Maybe graphics drivers will
 	// appreciate it.
 	// All this is a LOT of memory, need to see if we can cut down somehow.
@@ -114,13 +109,6 @@ void DrawEngineD3D11::InitDeviceObjects() {
 	tessDataTransfer = new TessellationDataTransferD3D11(context_, device_);
 }
 
-void DrawEngineD3D11::ClearTrackedVertexArrays() {
-	vai_.Iterate([&](uint32_t hash, VertexArrayInfoD3D11 *vai){
-		delete vai;
-	});
-	vai_.Clear();
-}
-
 void DrawEngineD3D11::ClearInputLayoutMap() {
 	inputLayoutMap_.Iterate([&](const InputLayoutKey &key, ID3D11InputLayout *il) {
 		if (il)
@@ -256,8 +244,8 @@ ID3D11InputLayout *DrawEngineD3D11::SetupDecFmtForDraw(D3D11VertexShader *vshade
 	}
 }
 
-void DrawEngineD3D11::MarkUnreliable(VertexArrayInfoD3D11 *vai) {
-	vai->status = VertexArrayInfoD3D11::VAI_UNRELIABLE;
+void DrawEngineD3D11::FreeVertexArray(VertexArrayInfo *info) {
+	VertexArrayInfoD3D11 *vai = static_cast<VertexArrayInfoD3D11 *>(info);
 	if (vai->vbo) {
 		vai->vbo->Release();
 		vai->vbo = nullptr;
@@ -272,29 +260,7 @@ void DrawEngineD3D11::BeginFrame() {
 	pushVerts_->Reset();
 	pushInds_->Reset();
 
-	if (--decimationCounter_ <= 0) {
-		decimationCounter_ = VERTEXCACHE_DECIMATION_INTERVAL;
-	} else {
-		return;
-	}
-
-	const int threshold = gpuStats.numFlips - VAI_KILL_AGE;
-	const int unreliableThreshold = gpuStats.numFlips - VAI_UNRELIABLE_KILL_AGE;
-	int unreliableLeft = VAI_UNRELIABLE_KILL_MAX;
-	vai_.Iterate([&](uint32_t hash, VertexArrayInfoD3D11 *vai){
-		bool kill;
-		if (vai->status == VertexArrayInfoD3D11::VAI_UNRELIABLE) {
-			// We limit killing unreliable so we don't rehash too often.
-			kill = vai->lastFrame < unreliableThreshold && --unreliableLeft >= 0;
-		} else {
-			kill = vai->lastFrame < threshold;
-		}
-		if (kill) {
-			delete vai;
-			vai_.Remove(hash);
-		}
-	});
-	vai_.Maintain();
+	DecimateTrackedVertexArrays();
 
 	// Enable if you want to see vertex decoders in the log output. Need a better way.
 #if 0
@@ -308,13 +274,6 @@ void DrawEngineD3D11::BeginFrame() {
 #endif
 }
 
-VertexArrayInfoD3D11::~VertexArrayInfoD3D11() {
-	if (vbo)
-		vbo->Release();
-	if (ebo)
-		ebo->Release();
-}
-
 static uint32_t SwapRB(uint32_t c) {
 	return (c & 0xFF00FF00) | ((c >> 16) & 0xFF) | ((c << 16) & 0xFF0000);
 }
@@ -349,145 +308,55 @@ void DrawEngineD3D11::DoFlush() {
 			useCache = false;
 
 		if (useCache) {
-			u32 id = dcid_ ^ gstate.getUVGenMode();  // This can have an effect on which UV decoder we need to use! And hence what the decoded data will look like. See #9263
-
-			VertexArrayInfoD3D11 *vai = vai_.Get(id);
-			if (!vai) {
-				vai = new VertexArrayInfoD3D11();
-				vai_.Insert(id, vai);
-			}
+			VertexArrayInfo *info;
+			VertexCacheAction action = LookupVertexCache(&info);
+			VertexArrayInfoD3D11 *vai = static_cast<VertexArrayInfoD3D11 *>(info);
 
-			switch (vai->status) {
-			case VertexArrayInfoD3D11::VAI_NEW:
-				{
-					// Haven't seen this one before.
-					ReliableHashType dataHash = ComputeHash();
-					vai->hash = dataHash;
-					vai->minihash = ComputeMiniHash();
-					vai->status = VertexArrayInfoD3D11::VAI_HASHING;
-					vai->drawsUntilNextFullHash = 0;
-					DecodeVerts(decoded); // writes to indexGen
-					vai->numVerts = indexGen.VertexCount();
-					vai->prim = indexGen.Prim();
-					vai->maxIndex = indexGen.MaxIndex();
-					vai->flags = gstate_c.vertexFullAlpha ? VAI11_FLAG_VERTEXFULLALPHA : 0;
-					goto rotateVBO;
-				}
+			switch (action) {
+			case VertexCacheAction::DECODE:
+				DecodeVerts(decoded); // writes to indexGen
+				goto rotateVBO;
 
-				// Hashing - still gaining confidence about the buffer.
-				// But if we get this far it's likely to be worth creating a vertex buffer.
-			case VertexArrayInfoD3D11::VAI_HASHING:
+			// If we get this far it's likely to be worth creating a vertex buffer.
+			case VertexCacheAction::UPLOAD:
 				{
-					vai->numDraws++;
-					if (vai->lastFrame != gpuStats.numFlips) {
-						vai->numFrames++;
-					}
-					if (vai->drawsUntilNextFullHash == 0) {
-						// Let's try to skip a full hash if mini would fail.
-						const u32 newMiniHash = ComputeMiniHash();
-						ReliableHashType newHash = vai->hash;
-						if (newMiniHash == vai->minihash) {
-							newHash = ComputeHash();
-						}
-						if (newMiniHash != vai->minihash || newHash != vai->hash) {
-							MarkUnreliable(vai);
-							DecodeVerts(decoded);
-							goto rotateVBO;
-						}
-						if (vai->numVerts > 64) {
-							// exponential backoff up to 16 draws, then every 24
-							vai->drawsUntilNextFullHash = std::min(24, vai->numFrames);
-						} else {
-							// Lower numbers seem much more likely to change.
-							vai->drawsUntilNextFullHash = 0;
-						}
-						// TODO: tweak
-						//if (vai->numFrames > 1000) {
-						//	vai->status = VertexArrayInfo::VAI_RELIABLE;
-						//}
-					} else {
-						vai->drawsUntilNextFullHash--;
-						u32 newMiniHash = ComputeMiniHash();
-						if (newMiniHash != vai->minihash) {
-							MarkUnreliable(vai);
-							DecodeVerts(decoded);
-							goto rotateVBO;
-						}
+					DecodeVerts(decoded);
+					StoreVertexArrayDrawInfo(vai);
+					useElements = !indexGen.SeenOnlyPurePrims() || prim == GE_PRIM_TRIANGLE_FAN;
+					if (!useElements && indexGen.PureCount()) {
+						vai->numVerts = indexGen.PureCount();
 					}
 
-					if (vai->vbo == 0) {
-						DecodeVerts(decoded);
-						vai->numVerts = indexGen.VertexCount();
-						vai->prim = indexGen.Prim();
-						vai->maxIndex = indexGen.MaxIndex();
-						vai->flags = gstate_c.vertexFullAlpha ? VAI11_FLAG_VERTEXFULLALPHA : 0;
-						useElements = !indexGen.SeenOnlyPurePrims() || prim == GE_PRIM_TRIANGLE_FAN;
-						if (!useElements && indexGen.PureCount()) {
-							vai->numVerts = indexGen.PureCount();
-						}
-
-						_dbg_assert_msg_(G3D, gstate_c.vertBounds.minV >= gstate_c.vertBounds.maxV, "Should not have checked UVs when caching.");
-
-						// TODO: Combine these two into one buffer?
-						u32 size = dec_->GetDecVtxFmt().stride * indexGen.MaxIndex();
-						D3D11_BUFFER_DESC desc{ size, D3D11_USAGE_IMMUTABLE, D3D11_BIND_VERTEX_BUFFER, 0 };
-						D3D11_SUBRESOURCE_DATA data{ decoded };
-						ASSERT_SUCCESS(device_->CreateBuffer(&desc, &data, &vai->vbo));
-						if (useElements) {
-							u32 size = sizeof(short) * indexGen.VertexCount();
-							D3D11_BUFFER_DESC desc{ size, D3D11_USAGE_IMMUTABLE, D3D11_BIND_INDEX_BUFFER, 0 };
-							D3D11_SUBRESOURCE_DATA data{ decIndex };
-							ASSERT_SUCCESS(device_->CreateBuffer(&desc, &data, &vai->ebo));
-						} else {
-							vai->ebo = 0;
-						}
+					_dbg_assert_msg_(G3D, gstate_c.vertBounds.minV >= gstate_c.vertBounds.maxV, "Should not have checked UVs when caching.");
+
+					// TODO: Combine these two into one buffer?
+					u32 vsize = dec_->GetDecVtxFmt().stride * (indexGen.MaxIndex() + 1);
+					u32 esize = 0;
+					D3D11_BUFFER_DESC desc{ vsize, D3D11_USAGE_IMMUTABLE, D3D11_BIND_VERTEX_BUFFER, 0 };
+					D3D11_SUBRESOURCE_DATA data{ decoded };
+					ASSERT_SUCCESS(device_->CreateBuffer(&desc, &data, &vai->vbo));
+					if (useElements) {
+						esize = sizeof(short) * indexGen.VertexCount();
+						D3D11_BUFFER_DESC desc{ esize, D3D11_USAGE_IMMUTABLE, D3D11_BIND_INDEX_BUFFER, 0 };
+						D3D11_SUBRESOURCE_DATA data{ decIndex };
+						ASSERT_SUCCESS(device_->CreateBuffer(&desc, &data, &vai->ebo));
 					} else {
-						gpuStats.numCachedDrawCalls++;
-						useElements = vai->ebo ? true : false;
-						gpuStats.numCachedVertsDrawn += vai->numVerts;
-						gstate_c.vertexFullAlpha = vai->flags & VAI11_FLAG_VERTEXFULLALPHA;
-					}
-					vb_ = vai->vbo;
-					ib_ = vai->ebo;
-					vertexCount = vai->numVerts;
-					maxIndex = vai->maxIndex;
-					prim = static_cast<GEPrimitiveType>(vai->prim);
-					break;
-				}
-
-				// Reliable - we don't even bother hashing anymore. Right now we don't go here until after a very long time.
-			case VertexArrayInfoD3D11::VAI_RELIABLE:
-				{
-					vai->numDraws++;
-					if (vai->lastFrame != gpuStats.numFlips) {
-						vai->numFrames++;
+						vai->ebo = 0;
 					}
-					gpuStats.numCachedDrawCalls++;
-					gpuStats.numCachedVertsDrawn += vai->numVerts;
-					vb_ = vai->vbo;
-					ib_ = vai->ebo;
-
-					vertexCount = vai->numVerts;
-
-					maxIndex = vai->maxIndex;
-					prim = static_cast<GEPrimitiveType>(vai->prim);
-
-					gstate_c.vertexFullAlpha = vai->flags & VAI11_FLAG_VERTEXFULLALPHA;
+					NotifyVertexArrayUploaded(vai, vsize + esize);
 					break;
 				}
 
-			case VertexArrayInfoD3D11::VAI_UNRELIABLE:
-				{
-					vai->numDraws++;
-					if (vai->lastFrame != gpuStats.numFlips) {
-						vai->numFrames++;
-					}
-					DecodeVerts(decoded);
-					goto rotateVBO;
-				}
+			case VertexCacheAction::DRAW_CACHED:
+				useElements = vai->ebo ? true : false;
+				break;
 			}
 
-			vai->lastFrame = gpuStats.numFlips;
+			vb_ = vai->vbo;
+			ib_ = vai->ebo;
+			vertexCount = vai->numVerts;
+			maxIndex = vai->maxIndex;
+			prim = static_cast<GEPrimitiveType>(vai->prim);
 		} else {
 			DecodeVerts(decoded);
 rotateVBO:
@@ -51,52 +51,10 @@ class FramebufferManagerD3D11;
 // DRAWN_ONCE -> death
 // DRAWN_RELIABLE -> death
 
-enum {
-	VAI11_FLAG_VERTEXFULLALPHA = 1,
-};
-
-// Try to keep this POD.
-class VertexArrayInfoD3D11 {
+class VertexArrayInfoD3D11 : public VertexArrayInfo {
 public:
-	VertexArrayInfoD3D11() {
-		status = VAI_NEW;
-		vbo = 0;
-		ebo = 0;
-		prim = GE_PRIM_INVALID;
-		numDraws = 0;
-		numFrames = 0;
-		lastFrame = gpuStats.numFlips;
-		numVerts = 0;
-		drawsUntilNextFullHash = 0;
-		flags = 0;
-	}
-	~VertexArrayInfoD3D11();
-
-	enum Status : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
-	ID3D11Buffer *vbo;
-	ID3D11Buffer *ebo;
-
-	// Precalculated parameter for drawRangeElements
-	u16 numVerts;
-	u16 maxIndex;
-	s8 prim;
-	Status status;
-
-	// ID information
-	int numDraws;
-	int numFrames;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash;
-	u8 flags;
+	ID3D11Buffer *vbo = nullptr;
+	ID3D11Buffer *ebo = nullptr;
 };
 
 // Handles transform, lighting and drawing.
@@ -134,8 +92,6 @@ class DrawEngineD3D11 : public DrawEngineCommon {
 
 	void DispatchFlush() override { Flush(); }
 
-	void ClearTrackedVertexArrays() override;
-
 	void Resized() override;
 
 	void ClearInputLayoutMap();
@@ -149,7 +105,10 @@ class DrawEngineD3D11 : public DrawEngineCommon {
 
 	ID3D11InputLayout *SetupDecFmtForDraw(D3D11VertexShader *vshader, const DecVtxFormat &decFmt, u32 pspFmt);
 
-	void MarkUnreliable(VertexArrayInfoD3D11 *vai);
+	VertexArrayInfo *CreateVertexArray() override {
+		return new VertexArrayInfoD3D11();
+	}
+	void FreeVertexArray(VertexArrayInfo *vai) override;
 
 	Draw::DrawContext *draw_;  // Used for framebuffer related things exclusively.
 	ID3D11Device *device_;
@@ -157,8 +116,6 @@ class DrawEngineD3D11 : public DrawEngineCommon {
 	ID3D11DeviceContext *context_;
 	ID3D11DeviceContext1 *context1_;
 
-	PrehashMap<VertexArrayInfoD3D11 *, nullptr> vai_;
-
 	struct InputLayoutKey {
 		D3D11VertexShader *vshader;
 		u32 decFmtId;
@@ -49,52 +49,10 @@ class FramebufferManagerDX9;
 // DRAWN_ONCE -> death
 // DRAWN_RELIABLE -> death
 
-enum {
-	VAI_FLAG_VERTEXFULLALPHA = 1,
-};
-
-// Try to keep this POD.
-class VertexArrayInfoDX9 {
+class VertexArrayInfoDX9 : public VertexArrayInfo {
 public:
-	VertexArrayInfoDX9() {
-		status = VAI_NEW;
-		vbo = 0;
-		ebo = 0;
-		prim = GE_PRIM_INVALID;
-		numDraws = 0;
-		numFrames = 0;
-		lastFrame = gpuStats.numFlips;
-		numVerts = 0;
-		drawsUntilNextFullHash = 0;
-		flags = 0;
-	}
-	~VertexArrayInfoDX9();
-
-	enum Status : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
-	LPDIRECT3DVERTEXBUFFER9 vbo;
-	LPDIRECT3DINDEXBUFFER9 ebo;
-
-	// Precalculated parameter for drawRangeElements
-	u16 numVerts;
-	u16 maxIndex;
-	s8 prim;
-	Status status;
-
-	// ID information
-	int numDraws;
-	int numFrames;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash;
-	u8 flags;
+	LPDIRECT3DVERTEXBUFFER9 vbo = nullptr;
+	LPDIRECT3DINDEXBUFFER9 ebo = nullptr;
 };
 
 // Handles transform, lighting and drawing.
@@ -115,9 +73,6 @@ class DrawEngineDX9 : public DrawEngineCommon {
 	void InitDeviceObjects();
 	void DestroyDeviceObjects();
 
-	void ClearTrackedVertexArrays() override;
-	void DecimateTrackedVertexArrays();
-
 	// So that this can be inlined
 	void Flush() {
 		if (!numDrawCalls)
@@ -142,11 +97,13 @@ class DrawEngineDX9 : public DrawEngineCommon {
 
 	IDirect3DVertexDeclaration9 *SetupDecFmtForDraw(VSShader *vshader, const DecVtxFormat &decFmt, u32 pspFmt);
 
-	void MarkUnreliable(VertexArrayInfoDX9 *vai);
+	VertexArrayInfo *CreateVertexArray() override {
+		return new VertexArrayInfoDX9();
+	}
+	void FreeVertexArray(VertexArrayInfo *vai) override;
 
 	LPDIRECT3DDEVICE9 device_ = nullptr;
 
-	PrehashMap<VertexArrayInfoDX9 *, nullptr> vai_;
 	DenseHashMap<u32, IDirect3DVertexDeclaration9 *, nullptr> vertexDeclMap_;
 
 	// SimpleVertex
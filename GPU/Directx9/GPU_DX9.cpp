@@ -291,7 +291,7 @@ void GPU_DX9::GetStats(char *buffer, size_t bufsize) {
 	snprintf(buffer, bufsize - 1,
 		"DL processing time: %0.2f ms\n"
 		"Draw calls: %i, flushes %i, clears %i\n"
-		"Cached Draw calls: %i\n"
+		"Cached Draw calls: %i (%0.1f%% hit), misses: %i, uploads: %i, evictions: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
 		"GPU cycles executed: %d (%f per vertex)\n"
 		"Commands per call level: %i %i %i %i\n"
@@ -306,6 +306,10 @@ void GPU_DX9::GetStats(char *buffer, size_t bufsize) {
 		gpuStats.numFlushes,
 		gpuStats.numClears,
 		gpuStats.numCachedDrawCalls,
+		gpuStats.VertexCacheHitRate(),
+		gpuStats.numVertexCacheMisses,
+		gpuStats.numVertexCacheUploads,
+		gpuStats.numVertexCacheEvictions,
 		gpuStats.numTrackedVertexArrays,
 		gpuStats.vertexGPUCycles + gpuStats.otherGPUCycles,
 		vertexAverageCycles,
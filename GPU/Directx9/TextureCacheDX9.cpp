@@ -231,6 +231,7 @@ void TextureCacheDX9::StartFrame() {
 		clearCacheNextFrame_ = false;
 	} else {
 		Decimate();
+		ProcessScaledTextures();
 	}
 
 	if (gstate_c.Supports(GPU_SUPPORTS_ANISOTROPY)) {
@@ -241,6 +242,10 @@ void TextureCacheDX9::StartFrame() {
 
 }
 
+TextureScalerCommon *TextureCacheDX9::CreateScaler() {
+	return new TextureScalerDX9();
+}
+
 void TextureCacheDX9::UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBase, bool clutIndexIsSimple) {
 	const u32 clutBaseBytes = clutBase * (clutFormat == GE_CMODE_32BIT_ABGR8888 ? sizeof(u32) : sizeof(u16));
 	// Technically, these extra bytes weren't loaded, but hopefully it was loaded earlier.
@@ -530,10 +535,9 @@ void TextureCacheDX9::BuildTexture(TexCacheEntry *const entry) {
 		scaleFactor = scaleFactor > 4 ? 4 : (scaleFactor > 2 ? 2 : 1);
 	}
 
-	u64 cachekey = replacer_.Enabled() ? entry->CacheKey() : 0;
 	int w = gstate.getTextureWidth(0);
 	int h = gstate.getTextureHeight(0);
-	ReplacedTexture &replaced = replacer_.FindReplacement(cachekey, entry->fullhash, w, h);
+	ReplacedTexture &replaced = FindReplacement(entry, w, h);
 	if (replaced.GetSize(0, w, h)) {
 		// We're replacing, so we won't scale.
 		scaleFactor = 1;
@@ -551,16 +555,7 @@ void TextureCacheDX9::BuildTexture(TexCacheEntry *const entry) {
 		scaleFactor = 1;
 	}
 
-	if (scaleFactor != 1) {
-		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED) {
-			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
-			scaleFactor = 1;
-		} else {
-			entry->status &= ~TexCacheEntry::STATUS_TO_SCALE;
-			entry->status |= TexCacheEntry::STATUS_IS_SCALED;
-			texelsScaledThisFrame_ += w * h;
-		}
-	}
+	scaleFactor = ThrottleScaleFactor(entry, scaleFactor, w, h);
 
 	// Seems to cause problems in Tactics Ogre.
 	if (badMipSizes) {
@@ -735,8 +730,10 @@ void TextureCacheDX9::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &re
 			entry.SetAlphaStatus(TexCacheEntry::STATUS_ALPHA_UNKNOWN);
 		}
 
+		QueueAsyncScale(&entry, level, pixelData, decPitch, bpp, dstFmt, w, h);
+
 		if (scaleFactor > 1) {
-			scaler.ScaleAlways((u32 *)rect.pBits, pixelData, dstFmt, w, h, scaleFactor);
+			ScaleLevel(scaler, &entry, (u32 *)rect.pBits, pixelData, dstFmt, w, h, scaleFactor);
 			pixelData = (u32 *)rect.pBits;
 
 			// We always end up at 8888.  Other parts assume this.
@@ -754,13 +751,14 @@ void TextureCacheDX9::LoadTextureLevel(TexCacheEntry &entry, ReplacedTexture &re
 			}
 		}
 
-		if (replacer_.Enabled()) {
+		// While the replacement is still loading, there is one, so don't save this.
+		if (replacer_.Enabled() && !(entry.status & TexCacheEntry::STATUS_TO_REPLACE)) {
 			ReplacedTextureDecodeInfo replacedInfo;
 			replacedInfo.cachekey = entry.CacheKey();
 			replacedInfo.hash = entry.fullhash;
 			replacedInfo.addr = entry.addr;
 			replacedInfo.isVideo = videos_.find(entry.addr & 0x3FFFFFFF) != videos_.end();
-			replacedInfo.isFinal = (entry.status & TexCacheEntry::STATUS_TO_SCALE) == 0;
+			replacedInfo.isFinal = (entry.status & (TexCacheEntry::STATUS_TO_SCALE | TexCacheEntry::STATUS_SCALING_ASYNC)) == 0;
 			replacedInfo.scaleFactor = scaleFactor;
 			replacedInfo.fmt = FromD3D9Format(dstFmt);
 
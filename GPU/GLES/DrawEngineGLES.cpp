@@ -59,22 +59,18 @@ enum {
 	TRANSFORMED_VERTEX_BUFFER_SIZE = VERTEX_BUFFER_MAX * sizeof(TransformedVertex)
 };
 
-#define VERTEXCACHE_DECIMATION_INTERVAL 17
 #define VERTEXCACHE_NAME_DECIMATION_INTERVAL 41
 #define VERTEXCACHE_NAME_DECIMATION_MAX 100
 #define VERTEXCACHE_NAME_CACHE_SIZE 64
 #define VERTEXCACHE_NAME_CACHE_FULL_BYTES (1024 * 1024)
 #define VERTEXCACHE_NAME_CACHE_MAX_AGE 120
 
-enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
-
-DrawEngineGLES::DrawEngineGLES(Draw::DrawContext *draw) : vai_(256), draw_(draw), inputLayoutMap_(16) {
+DrawEngineGLES::DrawEngineGLES(Draw::DrawContext *draw) : draw_(draw), inputLayoutMap_(16) {
 	render_ = (GLRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
 
 	decOptions_.expandAllWeightsToFloat = false;
 	decOptions_.expand8BitNormalsToFloat = false;
 
-	decimationCounter_ = VERTEXCACHE_DECIMATION_INTERVAL;
 	bufferDecimationCounter_ = VERTEXCACHE_NAME_DECIMATION_INTERVAL;
 	// Allocate nicely aligned memory. Maybe graphics drivers will
 	// appreciate it.
@@ -240,54 +236,8 @@ void DrawEngineGLES::DecodeVertsToPushBuffer(GLPushBuffer *push, uint32_t *bindO
 	DecodeVerts(dest);
 }
 
-void DrawEngineGLES::MarkUnreliable(VertexArrayInfo *vai) {
-	vai->status = VertexArrayInfo::VAI_UNRELIABLE;
-	if (vai->vbo) {
-		render_->DeleteBuffer(vai->vbo);
-		vai->vbo = 0;
-	}
-	if (vai->ebo) {
-		render_->DeleteBuffer(vai->ebo);
-		vai->ebo = 0;
-	}
-}
-
-void DrawEngineGLES::ClearTrackedVertexArrays() {
-	vai_.Iterate([&](uint32_t hash, VertexArrayInfo *vai){
-		FreeVertexArray(vai);
-		delete vai;
-	});
-	vai_.Clear();
-}
-
-void DrawEngineGLES::DecimateTrackedVertexArrays() {
-	if (--decimationCounter_ <= 0) {
-		decimationCounter_ = VERTEXCACHE_DECIMATION_INTERVAL;
-	} else {
-		return;
-	}
-
-	const int threshold = gpuStats.numFlips - VAI_KILL_AGE;
-	const int unreliableThreshold = gpuStats.numFlips - VAI_UNRELIABLE_KILL_AGE;
-	int unreliableLeft = VAI_UNRELIABLE_KILL_MAX;
-	vai_.Iterate([&](uint32_t hash, VertexArrayInfo *vai) {
-		bool kill;
-		if (vai->status == VertexArrayInfo::VAI_UNRELIABLE) {
-			// We limit killing unreliable so we don't rehash too often.
-			kill = vai->lastFrame < unreliableThreshold && --unreliableLeft >= 0;
-		} else {
-			kill = vai->lastFrame < threshold;
-		}
-		if (kill) {
-			FreeVertexArray(vai);
-			delete vai;
-			vai_.Remove(hash);
-		}
-	});
-	vai_.Maintain();
-}
-
-void DrawEngineGLES::FreeVertexArray(VertexArrayInfo *vai) {
+void DrawEngineGLES::FreeVertexArray(VertexArrayInfo *info) {
+	VertexArrayInfoGLES *vai = static_cast<VertexArrayInfoGLES *>(info);
 	if (vai->vbo) {
 		render_->DeleteBuffer(vai->vbo);
 		vai->vbo = nullptr;
@@ -340,142 +290,55 @@ void DrawEngineGLES::DoFlush() {
 		useCache = false;
 
 		if (useCache) {
-			u32 id = dcid_ ^ gstate.getUVGenMode();  // This can have an effect on which UV decoder we need to use! And hence what the decoded data will look like. See #9263
-			VertexArrayInfo *vai = vai_.Get(id);
-			if (!vai) {
-				vai = new VertexArrayInfo();
-				vai_.Insert(id, vai);
-			}
+			VertexArrayInfo *info;
+			VertexCacheAction action = LookupVertexCache(&info);
+			VertexArrayInfoGLES *vai = static_cast<VertexArrayInfoGLES *>(info);
 
-			switch (vai->status) {
-			case VertexArrayInfo::VAI_NEW:
-				{
-					// Haven't seen this one before.
-					ReliableHashType dataHash = ComputeHash();
-					vai->hash = dataHash;
-					vai->minihash = ComputeMiniHash();
-					vai->status = VertexArrayInfo::VAI_HASHING;
-					vai->drawsUntilNextFullHash = 0;
-					DecodeVerts(decoded); // writes to indexGen
-					vai->numVerts = indexGen.VertexCount();
-					vai->prim = indexGen.Prim();
-					vai->maxIndex = indexGen.MaxIndex();
-					vai->flags = gstate_c.vertexFullAlpha ? VAI_FLAG_VERTEXFULLALPHA : 0;
-
-					goto rotateVBO;
-				}
+			switch (action) {
+			case VertexCacheAction::DECODE:
+				DecodeVertsToPushBuffer(frameData.pushVertex, &vertexBufferOffset, &vertexBuffer);  // writes to indexGen
+				goto rotateVBO;
 
-				// Hashing - still gaining confidence about the buffer.
-				// But if we get this far it's likely to be worth creating a vertex buffer.
-			case VertexArrayInfo::VAI_HASHING:
+			// If we get this far it's likely to be worth creating a vertex buffer.
+			case VertexCacheAction::UPLOAD:
 				{
-					vai->numDraws++;
-					if (vai->lastFrame != gpuStats.numFlips) {
-						vai->numFrames++;
-					}
-					if (vai->drawsUntilNextFullHash == 0) {
-						// Let's try to skip a full hash if mini would fail.
-						const u32 newMiniHash = ComputeMiniHash();
-						ReliableHashType newHash = vai->hash;
-						if (newMiniHash == vai->minihash) {
-							newHash = ComputeHash();
-						}
-						if (newMiniHash != vai->minihash || newHash != vai->hash) {
-							MarkUnreliable(vai);
-							DecodeVerts(decoded);
-							goto rotateVBO;
-						}
-						if (vai->numVerts > 64) {
-							// exponential backoff up to 16 draws, then every 32
-							vai->drawsUntilNextFullHash = std::min(32, vai->numFrames);
-						} else {
-							// Lower numbers seem much more likely to change.
-							vai->drawsUntilNextFullHash = 0;
-						}
-						// TODO: tweak
-						//if (vai->numFrames > 1000) {
-						//	vai->status = VertexArrayInfo::VAI_RELIABLE;
-						//}
-					} else {
-						vai->drawsUntilNextFullHash--;
-						u32 newMiniHash = ComputeMiniHash();
-						if (newMiniHash != vai->minihash) {
-							MarkUnreliable(vai);
-							DecodeVerts(decoded);
-							goto rotateVBO;
-						}
+					DecodeVerts(decoded);
+					StoreVertexArrayDrawInfo(vai);
+					useElements = !indexGen.SeenOnlyPurePrims();
+					if (!useElements && indexGen.PureCount()) {
+						vai->numVerts = indexGen.PureCount();
 					}
 
-					if (vai->vbo == 0) {
-						DecodeVerts(decoded);
-						vai->numVerts = indexGen.VertexCount();
-						vai->prim = indexGen.Prim();
-						vai->maxIndex = indexGen.MaxIndex();
-						vai->flags = gstate_c.vertexFullAlpha ? VAI_FLAG_VERTEXFULLALPHA : 0;
-						useElements = !indexGen.SeenOnlyPurePrims();
-						if (!useElements && indexGen.PureCount()) {
-							vai->numVerts = indexGen.PureCount();
-						}
-
-						_dbg_assert_msg_(G3D, gstate_c.vertBounds.minV >= gstate_c.vertBounds.maxV, "Should not have checked UVs when caching.");
-
-						size_t vsz = dec_->GetDecVtxFmt().stride * indexGen.MaxIndex();
-						vai->vbo = render_->CreateBuffer(GL_ARRAY_BUFFER, vsz, GL_STATIC_DRAW);
-						render_->BufferSubdata(vai->vbo, 0, vsz, decoded);
-						// If there's only been one primitive type, and it's either TRIANGLES, LINES or POINTS,
-						// there is no need for the index buffer we built. We can then use glDrawArrays instead
-						// for a very minor speed boost.
-						if (useElements) {
-							size_t esz = sizeof(short) * indexGen.VertexCount();
-							vai->ebo = render_->CreateBuffer(GL_ARRAY_BUFFER, esz, GL_STATIC_DRAW);
-							render_->BufferSubdata(vai->ebo, 0, esz, (uint8_t *)decIndex, false);
-						} else {
-							vai->ebo = 0;
-							render_->BindIndexBuffer(vai->ebo);
-						}
+					_dbg_assert_msg_(G3D, gstate_c.vertBounds.minV >= gstate_c.vertBounds.maxV, "Should not have checked UVs when caching.");
+
+					size_t vsz = dec_->GetDecVtxFmt().stride * (indexGen.MaxIndex() + 1);
+					size_t esz = 0;
+					vai->vbo = render_->CreateBuffer(GL_ARRAY_BUFFER, vsz, GL_STATIC_DRAW);
+					render_->BufferSubdata(vai->vbo, 0, vsz, decoded);
+					// If there's only been one primitive type, and it's either TRIANGLES, LINES or POINTS,
+					// there is no need for the index buffer we built. We can then use glDrawArrays instead
+					// for a very minor speed boost.
+					if (useElements) {
+						esz = sizeof(short) * indexGen.VertexCount();
+						vai->ebo = render_->CreateBuffer(GL_ARRAY_BUFFER, esz, GL_STATIC_DRAW);
+						render_->BufferSubdata(vai->ebo, 0, esz, (uint8_t *)decIndex, false);
 					} else {
-						gpuStats.numCachedDrawCalls++;
-						useElements = vai->ebo ? true : false;
-						gpuStats.numCachedVertsDrawn += vai->numVerts;
-						gstate_c.vertexFullAlpha = vai->flags & VAI_FLAG_VERTEXFULLALPHA;
+						vai->ebo = 0;
+						render_->BindIndexBuffer(vai->ebo);
 					}
-					vertexBuffer = vai->vbo;
-					indexBuffer = vai->ebo;
-					vertexCount = vai->numVerts;
-					prim = static_cast<GEPrimitiveType>(vai->prim);
+					NotifyVertexArrayUploaded(vai, (u32)(vsz + esz));
 					break;
 				}
 
-				// Reliable - we don't even bother hashing anymore. Right now we don't go here until after a very long time.
-			case VertexArrayInfo::VAI_RELIABLE:
-				{
-					vai->numDraws++;
-					if (vai->lastFrame != gpuStats.numFlips) {
-						vai->numFrames++;
-					}
-					gpuStats.numCachedDrawCalls++;
-					gpuStats.numCachedVertsDrawn += vai->numVerts;
-					vertexBuffer = vai->vbo;
-					indexBuffer = vai->ebo;
-					vertexCount = vai->numVerts;
-					prim = static_cast<GEPrimitiveType>(vai->prim);
-
-					gstate_c.vertexFullAlpha = vai->flags & VAI_FLAG_VERTEXFULLALPHA;
-					break;
-				}
-
-			case VertexArrayInfo::VAI_UNRELIABLE:
-				{
-					vai->numDraws++;
-					if (vai->lastFrame != gpuStats.numFlips) {
-						vai->numFrames++;
-					}
-					DecodeVerts(decoded);
-					goto rotateVBO;
-				}
+			case VertexCacheAction::DRAW_CACHED:
+				useElements = vai->ebo ? true : false;
+				break;
 			}
 
-			vai->lastFrame = gpuStats.numFlips;
+			vertexBuffer = vai->vbo;
+			indexBuffer = vai->ebo;
+			vertexCount = vai->numVerts;
+			prim = static_cast<GEPrimitiveType>(vai->prim);
 		} else {
 			if (g_Config.bSoftwareSkinning && (lastVType_ & GE_VTYPE_WEIGHT_MASK)) {
 				// If software skinning, we've already predecoded into "decoded". So push that content.
@@ -63,51 +63,10 @@ enum {
 // DRAWN_ONCE -> death
 // DRAWN_RELIABLE -> death
 
-enum {
-	VAI_FLAG_VERTEXFULLALPHA = 1,
-};
-
-// Try to keep this POD.
-class VertexArrayInfo {
+class VertexArrayInfoGLES : public VertexArrayInfo {
 public:
-	VertexArrayInfo() {
-		status = VAI_NEW;
-		vbo = nullptr;
-		ebo = nullptr;
-		prim = GE_PRIM_INVALID;
-		numDraws = 0;
-		numFrames = 0;
-		lastFrame = gpuStats.numFlips;
-		numVerts = 0;
-		drawsUntilNextFullHash = 0;
-		flags = 0;
-	}
-
-	enum Status : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
-	GLRBuffer *vbo;
-	GLRBuffer *ebo;
-
-	// Precalculated parameter for drawRangeElements
-	u16 numVerts;
-	u16 maxIndex;
-	s8 prim;
-	Status status;
-
-	// ID information
-	int numDraws;
-	int numFrames;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash;
-	u8 flags;
+	GLRBuffer *vbo = nullptr;
+	GLRBuffer *ebo = nullptr;
 };
 
 // Handles transform, lighting and drawing.
@@ -132,9 +91,6 @@ class DrawEngineGLES : public DrawEngineCommon {
 	void DeviceLost();
 	void DeviceRestore(Draw::DrawContext *draw);
 
-	void ClearTrackedVertexArrays() override;
-	void DecimateTrackedVertexArrays();
-
 	void BeginFrame();
 	void EndFrame();
 
@@ -178,9 +134,10 @@ class DrawEngineGLES : public DrawEngineCommon {
 
 	void DecodeVertsToPushBuffer(GLPushBuffer *push, uint32_t *bindOffset, GLRBuffer **buf);
 
-	void FreeVertexArray(VertexArrayInfo *vai);
-
-	void MarkUnreliable(VertexArrayInfo *vai);
+	VertexArrayInfo *CreateVertexArray() override {
+		return new VertexArrayInfoGLES();
+	}
+	void FreeVertexArray(VertexArrayInfo *vai) override;
 
 	struct FrameData {
 		GLPushBuffer *pushVertex;
@@ -188,8 +145,6 @@ class DrawEngineGLES : public DrawEngineCommon {
 	};
 	FrameData frameData_[GLRenderManager::MAX_INFLIGHT_FRAMES];
 
-	PrehashMap<VertexArrayInfo *, nullptr> vai_;
-
 	DenseHashMap<uint32_t, GLRInputLayout *, nullptr> inputLayoutMap_;
 
 	GLRInputLayout *softwareInputLayout_ = nullptr;
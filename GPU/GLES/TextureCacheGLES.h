@@ -81,6 +81,7 @@ class TextureCacheGLES : public TextureCacheCommon {
 
 	TexCacheEntry::TexStatus CheckAlpha(const uint8_t *pixelData, GLenum dstFmt, int stride, int w, int h);
 	void UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBase, bool clutIndexIsSimple) override;
+	TextureScalerCommon *CreateScaler() override;
 	void ApplyTextureFramebuffer(TexCacheEntry *entry, VirtualFramebuffer *framebuffer) override;
 
 	void BuildTexture(TexCacheEntry *const entry) override;
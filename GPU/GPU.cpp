@@ -112,6 +112,8 @@ void GPU_Shutdown() {
 		while (!gpu->IsReady()) {
 			sleep_ms(10);
 		}
+		// Stop any list thread while the backend is still whole.
+		gpu->FinishEventLoop();
 	}
 	delete gpu;
 	gpu = nullptr;
@@ -62,6 +62,9 @@ struct GPUStatistics {
 		numCachedVertsDrawn = 0;
 		numUncachedVertsDrawn = 0;
 		numTrackedVertexArrays = 0;
+		numVertexCacheMisses = 0;
+		numVertexCacheUploads = 0;
+		numVertexCacheEvictions = 0;
 		numTextureInvalidations = 0;
 		numTextureSwitches = 0;
 		numShaderSwitches = 0;
@@ -84,6 +87,9 @@ struct GPUStatistics {
 	int numCachedVertsDrawn;
 	int numUncachedVertsDrawn;
 	int numTrackedVertexArrays;
+	int numVertexCacheMisses;
+	int numVertexCacheUploads;
+	int numVertexCacheEvictions;
 	int numTextureInvalidations;
 	int numTextureSwitches;
 	int numShaderSwitches;
@@ -96,6 +102,11 @@ struct GPUStatistics {
 	int otherGPUCycles;
 	int gpuCommandsAtCallLevel[4];
 
+	float VertexCacheHitRate() const {
+		int lookups = numCachedDrawCalls + numVertexCacheUploads + numVertexCacheMisses;
+		return lookups > 0 ? (float)numCachedDrawCalls * 100.0f / (float)lookups : 0.0f;
+	}
+
 	// Flip count. Doesn't really belong here.
 	int numFlips;
 };
@@ -1,9 +1,11 @@
 #include <algorithm>
+#include <limits>
 #include <type_traits>
 #include <mutex>
 
 #include "base/timeutil.h"
 #include "profiler/profiler.h"
+#include "thread/threadutil.h"
 
 #include "Common/ColorConv.h"
 #include "Core/Reporting.h"
@@ -376,6 +378,7 @@ GPUCommon::GPUCommon(GraphicsContext *gfxCtx, Draw::DrawContext *draw) :
 	// you'd expect due to the int64 field, but the Linux ABI apparently does not require that.
 	static_assert(sizeof(DisplayList) == 456, "Bad DisplayList size");
 
+	SetThreadEnabled(g_Config.bSeparateGEThread);
 	Reinitialize();
 	SetupColorConv();
 	gstate.Reset();
@@ -411,6 +414,8 @@ GPUCommon::GPUCommon(GraphicsContext *gfxCtx, Draw::DrawContext *draw) :
 }
 
 GPUCommon::~GPUCommon() {
+	// Normally already stopped by GPU_Shutdown(), before the backend is gone.
+	FinishEventLoop();
 }
 
 void GPUCommon::UpdateCmdInfo() {
@@ -442,7 +447,81 @@ void GPUCommon::EndHostFrame() {
 
 }
 
+void GPUCommon::SyncThread() {
+	if (OnGEThread() || !geThread_.joinable())
+		return;
+
+	// Forced, since the caller is about to touch state the lists use, whatever the core state.
+	GPUThreadEventQueue::SyncThread(true);
+	// Only now can the kernel see what the lists triggered.
+	__GeRunQueuedTriggers();
+}
+
+void GPUCommon::FinishEventLoop() {
+	if (!geThread_.joinable())
+		return;
+
+	geThreadExit_ = true;
+	GPUThreadEventQueue::FinishEventLoop();
+	geThread_.join();
+}
+
+void GPUCommon::GEThreadFunc() {
+	setCurrentThreadName("GE");
+	// Runs until FinishEventLoop().
+	RunEventsUntil(std::numeric_limits<u64>::max());
+}
+
+void GPUCommon::ProcessEvent(GPUEvent ev) {
+	switch (ev.type) {
+	case GPU_EVENT_PROCESS_QUEUE:
+		ProcessDLQueue(ev.ticks);
+		break;
+
+	case GPU_EVENT_INVALIDATE_CACHE:
+		InvalidateCacheInternal(ev.invalidate_cache.addr, ev.invalidate_cache.size, ev.invalidate_cache.type);
+		break;
+
+	default:
+		ERROR_LOG_REPORT(G3D, "Unexpected GPU event type: %d", (int)ev);
+		break;
+	}
+}
+
+void GPUCommon::ScheduleProcessDLQueue() {
+	// The debugger and recorder expect to step through lists on the emu thread.
+	if (!ThreadEnabled() || GPUDebug::IsActive() || GPURecord::IsActive()) {
+		ProcessDLQueue(CoreTiming::GetTicks());
+		return;
+	}
+
+	if (!geThread_.joinable()) {
+		geThread_ = std::thread(&GPUCommon::GEThreadFunc, this);
+		geThreadId_ = geThread_.get_id();
+	}
+
+	// Timing is in emu thread ticks, which the GE thread can't safely read.
+	GPUEvent ev(GPU_EVENT_PROCESS_QUEUE);
+	ev.ticks = CoreTiming::GetTicks();
+	ScheduleEvent(ev);
+}
+
+void GPUCommon::TriggerSync(GPUSyncType type, int listid, u64 atTicks) {
+	// The GE thread can't touch CoreTiming or the kernel, so sceGe holds these for the emu thread.
+	if (OnGEThread())
+		__GeQueueTriggerSync(type, listid, atTicks);
+	else
+		__GeTriggerSync(type, listid, atTicks);
+}
+
+bool GPUCommon::TriggerInterrupt(int listid, u32 pc, u64 atTicks) {
+	if (OnGEThread())
+		return __GeQueueTriggerInterrupt(listid, pc, atTicks);
+	return __GeTriggerInterrupt(listid, pc, atTicks);
+}
+
 void GPUCommon::Reinitialize() {
+	SyncThread();
 	memset(dls, 0, sizeof(dls));
 	for (int i = 0; i < DisplayListMaxCount; ++i) {
 		dls[i].state = PSP_GE_DL_STATE_NONE;
@@ -520,6 +599,7 @@ void GPUCommon::DumpNextFrame() {
 }
 
 u32 GPUCommon::DrawSync(int mode) {
+	SyncThread();
 	if (mode < 0 || mode > 1)
 		return SCE_KERNEL_ERROR_INVALID_MODE;
 
@@ -568,6 +648,7 @@ void GPUCommon::CheckDrawSync() {
 }
 
 int GPUCommon::ListSync(int listid, int mode) {
+	SyncThread();
 	if (listid < 0 || listid >= DisplayListMaxCount)
 		return SCE_KERNEL_ERROR_INVALID_ID;
 
@@ -612,6 +693,7 @@ int GPUCommon::ListSync(int listid, int mode) {
 }
 
 int GPUCommon::GetStack(int index, u32 stackPtr) {
+	SyncThread();
 	if (!currentList) {
 		// Seems like it doesn't return an error code?
 		return 0;
@@ -637,6 +719,8 @@ int GPUCommon::GetStack(int index, u32 stackPtr) {
 }
 
 u32 GPUCommon::EnqueueList(u32 listpc, u32 stall, int subIntrBase, PSPPointer<PspGeListArgs> args, bool head) {
+	SyncThread();
+
 	// TODO Check the stack values in missing arg and ajust the stack depth
 
 	// Check alignment
@@ -737,13 +821,14 @@ u32 GPUCommon::EnqueueList(u32 listpc, u32 stall, int subIntrBase, PSPPointer<Ps
 		drawCompleteTicks = (u64)-1;
 
 		// TODO save context when starting the list if param is set
-		ProcessDLQueue();
+		ScheduleProcessDLQueue();
 	}
 
 	return id;
 }
 
 u32 GPUCommon::DequeueList(int listid) {
+	SyncThread();
 	if (listid < 0 || listid >= DisplayListMaxCount || dls[listid].state == PSP_GE_DL_STATE_NONE)
 		return SCE_KERNEL_ERROR_INVALID_ID;
 
@@ -767,6 +852,7 @@ u32 GPUCommon::DequeueList(int listid) {
 }
 
 u32 GPUCommon::UpdateStall(int listid, u32 newstall) {
+	SyncThread();
 	if (listid < 0 || listid >= DisplayListMaxCount || dls[listid].state == PSP_GE_DL_STATE_NONE)
 		return SCE_KERNEL_ERROR_INVALID_ID;
 	auto &dl = dls[listid];
@@ -775,12 +861,13 @@ u32 GPUCommon::UpdateStall(int listid, u32 newstall) {
 
 	dl.stall = newstall & 0x0FFFFFFF;
 	
-	ProcessDLQueue();
+	ScheduleProcessDLQueue();
 
 	return 0;
 }
 
 u32 GPUCommon::Continue() {
+	SyncThread();
 	if (!currentList)
 		return 0;
 
@@ -816,11 +903,12 @@ u32 GPUCommon::Continue() {
 		return -1;
 	}
 
-	ProcessDLQueue();
+	ScheduleProcessDLQueue();
 	return 0;
 }
 
 u32 GPUCommon::Break(int mode) {
+	SyncThread();
 	if (mode < 0 || mode > 1)
 		return SCE_KERNEL_ERROR_INVALID_MODE;
 
@@ -972,7 +1060,9 @@ bool GPUCommon::InterpretList(DisplayList &list) {
 	if (coreCollectDebugStats) {
 		time_update();
 		double total = time_now_d() - start - timeSpentStepping_;
-		hleSetSteppingTime(timeSpentStepping_);
+		// Only stepped on the emu thread, see ScheduleProcessDLQueue().
+		if (timeSpentStepping_ != 0.0)
+			hleSetSteppingTime(timeSpentStepping_);
 		timeSpentStepping_ = 0.0;
 		gpuStats.msProcessingDisplayLists += total;
 	}
@@ -1083,6 +1173,7 @@ void GPUCommon::UpdatePC(u32 currentPC, u32 newPC) {
 }
 
 void GPUCommon::ReapplyGfxState() {
+	SyncThread();
 	// The commands are embedded in the command memory so we can just reexecute the words. Convenient.
 	// To be safe we pass 0xFFFFFFFF as the diff.
 
@@ -1122,8 +1213,8 @@ int GPUCommon::GetNextListIndex() {
 	}
 }
 
-void GPUCommon::ProcessDLQueue() {
-	startingTicks = CoreTiming::GetTicks();
+void GPUCommon::ProcessDLQueue(u64 ticks) {
+	startingTicks = ticks;
 	cyclesExecuted = 0;
 
 	// Seems to be correct behaviour to process the list anyway?
@@ -1150,7 +1241,7 @@ void GPUCommon::ProcessDLQueue() {
 
 	drawCompleteTicks = startingTicks + cyclesExecuted;
 	busyTicks = std::max(busyTicks, drawCompleteTicks);
-	__GeTriggerSync(GPU_SYNC_DRAW, 1, drawCompleteTicks);
+	TriggerSync(GPU_SYNC_DRAW, 1, drawCompleteTicks);
 	// Since the event is in CoreTiming, we're in sync.  Just set 0 now.
 }
 
@@ -1385,7 +1476,7 @@ void GPUCommon::Execute_End(u32 op, u32 diff) {
 			}
 			// TODO: Technically, jump/call/ret should generate an interrupt, but before the pc change maybe?
 			if (currentList->interruptsEnabled && trigger) {
-				if (__GeTriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
+				if (TriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
 					currentList->pendingInterrupt = true;
 					UpdateState(GPUSTATE_INTERRUPT);
 				}
@@ -1397,7 +1488,7 @@ void GPUCommon::Execute_End(u32 op, u32 diff) {
 		case PSP_GE_SIGNAL_HANDLER_PAUSE:
 			currentList->state = PSP_GE_DL_STATE_PAUSED;
 			if (currentList->interruptsEnabled) {
-				if (__GeTriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
+				if (TriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
 					currentList->pendingInterrupt = true;
 					UpdateState(GPUSTATE_INTERRUPT);
 				}
@@ -1412,13 +1503,13 @@ void GPUCommon::Execute_End(u32 op, u32 diff) {
 		default:
 			currentList->subIntrToken = prev & 0xFFFF;
 			UpdateState(GPUSTATE_DONE);
-			if (currentList->interruptsEnabled && __GeTriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
+			if (currentList->interruptsEnabled && TriggerInterrupt(currentList->id, currentList->pc, startingTicks + cyclesExecuted)) {
 				currentList->pendingInterrupt = true;
 			} else {
 				currentList->state = PSP_GE_DL_STATE_COMPLETED;
 				currentList->waitTicks = startingTicks + cyclesExecuted;
 				busyTicks = std::max(busyTicks, currentList->waitTicks);
-				__GeTriggerSync(GPU_SYNC_LIST, currentList->id, currentList->waitTicks);
+				TriggerSync(GPU_SYNC_LIST, currentList->id, currentList->waitTicks);
 				if (currentList->started && currentList->context.IsValid()) {
 					gstate.Restore(currentList->context);
 					ReapplyGfxState();
@@ -1579,9 +1670,8 @@ void GPUCommon::Execute_Prim(u32 op, u32 diff) {
 
 	// Optimized submission of sequences of PRIM. Allows us to avoid going through all the mess
 	// above for each one. This can be expanded to support additional games that intersperse
-	// PRIM commands with other commands. A special case that might be interesting is that game
-	// that changes culling mode between each prim, we could just change the triangle winding
-	// right here to still be able to join draw calls.
+	// PRIM commands with other commands. Culling mode changes between prims don't break up
+	// the draw, each one remembers its mode and the index generator flips its triangle winding.
 
 	uint32_t vtypeCheckMask = ~GE_VTYPE_WEIGHTCOUNT_MASK;
 	if (!g_Config.bSoftwareSkinning)
@@ -1609,13 +1699,6 @@ void GPUCommon::Execute_Prim(u32 op, u32 diff) {
 				inds = Memory::GetPointerUnchecked(gstate_c.indexAddr);
 			}
 
-			if (newPrim != GE_PRIM_TRIANGLE_STRIP && cullMode != -1 && cullMode != gstate.getCullMode()) {
-				DEBUG_LOG(G3D, "flush cull mode before prim: %d", newPrim);
-				drawEngineCommon_->DispatchFlush();
-				gstate.cmdmem[GE_CMD_CULL] ^= 1;
-				gstate_c.Dirty(DIRTY_RASTER_STATE);
-			}
-
 			drawEngineCommon_->SubmitPrim(verts, inds, newPrim, count, vertTypeID, cullMode, &bytesRead);
 			AdvanceVerts(vertexType, count, bytesRead);
 			totalVertCount += count;
@@ -1644,7 +1727,7 @@ void GPUCommon::Execute_Prim(u32 op, u32 diff) {
 			gstate.cmdmem[GE_CMD_BASE] = data;
 			break;
 		case GE_CMD_CULL:
-			// flip face by indices for GE_PRIM_TRIANGLE_STRIP
+			// Applied by flipping the winding of the following prims' indices.
 			cullMode = data & 1;
 			break;
 		case GE_CMD_NOP:
@@ -2340,6 +2423,8 @@ struct DisplayList_v2 {
 };
 
 void GPUCommon::DoState(PointerWrap &p) {
+	SyncThread();
+
 	auto s = p.Section("GPUCommon", 1, 4);
 	if (!s)
 		return;
@@ -2415,9 +2500,11 @@ void GPUCommon::DoState(PointerWrap &p) {
 }
 
 void GPUCommon::InterruptStart(int listid) {
+	SyncThread();
 	interruptRunning = true;
 }
 void GPUCommon::InterruptEnd(int listid) {
+	SyncThread();
 	interruptRunning = false;
 	isbreak = false;
 
@@ -2433,11 +2520,12 @@ void GPUCommon::InterruptEnd(int listid) {
 		__GeTriggerWait(GPU_SYNC_LIST, listid);
 	}
 
-	ProcessDLQueue();
+	ScheduleProcessDLQueue();
 }
 
 // TODO: Maybe cleaner to keep this in GE and trigger the clear directly?
 void GPUCommon::SyncEnd(GPUSyncType waitType, int listid, bool wokeThreads) {
+	SyncThread();
 	if (waitType == GPU_SYNC_DRAW && wokeThreads)
 	{
 		for (int i = 0; i < DisplayListMaxCount; ++i) {
@@ -2640,6 +2728,7 @@ void GPUCommon::DoBlockTransfer(u32 skipDrawReason) {
 }
 
 bool GPUCommon::PerformMemoryCopy(u32 dest, u32 src, int size) {
+	SyncThread();
 	// Track stray copies of a framebuffer in RAM. MotoGP does this.
 	if (framebufferManager_->MayIntersectFramebuffer(src) || framebufferManager_->MayIntersectFramebuffer(dest)) {
 		if (!framebufferManager_->NotifyFramebufferCopy(src, dest, size, false, gstate_c.skipDrawReason)) {
@@ -2659,6 +2748,7 @@ bool GPUCommon::PerformMemoryCopy(u32 dest, u32 src, int size) {
 }
 
 bool GPUCommon::PerformMemorySet(u32 dest, u8 v, int size) {
+	SyncThread();
 	// This may indicate a memset, usually to 0, of a framebuffer.
 	if (framebufferManager_->MayIntersectFramebuffer(dest)) {
 		Memory::Memset(dest, v, size);
@@ -2675,6 +2765,7 @@ bool GPUCommon::PerformMemorySet(u32 dest, u8 v, int size) {
 }
 
 bool GPUCommon::PerformMemoryDownload(u32 dest, int size) {
+	SyncThread();
 	// Cheat a bit to force a download of the framebuffer.
 	// VRAM + 0x00400000 is simply a VRAM mirror.
 	if (Memory::IsVRAMAddress(dest)) {
@@ -2684,6 +2775,7 @@ bool GPUCommon::PerformMemoryDownload(u32 dest, int size) {
 }
 
 bool GPUCommon::PerformMemoryUpload(u32 dest, int size) {
+	SyncThread();
 	// Cheat a bit to force an upload of the framebuffer.
 	// VRAM + 0x00400000 is simply a VRAM mirror.
 	if (Memory::IsVRAMAddress(dest)) {
@@ -2694,6 +2786,23 @@ bool GPUCommon::PerformMemoryUpload(u32 dest, int size) {
 }
 
 void GPUCommon::InvalidateCache(u32 addr, int size, GPUInvalidationType type) {
+	// A dcache writeback is only a hint for lists queued after it, so there's nothing to wait for.
+	// Callers that touch memory the lists use afterward (the Perform*() functions) sync themselves.
+	if (geThread_.joinable() && !OnGEThread() && !GPUDebug::IsActive() && !GPURecord::IsActive()) {
+		GPUEvent ev(GPU_EVENT_INVALIDATE_CACHE);
+		ev.invalidate_cache.addr = addr;
+		ev.invalidate_cache.size = size;
+		ev.invalidate_cache.type = type;
+		ScheduleEvent(ev);
+		return;
+	}
+
+	// The debugger runs lists inline, but some may still be queued from before it started.
+	SyncThread();
+	InvalidateCacheInternal(addr, size, type);
+}
+
+void GPUCommon::InvalidateCacheInternal(u32 addr, int size, GPUInvalidationType type) {
 	if (size > 0)
 		textureCache_->Invalidate(addr, size, type);
 	else
@@ -2709,6 +2818,7 @@ void GPUCommon::InvalidateCache(u32 addr, int size, GPUInvalidationType type) {
 }
 
 void GPUCommon::NotifyVideoUpload(u32 addr, int size, int width, int format) {
+	SyncThread();
 	if (Memory::IsVRAMAddress(addr)) {
 		framebufferManager_->NotifyVideoUpload(addr, size, width, (GEBufferFormat)format);
 	}
@@ -2717,6 +2827,7 @@ void GPUCommon::NotifyVideoUpload(u32 addr, int size, int width, int format) {
 }
 
 bool GPUCommon::PerformStencilUpload(u32 dest, int size) {
+	SyncThread();
 	if (framebufferManager_->MayIntersectFramebuffer(dest)) {
 		framebufferManager_->NotifyStencilUpload(dest, size);
 		return true;
@@ -2782,6 +2893,7 @@ bool GPUCommon::DescribeCodePtr(const u8 *ptr, std::string &name) {
 }
 
 bool GPUCommon::FramebufferDirty() {
+	SyncThread();
 	VirtualFramebuffer *vfb = framebufferManager_->GetDisplayVFB();
 	if (vfb) {
 		bool dirty = vfb->dirtyAfterDisplay;
@@ -2792,6 +2904,7 @@ bool GPUCommon::FramebufferDirty() {
 }
 
 bool GPUCommon::FramebufferReallyDirty() {
+	SyncThread();
 	VirtualFramebuffer *vfb = framebufferManager_->GetDisplayVFB();
 	if (vfb) {
 		bool dirty = vfb->reallyDirtyAfterDisplay;
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <thread>
+
 #include "Common/Common.h"
 #include "Common/MemoryUtil.h"
+#include "Core/ThreadEventQueue.h"
 #include "GPU/GPUInterface.h"
 #include "GPU/GPUState.h"
 #include "GPU/Common/GPUDebugInterface.h"
@@ -62,7 +66,36 @@ struct TransformedVertex {
 	};
 };
 
-class GPUCommon : public GPUInterface, public GPUDebugInterface {
+enum GPUEventType {
+	GPU_EVENT_INVALID,
+	GPU_EVENT_PROCESS_QUEUE,
+	GPU_EVENT_FINISH_EVENT_LOOP,
+	GPU_EVENT_SYNC_THREAD,
+	GPU_EVENT_INVALIDATE_CACHE,
+};
+
+struct GPUEvent {
+	GPUEvent(GPUEventType t) : type(t), ticks(0) {}
+	GPUEventType type;
+	union {
+		// For GPU_EVENT_PROCESS_QUEUE, when it was queued.
+		u64 ticks;
+		// GPU_EVENT_INVALIDATE_CACHE
+		struct {
+			u32 addr;
+			int size;
+			GPUInvalidationType type;
+		} invalidate_cache;
+	};
+
+	operator GPUEventType() const {
+		return type;
+	}
+};
+
+typedef ThreadEventQueue<GPUInterface, GPUEvent, GPUEventType, GPU_EVENT_INVALID, GPU_EVENT_SYNC_THREAD, GPU_EVENT_FINISH_EVENT_LOOP> GPUThreadEventQueue;
+
+class GPUCommon : public GPUThreadEventQueue, public GPUDebugInterface {
 public:
 	GPUCommon(GraphicsContext *gfxCtx, Draw::DrawContext *draw);
 	virtual ~GPUCommon();
@@ -84,6 +117,9 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void BeginHostFrame() override;
 	void EndHostFrame() override;
 
+	void SyncThread() override;
+	void FinishEventLoop() override;
+
 	void InterruptStart(int listid) override;
 	void InterruptEnd(int listid) override;
 	void SyncEnd(GPUSyncType waitType, int listid, bool wokeThreads) override;
@@ -98,7 +134,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void PreExecuteOp(u32 op, u32 diff) override;
 
 	bool InterpretList(DisplayList &list) override;
-	void ProcessDLQueue();
+	void ProcessDLQueue(u64 ticks);
 	u32  UpdateStall(int listid, u32 newstall) override;
 	u32  EnqueueList(u32 listpc, u32 stall, int subIntrBase, PSPPointer<PspGeListArgs> args, bool head) override;
 	u32  DequeueList(int listid) override;
@@ -119,6 +155,8 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	bool PerformMemoryUpload(u32 dest, int size) override;
 
 	void InvalidateCache(u32 addr, int size, GPUInvalidationType type) override;
+	// On the thread that runs the lists, in order with them.
+	virtual void InvalidateCacheInternal(u32 addr, int size, GPUInvalidationType type);
 	void NotifyVideoUpload(u32 addr, int size, int width, int format) override;
 	bool PerformStencilUpload(u32 dest, int size) override;
 
@@ -232,6 +270,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	}
 
 	DisplayList* getList(int listid) override {
+		SyncThread();
 		return &dls[listid];
 	}
 
@@ -243,6 +282,7 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	void CleanupBeforeUI() override {}
 
 	s64 GetListTicks(int listid) override {
+		SyncThread();
 		if (listid >= 0 && listid < DisplayListMaxCount) {
 			return dls[listid].waitTicks;
 		}
@@ -277,6 +317,17 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 
 	void BeginFrame() override;
 
+	void ProcessEvent(GPUEvent ev) override;
+	bool ShouldExitEventLoop() override {
+		return geThreadExit_;
+	}
+	void ScheduleProcessDLQueue();
+	bool OnGEThread() const {
+		return std::this_thread::get_id() == geThreadId_;
+	}
+	void TriggerSync(GPUSyncType type, int listid, u64 atTicks);
+	bool TriggerInterrupt(int listid, u32 pc, u64 atTicks);
+
 	virtual void FastRunLoop(DisplayList &list);
 
 	void SlowRunLoop(DisplayList &list);
@@ -359,9 +410,16 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 
 private:
 	void FlushImm();
+	void GEThreadFunc();
+
 	// Debug stats.
 	double timeSteppingStarted_;
 	double timeSpentStepping_;
+
+	// Only started on the first list, when bSeparateGEThread is set.
+	std::thread geThread_;
+	std::thread::id geThreadId_;
+	std::atomic<bool> geThreadExit_{ false };
 };
 
 struct CommonCommandTableEntry {
@@ -177,6 +177,11 @@ class GPUInterface {
 	virtual void BeginHostFrame() = 0;
 	virtual void EndHostFrame() = 0;
 
+	// Lists may be processed on a separate thread.  This waits until it's done with everything queued.
+	virtual void SyncThread() = 0;
+	// Stops that thread, if any.
+	virtual void FinishEventLoop() = 0;
+
 	// Draw queue management
 	virtual DisplayList* getList(int listid) = 0;
 	// TODO: Much of this should probably be shared between the different GPU implementations.
@@ -0,0 +1,263 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+
+#include "profiler/profiler.h"
+
+#include "Common/ThreadPools.h"
+#include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "GPU/GPUState.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/Sampler.h"
+#include "GPU/Software/SoftGpu.h"
+#include "GPU/Software/SoftTextureCache.h"
+
+// Flush anyway after this many, to bound memory and latency.  Item indexes must fit in a u16.
+static const size_t MAX_QUEUED_ITEMS = 4096;
+static const size_t MAX_QUEUED_STATES = 1024;
+static const int MAX_QUEUED_CLUTS = 128;
+// Enough for the largest index transformClutIndex() produces, plus the per-level offset.
+static const int CLUT_COPY_ENTRIES = 1024;
+
+// VRAM is mirrored, so compare addresses in the first mirror.
+static u32 NormalizeAddress(u32 addr) {
+	addr &= 0x3FFFFFFF;
+	if (Memory::IsVRAMAddress(addr))
+		addr &= 0x041FFFFF;
+	return addr;
+}
+
+BinManager::BinManager() {
+	queue_.reserve(MAX_QUEUED_ITEMS);
+	states_.reserve(MAX_QUEUED_STATES);
+	cluts_.resize(MAX_QUEUED_CLUTS * CLUT_COPY_ENTRIES);
+}
+
+void BinManager::AddTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2) {
+	int minX = std::min(std::min(v0.screenpos.x, v1.screenpos.x), v2.screenpos.x);
+	int minY = std::min(std::min(v0.screenpos.y, v1.screenpos.y), v2.screenpos.y);
+	int maxX = std::max(std::max(v0.screenpos.x, v1.screenpos.x), v2.screenpos.x);
+	int maxY = std::max(std::max(v0.screenpos.y, v1.screenpos.y), v2.screenpos.y);
+	Add(BinItemType::TRIANGLE, minX, minY, maxX, maxY, v0, v1, v2);
+}
+
+void BinManager::AddClearRect(const VertexData &v0, const VertexData &v1) {
+	int minX = std::min(v0.screenpos.x, v1.screenpos.x);
+	int minY = std::min(v0.screenpos.y, v1.screenpos.y);
+	int maxX = std::max(v0.screenpos.x, v1.screenpos.x);
+	int maxY = std::max(v0.screenpos.y, v1.screenpos.y);
+	Add(BinItemType::CLEAR_RECT, minX, minY, maxX, maxY, v0, v1, v1);
+}
+
+void BinManager::AddLine(const VertexData &v0, const VertexData &v1) {
+	int minX = std::min(v0.screenpos.x, v1.screenpos.x);
+	int minY = std::min(v0.screenpos.y, v1.screenpos.y);
+	int maxX = std::max(v0.screenpos.x, v1.screenpos.x);
+	int maxY = std::max(v0.screenpos.y, v1.screenpos.y);
+	Add(BinItemType::LINE, minX, minY, maxX, maxY, v0, v1, v1);
+}
+
+void BinManager::AddPoint(const VertexData &v0) {
+	Add(BinItemType::POINT, v0.screenpos.x, v0.screenpos.y, v0.screenpos.x, v0.screenpos.y, v0, v0, v0);
+}
+
+void BinManager::Add(BinItemType type, int minScreenX, int minScreenY, int maxScreenX, int maxScreenY, const VertexData &v0, const VertexData &v1, const VertexData &v2) {
+	// Be generous, the rasterizers round in different ways.  Only the range passed to them matters.
+	DrawingCoords minPos = TransformUnit::ScreenToDrawing(ScreenCoords(minScreenX, minScreenY, 0));
+	DrawingCoords maxPos = TransformUnit::ScreenToDrawing(ScreenCoords(maxScreenX, maxScreenY, 0));
+	int minX = std::max(minPos.x - 1, gstate.getScissorX1());
+	int minY = std::max(minPos.y - 1, gstate.getScissorY1());
+	int maxX = std::min(maxPos.x + 1, gstate.getScissorX2());
+	int maxY = std::min(maxPos.y + 1, gstate.getScissorY2());
+	if (minX > maxX || minY > maxY)
+		return;
+
+	if (queue_.size() >= MAX_QUEUED_ITEMS)
+		Flush();
+	if (dirty_)
+		UpdateState();
+
+	const u16 index = (u16)queue_.size();
+	queue_.push_back(BinItem{ type, (u16)(states_.size() - 1), v0, v1, v2 });
+
+	for (int ty = minY >> TILE_SHIFT; ty <= maxY >> TILE_SHIFT; ++ty) {
+		for (int tx = minX >> TILE_SHIFT; tx <= maxX >> TILE_SHIFT; ++tx) {
+			const int tile = ty * TILES_PER_ROW + tx;
+			if (tiles_[tile].empty())
+				activeTiles_.push_back(tile);
+			tiles_[tile].push_back(index);
+		}
+	}
+}
+
+void BinManager::UpdateState() {
+	const bool textured = gstate.isTextureMapEnabled() && !gstate.isModeClear();
+
+	// Work out what this state reads and writes first, since looking up the texture reads it.
+	MemRange reads[8];
+	int numReads = 0;
+	if (textured) {
+		const GETextureFormat texfmt = gstate.getTextureFormat();
+		const int maxLevel = gstate.isMipmapEnabled() ? gstate.getTextureMaxLevel() : 0;
+		for (int i = 0; i <= maxLevel; ++i) {
+			const u32 texaddr = gstate.getTextureAddress(i);
+			const int bufw = GetTextureBufw(i, texaddr, texfmt);
+			const u32 start = NormalizeAddress(texaddr);
+			reads[numReads++] = MemRange{ start, start + (textureBitsPerPixel[texfmt] * bufw * gstate.getTextureHeight(i)) / 8 };
+		}
+	}
+
+	const u32 rows = gstate.getScissorY2() + 1;
+	const u32 fbStart = NormalizeAddress(gstate.getFrameBufAddress());
+	const u32 fbBytes = rows * gstate.FrameBufStride() * (gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2);
+	const MemRange fbWrites{ fbStart, fbStart + fbBytes };
+	MemRange depthWrites{};
+	if (gstate.isModeClear() ? gstate.isClearModeDepthMask() : gstate.isDepthTestEnabled() && gstate.isDepthWriteEnabled()) {
+		const u32 depthStart = NormalizeAddress(gstate.getDepthBufAddress());
+		depthWrites = MemRange{ depthStart, depthStart + rows * gstate.DepthBufStride() * 2 };
+	}
+
+	// A full JIT cache gets cleared when compiling, which would free funcs queued states use.
+	// So clear it here instead, once they're drawn.
+	const bool pixelJitFull = Rasterizer::JitCacheFull();
+	const bool samplerJitFull = Sampler::JitCacheFull();
+
+	bool flush = pixelJitFull || samplerJitFull || states_.size() >= MAX_QUEUED_STATES;
+	flush = flush || (textured && gstate.isTextureFormatIndexed() && clutDirty_ && clutCount_ >= MAX_QUEUED_CLUTS);
+	// Sampling what queued primitives write must see their results, and the reverse.
+	for (int i = 0; i < numReads; ++i)
+		flush = flush || fbWrites_.Overlaps(reads[i]) || depthWrites_.Overlaps(reads[i]);
+	if (fbWrites.end > fbWrites_.end || depthWrites.end > depthWrites_.end) {
+		for (const MemRange &read : texReads_)
+			flush = flush || fbWrites.Overlaps(read) || depthWrites.Overlaps(read);
+	}
+
+	if (flush)
+		Flush();
+	if (pixelJitFull)
+		Rasterizer::ClearJitCache();
+	if (samplerJitFull)
+		Sampler::ClearJitCache();
+
+	const u32 *stateClut = clut;
+	if (textured && gstate.isTextureFormatIndexed()) {
+		if (clutDirty_ || clutCount_ == 0) {
+			memcpy(&cluts_[clutCount_ * CLUT_COPY_ENTRIES], clut, CLUT_COPY_ENTRIES * sizeof(u32));
+			clutCount_++;
+			clutDirty_ = false;
+		}
+		stateClut = &cluts_[(clutCount_ - 1) * CLUT_COPY_ENTRIES];
+	}
+
+	states_.push_back(Rasterizer::RasterizerState());
+	Rasterizer::ComputeRasterizerState(&states_.back(), stateClut);
+
+	if (fbWrites_.end == fbWrites_.start)
+		fbWrites_ = fbWrites;
+	fbWrites_.end = std::max(fbWrites_.end, fbWrites.end);
+	if (depthWrites_.end == depthWrites_.start)
+		depthWrites_ = depthWrites;
+	depthWrites_.end = std::max(depthWrites_.end, depthWrites.end);
+
+	// A state that samples what it draws needs each primitive to see the ones before it, so
+	// stay dirty and let the check above flush for the next one.
+	dirty_ = false;
+	for (int i = 0; i < numReads; ++i) {
+		if (texReads_.empty() || texReads_.back().start != reads[i].start || texReads_.back().end != reads[i].end)
+			texReads_.push_back(reads[i]);
+		if (fbWrites.Overlaps(reads[i]) || depthWrites.Overlaps(reads[i]))
+			dirty_ = true;
+	}
+}
+
+bool BinManager::HasPendingWrite(u32 addr, u32 size) const {
+	if (!HasPendingWork())
+		return false;
+	const u32 start = NormalizeAddress(addr);
+	const MemRange range{ start, start + size };
+	return fbWrites_.Overlaps(range) || depthWrites_.Overlaps(range);
+}
+
+void BinManager::DrawTiles(int start, int end) {
+	for (int i = start; i < end; ++i) {
+		const int tile = tileOrder_[i];
+		const int tx = tile % TILES_PER_ROW;
+		const int ty = tile / TILES_PER_ROW;
+		const Rasterizer::TileRange range{ tx << TILE_SHIFT, ty << TILE_SHIFT, (tx + 1) << TILE_SHIFT, (ty + 1) << TILE_SHIFT };
+
+		for (u16 index : tiles_[tile]) {
+			const BinItem &item = queue_[index];
+			const Rasterizer::RasterizerState &state = states_[item.stateIndex];
+
+			switch (item.type) {
+			case BinItemType::TRIANGLE:
+				Rasterizer::DrawTriangle(item.v0, item.v1, item.v2, state, range);
+				break;
+
+			case BinItemType::CLEAR_RECT:
+				Rasterizer::ClearRectangle(item.v0, item.v1, state, range);
+				break;
+
+			case BinItemType::LINE:
+				Rasterizer::DrawLine(item.v0, item.v1, state, range);
+				break;
+
+			case BinItemType::POINT:
+				Rasterizer::DrawPoint(item.v0, state, range);
+				break;
+			}
+		}
+	}
+}
+
+void BinManager::Flush() {
+	if (queue_.empty())
+		return;
+
+	PROFILE_THIS_SCOPE("bin_flush");
+
+	// Deal the tiles out round-robin, so each thread's slice is spread over the whole screen.
+	std::sort(activeTiles_.begin(), activeTiles_.end());
+	const int threads = std::max(1, g_Config.iNumWorkerThreads);
+	tileOrder_.clear();
+	for (int t = 0; t < threads; ++t) {
+		for (size_t i = t; i < activeTiles_.size(); i += threads)
+			tileOrder_.push_back(activeTiles_[i]);
+	}
+	GlobalThreadPool::Loop(std::bind(&BinManager::DrawTiles, this, std::placeholders::_1, std::placeholders::_2), 0, (int)tileOrder_.size());
+
+	for (int tile : activeTiles_)
+		tiles_[tile].clear();
+	activeTiles_.clear();
+	queue_.clear();
+	states_.clear();
+	clutCount_ = 0;
+	fbWrites_ = MemRange{};
+	depthWrites_ = MemRange{};
+	texReads_.clear();
+	dirty_ = true;
+
+	softTexCache.Flushed();
+	coarseDepth.Flushed();
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/TransformUnit.h"
+
+// Collects primitives after clipping, and rasterizes them all at once on the thread pool.
+// The screen is split into tiles, and each thread draws every queued primitive touching its
+// tiles, in submission order.  Since each pixel is owned by one thread, the result is the same as
+// drawing them one after another.
+//
+// Each primitive keeps a snapshot of the state it was queued with, so state changes only need
+// MarkDirty().  The rasterizer still writes through fb and depthbuf though, so anything that
+// switches those, reads back the framebuffer, or writes to memory must Flush() first.  Textures
+// that overlap queued writes are caught here.
+class BinManager {
+public:
+	BinManager();
+
+	void AddTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2);
+	void AddClearRect(const VertexData &v0, const VertexData &v1);
+	void AddLine(const VertexData &v0, const VertexData &v1);
+	void AddPoint(const VertexData &v0);
+
+	// Call after gstate changes in a way the rasterizer reads, so later primitives get a new state.
+	void MarkDirty() {
+		dirty_ = true;
+	}
+	// Call after the CLUT is loaded.  Queued primitives keep a copy of the old one.
+	void MarkClutDirty() {
+		dirty_ = true;
+		clutDirty_ = true;
+	}
+
+	bool HasPendingWork() const {
+		return !queue_.empty();
+	}
+	// Whether queued primitives may write to the range, so reading it must Flush() first.
+	bool HasPendingWrite(u32 addr, u32 size) const;
+
+	void Flush();
+
+private:
+	static const int TILE_SHIFT = 5;
+	static const int TILE_SIZE = 1 << TILE_SHIFT;
+	// Drawing coordinates go up to 1023.
+	static const int TILES_PER_ROW = 1024 >> TILE_SHIFT;
+	// Each thread owns whole depth tiles, since it updates their ranges.
+	static_assert(TILE_SIZE % CoarseDepthBuffer::TILE_SIZE == 0, "Bin tiles must cover whole depth tiles");
+
+	enum class BinItemType {
+		TRIANGLE,
+		CLEAR_RECT,
+		LINE,
+		POINT,
+	};
+
+	struct BinItem {
+		BinItemType type;
+		u16 stateIndex;
+		VertexData v0;
+		VertexData v1;
+		VertexData v2;
+	};
+
+	// Emulated addresses start to end, exclusive.
+	struct MemRange {
+		u32 start;
+		u32 end;
+
+		bool Overlaps(const MemRange &other) const {
+			return other.start < end && start < other.end;
+		}
+	};
+
+	void Add(BinItemType type, int minScreenX, int minScreenY, int maxScreenX, int maxScreenY, const VertexData &v0, const VertexData &v1, const VertexData &v2);
+	void UpdateState();
+	void DrawTiles(int start, int end);
+
+	std::vector<Rasterizer::RasterizerState> states_;
+	std::vector<BinItem> queue_;
+	// Indexes into queue_ of the items touching each tile, in submission order.
+	std::vector<u16> tiles_[TILES_PER_ROW * TILES_PER_ROW];
+	// Tiles with any items, and the order they're handed to threads in.
+	std::vector<int> activeTiles_;
+	std::vector<int> tileOrder_;
+
+	// Copies of the CLUT for queued states that use one.
+	std::vector<u32> cluts_;
+	int clutCount_ = 0;
+	bool dirty_ = true;
+	bool clutDirty_ = true;
+
+	// Memory queued primitives may write or sample.  Writes only ever grow from the start, since
+	// switching fb or depthbuf flushes.
+	MemRange fbWrites_{};
+	MemRange depthWrites_{};
+	std::vector<MemRange> texReads_;
+};
@@ -19,8 +19,8 @@
 
 #include "GPU/GPUState.h"
 
+#include "GPU/Software/BinManager.h"
 #include "GPU/Software/Clipper.h"
-#include "GPU/Software/Rasterizer.h"
 
 #include "profiler/profiler.h"
 
@@ -38,6 +38,16 @@ enum {
 
 static inline int CalcClipMask(const ClipCoords& v)
 {
+#if defined(_M_SSE)
+	// Compare x, y, and z against w and -w all at once, then spread the bits out to match.
+	const __m128 w = _mm_shuffle_ps(v.vec, v.vec, _MM_SHUFFLE(3, 3, 3, 3));
+	const __m128 negw = _mm_xor_ps(w, _mm_set1_ps(-0.0f));
+	const int pos = _mm_movemask_ps(_mm_cmpgt_ps(v.vec, w));
+	const int neg = _mm_movemask_ps(_mm_cmplt_ps(v.vec, negw));
+	const int bits = (pos & 7) | ((neg & 7) << 4);
+	// Bits 0-2 are POS_X/Y/Z, and 4-6 NEG_X/Y/Z.  Interleave into POS_X, NEG_X, POS_Y, ...
+	return (bits & 1) | ((bits & 2) << 1) | ((bits & 4) << 2) | ((bits >> 3) & 2) | ((bits >> 2) & 8) | ((bits >> 1) & 0x20);
+#else
 	int mask = 0;
 	// This checks `x / w` compared to 1 or -1, skipping the division.
 	if (v.x > v.w) mask |= CLIP_POS_X_BIT;
@@ -47,6 +57,7 @@ static inline int CalcClipMask(const ClipCoords& v)
 	if (v.z > v.w) mask |= CLIP_POS_Z_BIT;
 	if (v.z < -v.w) mask |= CLIP_NEG_Z_BIT;
 	return mask;
+#endif
 }
 
 #define AddInterpolatedVertex(t, out, in, numVertices) \
@@ -139,7 +150,7 @@ static void RotateUVThrough(const VertexData &tl, const VertexData &br, VertexDa
 	}
 }
 
-void ProcessRect(const VertexData& v0, const VertexData& v1)
+void ProcessRect(const VertexData& v0, const VertexData& v1, BinManager &binner)
 {
 	if (!gstate.isModeThrough()) {
 		VertexData buf[4];
@@ -176,10 +187,10 @@ void ProcessRect(const VertexData& v0, const VertexData& v1)
 		}
 
 		// Four triangles to do backfaces as well. Two of them will get backface culled.
-		ProcessTriangle(*topleft, *topright, *bottomright);
-		ProcessTriangle(*bottomright, *topright, *topleft);
-		ProcessTriangle(*bottomright, *bottomleft, *topleft);
-		ProcessTriangle(*topleft, *bottomleft, *bottomright);
+		ProcessTriangle(*topleft, *topright, *bottomright, binner);
+		ProcessTriangle(*bottomright, *topright, *topleft, binner);
+		ProcessTriangle(*bottomright, *bottomleft, *topleft, binner);
+		ProcessTriangle(*topleft, *bottomleft, *bottomright, binner);
 	} else {
 		// through mode handling
 		VertexData buf[4];
@@ -220,28 +231,28 @@ void ProcessRect(const VertexData& v0, const VertexData& v1)
 		RotateUVThrough(v0, v1, *topright, *bottomleft);
 
 		if (gstate.isModeClear()) {
-			Rasterizer::ClearRectangle(v0, v1);
+			binner.AddClearRect(v0, v1);
 		} else {
 			// Four triangles to do backfaces as well. Two of them will get backface culled.
-			Rasterizer::DrawTriangle(*topleft, *topright, *bottomright);
-			Rasterizer::DrawTriangle(*bottomright, *topright, *topleft);
-			Rasterizer::DrawTriangle(*bottomright, *bottomleft, *topleft);
-			Rasterizer::DrawTriangle(*topleft, *bottomleft, *bottomright);
+			binner.AddTriangle(*topleft, *topright, *bottomright);
+			binner.AddTriangle(*bottomright, *topright, *topleft);
+			binner.AddTriangle(*bottomright, *bottomleft, *topleft);
+			binner.AddTriangle(*topleft, *bottomleft, *bottomright);
 		}
 	}
 }
 
-void ProcessPoint(VertexData& v0)
+void ProcessPoint(VertexData& v0, BinManager &binner)
 {
 	// Points need no clipping. Will be bounds checked in the rasterizer (which seems backwards?)
-	Rasterizer::DrawPoint(v0);
+	binner.AddPoint(v0);
 }
 
-void ProcessLine(VertexData& v0, VertexData& v1)
+void ProcessLine(VertexData& v0, VertexData& v1, BinManager &binner)
 {
 	if (gstate.isModeThrough()) {
 		// Actually, should clip this one too so we don't need to do bounds checks in the rasterizer.
-		Rasterizer::DrawLine(v0, v1);
+		binner.AddLine(v0, v1);
 		return;
 	}
 
@@ -268,13 +279,13 @@ void ProcessLine(VertexData& v0, VertexData& v1)
 	VertexData data[2] = { *Vertices[0], *Vertices[1] };
 	data[0].screenpos = TransformUnit::ClipToScreen(data[0].clippos);
 	data[1].screenpos = TransformUnit::ClipToScreen(data[1].clippos);
-	Rasterizer::DrawLine(data[0], data[1]);
+	binner.AddLine(data[0], data[1]);
 }
 
-void ProcessTriangle(VertexData& v0, VertexData& v1, VertexData& v2)
+void ProcessTriangle(VertexData& v0, VertexData& v1, VertexData& v2, BinManager &binner)
 {
 	if (gstate.isModeThrough()) {
-		Rasterizer::DrawTriangle(v0, v1, v2);
+		binner.AddTriangle(v0, v1, v2);
 		return;
 	}
 
@@ -347,7 +358,7 @@ void ProcessTriangle(VertexData& v0, VertexData& v1, VertexData& v2)
 			data[0].screenpos = TransformUnit::ClipToScreen(data[0].clippos);
 			data[1].screenpos = TransformUnit::ClipToScreen(data[1].clippos);
 			data[2].screenpos = TransformUnit::ClipToScreen(data[2].clippos);
-			Rasterizer::DrawTriangle(data[0], data[1], data[2]);
+			binner.AddTriangle(data[0], data[1], data[2]);
 		}
 	}
 }
@@ -19,11 +19,13 @@
 
 #include "TransformUnit.h"
 
+class BinManager;
+
 namespace Clipper {
 
-void ProcessPoint(VertexData& v0);
-void ProcessLine(VertexData& v0, VertexData& v1);
-void ProcessTriangle(VertexData& v0, VertexData& v1, VertexData& v2);
-void ProcessRect(const VertexData& v0, const VertexData& v1);
+void ProcessPoint(VertexData& v0, BinManager &binner);
+void ProcessLine(VertexData& v0, VertexData& v1, BinManager &binner);
+void ProcessTriangle(VertexData& v0, VertexData& v1, VertexData& v2, BinManager &binner);
+void ProcessRect(const VertexData& v0, const VertexData& v1, BinManager &binner);
 
 }
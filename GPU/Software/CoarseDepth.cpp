@@ -0,0 +1,210 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+
+#include "Core/MemMap.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/SoftGpu.h"
+
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+
+CoarseDepthBuffer coarseDepth;
+
+void CoarseDepthBuffer::Prepare(DrawState *ds) {
+	ds->stride = gstate.DepthBufStride();
+	if (depthbuf.data != lastData_ || ds->stride != lastStride_) {
+		InvalidateAll();
+		lastData_ = depthbuf.data;
+		lastStride_ = ds->stride;
+	}
+
+	ds->writesDepth = false;
+	ds->marksWrites = false;
+	ds->rejectFunc = GE_COMP_ALWAYS;
+	ds->rejectX1 = 0;
+	ds->rejectY1 = 0;
+	ds->rejectX2 = -1;
+	ds->rejectY2 = -1;
+
+	const int x1 = gstate.getScissorX1();
+	const int y1 = gstate.getScissorY1();
+	const int x2 = gstate.getScissorX2();
+	const int y2 = gstate.getScissorY2();
+	const u8 *fbEnd = fb.data + (y2 + 1) * gstate.FrameBufStride() * (gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2);
+	const u8 *depthEnd = depthbuf.data + (y2 + 1) * ds->stride * 2;
+
+	// Pixels past the stride land on other rows in memory, possibly other threads' tiles.
+	// Color writes into the depth buffer would also go unnoticed.  Just start over afterward.
+	if (!depthbuf.data || x2 >= ds->stride || (fb.data < depthEnd && depthbuf.data < fbEnd))
+		unsafe_ = true;
+	if (unsafe_) {
+		ds->epoch = epoch_;
+		return;
+	}
+
+	if (gstate.isModeClear()) {
+		ds->writesDepth = gstate.isClearModeDepthMask();
+		ds->marksWrites = ds->writesDepth;
+		ds->epoch = epoch_;
+		return;
+	}
+	if (!gstate.isDepthTestEnabled()) {
+		ds->epoch = epoch_;
+		return;
+	}
+	ds->writesDepth = gstate.isDepthWriteEnabled();
+
+	const GEComparison depthFunc = gstate.getDepthTestFunction();
+	switch (depthFunc) {
+	case GE_COMP_LESS:
+	case GE_COMP_LEQUAL:
+	case GE_COMP_GREATER:
+	case GE_COMP_GEQUAL:
+		// Skipped pixels must not have mattered, so no stencil ops may apply.
+		if (!gstate.isStencilTestEnabled() || (gstate.getStencilOpSFail() == GE_STENCILOP_KEEP && gstate.getStencilOpZFail() == GE_STENCILOP_KEEP))
+			ds->rejectFunc = depthFunc;
+		break;
+	default:
+		break;
+	}
+
+	// LESS/LEQUAL reject against the max, and GREATER/GEQUAL against the min.
+	const bool readsMax = ds->rejectFunc == GE_COMP_LESS || ds->rejectFunc == GE_COMP_LEQUAL;
+	const bool readsMin = ds->rejectFunc == GE_COMP_GREATER || ds->rejectFunc == GE_COMP_GEQUAL;
+	if ((readsMax && maxLoose_) || (readsMin && minLoose_))
+		InvalidateAll();
+	ds->epoch = epoch_;
+
+	if (ds->writesDepth) {
+		switch (depthFunc) {
+		case GE_COMP_NEVER:
+		case GE_COMP_EQUAL:
+			// Nothing written, or nothing changed.
+			break;
+		case GE_COMP_LESS:
+		case GE_COMP_LEQUAL:
+			minLoose_ = true;
+			break;
+		case GE_COMP_GREATER:
+		case GE_COMP_GEQUAL:
+			maxLoose_ = true;
+			break;
+		default:
+			ds->marksWrites = true;
+			break;
+		}
+	}
+
+	if (ds->rejectFunc == GE_COMP_ALWAYS)
+		return;
+
+	// Pixels outside the scissor are never tested, and might not be safe to read.
+	ds->rejectX1 = (x1 + TILE_SIZE - 1) >> TILE_SHIFT;
+	ds->rejectY1 = (y1 + TILE_SIZE - 1) >> TILE_SHIFT;
+	ds->rejectX2 = ((x2 + 1) >> TILE_SHIFT) - 1;
+	ds->rejectY2 = ((y2 + 1) >> TILE_SHIFT) - 1;
+}
+
+void CoarseDepthBuffer::Flushed() {
+	if (unsafe_) {
+		InvalidateAll();
+		unsafe_ = false;
+	}
+}
+
+void CoarseDepthBuffer::Compute(const DrawState &ds, int tx, int ty, Tile &tile) const {
+	const int stride = ds.stride;
+	const u16 *row = depthbuf.as16 + (ty << TILE_SHIFT) * stride + (tx << TILE_SHIFT);
+
+#if defined(_M_SSE)
+	// SSE2 only has signed 16-bit min/max, so flip the sign bits first.
+	const __m128i flip = _mm_set1_epi16(-0x8000);
+	__m128i minZ = _mm_set1_epi16(0x7FFF);
+	__m128i maxZ = _mm_set1_epi16(-0x8000);
+	for (int y = 0; y < TILE_SIZE; ++y, row += stride) {
+		const __m128i *src = (const __m128i *)row;
+		for (int x = 0; x < TILE_SIZE / 8; ++x) {
+			const __m128i z = _mm_xor_si128(_mm_loadu_si128(src + x), flip);
+			minZ = _mm_min_epi16(minZ, z);
+			maxZ = _mm_max_epi16(maxZ, z);
+		}
+	}
+
+	// Now reduce each to a single lane.
+	minZ = _mm_min_epi16(minZ, _mm_shuffle_epi32(minZ, _MM_SHUFFLE(1, 0, 3, 2)));
+	maxZ = _mm_max_epi16(maxZ, _mm_shuffle_epi32(maxZ, _MM_SHUFFLE(1, 0, 3, 2)));
+	minZ = _mm_min_epi16(minZ, _mm_shuffle_epi32(minZ, _MM_SHUFFLE(2, 3, 0, 1)));
+	maxZ = _mm_max_epi16(maxZ, _mm_shuffle_epi32(maxZ, _MM_SHUFFLE(2, 3, 0, 1)));
+	minZ = _mm_min_epi16(minZ, _mm_srli_epi32(minZ, 16));
+	maxZ = _mm_max_epi16(maxZ, _mm_srli_epi32(maxZ, 16));
+	tile.minZ = (u16)_mm_cvtsi128_si32(minZ) ^ 0x8000;
+	tile.maxZ = (u16)_mm_cvtsi128_si32(maxZ) ^ 0x8000;
+#else
+	u16 minZ = 0xFFFF;
+	u16 maxZ = 0;
+	for (int y = 0; y < TILE_SIZE; ++y, row += stride) {
+		for (int x = 0; x < TILE_SIZE; ++x) {
+			minZ = std::min(minZ, row[x]);
+			maxZ = std::max(maxZ, row[x]);
+		}
+	}
+	tile.minZ = minZ;
+	tile.maxZ = maxZ;
+#endif
+	tile.epoch = ds.epoch;
+	tile.valid = true;
+}
+
+void CoarseDepthBuffer::Fill(const DrawState &ds, int x1, int y1, int x2, int y2, u16 z) {
+	if (!ds.writesDepth || x1 > x2 || y1 > y2)
+		return;
+
+	x2 = std::min(x2, 1023);
+	y2 = std::min(y2, 1023);
+	for (int ty = y1 >> TILE_SHIFT; ty <= y2 >> TILE_SHIFT; ++ty) {
+		const bool coversY = (ty << TILE_SHIFT) >= y1 && ((ty + 1) << TILE_SHIFT) - 1 <= y2;
+		for (int tx = x1 >> TILE_SHIFT; tx <= x2 >> TILE_SHIFT; ++tx) {
+			Tile &tile = tiles_[ty * TILES_PER_ROW + tx];
+			if (coversY && (tx << TILE_SHIFT) >= x1 && ((tx + 1) << TILE_SHIFT) - 1 <= x2) {
+				tile.minZ = z;
+				tile.maxZ = z;
+				tile.epoch = ds.epoch;
+				tile.valid = true;
+			} else {
+				tile.valid = false;
+			}
+		}
+	}
+}
+
+void CoarseDepthBuffer::Invalidate(u32 addr, int size, GPUInvalidationType type) {
+	// The depth buffer is always in VRAM.  Not worth being more precise.
+	if (type == GPU_INVALIDATE_ALL || Memory::IsVRAMAddress(addr)) {
+		InvalidateAll();
+	}
+}
+
+void CoarseDepthBuffer::InvalidateAll() {
+	// Tiles still in use by queued draws stay valid for them, see Rejects().
+	epoch_++;
+	minLoose_ = false;
+	maxLoose_ = false;
+}
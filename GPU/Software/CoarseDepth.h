@@ -0,0 +1,127 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+#include "GPU/GPUInterface.h"
+#include "GPU/ge_constants.h"
+
+// Tracks the min and max depth of each 16x16 tile of the depth buffer, so the rasterizer can
+// skip whole blocks of pixels that would all fail the depth test.
+//
+// A tile's range is recomputed from the depth buffer the first time it's tested after being
+// drawn to or invalidated.  Writes that had to pass a LESS/LEQUAL test can only lower depth, so
+// they leave the max a safe bound and don't invalidate anything (and the same for the min with
+// GREATER/GEQUAL.)  The loose side is only thrown away when a test that reads it is prepared.
+//
+// Draws are prepared in order on the GPU thread, but run later.  So invalidating everything
+// just starts a new epoch, and each tile recomputes when first tested by a draw from a later
+// epoch than its range.  Tiles are only touched by the thread that owns their pixels, which is
+// why BinManager tiles are aligned to TILE_SIZE.
+class CoarseDepthBuffer {
+public:
+	static const int TILE_SHIFT = 4;
+	static const int TILE_SIZE = 1 << TILE_SHIFT;
+
+	// What a prepared draw needs to know, kept with its queued state.
+	struct DrawState {
+		int stride;
+		u32 epoch;
+		bool writesDepth;
+		// Whether it may write depth outside the bounds, and so must mark tiles.
+		bool marksWrites;
+		GEComparison rejectFunc;
+		// Tiles fully inside the scissor, the only ones that may be rejected.
+		int rejectX1;
+		int rejectY1;
+		int rejectX2;
+		int rejectY2;
+
+		// Whether the depth test lets pixels be skipped without any other effect.
+		bool CanReject() const {
+			return rejectFunc != GE_COMP_ALWAYS;
+		}
+	};
+
+	// Checks the current state and buffers.  Call on the GPU thread when queueing a draw.
+	void Prepare(DrawState *ds);
+	// Call on the GPU thread once every prepared draw has finished.
+	void Flushed();
+
+	// The rest take drawing coordinates, and are called from the drawing threads.
+	void MarkWritten(int x, int y) {
+		tiles_[TileIndex(x, y)].valid = false;
+	}
+	// Records a depth clear of the inclusive rectangle, which makes fully covered tiles exact.
+	void Fill(const DrawState &ds, int x1, int y1, int x2, int y2, u16 z);
+	// True if no z between minZ and maxZ can pass the depth test at any pixel of the tile at x, y.
+	bool Rejects(const DrawState &ds, int x, int y, int minZ, int maxZ) {
+		const int tx = x >> TILE_SHIFT;
+		const int ty = y >> TILE_SHIFT;
+		if (tx < ds.rejectX1 || tx > ds.rejectX2 || ty < ds.rejectY1 || ty > ds.rejectY2)
+			return false;
+
+		Tile &tile = tiles_[ty * TILES_PER_ROW + tx];
+		if (!tile.valid || tile.epoch != ds.epoch)
+			Compute(ds, tx, ty, tile);
+
+		switch (ds.rejectFunc) {
+		case GE_COMP_LESS: return minZ >= tile.maxZ;
+		case GE_COMP_LEQUAL: return minZ > tile.maxZ;
+		case GE_COMP_GREATER: return maxZ <= tile.minZ;
+		case GE_COMP_GEQUAL: return maxZ < tile.minZ;
+		default: return false;
+		}
+	}
+
+	// Call on the GPU thread after anything else may have written to the depth buffer.
+	void Invalidate(u32 addr, int size, GPUInvalidationType type);
+	void InvalidateAll();
+
+private:
+	// Drawing coordinates go up to 1023.
+	static const int TILES_PER_ROW = 1024 >> TILE_SHIFT;
+
+	struct Tile {
+		u32 epoch;
+		u16 minZ;
+		u16 maxZ;
+		bool valid;
+	};
+
+	static int TileIndex(int x, int y) {
+		return (y >> TILE_SHIFT) * TILES_PER_ROW + (x >> TILE_SHIFT);
+	}
+	void Compute(const DrawState &ds, int tx, int ty, Tile &tile) const;
+
+	Tile tiles_[TILES_PER_ROW * TILES_PER_ROW]{};
+	// Starts above the tiles' epoch, so they're all invalid at first.
+	u32 epoch_ = 1;
+	const u8 *lastData_ = nullptr;
+	int lastStride_ = 0;
+
+	// Whether passing writes since the last InvalidateAll() may have left tiles' min or max
+	// above or below the real depth, respectively.
+	bool minLoose_ = false;
+	bool maxLoose_ = false;
+	// Set when a queued draw may write anywhere in the depth buffer.  Nothing can be trusted
+	// until it has finished, so later draws don't use or update tiles until Flushed().
+	bool unsafe_ = false;
+};
+
+extern CoarseDepthBuffer coarseDepth;
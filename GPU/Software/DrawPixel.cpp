@@ -0,0 +1,733 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <mutex>
+#include "Core/Reporting.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
+
+#if defined(_M_SSE)
+#include <emmintrin.h>
+#endif
+
+using namespace Math3D;
+
+namespace Rasterizer {
+
+static_assert(sizeof(PixelFuncID) == sizeof(u64), "PixelFuncID must fit in its key");
+
+std::mutex jitCacheLock;
+PixelJitCache *jitCache = nullptr;
+
+void Init() {
+	jitCache = new PixelJitCache();
+}
+
+void Shutdown() {
+	delete jitCache;
+	jitCache = nullptr;
+}
+
+bool JitCacheFull() {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	// Plenty for everything one state compiles.
+	return jitCache->GetSpaceLeft() < 65536;
+}
+
+void ClearJitCache() {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	jitCache->Clear();
+}
+
+bool DescribeCodePtr(const u8 *ptr, std::string &name) {
+	if (!jitCache->IsInSpace(ptr)) {
+		return false;
+	}
+
+	name = jitCache->DescribeCodePtr(ptr);
+	return true;
+}
+
+SingleFunc GetSingleFunc() {
+	PixelFuncID id;
+	jitCache->ComputePixelFuncID(&id);
+	SingleFunc jitted = jitCache->GetSingle(id);
+	if (jitted) {
+		return jitted;
+	}
+
+	return id.clearMode ? &DrawSinglePixel<true> : &DrawSinglePixel<false>;
+}
+
+PixelJitCache::PixelJitCache()
+#if PPSSPP_ARCH(ARM64)
+ : fp(this)
+#endif
+{
+	// 256k should be plenty, there aren't many state combinations per game.
+	AllocCodeSpace(1024 * 64 * 4);
+
+	// Add some random code to "help" MSVC's buggy disassembler :(
+#if defined(_WIN32) && (defined(_M_IX86) || defined(_M_X64))
+	using namespace Gen;
+	for (int i = 0; i < 100; i++) {
+		MOV(32, R(EAX), R(EBX));
+		RET();
+	}
+#elif defined(ARM)
+	BKPT(0);
+	BKPT(0);
+#endif
+}
+
+void PixelJitCache::Clear() {
+	ClearCodeSpace(0);
+	cache_.clear();
+	addresses_.clear();
+}
+
+void PixelJitCache::ComputePixelFuncID(PixelFuncID *id_out) {
+	PixelFuncID id;
+
+	id.clearMode = gstate.isModeClear();
+	if (id.clearMode) {
+		id.colorClear = gstate.isClearModeColorMask();
+		id.stencilClear = gstate.isClearModeAlphaMask();
+		id.depthClear = gstate.isClearModeDepthMask();
+		id.alphaTestFunc = GE_COMP_ALWAYS;
+		id.colorTestFunc = GE_COMP_ALWAYS;
+		id.depthTestFunc = GE_COMP_ALWAYS;
+		id.stencilTestFunc = GE_COMP_ALWAYS;
+	} else {
+		id.alphaTestFunc = gstate.isAlphaTestEnabled() ? gstate.getAlphaTestFunction() : GE_COMP_ALWAYS;
+		id.colorTestFunc = gstate.isColorTestEnabled() ? gstate.getColorTestFunction() : GE_COMP_ALWAYS;
+		id.applyFog = gstate.isFogEnabled() && !gstate.isModeThrough();
+
+		if (gstate.isStencilTestEnabled()) {
+			id.stencilTestFunc = gstate.getStencilTestFunction();
+			// Ops beyond DECR act like KEEP.
+			id.sFail = gstate.getStencilOpSFail() <= GE_STENCILOP_DECR ? gstate.getStencilOpSFail() : GE_STENCILOP_KEEP;
+			id.zFail = gstate.getStencilOpZFail() <= GE_STENCILOP_DECR ? gstate.getStencilOpZFail() : GE_STENCILOP_KEEP;
+			id.zPass = gstate.getStencilOpZPass() <= GE_STENCILOP_DECR ? gstate.getStencilOpZPass() : GE_STENCILOP_KEEP;
+		} else {
+			id.stencilTestFunc = GE_COMP_ALWAYS;
+		}
+
+		if (gstate.isDepthTestEnabled()) {
+			id.depthTestFunc = gstate.getDepthTestFunction();
+			id.depthWrite = gstate.isDepthWriteEnabled();
+		} else {
+			id.depthTestFunc = GE_COMP_ALWAYS;
+		}
+
+		id.alphaBlend = gstate.isAlphaBlendEnabled();
+		if (id.alphaBlend) {
+			id.alphaBlendEq = gstate.getBlendEq();
+			// All factors past the last are treated as the fixed color.
+			id.alphaBlendSrc = std::min((int)gstate.getBlendFuncA(), (int)GE_SRCBLEND_FIXA);
+			id.alphaBlendDst = std::min((int)gstate.getBlendFuncB(), (int)GE_DSTBLEND_FIXB);
+		}
+
+		id.applyLogicOp = gstate.isLogicOpEnabled();
+		if (id.applyLogicOp) {
+			id.logicOp = gstate.getLogicOp();
+		}
+	}
+
+	id.applyDepthRange = !gstate.isModeThrough();
+	id.fbFormat = gstate.FrameBufFormat();
+	id.applyColorWriteMask = gstate.getColorMask() != 0;
+
+	*id_out = id;
+}
+
+std::string PixelJitCache::DescribePixelFuncID(const PixelFuncID &id) {
+	static const char *const compNames[] = { "NEVER", "ALWAYS", "EQ", "NE", "LT", "LE", "GT", "GE" };
+	static const char *const stencilOpNames[] = { "KEEP", "ZERO", "REPL", "INV", "INC", "DEC" };
+	static const char *const fbNames[] = { "565", "5551", "4444", "8888" };
+
+	std::string name = fbNames[id.fbFormat];
+	if (id.clearMode) {
+		name += ":CLEAR";
+		if (id.colorClear)
+			name += "C";
+		if (id.stencilClear)
+			name += "S";
+		if (id.depthClear)
+			name += "D";
+	}
+	if (id.applyDepthRange)
+		name += ":DEPTHRANGE";
+	if (id.alphaTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":AT_") + compNames[id.alphaTestFunc];
+	if (id.applyFog)
+		name += ":FOG";
+	if (id.colorTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":CT_") + compNames[id.colorTestFunc];
+	if (id.stencilTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":ST_") + compNames[id.stencilTestFunc];
+	if (id.sFail != GE_STENCILOP_KEEP || id.zFail != GE_STENCILOP_KEEP || id.zPass != GE_STENCILOP_KEEP) {
+		name += std::string(":STOP_") + stencilOpNames[id.sFail] + "_" + stencilOpNames[id.zFail] + "_" + stencilOpNames[id.zPass];
+	}
+	if (id.depthTestFunc != GE_COMP_ALWAYS)
+		name += std::string(":ZT_") + compNames[id.depthTestFunc];
+	if (id.depthWrite)
+		name += ":ZWRITE";
+	if (id.alphaBlend)
+		name += ":BLEND_" + std::to_string(id.alphaBlendEq) + "_" + std::to_string(id.alphaBlendSrc) + "_" + std::to_string(id.alphaBlendDst);
+	if (id.applyLogicOp)
+		name += ":LOGIC_" + std::to_string(id.logicOp);
+	if (id.applyColorWriteMask)
+		name += ":MASK";
+	return name;
+}
+
+std::string PixelJitCache::DescribeCodePtr(const u8 *ptr) {
+	ptrdiff_t dist = 0x7FFFFFFF;
+	PixelFuncID found;
+	for (const auto &it : addresses_) {
+		ptrdiff_t it_dist = ptr - it.second;
+		if (it_dist >= 0 && it_dist < dist) {
+			found = it.first;
+			dist = it_dist;
+		}
+	}
+
+	return DescribePixelFuncID(found);
+}
+
+SingleFunc PixelJitCache::GetSingle(const PixelFuncID &id) {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+
+	auto it = cache_.find(id);
+	if (it != cache_.end()) {
+		return it->second;
+	}
+
+	// TODO: What should be the min size?  Can we even hit this?
+	if (GetSpaceLeft() < 16384) {
+		Clear();
+	}
+
+#ifdef _M_X64
+	addresses_[id] = GetCodePointer();
+	SingleFunc func = CompileSingle(id);
+	cache_[id] = func;
+	return func;
+#else
+	return nullptr;
+#endif
+}
+
+static inline bool DepthTestPassed(const GPUgstate &regs, int x, int y, u16 z)
+{
+	u16 reference_z = GetPixelDepth(regs, x, y);
+
+	switch (regs.getDepthTestFunction()) {
+	case GE_COMP_NEVER:
+		return false;
+
+	case GE_COMP_ALWAYS:
+		return true;
+
+	case GE_COMP_EQUAL:
+		return (z == reference_z);
+
+	case GE_COMP_NOTEQUAL:
+		return (z != reference_z);
+
+	case GE_COMP_LESS:
+		return (z < reference_z);
+
+	case GE_COMP_LEQUAL:
+		return (z <= reference_z);
+
+	case GE_COMP_GREATER:
+		return (z > reference_z);
+
+	case GE_COMP_GEQUAL:
+		return (z >= reference_z);
+
+	default:
+		return 0;
+	}
+}
+
+static inline bool StencilTestPassed(const GPUgstate &regs, u8 stencil)
+{
+	// TODO: Does the masking logic make any sense?
+	stencil &= regs.getStencilTestMask();
+	u8 ref = regs.getStencilTestRef() & regs.getStencilTestMask();
+	switch (regs.getStencilTestFunction()) {
+		case GE_COMP_NEVER:
+			return false;
+
+		case GE_COMP_ALWAYS:
+			return true;
+
+		case GE_COMP_EQUAL:
+			return ref == stencil;
+
+		case GE_COMP_NOTEQUAL:
+			return ref != stencil;
+
+		case GE_COMP_LESS:
+			return ref < stencil;
+
+		case GE_COMP_LEQUAL:
+			return ref <= stencil;
+
+		case GE_COMP_GREATER:
+			return ref > stencil;
+
+		case GE_COMP_GEQUAL:
+			return ref >= stencil;
+	}
+	return true;
+}
+
+static inline u8 ApplyStencilOp(const GPUgstate &regs, int op, u8 old_stencil) {
+	// TODO: Apply mask to reference or old stencil?
+	u8 reference_stencil = regs.getStencilTestRef(); // TODO: Apply mask?
+
+	switch (op) {
+		case GE_STENCILOP_KEEP:
+			return old_stencil;
+
+		case GE_STENCILOP_ZERO:
+			return 0;
+
+		case GE_STENCILOP_REPLACE:
+			return reference_stencil;
+
+		case GE_STENCILOP_INVERT:
+			return ~old_stencil;
+
+		case GE_STENCILOP_INCR:
+			switch (regs.FrameBufFormat()) {
+			case GE_FORMAT_8888:
+				if (old_stencil != 0xFF) {
+					return old_stencil + 1;
+				}
+				return old_stencil;
+			case GE_FORMAT_5551:
+				return 0xFF;
+			case GE_FORMAT_4444:
+				if (old_stencil < 0xF0) {
+					return old_stencil + 0x10;
+				}
+				return old_stencil;
+			default:
+				return old_stencil;
+			}
+			break;
+
+		case GE_STENCILOP_DECR:
+			switch (regs.FrameBufFormat()) {
+			case GE_FORMAT_4444:
+				if (old_stencil >= 0x10)
+					return old_stencil - 0x10;
+				break;
+			default:
+				if (old_stencil != 0)
+					return old_stencil - 1;
+				return old_stencil;
+			}
+			break;
+	}
+
+	return old_stencil;
+}
+
+static inline u32 ApplyLogicOp(GELogicOp op, u32 old_color, u32 new_color) {
+	// All of the operations here intentionally preserve alpha/stencil.
+	switch (op) {
+	case GE_LOGIC_CLEAR:
+		new_color &= 0xFF000000;
+		break;
+
+	case GE_LOGIC_AND:
+		new_color = new_color & (old_color | 0xFF000000);
+		break;
+
+	case GE_LOGIC_AND_REVERSE:
+		new_color = new_color & (~old_color | 0xFF000000);
+		break;
+
+	case GE_LOGIC_COPY:
+		// No change to new_color.
+		break;
+
+	case GE_LOGIC_AND_INVERTED:
+		new_color = (~new_color & (old_color & 0x00FFFFFF)) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_NOOP:
+		new_color = (old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_XOR:
+		new_color = new_color ^ (old_color & 0x00FFFFFF);
+		break;
+
+	case GE_LOGIC_OR:
+		new_color = new_color | (old_color & 0x00FFFFFF);
+		break;
+
+	case GE_LOGIC_NOR:
+		new_color = (~(new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_EQUIV:
+		new_color = (~(new_color ^ old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_INVERTED:
+		new_color = (~old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_OR_REVERSE:
+		new_color = new_color | (~old_color & 0x00FFFFFF);
+		break;
+
+	case GE_LOGIC_COPY_INVERTED:
+		new_color = (~new_color & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_OR_INVERTED:
+		new_color = ((~new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_NAND:
+		new_color = (~(new_color & old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
+		break;
+
+	case GE_LOGIC_SET:
+		new_color |= 0x00FFFFFF;
+		break;
+	}
+
+	return new_color;
+}
+
+static inline bool ColorTestPassed(const GPUgstate &regs, const Vec3<int> &color)
+{
+	const u32 mask = regs.getColorTestMask();
+	const u32 c = color.ToRGB() & mask;
+	const u32 ref = regs.getColorTestRef() & mask;
+	switch (regs.getColorTestFunction()) {
+		case GE_COMP_NEVER:
+			return false;
+
+		case GE_COMP_ALWAYS:
+			return true;
+
+		case GE_COMP_EQUAL:
+			return c == ref;
+
+		case GE_COMP_NOTEQUAL:
+			return c != ref;
+
+		default:
+			ERROR_LOG_REPORT(G3D, "Software: Invalid colortest function: %d", regs.getColorTestFunction());
+			break;
+	}
+	return true;
+}
+
+static inline bool AlphaTestPassed(const GPUgstate &regs, int alpha)
+{
+	const u8 mask = regs.getAlphaTestMask() & 0xFF;
+	const u8 ref = regs.getAlphaTestRef() & mask;
+	alpha &= mask;
+
+	switch (regs.getAlphaTestFunction()) {
+		case GE_COMP_NEVER:
+			return false;
+
+		case GE_COMP_ALWAYS:
+			return true;
+
+		case GE_COMP_EQUAL:
+			return (alpha == ref);
+
+		case GE_COMP_NOTEQUAL:
+			return (alpha != ref);
+
+		case GE_COMP_LESS:
+			return (alpha < ref);
+
+		case GE_COMP_LEQUAL:
+			return (alpha <= ref);
+
+		case GE_COMP_GREATER:
+			return (alpha > ref);
+
+		case GE_COMP_GEQUAL:
+			return (alpha >= ref);
+	}
+	return true;
+}
+
+static inline Vec3<int> GetSourceFactor(const GPUgstate &regs, const Vec4<int>& source, const Vec4<int>& dst)
+{
+	switch (regs.getBlendFuncA()) {
+	case GE_SRCBLEND_DSTCOLOR:
+		return dst.rgb();
+
+	case GE_SRCBLEND_INVDSTCOLOR:
+		return Vec3<int>::AssignToAll(255) - dst.rgb();
+
+	case GE_SRCBLEND_SRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
+#else
+		return Vec3<int>::AssignToAll(source.a());
+#endif
+
+	case GE_SRCBLEND_INVSRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
+#else
+		return Vec3<int>::AssignToAll(255 - source.a());
+#endif
+
+	case GE_SRCBLEND_DSTALPHA:
+		return Vec3<int>::AssignToAll(dst.a());
+
+	case GE_SRCBLEND_INVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - dst.a());
+
+	case GE_SRCBLEND_DOUBLESRCALPHA:
+		return Vec3<int>::AssignToAll(2 * source.a());
+
+	case GE_SRCBLEND_DOUBLEINVSRCALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
+
+	case GE_SRCBLEND_DOUBLEDSTALPHA:
+		return Vec3<int>::AssignToAll(2 * dst.a());
+
+	case GE_SRCBLEND_DOUBLEINVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
+
+	case GE_SRCBLEND_FIXA:
+	default:
+		// All other dest factors (> 10) are treated as FIXA.
+		return Vec3<int>::FromRGB(regs.getFixA());
+	}
+}
+
+static inline Vec3<int> GetDestFactor(const GPUgstate &regs, const Vec4<int>& source, const Vec4<int>& dst)
+{
+	switch (regs.getBlendFuncB()) {
+	case GE_DSTBLEND_SRCCOLOR:
+		return source.rgb();
+
+	case GE_DSTBLEND_INVSRCCOLOR:
+		return Vec3<int>::AssignToAll(255) - source.rgb();
+
+	case GE_DSTBLEND_SRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
+#else
+		return Vec3<int>::AssignToAll(source.a());
+#endif
+
+	case GE_DSTBLEND_INVSRCALPHA:
+#if defined(_M_SSE)
+		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
+#else
+		return Vec3<int>::AssignToAll(255 - source.a());
+#endif
+
+	case GE_DSTBLEND_DSTALPHA:
+		return Vec3<int>::AssignToAll(dst.a());
+
+	case GE_DSTBLEND_INVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - dst.a());
+
+	case GE_DSTBLEND_DOUBLESRCALPHA:
+		return Vec3<int>::AssignToAll(2 * source.a());
+
+	case GE_DSTBLEND_DOUBLEINVSRCALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
+
+	case GE_DSTBLEND_DOUBLEDSTALPHA:
+		return Vec3<int>::AssignToAll(2 * dst.a());
+
+	case GE_DSTBLEND_DOUBLEINVDSTALPHA:
+		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
+
+	case GE_DSTBLEND_FIXB:
+	default:
+		// All other dest factors (> 10) are treated as FIXB.
+		return Vec3<int>::FromRGB(regs.getFixB());
+	}
+}
+
+static inline Vec3<int> AlphaBlendingResult(const GPUgstate &regs, const Vec4<int> &source, const Vec4<int> &dst)
+{
+	// Note: These factors cannot go below 0, but they can go above 255 when doubling.
+	Vec3<int> srcfactor = GetSourceFactor(regs, source, dst);
+	Vec3<int> dstfactor = GetDestFactor(regs, source, dst);
+
+	switch (regs.getBlendEq()) {
+	case GE_BLENDMODE_MUL_AND_ADD:
+	{
+#if defined(_M_SSE)
+		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
+		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
+		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
+#else
+		return (source.rgb() * srcfactor + dst.rgb() * dstfactor) / 255;
+#endif
+	}
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT:
+	{
+#if defined(_M_SSE)
+		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
+		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
+		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
+#else
+		return (source.rgb() * srcfactor - dst.rgb() * dstfactor) / 255;
+#endif
+	}
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
+	{
+#if defined(_M_SSE)
+		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
+		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
+		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(d, s), _mm_set_ps1(1.0f / 255.0f))));
+#else
+		return (dst.rgb() * dstfactor - source.rgb() * srcfactor) / 255;
+#endif
+	}
+
+	case GE_BLENDMODE_MIN:
+		return Vec3<int>(std::min(source.r(), dst.r()),
+						std::min(source.g(), dst.g()),
+						std::min(source.b(), dst.b()));
+
+	case GE_BLENDMODE_MAX:
+		return Vec3<int>(std::max(source.r(), dst.r()),
+						std::max(source.g(), dst.g()),
+						std::max(source.b(), dst.b()));
+
+	case GE_BLENDMODE_ABSDIFF:
+		return Vec3<int>(::abs(source.r() - dst.r()),
+						::abs(source.g() - dst.g()),
+						::abs(source.b() - dst.b()));
+
+	default:
+		ERROR_LOG_REPORT(G3D, "Software: Unknown blend function %x", regs.getBlendEq());
+		return Vec3<int>();
+	}
+}
+
+template <bool clearMode>
+void DrawSinglePixel(int x, int y, int z, int fog, const Vec4<int> &color_in, const RasterizerState &state) {
+	const GPUgstate &regs = state.regs;
+	Vec4<int> prim_color = color_in.Clamp(0, 255);
+	// Depth range test - applied in clear mode, if not through mode.
+	if (!regs.isModeThrough())
+		if (z < regs.getDepthRangeMin() || z > regs.getDepthRangeMax())
+			return;
+
+	if (regs.isAlphaTestEnabled() && !clearMode)
+		if (!AlphaTestPassed(regs, prim_color.a()))
+			return;
+
+	// Fog is applied prior to color test.
+	if (regs.isFogEnabled() && !regs.isModeThrough() && !clearMode) {
+		Vec3<int> fogColor = Vec3<int>::FromRGB(regs.fogcolor);
+		fogColor = (prim_color.rgb() * (int)fog + fogColor * (255 - (int)fog)) / 255;
+		prim_color.r() = fogColor.r();
+		prim_color.g() = fogColor.g();
+		prim_color.b() = fogColor.b();
+	}
+
+	if (regs.isColorTestEnabled() && !clearMode)
+		if (!ColorTestPassed(regs, prim_color.rgb()))
+			return;
+
+	// In clear mode, it uses the alpha color as stencil.
+	u8 stencil = clearMode ? prim_color.a() : GetPixelStencil(regs, x, y);
+	if (!clearMode && (regs.isStencilTestEnabled() || regs.isDepthTestEnabled())) {
+		if (regs.isStencilTestEnabled() && !StencilTestPassed(regs, stencil)) {
+			stencil = ApplyStencilOp(regs, regs.getStencilOpSFail(), stencil);
+			SetPixelStencil(regs, x, y, stencil);
+			return;
+		}
+
+		// Also apply depth at the same time.  If disabled, same as passing.
+		if (regs.isDepthTestEnabled() && !DepthTestPassed(regs, x, y, z)) {
+			if (regs.isStencilTestEnabled()) {
+				stencil = ApplyStencilOp(regs, regs.getStencilOpZFail(), stencil);
+				SetPixelStencil(regs, x, y, stencil);
+			}
+			return;
+		} else if (regs.isStencilTestEnabled()) {
+			stencil = ApplyStencilOp(regs, regs.getStencilOpZPass(), stencil);
+		}
+
+		if (regs.isDepthTestEnabled() && regs.isDepthWriteEnabled()) {
+			SetPixelDepth(regs, x, y, z);
+		}
+	} else if (clearMode && regs.isClearModeDepthMask()) {
+		SetPixelDepth(regs, x, y, z);
+	}
+
+	const u32 old_color = GetPixelColor(regs, x, y);
+	u32 new_color;
+
+	if (regs.isAlphaBlendEnabled() && !clearMode) {
+		const Vec4<int> dst = Vec4<int>::FromRGBA(old_color);
+		// ToRGB() always automatically clamps.
+		new_color = AlphaBlendingResult(regs, prim_color, dst).ToRGB();
+		new_color |= stencil << 24;
+	} else {
+#if defined(_M_SSE)
+		new_color = Vec3<int>(prim_color.ivec).ToRGB();
+		new_color |= stencil << 24;
+#else
+		new_color = Vec4<int>(prim_color.r(), prim_color.g(), prim_color.b(), stencil).ToRGBA();
+#endif
+	}
+
+	// Logic ops are applied after blending (if blending is enabled.)
+	if (regs.isLogicOpEnabled() && !clearMode) {
+		// Logic ops don't affect stencil, which happens inside ApplyLogicOp.
+		new_color = ApplyLogicOp(regs.getLogicOp(), old_color, new_color);
+	}
+
+	if (clearMode) {
+		new_color = (new_color & ~regs.getClearModeColorMask()) | (old_color & regs.getClearModeColorMask());
+	}
+	new_color = (new_color & ~regs.getColorMask()) | (old_color & regs.getColorMask());
+
+	// TODO: Dither before or inside SetPixelColor
+	SetPixelColor(regs, x, y, new_color);
+}
+
+template void DrawSinglePixel<true>(int x, int y, int z, int fog, const Vec4<int> &color_in, const RasterizerState &state);
+template void DrawSinglePixel<false>(int x, int y, int z, int fog, const Vec4<int> &color_in, const RasterizerState &state);
+
+};
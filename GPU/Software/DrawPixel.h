@@ -0,0 +1,264 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "ppsspp_config.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#if PPSSPP_ARCH(ARM)
+#include "Common/ArmEmitter.h"
+#elif PPSSPP_ARCH(ARM64)
+#include "Common/Arm64Emitter.h"
+#elif PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#include "Common/x64Emitter.h"
+#elif PPSSPP_ARCH(MIPS)
+#include "Common/MipsEmitter.h"
+#else
+#include "Common/FakeEmitter.h"
+#endif
+#include "Common/ColorConv.h"
+#include "GPU/GPUState.h"
+#include "GPU/Math3D.h"
+#include "GPU/Software/SoftGpu.h"
+
+// Everything about the state that changes the code path for a pixel, once it's been shaded.
+// Reference values and masks aren't included, they're read from the queued state when drawing.
+struct PixelFuncID {
+	PixelFuncID() : fullKey(0) {
+	}
+
+	union {
+		u64 fullKey;
+		struct {
+			bool clearMode : 1;
+			// Only used in clear mode.
+			bool colorClear : 1;
+			bool stencilClear : 1;
+			bool depthClear : 1;
+			bool applyDepthRange : 1;
+			// GEComparison, ALWAYS when disabled.
+			uint8_t alphaTestFunc : 3;
+
+			uint8_t colorTestFunc : 2;
+			bool applyFog : 1;
+			uint8_t depthTestFunc : 3;
+			bool depthWrite : 1;
+			uint8_t : 1;
+
+			uint8_t stencilTestFunc : 3;
+			// GEStencilOp, KEEP when stencil test is disabled.
+			uint8_t sFail : 3;
+			// GEBufferFormat.
+			uint8_t fbFormat : 2;
+
+			uint8_t zFail : 3;
+			uint8_t zPass : 3;
+			bool alphaBlend : 1;
+			bool applyLogicOp : 1;
+
+			// GEBlendMode.
+			uint8_t alphaBlendEq : 3;
+			bool applyColorWriteMask : 1;
+			// GELogicOp.
+			uint8_t logicOp : 4;
+
+			// GEBlendSrcFactor and GEBlendDstFactor.
+			uint8_t alphaBlendSrc : 4;
+			uint8_t alphaBlendDst : 4;
+		};
+	};
+
+	bool operator == (const PixelFuncID &other) const {
+		return fullKey == other.fullKey;
+	}
+};
+
+namespace std {
+
+template <>
+struct hash<PixelFuncID> {
+	std::size_t operator()(const PixelFuncID &k) const {
+		return hash<u64>()(k.fullKey);
+	}
+};
+
+};
+
+namespace Rasterizer {
+
+struct RasterizerState;
+
+// Tests, blends, and writes one pixel.  z must be 0-65535 and fog 0-255, color_in is clamped.
+// The func is picked for the current gstate, but reads references and masks from state.regs.
+typedef void (*SingleFunc)(int x, int y, int z, int fog, const Math3D::Vec4<int> &color_in, const RasterizerState &state);
+SingleFunc GetSingleFunc();
+
+// The generic path, which reads everything from state.regs.  Used when there's no jitted func.
+template <bool clearMode>
+void DrawSinglePixel(int x, int y, int z, int fog, const Math3D::Vec4<int> &color_in, const RasterizerState &state);
+
+void Init();
+void Shutdown();
+
+// Compiling clears the cache when it runs out of space, which frees funcs already handed out.
+// This is true well before then, so queued draws can be finished and ClearJitCache() called.
+bool JitCacheFull();
+void ClearJitCache();
+
+bool DescribeCodePtr(const u8 *ptr, std::string &name);
+
+#if PPSSPP_ARCH(ARM)
+class PixelJitCache : public ArmGen::ARMXCodeBlock {
+#elif PPSSPP_ARCH(ARM64)
+class PixelJitCache : public Arm64Gen::ARM64CodeBlock {
+#elif PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+class PixelJitCache : public Gen::XCodeBlock {
+#elif PPSSPP_ARCH(MIPS)
+class PixelJitCache : public MIPSGen::MIPSCodeBlock {
+#else
+class PixelJitCache : public FakeGen::FakeXCodeBlock {
+#endif
+public:
+	PixelJitCache();
+
+	void ComputePixelFuncID(PixelFuncID *id_out);
+
+	// Returns a pointer to the code to run, or nullptr if the state isn't supported.
+	SingleFunc GetSingle(const PixelFuncID &id);
+	void Clear();
+
+	std::string DescribeCodePtr(const u8 *ptr);
+	std::string DescribePixelFuncID(const PixelFuncID &id);
+
+private:
+	SingleFunc CompileSingle(const PixelFuncID &id);
+
+#if PPSSPP_ARCH(AMD64)
+	void LoadGState(Gen::X64Reg dest, const u32 *field);
+	Gen::OpArg ConstArg(const void *ptr);
+	void Jit_CompareTest(GEComparison func, std::vector<Gen::FixupBranch> &failures);
+	bool Jit_DepthRange(const PixelFuncID &id);
+	bool Jit_CalculateAddresses(const PixelFuncID &id);
+	bool Jit_AlphaTest(const PixelFuncID &id);
+	bool Jit_ApplyFog(const PixelFuncID &id);
+	bool Jit_ColorTest(const PixelFuncID &id);
+	bool Jit_ReadColor(const PixelFuncID &id);
+	bool Jit_StencilAndDepthTest(const PixelFuncID &id);
+	bool Jit_StencilFailure(const PixelFuncID &id, std::vector<Gen::FixupBranch> &failures, GEStencilOp op);
+	bool Jit_ApplyStencilOp(const PixelFuncID &id, GEStencilOp op);
+	bool Jit_WriteStencilOnly(const PixelFuncID &id);
+	bool Jit_BlendFactor(const PixelFuncID &id, Gen::X64Reg factorReg, int factor, bool isSrc);
+	bool Jit_AlphaBlend(const PixelFuncID &id);
+	bool Jit_PackColor(const PixelFuncID &id);
+	bool Jit_LogicOp(const PixelFuncID &id);
+	bool Jit_WriteColor(const PixelFuncID &id);
+
+	std::vector<Gen::FixupBranch> discards_;
+#endif
+
+	std::unordered_map<PixelFuncID, SingleFunc> cache_;
+	std::unordered_map<PixelFuncID, const u8 *> addresses_;
+};
+
+inline u32 GetPixelColor(const GPUgstate &regs, int x, int y) {
+	switch (regs.FrameBufFormat()) {
+	case GE_FORMAT_565:
+		return RGB565ToRGBA8888(fb.Get16(x, y, regs.FrameBufStride()));
+
+	case GE_FORMAT_5551:
+		return RGBA5551ToRGBA8888(fb.Get16(x, y, regs.FrameBufStride()));
+
+	case GE_FORMAT_4444:
+		return RGBA4444ToRGBA8888(fb.Get16(x, y, regs.FrameBufStride()));
+
+	case GE_FORMAT_8888:
+		return fb.Get32(x, y, regs.FrameBufStride());
+
+	case GE_FORMAT_INVALID:
+		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
+	}
+	return 0;
+}
+
+inline void SetPixelColor(const GPUgstate &regs, int x, int y, u32 value) {
+	switch (regs.FrameBufFormat()) {
+	case GE_FORMAT_565:
+		fb.Set16(x, y, regs.FrameBufStride(), RGBA8888ToRGB565(value));
+		break;
+
+	case GE_FORMAT_5551:
+		fb.Set16(x, y, regs.FrameBufStride(), RGBA8888ToRGBA5551(value));
+		break;
+
+	case GE_FORMAT_4444:
+		fb.Set16(x, y, regs.FrameBufStride(), RGBA8888ToRGBA4444(value));
+		break;
+
+	case GE_FORMAT_8888:
+		fb.Set32(x, y, regs.FrameBufStride(), value);
+		break;
+
+	case GE_FORMAT_INVALID:
+		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
+	}
+}
+
+inline u16 GetPixelDepth(const GPUgstate &regs, int x, int y) {
+	return depthbuf.Get16(x, y, regs.DepthBufStride());
+}
+
+inline void SetPixelDepth(const GPUgstate &regs, int x, int y, u16 value) {
+	depthbuf.Set16(x, y, regs.DepthBufStride(), value);
+}
+
+inline u8 GetPixelStencil(const GPUgstate &regs, int x, int y) {
+	if (regs.FrameBufFormat() == GE_FORMAT_565) {
+		// Always treated as 0 for comparison purposes.
+		return 0;
+	} else if (regs.FrameBufFormat() == GE_FORMAT_5551) {
+		return ((fb.Get16(x, y, regs.FrameBufStride()) & 0x8000) != 0) ? 0xFF : 0;
+	} else if (regs.FrameBufFormat() == GE_FORMAT_4444) {
+		return Convert4To8(fb.Get16(x, y, regs.FrameBufStride()) >> 12);
+	} else {
+		return fb.Get32(x, y, regs.FrameBufStride()) >> 24;
+	}
+}
+
+inline void SetPixelStencil(const GPUgstate &regs, int x, int y, u8 value) {
+	// TODO: This seems like it maybe respects the alpha mask (at least in some scenarios?)
+
+	if (regs.FrameBufFormat() == GE_FORMAT_565) {
+		// Do nothing
+	} else if (regs.FrameBufFormat() == GE_FORMAT_5551) {
+		u16 pixel = fb.Get16(x, y, regs.FrameBufStride()) & ~0x8000;
+		pixel |= value != 0 ? 0x8000 : 0;
+		fb.Set16(x, y, regs.FrameBufStride(), pixel);
+	} else if (regs.FrameBufFormat() == GE_FORMAT_4444) {
+		u16 pixel = fb.Get16(x, y, regs.FrameBufStride()) & ~0xF000;
+		pixel |= (u16)value << 12;
+		fb.Set16(x, y, regs.FrameBufStride(), pixel);
+	} else {
+		u32 pixel = fb.Get32(x, y, regs.FrameBufStride()) & ~0xFF000000;
+		pixel |= (u32)value << 24;
+		fb.Set32(x, y, regs.FrameBufStride(), pixel);
+	}
+}
+
+};
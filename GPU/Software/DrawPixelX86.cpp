@@ -0,0 +1,834 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+#if PPSSPP_ARCH(AMD64)
+
+#include <cstddef>
+#include <emmintrin.h>
+#include "Common/x64Emitter.h"
+#include "Common/CPUDetect.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/SoftGpu.h"
+#include "GPU/ge_constants.h"
+
+using namespace Gen;
+
+namespace Rasterizer {
+
+#ifdef _WIN32
+static const X64Reg argXReg = RCX;
+static const X64Reg argYReg = RDX;
+static const X64Reg argZReg = R8;
+static const X64Reg argFogReg = R9;
+// The color and state pointers are on the stack.
+#else
+static const X64Reg argXReg = RDI;
+static const X64Reg argYReg = RSI;
+static const X64Reg argZReg = RDX;
+static const X64Reg argFogReg = RCX;
+static const X64Reg argColorReg = R8;
+static const X64Reg argStateReg = R9;
+#endif
+
+// Only caller saved registers are used, so there's nothing to push.
+static const X64Reg tempReg1 = RAX;
+static const X64Reg fbPtrReg = R10;
+static const X64Reg depthPtrReg = R11;
+// Once the addresses are calculated, x and y are free.
+static const X64Reg tempReg2 = argXReg;
+static const X64Reg tempReg3 = argYReg;
+// After it's read, the old color (as 8888) stays here.
+static const X64Reg oldColorReg = tempReg3;
+// Likewise, fog is only needed until it's applied.
+static const X64Reg stencilReg = argFogReg;
+
+// XMM0 holds the primitive color (as ints) throughout, and XMM1 the old color when blending.
+static const X64Reg primColorReg = XMM0;
+static const X64Reg dstColorReg = XMM1;
+
+alignas(16) static const int const255[4] = { 255, 255, 255, 255 };
+alignas(16) static const int const1[4] = { 1, 1, 1, 1 };
+alignas(16) static const float by255[4] = { 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f };
+
+static bool NeedsOldColor(const PixelFuncID &id) {
+	if (id.alphaBlend || id.applyLogicOp || id.applyColorWriteMask)
+		return true;
+	if (id.clearMode)
+		return !id.colorClear || !id.stencilClear;
+	// Otherwise, it's needed for stencil (which 565 doesn't have.)
+	return id.fbFormat != GE_FORMAT_565;
+}
+
+SingleFunc PixelJitCache::CompileSingle(const PixelFuncID &id) {
+	// Invalid blend equations are left to the fallback, which reports them.
+	if (!cpu_info.bSSE4_1)
+		return nullptr;
+	if (id.alphaBlend && id.alphaBlendEq > GE_BLENDMODE_ABSDIFF)
+		return nullptr;
+
+	BeginWrite();
+	const u8 *start = AlignCode16();
+	discards_.clear();
+
+	// Start by loading and clamping the color.
+#ifdef _WIN32
+	MOV(PTRBITS, R(tempReg1), MDisp(RSP, 40));
+	MOVDQU(primColorReg, MatR(tempReg1));
+#else
+	MOVDQU(primColorReg, MatR(argColorReg));
+#endif
+	PXOR(XMM1, R(XMM1));
+	PMAXSD(primColorReg, R(XMM1));
+	PMINSD(primColorReg, ConstArg(const255));
+
+	bool success = true;
+	success = success && Jit_DepthRange(id);
+	success = success && Jit_CalculateAddresses(id);
+	success = success && Jit_AlphaTest(id);
+	success = success && Jit_ApplyFog(id);
+	success = success && Jit_ColorTest(id);
+	success = success && Jit_ReadColor(id);
+	success = success && Jit_StencilAndDepthTest(id);
+	success = success && Jit_AlphaBlend(id);
+	success = success && Jit_PackColor(id);
+	success = success && Jit_LogicOp(id);
+	success = success && Jit_WriteColor(id);
+
+	if (!success) {
+		discards_.clear();
+		EndWrite();
+		SetCodePtr(const_cast<u8 *>(start));
+		return nullptr;
+	}
+
+	for (FixupBranch &discard : discards_) {
+		SetJumpTarget(discard);
+	}
+	discards_.clear();
+
+	RET();
+
+	EndWrite();
+	return (SingleFunc)start;
+}
+
+// Reads the same register from the state's copy, rather than the live gstate.
+void PixelJitCache::LoadGState(X64Reg dest, const u32 *field) {
+	const int offset = (int)(offsetof(RasterizerState, regs) + ((const u8 *)field - (const u8 *)&gstate));
+#ifdef _WIN32
+	MOV(PTRBITS, R(dest), MDisp(RSP, 48));
+	MOV(32, R(dest), MDisp(dest, offset));
+#else
+	MOV(32, R(dest), MDisp(argStateReg, offset));
+#endif
+}
+
+// Note: may clobber tempReg1.
+OpArg PixelJitCache::ConstArg(const void *ptr) {
+	if (RipAccessible(ptr)) {
+		return M(ptr);
+	}
+	MOV(PTRBITS, R(tempReg1), ImmPtr(ptr));
+	return MatR(tempReg1);
+}
+
+// Expects the flags from CMP(left, right), and fails unless "left func right".
+void PixelJitCache::Jit_CompareTest(GEComparison func, std::vector<FixupBranch> &failures) {
+	switch (func) {
+	case GE_COMP_NEVER:
+		failures.push_back(J(true));
+		break;
+
+	case GE_COMP_ALWAYS:
+		break;
+
+	case GE_COMP_EQUAL:
+		failures.push_back(J_CC(CC_NE, true));
+		break;
+
+	case GE_COMP_NOTEQUAL:
+		failures.push_back(J_CC(CC_E, true));
+		break;
+
+	case GE_COMP_LESS:
+		failures.push_back(J_CC(CC_AE, true));
+		break;
+
+	case GE_COMP_LEQUAL:
+		failures.push_back(J_CC(CC_A, true));
+		break;
+
+	case GE_COMP_GREATER:
+		failures.push_back(J_CC(CC_BE, true));
+		break;
+
+	case GE_COMP_GEQUAL:
+		failures.push_back(J_CC(CC_B, true));
+		break;
+	}
+}
+
+bool PixelJitCache::Jit_DepthRange(const PixelFuncID &id) {
+	if (!id.applyDepthRange)
+		return true;
+
+	LoadGState(tempReg1, &gstate.minz);
+	MOVZX(32, 16, tempReg1, R(tempReg1));
+	CMP(32, R(argZReg), R(tempReg1));
+	discards_.push_back(J_CC(CC_L, true));
+
+	LoadGState(tempReg1, &gstate.maxz);
+	MOVZX(32, 16, tempReg1, R(tempReg1));
+	CMP(32, R(argZReg), R(tempReg1));
+	discards_.push_back(J_CC(CC_G, true));
+	return true;
+}
+
+bool PixelJitCache::Jit_CalculateAddresses(const PixelFuncID &id) {
+	// fbPtrReg = fb.data + (y * stride + x) * bpp.
+	LoadGState(tempReg1, &gstate.fbwidth);
+	AND(32, R(tempReg1), Imm32(0x7FC));
+	IMUL(32, tempReg1, R(argYReg));
+	ADD(32, R(tempReg1), R(argXReg));
+	MOV(PTRBITS, R(fbPtrReg), ImmPtr(&fb.data));
+	MOV(PTRBITS, R(fbPtrReg), MatR(fbPtrReg));
+	LEA(PTRBITS, fbPtrReg, MComplex(fbPtrReg, tempReg1, id.fbFormat == GE_FORMAT_8888 ? SCALE_4 : SCALE_2, 0));
+
+	bool needsDepth = id.depthTestFunc != GE_COMP_ALWAYS || id.depthWrite || (id.clearMode && id.depthClear);
+	if (needsDepth) {
+		LoadGState(tempReg1, &gstate.zbwidth);
+		AND(32, R(tempReg1), Imm32(0x7FC));
+		IMUL(32, tempReg1, R(argYReg));
+		ADD(32, R(tempReg1), R(argXReg));
+		MOV(PTRBITS, R(depthPtrReg), ImmPtr(&depthbuf.data));
+		MOV(PTRBITS, R(depthPtrReg), MatR(depthPtrReg));
+		LEA(PTRBITS, depthPtrReg, MComplex(depthPtrReg, tempReg1, SCALE_2, 0));
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_AlphaTest(const PixelFuncID &id) {
+	if (id.alphaTestFunc == GE_COMP_ALWAYS)
+		return true;
+
+	PSHUFD(XMM1, R(primColorReg), _MM_SHUFFLE(3, 3, 3, 3));
+	MOVD_xmm(R(tempReg2), XMM1);
+
+	// The mask is in the third byte, the ref in the second.
+	LoadGState(tempReg1, &gstate.alphatest);
+	MOV(32, R(tempReg3), R(tempReg1));
+	SHR(32, R(tempReg3), Imm8(16));
+	AND(32, R(tempReg3), Imm32(0xFF));
+	SHR(32, R(tempReg1), Imm8(8));
+	AND(32, R(tempReg1), R(tempReg3));
+	AND(32, R(tempReg2), R(tempReg3));
+
+	CMP(32, R(tempReg2), R(tempReg1));
+	Jit_CompareTest((GEComparison)id.alphaTestFunc, discards_);
+	return true;
+}
+
+bool PixelJitCache::Jit_ApplyFog(const PixelFuncID &id) {
+	if (!id.applyFog)
+		return true;
+
+	// rgb = (rgb * fog + fogcolor * (255 - fog)) / 255.  All products fit in the low 16 bits.
+	MOVD_xmm(XMM1, R(argFogReg));
+	PSHUFD(XMM1, R(XMM1), _MM_SHUFFLE(0, 0, 0, 0));
+	MOVDQA(XMM3, ConstArg(const255));
+	PSUBD(XMM3, R(XMM1));
+
+	// The top byte is the command, but we throw away that lane anyway.
+	LoadGState(tempReg1, &gstate.fogcolor);
+	MOVD_xmm(XMM2, R(tempReg1));
+	PMOVZXBD(XMM2, R(XMM2));
+	PMULLW(XMM2, R(XMM3));
+
+	MOVDQA(XMM4, R(primColorReg));
+	PMULLW(XMM4, R(XMM1));
+	PADDD(XMM4, R(XMM2));
+
+	// Exact for 0 - 255*255: (x + 1 + (x >> 8)) >> 8.
+	MOVDQA(XMM2, R(XMM4));
+	PSRLD(XMM2, 8);
+	PADDD(XMM4, R(XMM2));
+	PADDD(XMM4, ConstArg(const1));
+	PSRLD(XMM4, 8);
+
+	// Now keep the original alpha, and take rgb from the result.
+	PSLLDQ(XMM4, 4);
+	PSRLDQ(XMM4, 4);
+	PSRLDQ(primColorReg, 12);
+	PSLLDQ(primColorReg, 12);
+	POR(primColorReg, R(XMM4));
+	return true;
+}
+
+bool PixelJitCache::Jit_ColorTest(const PixelFuncID &id) {
+	if (id.colorTestFunc == GE_COMP_ALWAYS)
+		return true;
+
+	MOVDQA(XMM1, R(primColorReg));
+	PACKSSDW(XMM1, R(XMM1));
+	PACKUSWB(XMM1, R(XMM1));
+	MOVD_xmm(R(tempReg2), XMM1);
+
+	// This also drops the alpha.
+	LoadGState(tempReg3, &gstate.colortestmask);
+	AND(32, R(tempReg3), Imm32(0x00FFFFFF));
+	AND(32, R(tempReg2), R(tempReg3));
+	LoadGState(tempReg1, &gstate.colorref);
+	AND(32, R(tempReg1), R(tempReg3));
+
+	CMP(32, R(tempReg2), R(tempReg1));
+	Jit_CompareTest((GEComparison)id.colorTestFunc, discards_);
+	return true;
+}
+
+bool PixelJitCache::Jit_ReadColor(const PixelFuncID &id) {
+	if (!NeedsOldColor(id)) {
+		if (!id.clearMode)
+			XOR(32, R(stencilReg), R(stencilReg));
+		return true;
+	}
+
+	// Like Convert5To8() etc., multiplying replicates the top bits into the bottom.
+	auto expandChannel = [&](int shift, int bits, int destShift) {
+		MOV(32, R(tempReg2), R(tempReg1));
+		if (shift != 0)
+			SHR(32, R(tempReg2), Imm8(shift));
+		AND(32, R(tempReg2), Imm32((1 << bits) - 1));
+		IMUL(32, tempReg2, R(tempReg2), Imm32(bits == 4 ? 0x11 : (bits == 5 ? 0x21 : 0x41)));
+		if (bits != 4)
+			SHR(32, R(tempReg2), Imm8(2 * bits - 8));
+		if (destShift != 0)
+			SHL(32, R(tempReg2), Imm8(destShift));
+		OR(32, R(oldColorReg), R(tempReg2));
+	};
+
+	switch (id.fbFormat) {
+	case GE_FORMAT_565:
+		MOVZX(32, 16, tempReg1, MatR(fbPtrReg));
+		MOV(32, R(oldColorReg), Imm32(0xFF000000));
+		expandChannel(0, 5, 0);
+		expandChannel(5, 6, 8);
+		expandChannel(11, 5, 16);
+		break;
+
+	case GE_FORMAT_5551:
+		MOVZX(32, 16, tempReg1, MatR(fbPtrReg));
+		XOR(32, R(oldColorReg), R(oldColorReg));
+		expandChannel(0, 5, 0);
+		expandChannel(5, 5, 8);
+		expandChannel(10, 5, 16);
+		// Spread the top bit over the alpha byte.
+		MOV(32, R(tempReg2), R(tempReg1));
+		SHL(32, R(tempReg2), Imm8(16));
+		SAR(32, R(tempReg2), Imm8(7));
+		AND(32, R(tempReg2), Imm32(0xFF000000));
+		OR(32, R(oldColorReg), R(tempReg2));
+		break;
+
+	case GE_FORMAT_4444:
+		MOVZX(32, 16, tempReg1, MatR(fbPtrReg));
+		XOR(32, R(oldColorReg), R(oldColorReg));
+		expandChannel(0, 4, 0);
+		expandChannel(4, 4, 8);
+		expandChannel(8, 4, 16);
+		expandChannel(12, 4, 24);
+		break;
+
+	case GE_FORMAT_8888:
+		MOV(32, R(oldColorReg), MatR(fbPtrReg));
+		break;
+
+	default:
+		return false;
+	}
+
+	// The old alpha matches GetPixelStencil(), except for 565 which has no stencil.
+	if (!id.clearMode) {
+		if (id.fbFormat == GE_FORMAT_565) {
+			XOR(32, R(stencilReg), R(stencilReg));
+		} else {
+			MOV(32, R(stencilReg), R(oldColorReg));
+			SHR(32, R(stencilReg), Imm8(24));
+		}
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_StencilAndDepthTest(const PixelFuncID &id) {
+	if (id.clearMode) {
+		if (id.depthClear)
+			MOV(16, MatR(depthPtrReg), R(argZReg));
+		return true;
+	}
+
+	bool success = true;
+	if (id.stencilTestFunc != GE_COMP_ALWAYS) {
+		// Compares (ref & mask) against (stencil & mask.)
+		LoadGState(tempReg1, &gstate.stenciltest);
+		MOV(32, R(tempReg2), R(tempReg1));
+		SHR(32, R(tempReg2), Imm8(16));
+		AND(32, R(tempReg2), Imm32(0xFF));
+		SHR(32, R(tempReg1), Imm8(8));
+		AND(32, R(tempReg1), R(tempReg2));
+		AND(32, R(tempReg2), R(stencilReg));
+
+		CMP(32, R(tempReg1), R(tempReg2));
+		std::vector<FixupBranch> failures;
+		Jit_CompareTest((GEComparison)id.stencilTestFunc, failures);
+		success = success && Jit_StencilFailure(id, failures, (GEStencilOp)id.sFail);
+	}
+
+	if (id.depthTestFunc != GE_COMP_ALWAYS) {
+		MOVZX(32, 16, tempReg1, MatR(depthPtrReg));
+		CMP(32, R(argZReg), R(tempReg1));
+		std::vector<FixupBranch> failures;
+		Jit_CompareTest((GEComparison)id.depthTestFunc, failures);
+		success = success && Jit_StencilFailure(id, failures, (GEStencilOp)id.zFail);
+	}
+
+	success = success && Jit_ApplyStencilOp(id, (GEStencilOp)id.zPass);
+
+	if (id.depthWrite)
+		MOV(16, MatR(depthPtrReg), R(argZReg));
+	return success;
+}
+
+bool PixelJitCache::Jit_StencilFailure(const PixelFuncID &id, std::vector<FixupBranch> &failures, GEStencilOp op) {
+	if (failures.empty())
+		return true;
+
+	// Writing back the same stencil value is a no-op for all formats.
+	if (op == GE_STENCILOP_KEEP) {
+		discards_.insert(discards_.end(), failures.begin(), failures.end());
+		return true;
+	}
+
+	FixupBranch skip = J(true);
+	for (FixupBranch &failure : failures) {
+		SetJumpTarget(failure);
+	}
+
+	bool success = Jit_ApplyStencilOp(id, op);
+	success = success && Jit_WriteStencilOnly(id);
+	discards_.push_back(J(true));
+
+	SetJumpTarget(skip);
+	return success;
+}
+
+bool PixelJitCache::Jit_ApplyStencilOp(const PixelFuncID &id, GEStencilOp op) {
+	FixupBranch skip;
+	switch (op) {
+	case GE_STENCILOP_KEEP:
+		break;
+
+	case GE_STENCILOP_ZERO:
+		XOR(32, R(stencilReg), R(stencilReg));
+		break;
+
+	case GE_STENCILOP_REPLACE:
+		// Note: the reference isn't masked.
+		LoadGState(stencilReg, &gstate.stenciltest);
+		SHR(32, R(stencilReg), Imm8(8));
+		AND(32, R(stencilReg), Imm32(0xFF));
+		break;
+
+	case GE_STENCILOP_INVERT:
+		XOR(32, R(stencilReg), Imm32(0xFF));
+		break;
+
+	case GE_STENCILOP_INCR:
+		switch (id.fbFormat) {
+		case GE_FORMAT_8888:
+			CMP(32, R(stencilReg), Imm32(0xFF));
+			skip = J_CC(CC_E);
+			ADD(32, R(stencilReg), Imm8(1));
+			SetJumpTarget(skip);
+			break;
+
+		case GE_FORMAT_5551:
+			MOV(32, R(stencilReg), Imm32(0xFF));
+			break;
+
+		case GE_FORMAT_4444:
+			CMP(32, R(stencilReg), Imm32(0xF0));
+			skip = J_CC(CC_AE);
+			ADD(32, R(stencilReg), Imm8(0x10));
+			SetJumpTarget(skip);
+			break;
+
+		default:
+			break;
+		}
+		break;
+
+	case GE_STENCILOP_DECR:
+		if (id.fbFormat == GE_FORMAT_4444) {
+			CMP(32, R(stencilReg), Imm8(0x10));
+			skip = J_CC(CC_B);
+			SUB(32, R(stencilReg), Imm8(0x10));
+			SetJumpTarget(skip);
+		} else {
+			TEST(32, R(stencilReg), R(stencilReg));
+			skip = J_CC(CC_Z);
+			SUB(32, R(stencilReg), Imm8(1));
+			SetJumpTarget(skip);
+		}
+		break;
+
+	default:
+		return false;
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_WriteStencilOnly(const PixelFuncID &id) {
+	FixupBranch skip;
+	switch (id.fbFormat) {
+	case GE_FORMAT_565:
+		break;
+
+	case GE_FORMAT_5551:
+		MOVZX(32, 16, tempReg1, MatR(fbPtrReg));
+		AND(32, R(tempReg1), Imm32(0x7FFF));
+		TEST(32, R(stencilReg), R(stencilReg));
+		skip = J_CC(CC_Z);
+		OR(32, R(tempReg1), Imm32(0x8000));
+		SetJumpTarget(skip);
+		MOV(16, MatR(fbPtrReg), R(tempReg1));
+		break;
+
+	case GE_FORMAT_4444:
+		// Same as SetPixelStencil(), only the low 4 bits of the value survive.
+		MOVZX(32, 16, tempReg1, MatR(fbPtrReg));
+		AND(32, R(tempReg1), Imm32(0x0FFF));
+		MOV(32, R(tempReg2), R(stencilReg));
+		SHL(32, R(tempReg2), Imm8(12));
+		OR(32, R(tempReg1), R(tempReg2));
+		MOV(16, MatR(fbPtrReg), R(tempReg1));
+		break;
+
+	case GE_FORMAT_8888:
+		MOV(8, MDisp(fbPtrReg, 3), R(stencilReg));
+		break;
+
+	default:
+		return false;
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_BlendFactor(const PixelFuncID &id, X64Reg factorReg, int factor, bool isSrc) {
+	// The src and dst factors are the same, except for the first two and the fixed color.
+	switch (factor) {
+	case GE_SRCBLEND_DSTCOLOR:
+		MOVDQA(factorReg, R(isSrc ? dstColorReg : primColorReg));
+		break;
+
+	case GE_SRCBLEND_INVDSTCOLOR:
+		MOVDQA(factorReg, ConstArg(const255));
+		PSUBD(factorReg, R(isSrc ? dstColorReg : primColorReg));
+		break;
+
+	case GE_SRCBLEND_SRCALPHA:
+	case GE_SRCBLEND_INVSRCALPHA:
+	case GE_SRCBLEND_DSTALPHA:
+	case GE_SRCBLEND_INVDSTALPHA:
+	case GE_SRCBLEND_DOUBLESRCALPHA:
+	case GE_SRCBLEND_DOUBLEINVSRCALPHA:
+	case GE_SRCBLEND_DOUBLEDSTALPHA:
+	case GE_SRCBLEND_DOUBLEINVDSTALPHA:
+	{
+		bool useSrc = ((factor - GE_SRCBLEND_SRCALPHA) & 2) == 0;
+		bool doubled = factor >= GE_SRCBLEND_DOUBLESRCALPHA;
+		bool inverted = (factor & 1) != 0;
+
+		PSHUFD(XMM5, R(useSrc ? primColorReg : dstColorReg), _MM_SHUFFLE(3, 3, 3, 3));
+		if (doubled)
+			PADDD(XMM5, R(XMM5));
+		if (inverted) {
+			if (doubled)
+				PMINSD(XMM5, ConstArg(const255));
+			MOVDQA(factorReg, ConstArg(const255));
+			PSUBD(factorReg, R(XMM5));
+		} else {
+			MOVDQA(factorReg, R(XMM5));
+		}
+		break;
+	}
+
+	default:
+		// FIXA/FIXB, which the ID uses for everything above.
+		LoadGState(tempReg1, isSrc ? &gstate.blendfixa : &gstate.blendfixb);
+		MOVD_xmm(factorReg, R(tempReg1));
+		PMOVZXBD(factorReg, R(factorReg));
+		break;
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_AlphaBlend(const PixelFuncID &id) {
+	if (!id.alphaBlend)
+		return true;
+
+	MOVD_xmm(dstColorReg, R(oldColorReg));
+	PMOVZXBD(dstColorReg, R(dstColorReg));
+
+	bool success = true;
+	switch (id.alphaBlendEq) {
+	case GE_BLENDMODE_MUL_AND_ADD:
+	case GE_BLENDMODE_MUL_AND_SUBTRACT:
+	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
+		// This is done in float to match the fallback exactly.
+		success = success && Jit_BlendFactor(id, XMM2, id.alphaBlendSrc, true);
+		success = success && Jit_BlendFactor(id, XMM3, id.alphaBlendDst, false);
+		CVTDQ2PS(XMM2, R(XMM2));
+		CVTDQ2PS(XMM4, R(primColorReg));
+		MULPS(XMM2, R(XMM4));
+		CVTDQ2PS(XMM3, R(XMM3));
+		CVTDQ2PS(XMM4, R(dstColorReg));
+		MULPS(XMM3, R(XMM4));
+
+		if (id.alphaBlendEq == GE_BLENDMODE_MUL_AND_ADD) {
+			ADDPS(XMM2, R(XMM3));
+		} else if (id.alphaBlendEq == GE_BLENDMODE_MUL_AND_SUBTRACT) {
+			SUBPS(XMM2, R(XMM3));
+		} else {
+			SUBPS(XMM3, R(XMM2));
+			MOVAPS(XMM2, R(XMM3));
+		}
+		MULPS(XMM2, ConstArg(by255));
+		CVTPS2DQ(primColorReg, R(XMM2));
+		break;
+
+	case GE_BLENDMODE_MIN:
+		PMINSD(primColorReg, R(dstColorReg));
+		break;
+
+	case GE_BLENDMODE_MAX:
+		PMAXSD(primColorReg, R(dstColorReg));
+		break;
+
+	case GE_BLENDMODE_ABSDIFF:
+		MOVDQA(XMM2, R(primColorReg));
+		PMAXSD(XMM2, R(dstColorReg));
+		PMINSD(primColorReg, R(dstColorReg));
+		PSUBD(XMM2, R(primColorReg));
+		MOVDQA(primColorReg, R(XMM2));
+		break;
+
+	default:
+		return false;
+	}
+	return success;
+}
+
+bool PixelJitCache::Jit_PackColor(const PixelFuncID &id) {
+	// This saturates just like ToRGB(), and leaves the new color in tempReg1.
+	PACKSSDW(primColorReg, R(primColorReg));
+	PACKUSWB(primColorReg, R(primColorReg));
+	MOVD_xmm(R(tempReg1), primColorReg);
+
+	// In clear mode, the alpha is the new stencil value, so we're done.
+	if (!id.clearMode) {
+		AND(32, R(tempReg1), Imm32(0x00FFFFFF));
+		MOV(32, R(tempReg2), R(stencilReg));
+		SHL(32, R(tempReg2), Imm8(24));
+		OR(32, R(tempReg1), R(tempReg2));
+	}
+	return true;
+}
+
+bool PixelJitCache::Jit_LogicOp(const PixelFuncID &id) {
+	if (!id.applyLogicOp || id.logicOp == GE_LOGIC_COPY)
+		return true;
+
+	// Calculate the rgb result in tempReg2, alpha (stencil) is always kept.
+	switch (id.logicOp) {
+	case GE_LOGIC_CLEAR:
+		XOR(32, R(tempReg2), R(tempReg2));
+		break;
+
+	case GE_LOGIC_AND:
+		MOV(32, R(tempReg2), R(tempReg1));
+		AND(32, R(tempReg2), R(oldColorReg));
+		break;
+
+	case GE_LOGIC_AND_REVERSE:
+		MOV(32, R(tempReg2), R(oldColorReg));
+		NOT(32, R(tempReg2));
+		AND(32, R(tempReg2), R(tempReg1));
+		break;
+
+	case GE_LOGIC_AND_INVERTED:
+		MOV(32, R(tempReg2), R(tempReg1));
+		NOT(32, R(tempReg2));
+		AND(32, R(tempReg2), R(oldColorReg));
+		break;
+
+	case GE_LOGIC_NOOP:
+		MOV(32, R(tempReg2), R(oldColorReg));
+		break;
+
+	case GE_LOGIC_XOR:
+		MOV(32, R(tempReg2), R(tempReg1));
+		XOR(32, R(tempReg2), R(oldColorReg));
+		break;
+
+	case GE_LOGIC_OR:
+		MOV(32, R(tempReg2), R(tempReg1));
+		OR(32, R(tempReg2), R(oldColorReg));
+		break;
+
+	case GE_LOGIC_NOR:
+		MOV(32, R(tempReg2), R(tempReg1));
+		OR(32, R(tempReg2), R(oldColorReg));
+		NOT(32, R(tempReg2));
+		break;
+
+	case GE_LOGIC_EQUIV:
+		MOV(32, R(tempReg2), R(tempReg1));
+		XOR(32, R(tempReg2), R(oldColorReg));
+		NOT(32, R(tempReg2));
+		break;
+
+	case GE_LOGIC_INVERTED:
+		MOV(32, R(tempReg2), R(oldColorReg));
+		NOT(32, R(tempReg2));
+		break;
+
+	case GE_LOGIC_OR_REVERSE:
+		MOV(32, R(tempReg2), R(oldColorReg));
+		NOT(32, R(tempReg2));
+		OR(32, R(tempReg2), R(tempReg1));
+		break;
+
+	case GE_LOGIC_COPY_INVERTED:
+		MOV(32, R(tempReg2), R(tempReg1));
+		NOT(32, R(tempReg2));
+		break;
+
+	case GE_LOGIC_OR_INVERTED:
+		MOV(32, R(tempReg2), R(tempReg1));
+		NOT(32, R(tempReg2));
+		OR(32, R(tempReg2), R(oldColorReg));
+		break;
+
+	case GE_LOGIC_NAND:
+		MOV(32, R(tempReg2), R(tempReg1));
+		AND(32, R(tempReg2), R(oldColorReg));
+		NOT(32, R(tempReg2));
+		break;
+
+	case GE_LOGIC_SET:
+		MOV(32, R(tempReg2), Imm32(0xFFFFFFFF));
+		break;
+
+	default:
+		return false;
+	}
+
+	AND(32, R(tempReg1), Imm32(0xFF000000));
+	AND(32, R(tempReg2), Imm32(0x00FFFFFF));
+	OR(32, R(tempReg1), R(tempReg2));
+	return true;
+}
+
+bool PixelJitCache::Jit_WriteColor(const PixelFuncID &id) {
+	if (id.clearMode) {
+		// Keep the bits that aren't being cleared.
+		u32 keepMask = (id.colorClear ? 0 : 0x00FFFFFF) | (id.stencilClear ? 0 : 0xFF000000);
+		if (keepMask == 0xFFFFFFFF) {
+			MOV(32, R(tempReg1), R(oldColorReg));
+		} else if (keepMask != 0) {
+			MOV(32, R(tempReg2), R(oldColorReg));
+			AND(32, R(tempReg2), Imm32(keepMask));
+			AND(32, R(tempReg1), Imm32(~keepMask));
+			OR(32, R(tempReg1), R(tempReg2));
+		}
+	}
+
+	if (id.applyColorWriteMask) {
+		// Same as gstate.getColorMask(), stencil is free by now.
+		LoadGState(tempReg2, &gstate.pmska);
+		SHL(32, R(tempReg2), Imm8(24));
+		LoadGState(stencilReg, &gstate.pmskc);
+		AND(32, R(stencilReg), Imm32(0x00FFFFFF));
+		OR(32, R(tempReg2), R(stencilReg));
+
+		// new ^= (new ^ old) & mask, which takes the masked bits from old.
+		MOV(32, R(stencilReg), R(tempReg1));
+		XOR(32, R(stencilReg), R(oldColorReg));
+		AND(32, R(stencilReg), R(tempReg2));
+		XOR(32, R(tempReg1), R(stencilReg));
+	}
+
+	// Converting to 16-bit is just moving the top bits of each channel into place.
+	auto packChannel = [&](int shift, u32 mask) {
+		MOV(32, R(stencilReg), R(tempReg1));
+		SHR(32, R(stencilReg), Imm8(shift));
+		AND(32, R(stencilReg), Imm32(mask));
+		OR(32, R(tempReg2), R(stencilReg));
+	};
+
+	switch (id.fbFormat) {
+	case GE_FORMAT_565:
+		XOR(32, R(tempReg2), R(tempReg2));
+		packChannel(3, 0x001F);
+		packChannel(5, 0x07E0);
+		packChannel(8, 0xF800);
+		MOV(16, MatR(fbPtrReg), R(tempReg2));
+		break;
+
+	case GE_FORMAT_5551:
+		XOR(32, R(tempReg2), R(tempReg2));
+		packChannel(3, 0x001F);
+		packChannel(6, 0x03E0);
+		packChannel(9, 0x7C00);
+		packChannel(16, 0x8000);
+		MOV(16, MatR(fbPtrReg), R(tempReg2));
+		break;
+
+	case GE_FORMAT_4444:
+		XOR(32, R(tempReg2), R(tempReg2));
+		packChannel(4, 0x000F);
+		packChannel(8, 0x00F0);
+		packChannel(12, 0x0F00);
+		packChannel(16, 0xF000);
+		MOV(16, MatR(fbPtrReg), R(tempReg2));
+		break;
+
+	case GE_FORMAT_8888:
+		MOV(32, MatR(fbPtrReg), R(tempReg1));
+		break;
+
+	default:
+		return false;
+	}
+	return true;
+}
+
+};
+
+#endif
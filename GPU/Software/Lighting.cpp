@@ -21,24 +21,62 @@
 
 namespace Lighting {
 
-void Process(VertexData& vertex, bool hasColor)
+static inline Vec3<float> ReadLightVector(const u32 *data, int light) {
+	return Vec3<float>(getFloat24(data[3 * light]), getFloat24(data[3 * light + 1]), getFloat24(data[3 * light + 2]));
+}
+
+void ComputeState(State *state, bool hasColor) {
+	state->materialupdate = gstate.materialupdate & (hasColor ? 7 : 0);
+	state->materialEmissive = Vec3<float>::FromRGB(gstate.getMaterialEmissive());
+	state->materialAmbient = Vec3<float>::FromRGB(gstate.getMaterialAmbientRGBA());
+	state->materialDiffuse = Vec3<float>::FromRGB(gstate.getMaterialDiffuse());
+	state->materialSpecular = Vec3<float>::FromRGB(gstate.getMaterialSpecular());
+	state->ambientColor = Vec3<float>::FromRGB(gstate.getAmbientRGBA());
+	state->specularCoef = gstate.getMaterialSpecularCoef();
+	state->materialAmbientA = gstate.getMaterialAmbientA();
+	state->ambientA = gstate.getAmbientA();
+	state->enabled = gstate.isLightingEnabled();
+	state->envMap = gstate.getUVGenMode() == GE_TEXMAP_ENVIRONMENT_MAP;
+	state->secondaryColor = gstate.isUsingSecondaryColor();
+
+	for (int light = 0; light < 4; ++light) {
+		State::Light &l = state->lights[light];
+		l.enabled = gstate.isLightChanEnabled(light);
+		l.directional = gstate.isDirectionalLight(light);
+		l.spot = gstate.isSpotLight(light);
+		l.poweredDiffuse = gstate.isUsingPoweredDiffuseLight(light);
+		l.specular = gstate.isUsingSpecularLight(light);
+		l.pos = ReadLightVector(gstate.lpos, light);
+		l.normalizedPos = l.pos.Normalized();
+		l.spotDir = ReadLightVector(gstate.ldir, light).Normalized();
+		l.spotCutoff = getFloat24(gstate.lcutoff[light]);
+		l.spotConv = getFloat24(gstate.lconv[light]);
+		for (int i = 0; i < 3; ++i) {
+			l.att[i] = getFloat24(gstate.latt[3 * light + i]);
+		}
+		l.ambientColor = Vec3<float>::FromRGB(gstate.getLightAmbientColor(light));
+		l.diffuseColor = Vec3<float>::FromRGB(gstate.getDiffuseColor(light));
+		l.specularColor = Vec3<float>::FromRGB(gstate.getSpecularColor(light));
+	}
+}
+
+void Process(VertexData &vertex, const State &state)
 {
-	const int materialupdate = gstate.materialupdate & (hasColor ? 7 : 0);
+	const int materialupdate = state.materialupdate;
 
 	Vec3<float> vcol0 = vertex.color0.rgb().Cast<float>() * Vec3<float>::AssignToAll(1.0f / 255.0f);
-	Vec3<float> mec = Vec3<float>::FromRGB(gstate.getMaterialEmissive());
+	const Vec3<float> &mec = state.materialEmissive;
 
-	Vec3<float> mac = (materialupdate & 1) ? vcol0 : Vec3<float>::FromRGB(gstate.getMaterialAmbientRGBA());
-	Vec3<float> final_color = mec + mac * Vec3<float>::FromRGB(gstate.getAmbientRGBA());
+	Vec3<float> mac = (materialupdate & 1) ? vcol0 : state.materialAmbient;
+	Vec3<float> final_color = mec + mac * state.ambientColor;
 	Vec3<float> specular_color(0.0f, 0.0f, 0.0f);
 
-	for (unsigned int light = 0; light < 4; ++light) {
-		// Always calculate texture coords from lighting results if environment mapping is active
-		// TODO: Should specular lighting should affect this, too?  Doesn't in GLES.
-		// TODO: Not sure if this really should be done even if lighting is disabled altogether
-		if (gstate.getUVGenMode() == GE_TEXMAP_ENVIRONMENT_MAP) {
-			Vec3<float> L = Vec3<float>(getFloat24(gstate.lpos[3 * light]), getFloat24(gstate.lpos[3 * light + 1]),getFloat24(gstate.lpos[3 * light + 2]));
-			float diffuse_factor = Dot(L.Normalized(), vertex.worldnormal);
+	// Always calculate texture coords from lighting results if environment mapping is active
+	// TODO: Should specular lighting should affect this, too?  Doesn't in GLES.
+	// TODO: Not sure if this really should be done even if lighting is disabled altogether
+	if (state.envMap) {
+		for (unsigned int light = 0; light < 4; ++light) {
+			float diffuse_factor = Dot(state.lights[light].normalizedPos, vertex.worldnormal);
 
 			if (gstate.getUVLS0() == (int)light)
 				vertex.texturecoords.s() = (diffuse_factor + 1.f) / 2.f;
@@ -48,55 +86,48 @@ void Process(VertexData& vertex, bool hasColor)
 		}
 	}
 
-	if (!gstate.isLightingEnabled())
+	if (!state.enabled)
 		return;
 
 	for (unsigned int light = 0; light < 4; ++light) {
-		if (!gstate.isLightChanEnabled(light))
+		const State::Light &l = state.lights[light];
+		if (!l.enabled)
 			continue;
 
 		// L =  vector from vertex to light source
 		// TODO: Should transfer the light positions to world/view space for these calculations?
-		Vec3<float> L = Vec3<float>(getFloat24(gstate.lpos[3 * light]), getFloat24(gstate.lpos[3 * light + 1]),getFloat24(gstate.lpos[3 * light + 2]));
-		if (!gstate.isDirectionalLight(light)) {
+		Vec3<float> L = l.pos;
+		if (!l.directional) {
 			L -= vertex.worldpos;
 		}
 		float d = L.Normalize();
 
-		float lka = getFloat24(gstate.latt[3 * light]);
-		float lkb = getFloat24(gstate.latt[3 * light + 1]);
-		float lkc = getFloat24(gstate.latt[3 * light + 2]);
 		float att = 1.f;
-		if (!gstate.isDirectionalLight(light)) {
-			att = 1.f / (lka + lkb * d + lkc * d * d);
+		if (!l.directional) {
+			att = 1.f / (l.att[0] + l.att[1] * d + l.att[2] * d * d);
 			if (att > 1.f) att = 1.f;
 			if (att < 0.f) att = 0.f;
 		}
 
 		float spot = 1.f;
-		if (gstate.isSpotLight(light)) {
-			Vec3<float> dir = Vec3<float>(getFloat24(gstate.ldir[3 * light]), getFloat24(gstate.ldir[3 * light + 1]),getFloat24(gstate.ldir[3 * light + 2]));
-			float _spot = Dot(dir.Normalized(), L);
-			float cutoff = getFloat24(gstate.lcutoff[light]);
-			if (_spot >= cutoff) {
-				float conv = getFloat24(gstate.lconv[light]);
-				spot = pow(_spot, conv);
+		if (l.spot) {
+			float _spot = Dot(l.spotDir, L);
+			if (_spot >= l.spotCutoff) {
+				spot = pow(_spot, l.spotConv);
 			} else {
 				spot = 0.f;
 			}
 		}
 
 		// ambient lighting
-		Vec3<float> lac = Vec3<float>::FromRGB(gstate.getLightAmbientColor(light));
-		final_color += lac * mac * att * spot;
+		final_color += l.ambientColor * mac * att * spot;
 
 		// diffuse lighting
-		Vec3<float> ldc = Vec3<float>::FromRGB(gstate.getDiffuseColor(light));
-		Vec3<float> mdc = (materialupdate & 2) ? vcol0 : Vec3<float>::FromRGB(gstate.getMaterialDiffuse());
+		const Vec3<float> &mdc = (materialupdate & 2) ? vcol0 : state.materialDiffuse;
 
 		float diffuse_factor = Dot(L, vertex.worldnormal);
-		if (gstate.isUsingPoweredDiffuseLight(light)) {
-			float k = gstate.getMaterialSpecularCoef();
+		if (l.poweredDiffuse) {
+			float k = state.specularCoef;
 			// TODO: Validate Tales of the World: Radiant Mythology (#2424.)
 			// pow(0.0, 0.0) may be undefined, but the PSP seems to treat it as 1.0.
 			if (diffuse_factor <= 0.0f && k == 0.0f) {
@@ -107,29 +138,27 @@ void Process(VertexData& vertex, bool hasColor)
 		}
 
 		if (diffuse_factor > 0.f) {
-			final_color += ldc * mdc * diffuse_factor * att * spot;
+			final_color += l.diffuseColor * mdc * diffuse_factor * att * spot;
 		}
 
-		if (gstate.isUsingSpecularLight(light)) {
+		if (l.specular) {
 			Vec3<float> H = L + Vec3<float>(0.f, 0.f, 1.f);
 
-			Vec3<float> lsc = Vec3<float>::FromRGB(gstate.getSpecularColor(light));
-			Vec3<float> msc = (materialupdate & 4) ? vcol0 : Vec3<float>::FromRGB(gstate.getMaterialSpecular());
+			const Vec3<float> &msc = (materialupdate & 4) ? vcol0 : state.materialSpecular;
 
 			float specular_factor = Dot(H.Normalized(), vertex.worldnormal);
-			float k = gstate.getMaterialSpecularCoef();
-			specular_factor = pow(specular_factor, k);
+			specular_factor = pow(specular_factor, state.specularCoef);
 
 			if (specular_factor > 0.f) {
-				specular_color += lsc * msc * specular_factor * att * spot;
+				specular_color += l.specularColor * msc * specular_factor * att * spot;
 			}
 		}
 	}
 
-	int maa = (materialupdate & 1) ? vertex.color0.a() : gstate.getMaterialAmbientA();
-	int final_alpha = (gstate.getAmbientA() * maa) / 255;
+	int maa = (materialupdate & 1) ? vertex.color0.a() : state.materialAmbientA;
+	int final_alpha = (state.ambientA * maa) / 255;
 
-	if (gstate.isUsingSecondaryColor()) {
+	if (state.secondaryColor) {
 		Vec3<int> final_color_int = (final_color.Clamp(0.0f, 1.0f) * 255.0f).Cast<int>();
 		vertex.color0 = Vec4<int>(final_color_int, final_alpha);
 		vertex.color1 = (specular_color.Clamp(0.0f, 1.0f) * 255.0f).Cast<int>();
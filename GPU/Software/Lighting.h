@@ -21,6 +21,42 @@
 
 namespace Lighting {
 
-void Process(VertexData& vertex, bool hasColor);
+// Light and material parameters, converted from gstate once per draw rather than per vertex.
+struct State {
+	struct Light {
+		bool enabled;
+		bool directional;
+		bool spot;
+		bool poweredDiffuse;
+		bool specular;
+		Vec3<float> pos;
+		// Only used for environment mapping.
+		Vec3<float> normalizedPos;
+		Vec3<float> spotDir;
+		float spotCutoff;
+		float spotConv;
+		float att[3];
+		Vec3<float> ambientColor;
+		Vec3<float> diffuseColor;
+		Vec3<float> specularColor;
+	};
+
+	Light lights[4];
+	int materialupdate;
+	Vec3<float> materialEmissive;
+	Vec3<float> materialAmbient;
+	Vec3<float> materialDiffuse;
+	Vec3<float> materialSpecular;
+	Vec3<float> ambientColor;
+	float specularCoef;
+	int materialAmbientA;
+	int ambientA;
+	bool enabled;
+	bool envMap;
+	bool secondaryColor;
+};
+
+void ComputeState(State *state, bool hasColor);
+void Process(VertexData &vertex, const State &state);
 
 }
\ No newline at end of file
@@ -21,7 +21,6 @@
 #include "base/basictypes.h"
 #include "profiler/profiler.h"
 
-#include "Common/ThreadPools.h"
 #include "Common/ColorConv.h"
 #include "Core/Config.h"
 #include "Core/MemMap.h"
@@ -30,9 +29,12 @@
 
 #include "GPU/Common/TextureCacheCommon.h"
 #include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/SoftGpu.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
+#include "GPU/Software/SoftTextureCache.h"
 
 #if defined(_M_SSE)
 #include <emmintrin.h>
@@ -40,6 +42,54 @@
 
 namespace Rasterizer {
 
+// Like TransformUnit's, but with the offset the primitive was queued with.
+static inline DrawingCoords ScreenToDrawing(const GPUgstate &regs, const ScreenCoords &coords) {
+	DrawingCoords ret;
+	ret.x = ((s32)coords.x - regs.getOffsetX16()) / 16;
+	ret.y = ((s32)coords.y - regs.getOffsetY16()) / 16;
+	ret.z = coords.z;
+	return ret;
+}
+
+static inline ScreenCoords DrawingToScreen(const GPUgstate &regs, const DrawingCoords &coords) {
+	ScreenCoords ret;
+	ret.x = (u32)coords.x * 16 + regs.getOffsetX16();
+	ret.y = (u32)coords.y * 16 + regs.getOffsetY16();
+	ret.z = coords.z;
+	return ret;
+}
+
+void ComputeRasterizerState(RasterizerState *state, const u32 *clut) {
+	state->regs = gstate;
+	state->clut = clut;
+	state->drawPixel = GetSingleFunc();
+
+	state->maxTexLevel = gstate.getTextureMaxLevel();
+	if (!gstate.isMipmapEnabled()) {
+		// No mipmapping enabled
+		state->maxTexLevel = 0;
+	}
+
+	memset(state->texptr, 0, sizeof(state->texptr));
+	memset(state->texbufw, 0, sizeof(state->texbufw));
+	bool texDecoded = false;
+	if (gstate.isTextureMapEnabled() && !gstate.isModeClear()) {
+		GETextureFormat texfmt = gstate.getTextureFormat();
+		for (int i = 0; i <= state->maxTexLevel; i++) {
+			u32 texaddr = gstate.getTextureAddress(i);
+			state->texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
+			if (Memory::IsValidAddress(texaddr))
+				state->texptr[i] = Memory::GetPointerUnchecked(texaddr);
+			else
+				state->texptr[i] = 0;
+		}
+		texDecoded = softTexCache.Prepare(state);
+	}
+
+	state->sampler = Sampler::GetFuncs(texDecoded);
+	coarseDepth.Prepare(&state->depth);
+}
+
 // Only OK on x64 where our stack is aligned
 #if defined(_M_SSE) && !defined(_M_IX86)
 static inline __m128 Interpolate(const __m128 &c0, const __m128 &c1, const __m128 &c2, int w0, int w1, int w2, float wsum) {
@@ -118,8 +168,8 @@ static inline int WrapUV(int v, int height) {
 }
 
 template <int N>
-static inline void ApplyTexelClamp(int out_u[N], int out_v[N], const int u[N], const int v[N], int width, int height) {
-	if (gstate.isTexCoordClampedS()) {
+static inline void ApplyTexelClamp(const GPUgstate &regs, int out_u[N], int out_v[N], const int u[N], const int v[N], int width, int height) {
+	if (regs.isTexCoordClampedS()) {
 		for (int i = 0; i < N; ++i) {
 			out_u[i] = ClampUV(u[i], width);
 		}
@@ -128,7 +178,7 @@ static inline void ApplyTexelClamp(int out_u[N], int out_v[N], const int u[N], c
 			out_u[i] = WrapUV(u[i], width);
 		}
 	}
-	if (gstate.isTexCoordClampedT()) {
+	if (regs.isTexCoordClampedT()) {
 		for (int i = 0; i < N; ++i) {
 			out_v[i] = ClampUV(v[i], height);
 		}
@@ -140,8 +190,8 @@ static inline void ApplyTexelClamp(int out_u[N], int out_v[N], const int u[N], c
 }
 
 template <int N>
-static inline void ApplyTexelClampQuad(int out_u[N * 4], int out_v[N * 4], const int u[N], const int v[N], int width, int height) {
-	if (gstate.isTexCoordClampedS()) {
+static inline void ApplyTexelClampQuad(const GPUgstate &regs, int out_u[N * 4], int out_v[N * 4], const int u[N], const int v[N], int width, int height) {
+	if (regs.isTexCoordClampedS()) {
 		for (int i = 0; i < N * 4; ++i) {
 			out_u[i] = ClampUV(u[i >> 2] + (i & 1), width);
 		}
@@ -150,7 +200,7 @@ static inline void ApplyTexelClampQuad(int out_u[N * 4], int out_v[N * 4], const
 			out_u[i] = WrapUV(u[i >> 2] + (i & 1), width);
 		}
 	}
-	if (gstate.isTexCoordClampedT()) {
+	if (regs.isTexCoordClampedT()) {
 		for (int i = 0; i < N * 4; ++i) {
 			out_v[i] = ClampUV(v[i >> 2] + ((i >> 1) & 1), height);
 		}
@@ -161,10 +211,10 @@ static inline void ApplyTexelClampQuad(int out_u[N * 4], int out_v[N * 4], const
 	}
 }
 
-static inline void GetTexelCoordinates(int level, float s, float t, int& out_u, int& out_v)
+static inline void GetTexelCoordinates(const GPUgstate &regs, int level, float s, float t, int& out_u, int& out_v)
 {
-	int width = gstate.getTextureWidth(level);
-	int height = gstate.getTextureHeight(level);
+	int width = regs.getTextureWidth(level);
+	int height = regs.getTextureHeight(level);
 
 	int base_u = (int)(s * width * 256.0f + 0.375f);
 	int base_v = (int)(t * height * 256.0f + 0.375f);
@@ -172,14 +222,14 @@ static inline void GetTexelCoordinates(int level, float s, float t, int& out_u,
 	base_u >>= 8;
 	base_v >>= 8;
 
-	ApplyTexelClamp<1>(&out_u, &out_v, &base_u, &base_v, width, height);
+	ApplyTexelClamp<1>(regs, &out_u, &out_v, &base_u, &base_v, width, height);
 }
 
-static inline void GetTexelCoordinatesQuad(int level, float in_s, float in_t, int u[4], int v[4], int &frac_u, int &frac_v)
+static inline void GetTexelCoordinatesQuad(const GPUgstate &regs, int level, float in_s, float in_t, int u[4], int v[4], int &frac_u, int &frac_v)
 {
 	// 8 bits of fractional UV
-	int width = gstate.getTextureWidth(level);
-	int height = gstate.getTextureHeight(level);
+	int width = regs.getTextureWidth(level);
+	int height = regs.getTextureHeight(level);
 
 	int base_u = (int)(in_s * width * 256.0f + 0.375f) - 128;
 	int base_v = (int)(in_t * height * 256.0f + 0.375f) - 128;
@@ -191,11 +241,11 @@ static inline void GetTexelCoordinatesQuad(int level, float in_s, float in_t, in
 	base_v >>= 8;
 
 	// Need to generate and individually wrap/clamp the four sample coordinates. Ugh.
-	ApplyTexelClampQuad<1>(u, v, &base_u, &base_v, width, height);
+	ApplyTexelClampQuad<1>(regs, u, v, &base_u, &base_v, width, height);
 }
 
-static inline void GetTextureCoordinates(const VertexData& v0, const VertexData& v1, const float p, float &s, float &t) {
-	switch (gstate.getUVGenMode()) {
+static inline void GetTextureCoordinates(const GPUgstate &regs, const VertexData& v0, const VertexData& v1, const float p, float &s, float &t) {
+	switch (regs.getUVGenMode()) {
 	case GE_TEXMAP_TEXTURE_COORDS:
 	case GE_TEXMAP_UNKNOWN:
 	case GE_TEXMAP_ENVIRONMENT_MAP:
@@ -216,7 +266,7 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 		{
 			// projection mapping, TODO: Move this code to TransformUnit!
 			Vec3<float> source;
-			switch (gstate.getUVProjMode()) {
+			switch (regs.getUVProjMode()) {
 			case GE_PROJMAP_POSITION:
 				source = (v0.modelpos * p + v1.modelpos * (1.0f - p));
 				break;
@@ -234,28 +284,28 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 				break;
 
 			default:
-				ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", gstate.getUVProjMode());
+				ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", regs.getUVProjMode());
 				break;
 			}
 
-			Mat3x3<float> tgen(gstate.tgenMatrix);
-			Vec3<float> stq = tgen * source + Vec3<float>(gstate.tgenMatrix[9], gstate.tgenMatrix[10], gstate.tgenMatrix[11]);
+			Mat3x3<float> tgen(regs.tgenMatrix);
+			Vec3<float> stq = tgen * source + Vec3<float>(regs.tgenMatrix[9], regs.tgenMatrix[10], regs.tgenMatrix[11]);
 			float z_recip = 1.0f / stq.z;
 			s = stq.x * z_recip;
 			t = stq.y * z_recip;
 		}
 		break;
 	default:
-		ERROR_LOG_REPORT(G3D, "Software: Unsupported texture mapping mode %x!", gstate.getUVGenMode());
+		ERROR_LOG_REPORT(G3D, "Software: Unsupported texture mapping mode %x!", regs.getUVGenMode());
 		s = 0.0f;
 		t = 0.0f;
 		break;
 	}
 }
 
-static inline void GetTextureCoordinates(const VertexData& v0, const VertexData& v1, const VertexData& v2, const Vec4<int> &w0, const Vec4<int> &w1, const Vec4<int> &w2, const Vec4<float> &wsum_recip, Vec4<float> &s, Vec4<float> &t)
+static inline void GetTextureCoordinates(const GPUgstate &regs, const VertexData& v0, const VertexData& v1, const VertexData& v2, const Vec4<int> &w0, const Vec4<int> &w1, const Vec4<int> &w2, const Vec4<float> &wsum_recip, Vec4<float> &s, Vec4<float> &t)
 {
-	switch (gstate.getUVGenMode()) {
+	switch (regs.getUVGenMode()) {
 	case GE_TEXMAP_TEXTURE_COORDS:
 	case GE_TEXMAP_UNKNOWN:
 	case GE_TEXMAP_ENVIRONMENT_MAP:
@@ -278,7 +328,7 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 		for (int i = 0; i < 4; ++i) {
 			// projection mapping, TODO: Move this code to TransformUnit!
 			Vec3<float> source;
-			switch (gstate.getUVProjMode()) {
+			switch (regs.getUVProjMode()) {
 			case GE_PROJMAP_POSITION:
 				source = (v0.modelpos * w0[i] + v1.modelpos * w1[i] + v2.modelpos * w2[i]) * wsum_recip[i];
 				break;
@@ -296,150 +346,25 @@ static inline void GetTextureCoordinates(const VertexData& v0, const VertexData&
 				break;
 
 			default:
-				ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", gstate.getUVProjMode());
+				ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", regs.getUVProjMode());
 				break;
 			}
 
-			Mat3x3<float> tgen(gstate.tgenMatrix);
-			Vec3<float> stq = tgen * source + Vec3<float>(gstate.tgenMatrix[9], gstate.tgenMatrix[10], gstate.tgenMatrix[11]);
+			Mat3x3<float> tgen(regs.tgenMatrix);
+			Vec3<float> stq = tgen * source + Vec3<float>(regs.tgenMatrix[9], regs.tgenMatrix[10], regs.tgenMatrix[11]);
 			float z_recip = 1.0f / stq.z;
 			s[i] = stq.x * z_recip;
 			t[i] = stq.y * z_recip;
 		}
 		break;
 	default:
-		ERROR_LOG_REPORT(G3D, "Software: Unsupported texture mapping mode %x!", gstate.getUVGenMode());
+		ERROR_LOG_REPORT(G3D, "Software: Unsupported texture mapping mode %x!", regs.getUVGenMode());
 		s = Vec4<float>::AssignToAll(0.0f);
 		t = Vec4<float>::AssignToAll(0.0f);
 		break;
 	}
 }
 
-// NOTE: These likely aren't endian safe
-static inline u32 GetPixelColor(int x, int y)
-{
-	switch (gstate.FrameBufFormat()) {
-	case GE_FORMAT_565:
-		return RGB565ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
-
-	case GE_FORMAT_5551:
-		return RGBA5551ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
-
-	case GE_FORMAT_4444:
-		return RGBA4444ToRGBA8888(fb.Get16(x, y, gstate.FrameBufStride()));
-
-	case GE_FORMAT_8888:
-		return fb.Get32(x, y, gstate.FrameBufStride());
-
-	case GE_FORMAT_INVALID:
-		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
-	}
-	return 0;
-}
-
-static inline void SetPixelColor(int x, int y, u32 value)
-{
-	switch (gstate.FrameBufFormat()) {
-	case GE_FORMAT_565:
-		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGB565(value));
-		break;
-
-	case GE_FORMAT_5551:
-		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGBA5551(value));
-		break;
-
-	case GE_FORMAT_4444:
-		fb.Set16(x, y, gstate.FrameBufStride(), RGBA8888ToRGBA4444(value));
-		break;
-
-	case GE_FORMAT_8888:
-		fb.Set32(x, y, gstate.FrameBufStride(), value);
-		break;
-
-	case GE_FORMAT_INVALID:
-		_dbg_assert_msg_(G3D, false, "Software: invalid framebuf format.");
-	}
-}
-
-static inline u16 GetPixelDepth(int x, int y)
-{
-	return depthbuf.Get16(x, y, gstate.DepthBufStride());
-}
-
-static inline void SetPixelDepth(int x, int y, u16 value)
-{
-	depthbuf.Set16(x, y, gstate.DepthBufStride(), value);
-}
-
-static inline u8 GetPixelStencil(int x, int y)
-{
-	if (gstate.FrameBufFormat() == GE_FORMAT_565) {
-		// Always treated as 0 for comparison purposes.
-		return 0;
-	} else if (gstate.FrameBufFormat() == GE_FORMAT_5551) {
-		return ((fb.Get16(x, y, gstate.FrameBufStride()) & 0x8000) != 0) ? 0xFF : 0;
-	} else if (gstate.FrameBufFormat() == GE_FORMAT_4444) {
-		return Convert4To8(fb.Get16(x, y, gstate.FrameBufStride()) >> 12);
-	} else {
-		return fb.Get32(x, y, gstate.FrameBufStride()) >> 24;
-	}
-}
-
-static inline void SetPixelStencil(int x, int y, u8 value)
-{
-	// TODO: This seems like it maybe respects the alpha mask (at least in some scenarios?)
-
-	if (gstate.FrameBufFormat() == GE_FORMAT_565) {
-		// Do nothing
-	} else if (gstate.FrameBufFormat() == GE_FORMAT_5551) {
-		u16 pixel = fb.Get16(x, y, gstate.FrameBufStride()) & ~0x8000;
-		pixel |= value != 0 ? 0x8000 : 0;
-		fb.Set16(x, y, gstate.FrameBufStride(), pixel);
-	} else if (gstate.FrameBufFormat() == GE_FORMAT_4444) {
-		u16 pixel = fb.Get16(x, y, gstate.FrameBufStride()) & ~0xF000;
-		pixel |= (u16)value << 12;
-		fb.Set16(x, y, gstate.FrameBufStride(), pixel);
-	} else {
-		u32 pixel = fb.Get32(x, y, gstate.FrameBufStride()) & ~0xFF000000;
-		pixel |= (u32)value << 24;
-		fb.Set32(x, y, gstate.FrameBufStride(), pixel);
-	}
-}
-
-static inline bool DepthTestPassed(int x, int y, u16 z)
-{
-	u16 reference_z = GetPixelDepth(x, y);
-
-	switch (gstate.getDepthTestFunction()) {
-	case GE_COMP_NEVER:
-		return false;
-
-	case GE_COMP_ALWAYS:
-		return true;
-
-	case GE_COMP_EQUAL:
-		return (z == reference_z);
-
-	case GE_COMP_NOTEQUAL:
-		return (z != reference_z);
-
-	case GE_COMP_LESS:
-		return (z < reference_z);
-
-	case GE_COMP_LEQUAL:
-		return (z <= reference_z);
-
-	case GE_COMP_GREATER:
-		return (z > reference_z);
-
-	case GE_COMP_GEQUAL:
-		return (z >= reference_z);
-
-	default:
-		return 0;
-	}
-}
-
 static inline bool IsRightSideOrFlatBottomLine(const Vec2<int>& vertex, const Vec2<int>& line1, const Vec2<int>& line2)
 {
 	if (line1.y == line2.y) {
@@ -451,171 +376,14 @@ static inline bool IsRightSideOrFlatBottomLine(const Vec2<int>& vertex, const Ve
 	}
 }
 
-static inline bool StencilTestPassed(u8 stencil)
-{
-	// TODO: Does the masking logic make any sense?
-	stencil &= gstate.getStencilTestMask();
-	u8 ref = gstate.getStencilTestRef() & gstate.getStencilTestMask();
-	switch (gstate.getStencilTestFunction()) {
-		case GE_COMP_NEVER:
-			return false;
-
-		case GE_COMP_ALWAYS:
-			return true;
-
-		case GE_COMP_EQUAL:
-			return ref == stencil;
-
-		case GE_COMP_NOTEQUAL:
-			return ref != stencil;
-
-		case GE_COMP_LESS:
-			return ref < stencil;
-
-		case GE_COMP_LEQUAL:
-			return ref <= stencil;
-
-		case GE_COMP_GREATER:
-			return ref > stencil;
-
-		case GE_COMP_GEQUAL:
-			return ref >= stencil;
-	}
-	return true;
-}
-
-static inline u8 ApplyStencilOp(int op, u8 old_stencil) {
-	// TODO: Apply mask to reference or old stencil?
-	u8 reference_stencil = gstate.getStencilTestRef(); // TODO: Apply mask?
-
-	switch (op) {
-		case GE_STENCILOP_KEEP:
-			return old_stencil;
-
-		case GE_STENCILOP_ZERO:
-			return 0;
-
-		case GE_STENCILOP_REPLACE:
-			return reference_stencil;
-
-		case GE_STENCILOP_INVERT:
-			return ~old_stencil;
-
-		case GE_STENCILOP_INCR:
-			switch (gstate.FrameBufFormat()) {
-			case GE_FORMAT_8888:
-				if (old_stencil != 0xFF) {
-					return old_stencil + 1;
-				}
-				return old_stencil;
-			case GE_FORMAT_5551:
-				return 0xFF;
-			case GE_FORMAT_4444:
-				if (old_stencil < 0xF0) {
-					return old_stencil + 0x10;
-				}
-				return old_stencil;
-			default:
-				return old_stencil;
-			}
-			break;
-
-		case GE_STENCILOP_DECR:
-			switch (gstate.FrameBufFormat()) {
-			case GE_FORMAT_4444:
-				if (old_stencil >= 0x10)
-					return old_stencil - 0x10;
-				break;
-			default:
-				if (old_stencil != 0)
-					return old_stencil - 1;
-				return old_stencil;
-			}
-			break;
-	}
-
-	return old_stencil;
-}
-
-static inline u32 ApplyLogicOp(GELogicOp op, u32 old_color, u32 new_color) {
-	// All of the operations here intentionally preserve alpha/stencil.
-	switch (op) {
-	case GE_LOGIC_CLEAR:
-		new_color &= 0xFF000000;
-		break;
-
-	case GE_LOGIC_AND:
-		new_color = new_color & (old_color | 0xFF000000);
-		break;
-
-	case GE_LOGIC_AND_REVERSE:
-		new_color = new_color & (~old_color | 0xFF000000);
-		break;
-
-	case GE_LOGIC_COPY:
-		// No change to new_color.
-		break;
-
-	case GE_LOGIC_AND_INVERTED:
-		new_color = (~new_color & (old_color & 0x00FFFFFF)) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_NOOP:
-		new_color = (old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_XOR:
-		new_color = new_color ^ (old_color & 0x00FFFFFF);
-		break;
-
-	case GE_LOGIC_OR:
-		new_color = new_color | (old_color & 0x00FFFFFF);
-		break;
-
-	case GE_LOGIC_NOR:
-		new_color = (~(new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_EQUIV:
-		new_color = (~(new_color ^ old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_INVERTED:
-		new_color = (~old_color & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_OR_REVERSE:
-		new_color = new_color | (~old_color & 0x00FFFFFF);
-		break;
-
-	case GE_LOGIC_COPY_INVERTED:
-		new_color = (~new_color & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_OR_INVERTED:
-		new_color = ((~new_color | old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_NAND:
-		new_color = (~(new_color & old_color) & 0x00FFFFFF) | (new_color & 0xFF000000);
-		break;
-
-	case GE_LOGIC_SET:
-		new_color |= 0x00FFFFFF;
-		break;
-	}
-
-	return new_color;
-}
-
-static inline Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, const Vec4<int>& texcolor)
+static inline Vec4<int> GetTextureFunctionOutput(const GPUgstate &regs, const Vec4<int>& prim_color, const Vec4<int>& texcolor)
 {
 	Vec3<int> out_rgb;
 	int out_a;
 
-	bool rgba = gstate.isTextureAlphaUsed();
+	bool rgba = regs.isTextureAlphaUsed();
 
-	switch (gstate.getTextureFunction()) {
+	switch (regs.getTextureFunction()) {
 	case GE_TEXFUNC_MODULATE:
 	{
 #if defined(_M_SSE)
@@ -623,7 +391,7 @@ static inline Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, co
 		const __m128 p = _mm_cvtepi32_ps(prim_color.ivec);
 		const __m128 t = _mm_cvtepi32_ps(texcolor.ivec);
 		const __m128 b = _mm_mul_ps(p, t);
-		if (gstate.isColorDoublingEnabled()) {
+		if (regs.isColorDoublingEnabled()) {
 			// We double right here, only for modulate.  Other tex funcs do not color double.
 			out_rgb.ivec = _mm_cvtps_epi32(_mm_mul_ps(b, _mm_set_ps1(2.0f / 255.0f)));
 		} else {
@@ -636,7 +404,7 @@ static inline Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, co
 			out_a = prim_color.a();
 		}
 #else
-		if (gstate.isColorDoublingEnabled()) {
+		if (regs.isColorDoublingEnabled()) {
 			out_rgb = (prim_color.rgb() * texcolor.rgb() * 2) / 255;
 		} else {
 			out_rgb = prim_color.rgb() * texcolor.rgb() / 255;
@@ -658,7 +426,7 @@ static inline Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, co
 	case GE_TEXFUNC_BLEND:
 	{
 		const Vec3<int> const255(255, 255, 255);
-		const Vec3<int> texenv(gstate.getTextureEnvColR(), gstate.getTextureEnvColG(), gstate.getTextureEnvColB());
+		const Vec3<int> texenv(regs.getTextureEnvColR(), regs.getTextureEnvColG(), regs.getTextureEnvColB());
 		out_rgb = ((const255 - texcolor.rgb()) * prim_color.rgb() + texcolor.rgb() * texenv) / 255;
 		out_a = prim_color.a() * ((rgba) ? texcolor.a() : 255) / 255;
 		break;
@@ -678,7 +446,7 @@ static inline Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, co
 		break;
 
 	default:
-		ERROR_LOG_REPORT(G3D, "Software: Unknown texture function %x", gstate.getTextureFunction());
+		ERROR_LOG_REPORT(G3D, "Software: Unknown texture function %x", regs.getTextureFunction());
 		out_rgb = Vec3<int>::AssignToAll(0);
 		out_a = 0;
 	}
@@ -686,344 +454,46 @@ static inline Vec4<int> GetTextureFunctionOutput(const Vec4<int>& prim_color, co
 	return Vec4<int>(out_rgb.r(), out_rgb.g(), out_rgb.b(), out_a);
 }
 
-static inline bool ColorTestPassed(const Vec3<int> &color)
-{
-	const u32 mask = gstate.getColorTestMask();
-	const u32 c = color.ToRGB() & mask;
-	const u32 ref = gstate.getColorTestRef() & mask;
-	switch (gstate.getColorTestFunction()) {
-		case GE_COMP_NEVER:
-			return false;
-
-		case GE_COMP_ALWAYS:
-			return true;
-
-		case GE_COMP_EQUAL:
-			return c == ref;
-
-		case GE_COMP_NOTEQUAL:
-			return c != ref;
-
-		default:
-			ERROR_LOG_REPORT(G3D, "Software: Invalid colortest function: %d", gstate.getColorTestFunction());
-			break;
-	}
-	return true;
-}
-
-static inline bool AlphaTestPassed(int alpha)
-{
-	const u8 mask = gstate.getAlphaTestMask() & 0xFF;
-	const u8 ref = gstate.getAlphaTestRef() & mask;
-	alpha &= mask;
-
-	switch (gstate.getAlphaTestFunction()) {
-		case GE_COMP_NEVER:
-			return false;
-
-		case GE_COMP_ALWAYS:
-			return true;
-
-		case GE_COMP_EQUAL:
-			return (alpha == ref);
-
-		case GE_COMP_NOTEQUAL:
-			return (alpha != ref);
-
-		case GE_COMP_LESS:
-			return (alpha < ref);
-
-		case GE_COMP_LEQUAL:
-			return (alpha <= ref);
-
-		case GE_COMP_GREATER:
-			return (alpha > ref);
-
-		case GE_COMP_GEQUAL:
-			return (alpha >= ref);
-	}
-	return true;
-}
-
-static inline Vec3<int> GetSourceFactor(const Vec4<int>& source, const Vec4<int>& dst)
-{
-	switch (gstate.getBlendFuncA()) {
-	case GE_SRCBLEND_DSTCOLOR:
-		return dst.rgb();
-
-	case GE_SRCBLEND_INVDSTCOLOR:
-		return Vec3<int>::AssignToAll(255) - dst.rgb();
-
-	case GE_SRCBLEND_SRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
-#else
-		return Vec3<int>::AssignToAll(source.a());
-#endif
-
-	case GE_SRCBLEND_INVSRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
-#else
-		return Vec3<int>::AssignToAll(255 - source.a());
-#endif
-
-	case GE_SRCBLEND_DSTALPHA:
-		return Vec3<int>::AssignToAll(dst.a());
-
-	case GE_SRCBLEND_INVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - dst.a());
-
-	case GE_SRCBLEND_DOUBLESRCALPHA:
-		return Vec3<int>::AssignToAll(2 * source.a());
-
-	case GE_SRCBLEND_DOUBLEINVSRCALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
-
-	case GE_SRCBLEND_DOUBLEDSTALPHA:
-		return Vec3<int>::AssignToAll(2 * dst.a());
-
-	case GE_SRCBLEND_DOUBLEINVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
-
-	case GE_SRCBLEND_FIXA:
-	default:
-		// All other dest factors (> 10) are treated as FIXA.
-		return Vec3<int>::FromRGB(gstate.getFixA());
-	}
-}
-
-static inline Vec3<int> GetDestFactor(const Vec4<int>& source, const Vec4<int>& dst)
-{
-	switch (gstate.getBlendFuncB()) {
-	case GE_DSTBLEND_SRCCOLOR:
-		return source.rgb();
-
-	case GE_DSTBLEND_INVSRCCOLOR:
-		return Vec3<int>::AssignToAll(255) - source.rgb();
-
-	case GE_DSTBLEND_SRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3)));
-#else
-		return Vec3<int>::AssignToAll(source.a());
-#endif
-
-	case GE_DSTBLEND_INVSRCALPHA:
-#if defined(_M_SSE)
-		return Vec3<int>(_mm_sub_epi32(_mm_set1_epi32(255), _mm_shuffle_epi32(source.ivec, _MM_SHUFFLE(3, 3, 3, 3))));
-#else
-		return Vec3<int>::AssignToAll(255 - source.a());
-#endif
-
-	case GE_DSTBLEND_DSTALPHA:
-		return Vec3<int>::AssignToAll(dst.a());
-
-	case GE_DSTBLEND_INVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - dst.a());
-
-	case GE_DSTBLEND_DOUBLESRCALPHA:
-		return Vec3<int>::AssignToAll(2 * source.a());
-
-	case GE_DSTBLEND_DOUBLEINVSRCALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * source.a(), 255));
-
-	case GE_DSTBLEND_DOUBLEDSTALPHA:
-		return Vec3<int>::AssignToAll(2 * dst.a());
-
-	case GE_DSTBLEND_DOUBLEINVDSTALPHA:
-		return Vec3<int>::AssignToAll(255 - std::min(2 * dst.a(), 255));
-
-	case GE_DSTBLEND_FIXB:
-	default:
-		// All other dest factors (> 10) are treated as FIXB.
-		return Vec3<int>::FromRGB(gstate.getFixB());
-	}
-}
-
-static inline Vec3<int> AlphaBlendingResult(const Vec4<int> &source, const Vec4<int> &dst)
-{
-	// Note: These factors cannot go below 0, but they can go above 255 when doubling.
-	Vec3<int> srcfactor = GetSourceFactor(source, dst);
-	Vec3<int> dstfactor = GetDestFactor(source, dst);
-
-	switch (gstate.getBlendEq()) {
-	case GE_BLENDMODE_MUL_AND_ADD:
-	{
-#if defined(_M_SSE)
-		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
-		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
-		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
-#else
-		return (source.rgb() * srcfactor + dst.rgb() * dstfactor) / 255;
-#endif
-	}
-
-	case GE_BLENDMODE_MUL_AND_SUBTRACT:
-	{
-#if defined(_M_SSE)
-		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
-		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
-		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(s, d), _mm_set_ps1(1.0f / 255.0f))));
-#else
-		return (source.rgb() * srcfactor - dst.rgb() * dstfactor) / 255;
-#endif
-	}
-
-	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
-	{
-#if defined(_M_SSE)
-		const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(source.ivec), _mm_cvtepi32_ps(srcfactor.ivec));
-		const __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(dst.ivec), _mm_cvtepi32_ps(dstfactor.ivec));
-		return Vec3<int>(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(d, s), _mm_set_ps1(1.0f / 255.0f))));
-#else
-		return (dst.rgb() * dstfactor - source.rgb() * srcfactor) / 255;
-#endif
-	}
-
-	case GE_BLENDMODE_MIN:
-		return Vec3<int>(std::min(source.r(), dst.r()),
-						std::min(source.g(), dst.g()),
-						std::min(source.b(), dst.b()));
-
-	case GE_BLENDMODE_MAX:
-		return Vec3<int>(std::max(source.r(), dst.r()),
-						std::max(source.g(), dst.g()),
-						std::max(source.b(), dst.b()));
-
-	case GE_BLENDMODE_ABSDIFF:
-		return Vec3<int>(::abs(source.r() - dst.r()),
-						::abs(source.g() - dst.g()),
-						::abs(source.b() - dst.b()));
-
-	default:
-		ERROR_LOG_REPORT(G3D, "Software: Unknown blend function %x", gstate.getBlendEq());
-		return Vec3<int>();
-	}
-}
-
-template <bool clearMode>
-inline void DrawSinglePixel(const DrawingCoords &p, u16 z, u8 fog, const Vec4<int> &color_in) {
-	Vec4<int> prim_color = color_in.Clamp(0, 255);
-	// Depth range test - applied in clear mode, if not through mode.
-	if (!gstate.isModeThrough())
-		if (z < gstate.getDepthRangeMin() || z > gstate.getDepthRangeMax())
-			return;
-
-	if (gstate.isAlphaTestEnabled() && !clearMode)
-		if (!AlphaTestPassed(prim_color.a()))
-			return;
-
-	// Fog is applied prior to color test.
-	if (gstate.isFogEnabled() && !gstate.isModeThrough() && !clearMode) {
-		Vec3<int> fogColor = Vec3<int>::FromRGB(gstate.fogcolor);
-		fogColor = (prim_color.rgb() * (int)fog + fogColor * (255 - (int)fog)) / 255;
-		prim_color.r() = fogColor.r();
-		prim_color.g() = fogColor.g();
-		prim_color.b() = fogColor.b();
-	}
-
-	if (gstate.isColorTestEnabled() && !clearMode)
-		if (!ColorTestPassed(prim_color.rgb()))
-			return;
-
-	// In clear mode, it uses the alpha color as stencil.
-	u8 stencil = clearMode ? prim_color.a() : GetPixelStencil(p.x, p.y);
-	if (!clearMode && (gstate.isStencilTestEnabled() || gstate.isDepthTestEnabled())) {
-		if (gstate.isStencilTestEnabled() && !StencilTestPassed(stencil)) {
-			stencil = ApplyStencilOp(gstate.getStencilOpSFail(), stencil);
-			SetPixelStencil(p.x, p.y, stencil);
-			return;
-		}
-
-		// Also apply depth at the same time.  If disabled, same as passing.
-		if (gstate.isDepthTestEnabled() && !DepthTestPassed(p.x, p.y, z)) {
-			if (gstate.isStencilTestEnabled()) {
-				stencil = ApplyStencilOp(gstate.getStencilOpZFail(), stencil);
-				SetPixelStencil(p.x, p.y, stencil);
-			}
-			return;
-		} else if (gstate.isStencilTestEnabled()) {
-			stencil = ApplyStencilOp(gstate.getStencilOpZPass(), stencil);
-		}
-
-		if (gstate.isDepthTestEnabled() && gstate.isDepthWriteEnabled()) {
-			SetPixelDepth(p.x, p.y, z);
-		}
-	} else if (clearMode && gstate.isClearModeDepthMask()) {
-		SetPixelDepth(p.x, p.y, z);
-	}
-
-	const u32 old_color = GetPixelColor(p.x, p.y);
-	u32 new_color;
-
-	if (gstate.isAlphaBlendEnabled() && !clearMode) {
-		const Vec4<int> dst = Vec4<int>::FromRGBA(old_color);
-		// ToRGB() always automatically clamps.
-		new_color = AlphaBlendingResult(prim_color, dst).ToRGB();
-		new_color |= stencil << 24;
-	} else {
-#if defined(_M_SSE)
-		new_color = Vec3<int>(prim_color.ivec).ToRGB();
-		new_color |= stencil << 24;
-#else
-		new_color = Vec4<int>(prim_color.r(), prim_color.g(), prim_color.b(), stencil).ToRGBA();
-#endif
-	}
-
-	// Logic ops are applied after blending (if blending is enabled.)
-	if (gstate.isLogicOpEnabled() && !clearMode) {
-		// Logic ops don't affect stencil, which happens inside ApplyLogicOp.
-		new_color = ApplyLogicOp(gstate.getLogicOp(), old_color, new_color);
-	}
-
-	if (clearMode) {
-		new_color = (new_color & ~gstate.getClearModeColorMask()) | (old_color & gstate.getClearModeColorMask());
-	}
-	new_color = (new_color & ~gstate.getColorMask()) | (old_color & gstate.getColorMask());
-
-	// TODO: Dither before or inside SetPixelColor
-	SetPixelColor(p.x, p.y, new_color);
-}
-
-static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> &prim_color, float s, float t, int texlevel, int frac_texlevel, bool bilinear, u8 *texptr[], int texbufw[]) {
+static inline void ApplyTexturing(const RasterizerState &state, Vec4<int> &prim_color, float s, float t, int texlevel, int frac_texlevel, bool bilinear) {
+	const GPUgstate &regs = state.regs;
+	const Sampler::Funcs &sampler = state.sampler;
 	int u[8] = {0}, v[8] = {0};   // 1.23.8 fixed point
 	int frac_u[2], frac_v[2];
 
 	Vec4<int> texcolor0;
 	Vec4<int> texcolor1;
-	const u8 *tptr0 = texptr[texlevel];
-	int bufw0 = texbufw[texlevel];
-	const u8 *tptr1 = texptr[texlevel + 1];
-	int bufw1 = texbufw[texlevel + 1];
+	const u8 *tptr0 = state.texptr[texlevel];
+	int bufw0 = state.texbufw[texlevel];
+	const u8 *tptr1 = state.texptr[texlevel + 1];
+	int bufw1 = state.texbufw[texlevel + 1];
 
 	if (!bilinear) {
 		// Nearest filtering only.  Round texcoords.
-		GetTexelCoordinates(texlevel, s, t, u[0], v[0]);
+		GetTexelCoordinates(regs, texlevel, s, t, u[0], v[0]);
 		if (frac_texlevel) {
-			GetTexelCoordinates(texlevel + 1, s, t, u[1], v[1]);
+			GetTexelCoordinates(regs, texlevel + 1, s, t, u[1], v[1]);
 		}
 
-		texcolor0 = Vec4<int>::FromRGBA(sampler.nearest(u[0], v[0], tptr0, bufw0, texlevel));
+		texcolor0 = Vec4<int>::FromRGBA(sampler.nearest(u[0], v[0], tptr0, bufw0, texlevel, state));
 		if (frac_texlevel) {
-			texcolor1 = Vec4<int>::FromRGBA(sampler.nearest(u[1], v[1], tptr1, bufw1, texlevel + 1));
+			texcolor1 = Vec4<int>::FromRGBA(sampler.nearest(u[1], v[1], tptr1, bufw1, texlevel + 1, state));
 		}
 	} else {
-		GetTexelCoordinatesQuad(texlevel, s, t, u, v, frac_u[0], frac_v[0]);
+		GetTexelCoordinatesQuad(regs, texlevel, s, t, u, v, frac_u[0], frac_v[0]);
 		if (frac_texlevel) {
-			GetTexelCoordinatesQuad(texlevel + 1, s, t, u + 4, v + 4, frac_u[1], frac_v[1]);
+			GetTexelCoordinatesQuad(regs, texlevel + 1, s, t, u + 4, v + 4, frac_u[1], frac_v[1]);
 		}
 
-		texcolor0 = Vec4<int>::FromRGBA(sampler.linear(u, v, frac_u[0], frac_v[0], tptr0, bufw0, texlevel));
+		texcolor0 = Vec4<int>::FromRGBA(sampler.linear(u, v, frac_u[0], frac_v[0], tptr0, bufw0, texlevel, state));
 		if (frac_texlevel) {
-			texcolor1 = Vec4<int>::FromRGBA(sampler.linear(u + 4, v + 4, frac_u[1], frac_v[1], tptr1, bufw1, texlevel + 1));
+			texcolor1 = Vec4<int>::FromRGBA(sampler.linear(u + 4, v + 4, frac_u[1], frac_v[1], tptr1, bufw1, texlevel + 1, state));
 		}
 	}
 
 	if (frac_texlevel) {
 		texcolor0 = (texcolor1 * frac_texlevel + texcolor0 * (256 - frac_texlevel)) / 256;
 	}
-	prim_color = GetTextureFunctionOutput(prim_color, texcolor0);
+	prim_color = GetTextureFunctionOutput(regs, prim_color, texcolor0);
 }
 
 // Produces a signed 1.23.8 value.
@@ -1041,19 +511,19 @@ static int TexLog2(float delta) {
 	return useful - 127 * 256;
 }
 
-static inline void CalculateSamplingParams(const float ds, const float dt, const int maxTexLevel, int &level, int &levelFrac, bool &filt) {
-	const int width = gstate.getTextureWidth(0);
-	const int height = gstate.getTextureHeight(0);
+static inline void CalculateSamplingParams(const GPUgstate &regs, const float ds, const float dt, const int maxTexLevel, int &level, int &levelFrac, bool &filt) {
+	const int width = regs.getTextureWidth(0);
+	const int height = regs.getTextureHeight(0);
 
 	// With 8 bits of fraction (because texslope can be fairly precise.)
 	int detail;
-	switch (gstate.getTexLevelMode()) {
+	switch (regs.getTexLevelMode()) {
 	case GE_TEXLEVEL_MODE_AUTO:
 		detail = TexLog2(std::max(ds * width, dt * height));
 		break;
 	case GE_TEXLEVEL_MODE_SLOPE:
 		// This is always offset by an extra texlevel.
-		detail = 1 * 256 + TexLog2(gstate.getTextureLodSlope());
+		detail = 1 * 256 + TexLog2(regs.getTextureLodSlope());
 		break;
 	case GE_TEXLEVEL_MODE_CONST:
 	default:
@@ -1063,10 +533,10 @@ static inline void CalculateSamplingParams(const float ds, const float dt, const
 	}
 
 	// Add in the bias (used in all modes), expanding to 8 bits of fraction.
-	detail += gstate.getTexLevelOffset16() << 4;
+	detail += regs.getTexLevelOffset16() << 4;
 
 	if (detail > 0 && maxTexLevel > 0) {
-		bool mipFilt = gstate.isMipmapFilteringEnabled();
+		bool mipFilt = regs.isMipmapFilteringEnabled();
 
 		int level8 = std::min(detail, maxTexLevel * 256);
 		if (!mipFilt) {
@@ -1085,21 +555,21 @@ static inline void CalculateSamplingParams(const float ds, const float dt, const
 	} else if (g_Config.iTexFiltering == TEX_FILTER_NEAREST) {
 		filt = false;
 	} else {
-		filt = detail > 0 ? gstate.isMinifyFilteringEnabled() : gstate.isMagnifyFilteringEnabled();
+		filt = detail > 0 ? regs.isMinifyFilteringEnabled() : regs.isMagnifyFilteringEnabled();
 	}
 }
 
-static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> *prim_color, const Vec4<float> &s, const Vec4<float> &t, int maxTexLevel, u8 *texptr[], int texbufw[]) {
+static inline void ApplyTexturing(const RasterizerState &state, Vec4<int> *prim_color, const Vec4<float> &s, const Vec4<float> &t) {
 	float ds = s[1] - s[0];
 	float dt = t[2] - t[0];
 
 	int level;
 	int levelFrac;
 	bool bilinear;
-	CalculateSamplingParams(ds, dt, maxTexLevel, level, levelFrac, bilinear);
+	CalculateSamplingParams(state.regs, ds, dt, state.maxTexLevel, level, levelFrac, bilinear);
 
 	for (int i = 0; i < 4; ++i) {
-		ApplyTexturing(sampler, prim_color[i], s[i], t[i], level, levelFrac, bilinear, texptr, texbufw);
+		ApplyTexturing(state, prim_color[i], s[i], t[i], level, levelFrac, bilinear);
 	}
 }
 
@@ -1178,49 +648,56 @@ static inline Vec4<float> EdgeRecip(const Vec4<int> &w0, const Vec4<int> &w1, co
 #endif
 }
 
+// Whether the depth test fails for the whole 2x2 block at x, y.  Only checks pixels in range,
+// since other threads own the depth tiles of the rest.
+static inline bool QuadRejected(const CoarseDepthBuffer::DrawState &ds, int x, int y, bool col0, bool col1, bool row0, bool row1, int minZ, int maxZ) {
+	const int x1 = (x + 1) & 0x3FF;
+	if (row0 && ((col0 && !coarseDepth.Rejects(ds, x, y, minZ, maxZ)) || (col1 && !coarseDepth.Rejects(ds, x1, y, minZ, maxZ))))
+		return false;
+	if (row1 && ((col0 && !coarseDepth.Rejects(ds, x, y + 1, minZ, maxZ)) || (col1 && !coarseDepth.Rejects(ds, x1, y + 1, minZ, maxZ))))
+		return false;
+	return true;
+}
+
+static inline void MarkQuadWritten(int x, int y, bool col0, bool col1, bool row0, bool row1) {
+	const int x1 = (x + 1) & 0x3FF;
+	if (row0) {
+		if (col0)
+			coarseDepth.MarkWritten(x, y);
+		if (col1)
+			coarseDepth.MarkWritten(x1, y);
+	}
+	if (row1) {
+		if (col0)
+			coarseDepth.MarkWritten(x, y + 1);
+		if (col1)
+			coarseDepth.MarkWritten(x1, y + 1);
+	}
+}
+
 template <bool clearMode>
 void DrawTriangleSlice(
 	const VertexData& v0, const VertexData& v1, const VertexData& v2,
-	int minX, int minY, int maxX, int maxY,
-	bool byY, int h1, int h2)
+	int minX, int minY, int maxX, int maxY, const RasterizerState &state, const TileRange &range)
 {
+	const GPUgstate &regs = state.regs;
+
 	Vec4<int> bias0 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v0.screenpos.xy(), v1.screenpos.xy(), v2.screenpos.xy()) ? -1 : 0);
 	Vec4<int> bias1 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v1.screenpos.xy(), v2.screenpos.xy(), v0.screenpos.xy()) ? -1 : 0);
 	Vec4<int> bias2 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v2.screenpos.xy(), v0.screenpos.xy(), v1.screenpos.xy()) ? -1 : 0);
 
-	int texbufw[8] = {0};
-
-	int maxTexLevel = gstate.getTextureMaxLevel();
-	u8 *texptr[8] = {NULL};
-
-	if (!gstate.isMipmapEnabled()) {
-		// No mipmapping enabled
-		maxTexLevel = 0;
-	}
-
-	if (gstate.isTextureMapEnabled() && !clearMode) {
-		GETextureFormat texfmt = gstate.getTextureFormat();
-		for (int i = 0; i <= maxTexLevel; i++) {
-			u32 texaddr = gstate.getTextureAddress(i);
-			texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
-			if (Memory::IsValidAddress(texaddr))
-				texptr[i] = Memory::GetPointerUnchecked(texaddr);
-			else
-				texptr[i] = 0;
-		}
-	}
-
 	TriangleEdge e0;
 	TriangleEdge e1;
 	TriangleEdge e2;
 
-	if (byY) {
-		maxY = std::min(maxY, minY + h2 * 16 * 2);
-		minY += h1 * 16 * 2;
-	} else {
-		maxX = std::min(maxX, minX + h2 * 16 * 2);
-		minX += h1 * 16 * 2;
-	}
+	// Skip to the pairs of rows and columns that may be in range, the rest are masked out below.
+	// Steps stay whole quads from the triangle's corner, so every thread sees the same quads.
+	const ScreenCoords rangeMin = DrawingToScreen(regs, DrawingCoords(range.x1, range.y1, 0));
+	const ScreenCoords rangeMax = DrawingToScreen(regs, DrawingCoords(range.x2, range.y2, 0));
+	const int endY = std::min(maxY, minY + (((int)rangeMax.y - minY) / 32 + 1) * 32);
+	minY += std::max(0, ((int)rangeMin.y - minY) / 32 - 1) * 32;
+	const int endX = std::min(maxX, minX + (((int)rangeMax.x - minX) / 32 + 1) * 32);
+	minX += std::max(0, ((int)rangeMin.x - minX) / 32 - 1) * 32;
 
 	ScreenCoords pprime(minX, minY, 0);
 	Vec4<int> w0_base = e0.Start(v1.screenpos, v2.screenpos, pprime);
@@ -1230,10 +707,13 @@ void DrawTriangleSlice(
 	// All the z values are the same, no interpolation required.
 	// This is common, and when we interpolate, we lose accuracy.
 	const bool flatZ = v0.screenpos.z == v1.screenpos.z && v0.screenpos.z == v2.screenpos.z;
+	// Interpolated z stays within the vertices' range, give or take rounding.
+	const int minZ = std::min(std::min(v0.screenpos.z, v1.screenpos.z), v2.screenpos.z) - 1;
+	const int maxZ = std::max(std::max(v0.screenpos.z, v1.screenpos.z), v2.screenpos.z) + 1;
+	const bool depthReject = !clearMode && state.depth.CanReject();
+	const bool depthWrites = state.depth.marksWrites;
 
-	Sampler::Funcs sampler = Sampler::GetFuncs();
-
-	for (pprime.y = minY; pprime.y < maxY; pprime.y += 32,
+	for (pprime.y = minY; pprime.y < endY; pprime.y += 32,
 										w0_base = e0.StepY(w0_base),
 										w1_base = e1.StepY(w1_base),
 										w2_base = e2.StepY(w2_base)) {
@@ -1241,29 +721,43 @@ void DrawTriangleSlice(
 		Vec4<int> w1 = w1_base;
 		Vec4<int> w2 = w2_base;
 
+		pprime.x = minX;
+		DrawingCoords p = ScreenToDrawing(regs, pprime);
+
 		// TODO: Maybe we can clip the edges instead?
-		int scissorYPlus1 = pprime.y + 16 > maxY ? -1 : 0;
-		Vec4<int> scissor_mask = Vec4<int>(0, maxX - minX - 1, scissorYPlus1, (maxX - minX - 1) | scissorYPlus1);
+		int scissorY = range.ContainsY(p.y) ? 0 : -1;
+		int scissorYPlus1 = pprime.y + 16 > maxY || !range.ContainsY(p.y + 1) ? -1 : 0;
+		if (scissorY && scissorYPlus1)
+			continue;
+		Vec4<int> scissor_mask = Vec4<int>(scissorY, (maxX - minX - 1) | scissorY, scissorYPlus1, (maxX - minX - 1) | scissorYPlus1);
 		Vec4<int> scissor_step = Vec4<int>(0, -32, 0, -32);
 
-		pprime.x = minX;
-		DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
-
-		for (; pprime.x <= maxX; pprime.x += 32,
+		for (; pprime.x <= endX; pprime.x += 32,
 			w0 = e0.StepX(w0),
 			w1 = e1.StepX(w1),
 			w2 = e2.StepX(w2),
 			scissor_mask = scissor_mask + scissor_step,
 			p.x = (p.x + 2) & 0x3FF) {
 
+			// Columns outside the range belong to other threads.
+			const int rangeX = range.ContainsX(p.x) ? 0 : -1;
+			const int rangeXPlus1 = range.ContainsX(p.x + 1) ? 0 : -1;
+			if (rangeX && rangeXPlus1)
+				continue;
+
 			// If p is on or inside all edges, render pixel
-			Vec4<int> mask = MakeMask(w0, w1, w2, bias0, bias1, bias2, scissor_mask);
+			Vec4<int> mask = MakeMask(w0, w1, w2, bias0, bias1, bias2, scissor_mask | Vec4<int>(rangeX, rangeXPlus1, rangeX, rangeXPlus1));
 			if (AnyMask(mask)) {
+				if (depthReject && QuadRejected(state.depth, p.x, p.y, rangeX == 0, rangeXPlus1 == 0, scissorY == 0, scissorYPlus1 == 0, minZ, maxZ))
+					continue;
+				if (depthWrites)
+					MarkQuadWritten(p.x, p.y, rangeX == 0, rangeXPlus1 == 0, scissorY == 0, scissorYPlus1 == 0);
+
 				Vec4<float> wsum_recip = EdgeRecip(w0, w1, w2);
 
 				Vec4<int> prim_color[4];
 				Vec3<int> sec_color[4];
-				if (gstate.getShadeMode() == GE_SHADE_GOURAUD && !clearMode) {
+				if (regs.getShadeMode() == GE_SHADE_GOURAUD && !clearMode) {
 					// Does the PSP do perspective-correct color interpolation? The GC doesn't.
 					for (int i = 0; i < 4; ++i) {
 						prim_color[i] = Interpolate(v0.color0, v1.color0, v2.color0, w0[i], w1[i], w2[i], wsum_recip[i]);
@@ -1276,21 +770,21 @@ void DrawTriangleSlice(
 					}
 				}
 
-				if (gstate.isTextureMapEnabled() && !clearMode) {
+				if (regs.isTextureMapEnabled() && !clearMode) {
 					Vec4<float> s, t;
-					if (gstate.isModeThrough()) {
+					if (regs.isModeThrough()) {
 						s = Interpolate(v0.texturecoords.s(), v1.texturecoords.s(), v2.texturecoords.s(), w0, w1, w2, wsum_recip);
 						t = Interpolate(v0.texturecoords.t(), v1.texturecoords.t(), v2.texturecoords.t(), w0, w1, w2, wsum_recip);
 
 						// For levels > 0, mipmapping is always based on level 0.  Simpler to scale first.
-						s *= 1.0f / (float)gstate.getTextureWidth(0);
-						t *= 1.0f / (float)gstate.getTextureHeight(0);
+						s *= 1.0f / (float)regs.getTextureWidth(0);
+						t *= 1.0f / (float)regs.getTextureHeight(0);
 					} else {
 						// Texture coordinate interpolation must definitely be perspective-correct.
-						GetTextureCoordinates(v0, v1, v2, w0, w1, w2, wsum_recip, s, t);
+						GetTextureCoordinates(regs, v0, v1, v2, w0, w1, w2, wsum_recip, s, t);
 					}
 
-					ApplyTexturing(sampler, prim_color, s, t, maxTexLevel, texptr, texbufw);
+					ApplyTexturing(state, prim_color, s, t);
 				}
 
 				if (!clearMode) {
@@ -1306,7 +800,7 @@ void DrawTriangleSlice(
 				}
 
 				Vec4<int> fog = Vec4<int>::AssignToAll(255);
-				if (gstate.isFogEnabled() && !clearMode) {
+				if (regs.isFogEnabled() && !clearMode) {
 					Vec4<float> fogdepths = w0.Cast<float>() * v0.fogdepth + w1.Cast<float>() * v1.fogdepth + w2.Cast<float>() * v2.fogdepth;
 					fogdepths = fogdepths * wsum_recip;
 					for (int i = 0; i < 4; ++i) {
@@ -1331,7 +825,7 @@ void DrawTriangleSlice(
 					subp.x = p.x + (i & 1);
 					subp.y = p.y + (i / 2);
 
-					DrawSinglePixel<clearMode>(subp, (u16)z[i], fog[i], prim_color[i]);
+					state.drawPixel(subp.x, subp.y, (u16)z[i], fog[i], prim_color[i], state);
 				}
 			}
 		}
@@ -1339,10 +833,12 @@ void DrawTriangleSlice(
 }
 
 // Draws triangle, vertices specified in counter-clockwise direction
-void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData& v2)
+void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData& v2, const RasterizerState &state, const TileRange &range)
 {
 	PROFILE_THIS_SCOPE("draw_tri");
 
+	const GPUgstate &regs = state.regs;
+
 	Vec2<int> d01((int)v0.screenpos.x - (int)v1.screenpos.x, (int)v0.screenpos.y - (int)v1.screenpos.y);
 	Vec2<int> d02((int)v0.screenpos.x - (int)v2.screenpos.x, (int)v0.screenpos.y - (int)v2.screenpos.y);
 	Vec2<int> d12((int)v1.screenpos.x - (int)v2.screenpos.x, (int)v1.screenpos.y - (int)v2.screenpos.y);
@@ -1356,160 +852,119 @@ void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData&
 	int maxX = (std::max(std::max(v0.screenpos.x, v1.screenpos.x), v2.screenpos.x) + 0xF) & ~0xF;
 	int maxY = (std::max(std::max(v0.screenpos.y, v1.screenpos.y), v2.screenpos.y) + 0xF) & ~0xF;
 
-	DrawingCoords scissorTL(gstate.getScissorX1(), gstate.getScissorY1(), 0);
-	DrawingCoords scissorBR(gstate.getScissorX2(), gstate.getScissorY2(), 0);
-	minX = std::max(minX, (int)TransformUnit::DrawingToScreen(scissorTL).x);
-	maxX = std::min(maxX, (int)TransformUnit::DrawingToScreen(scissorBR).x);
-	minY = std::max(minY, (int)TransformUnit::DrawingToScreen(scissorTL).y);
-	maxY = std::min(maxY, (int)TransformUnit::DrawingToScreen(scissorBR).y);
-
-	// 32 because we do two pixels at once, and we don't want overlap.
-	int rangeY = (maxY - minY) / 32 + 1;
-	int rangeX = (maxX - minX) / 32 + 1;
-	if (rangeY >= 12 && rangeX >= rangeY * 4) {
-		if (gstate.isModeClear()) {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, false, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeX);
-		} else {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, false, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeX);
-		}
-	} else if (rangeY >= 12 && rangeX >= 12) {
-		if (gstate.isModeClear()) {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, true, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeY);
-		} else {
-			auto bound = [&](int a, int b) -> void {
-				DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, true, a, b);
-			};
-			GlobalThreadPool::Loop(bound, 0, rangeY);
-		}
+	DrawingCoords scissorTL(regs.getScissorX1(), regs.getScissorY1(), 0);
+	DrawingCoords scissorBR(regs.getScissorX2(), regs.getScissorY2(), 0);
+	minX = std::max(minX, (int)DrawingToScreen(regs, scissorTL).x);
+	maxX = std::min(maxX, (int)DrawingToScreen(regs, scissorBR).x);
+	minY = std::max(minY, (int)DrawingToScreen(regs, scissorTL).y);
+	maxY = std::min(maxY, (int)DrawingToScreen(regs, scissorBR).y);
+
+	if (regs.isModeClear()) {
+		DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, state, range);
 	} else {
-		if (gstate.isModeClear()) {
-			DrawTriangleSlice<true>(v0, v1, v2, minX, minY, maxX, maxY, true, 0, rangeY);
-		} else {
-			DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, true, 0, rangeY);
-		}
+		DrawTriangleSlice<false>(v0, v1, v2, minX, minY, maxX, maxY, state, range);
 	}
 }
 
-void DrawPoint(const VertexData &v0)
+void DrawPoint(const VertexData &v0, const RasterizerState &state, const TileRange &range)
 {
+	const GPUgstate &regs = state.regs;
 	ScreenCoords pos = v0.screenpos;
 	Vec4<int> prim_color = v0.color0;
 	Vec3<int> sec_color = v0.color1;
 
-	ScreenCoords scissorTL(TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX1(), gstate.getScissorY1(), 0)));
-	ScreenCoords scissorBR(TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX2(), gstate.getScissorY2(), 0)));
+	ScreenCoords scissorTL(DrawingToScreen(regs, DrawingCoords(regs.getScissorX1(), regs.getScissorY1(), 0)));
+	ScreenCoords scissorBR(DrawingToScreen(regs, DrawingCoords(regs.getScissorX2(), regs.getScissorY2(), 0)));
 
 	if (pos.x < scissorTL.x || pos.y < scissorTL.y || pos.x > scissorBR.x || pos.y > scissorBR.y)
 		return;
+	DrawingCoords p = ScreenToDrawing(regs, pos);
+	if (!range.Contains(p.x, p.y))
+		return;
 
-	bool clearMode = gstate.isModeClear();
-
-	Sampler::Funcs sampler = Sampler::GetFuncs();
-
-	if (gstate.isTextureMapEnabled() && !clearMode) {
-		int texbufw[8] = {0};
-
-		int maxTexLevel = gstate.getTextureMaxLevel();
-		u8 *texptr[8] = {NULL};
-
-		if (!gstate.isMipmapEnabled()) {
-			// No mipmapping enabled
-			maxTexLevel = 0;
-		}
-
-		if (gstate.isTextureMapEnabled() && !clearMode) {
-			GETextureFormat texfmt = gstate.getTextureFormat();
-			for (int i = 0; i <= maxTexLevel; i++) {
-				u32 texaddr = gstate.getTextureAddress(i);
-				texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
-				if (Memory::IsValidAddress(texaddr))
-					texptr[i] = Memory::GetPointerUnchecked(texaddr);
-				else
-					texptr[i] = 0;
-			}
-		}
+	bool clearMode = regs.isModeClear();
 
+	if (regs.isTextureMapEnabled() && !clearMode) {
 		float s = v0.texturecoords.s();
 		float t = v0.texturecoords.t();
-		if (gstate.isModeThrough()) {
-			s *= 1.0f / (float)gstate.getTextureWidth(0);
-			t *= 1.0f / (float)gstate.getTextureHeight(0);
+		if (regs.isModeThrough()) {
+			s *= 1.0f / (float)regs.getTextureWidth(0);
+			t *= 1.0f / (float)regs.getTextureHeight(0);
 		} else {
 			// Texture coordinate interpolation must definitely be perspective-correct.
-			GetTextureCoordinates(v0, v0, 0.0f, s, t);
+			GetTextureCoordinates(regs, v0, v0, 0.0f, s, t);
 		}
 
 		int texLevel;
 		int texLevelFrac;
 		bool bilinear;
-		CalculateSamplingParams(0.0f, 0.0f, maxTexLevel, texLevel, texLevelFrac, bilinear);
-		ApplyTexturing(sampler, prim_color, s, t, texLevel, texLevelFrac, bilinear, texptr, texbufw);
+		CalculateSamplingParams(regs, 0.0f, 0.0f, state.maxTexLevel, texLevel, texLevelFrac, bilinear);
+		ApplyTexturing(state, prim_color, s, t, texLevel, texLevelFrac, bilinear);
 	}
 
 	if (!clearMode)
 		prim_color += Vec4<int>(sec_color, 0);
 
-	ScreenCoords pprime = pos;
-
-	DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
 	u16 z = pos.z;
 
 	u8 fog = 255;
-	if (gstate.isFogEnabled() && !clearMode) {
+	if (regs.isFogEnabled() && !clearMode) {
 		fog = ClampFogDepth(v0.fogdepth);
 	}
 
-	if (clearMode) {
-		DrawSinglePixel<true>(p, z, fog, prim_color);
-	} else {
-		DrawSinglePixel<false>(p, z, fog, prim_color);
-	}
+	state.drawPixel(p.x, p.y, z, fog, prim_color, state);
+	if (state.depth.marksWrites)
+		coarseDepth.MarkWritten(p.x, p.y);
 }
 
-void ClearRectangle(const VertexData &v0, const VertexData &v1)
+void ClearRectangle(const VertexData &v0, const VertexData &v1, const RasterizerState &state, const TileRange &range)
 {
+	const GPUgstate &regs = state.regs;
+
 	int minX = std::min(v0.screenpos.x, v1.screenpos.x) & ~0xF;
 	int minY = std::min(v0.screenpos.y, v1.screenpos.y) & ~0xF;
 	int maxX = (std::max(v0.screenpos.x, v1.screenpos.x) + 0xF) & ~0xF;
 	int maxY = (std::max(v0.screenpos.y, v1.screenpos.y) + 0xF) & ~0xF;
 
-	DrawingCoords scissorTL(gstate.getScissorX1(), gstate.getScissorY1(), 0);
-	DrawingCoords scissorBR(gstate.getScissorX2(), gstate.getScissorY2(), 0);
-	minX = std::max(minX, (int)TransformUnit::DrawingToScreen(scissorTL).x);
-	maxX = std::max(0, std::min(maxX, (int)TransformUnit::DrawingToScreen(scissorBR).x));
-	minY = std::max(minY, (int)TransformUnit::DrawingToScreen(scissorTL).y);
-	maxY = std::max(0, std::min(maxY, (int)TransformUnit::DrawingToScreen(scissorBR).y));
+	DrawingCoords scissorTL(regs.getScissorX1(), regs.getScissorY1(), 0);
+	DrawingCoords scissorBR(regs.getScissorX2(), regs.getScissorY2(), 0);
+	minX = std::max(minX, (int)DrawingToScreen(regs, scissorTL).x);
+	maxX = std::max(0, std::min(maxX, (int)DrawingToScreen(regs, scissorBR).x));
+	minY = std::max(minY, (int)DrawingToScreen(regs, scissorTL).y);
+	maxY = std::max(0, std::min(maxY, (int)DrawingToScreen(regs, scissorBR).y));
+
+	if (maxX <= minX || maxY <= minY)
+		return;
 
-	const int w = (maxX - minX) / 16;
+	// Only the columns in range, other threads clear the rest.
+	const DrawingCoords tl = ScreenToDrawing(regs, ScreenCoords(minX, minY, 0));
+	const int x1 = std::max((int)tl.x, range.x1);
+	const int w = std::min((int)tl.x + (maxX - minX) / 16, range.x2) - x1;
 	if (w <= 0)
 		return;
 
-	if (gstate.isClearModeDepthMask()) {
+	if (regs.isClearModeDepthMask()) {
 		ScreenCoords pprime(minX, minY, 0);
 		const u16 z = v1.screenpos.z;
-		const int stride = gstate.DepthBufStride();
+		const int stride = regs.DepthBufStride();
 
 		for (pprime.y = minY; pprime.y < maxY; pprime.y += 16) {
-			DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
+			DrawingCoords p = ScreenToDrawing(regs, pprime);
+			if (!range.ContainsY(p.y))
+				continue;
 
 			if ((z & 0xFF) == (z >> 8)) {
-				u16 *row = &depthbuf.as16[p.x + p.y * stride];
+				u16 *row = &depthbuf.as16[x1 + p.y * stride];
 				memset(row, z, w * 2);
 			} else {
 				for (int x = 0; x < w; ++x) {
-					SetPixelDepth(p.x + x, p.y, z);
+					SetPixelDepth(regs, x1 + x, p.y, z);
 				}
 			}
 		}
+
+		const int h = (maxY - minY + 15) / 16;
+		coarseDepth.Fill(state.depth, x1, std::max((int)tl.y, range.y1), x1 + w - 1, std::min(tl.y + h - 1, range.y2 - 1), z);
 	}
 
 	const u32 new_color = v1.color0.ToRGBA();
@@ -1517,33 +972,33 @@ void ClearRectangle(const VertexData &v0, const VertexData &v1)
 
 	// Note: this stays 0xFFFFFFFF if keeping color and alpha, even for 16-bit.
 	u32 keepOldMask = 0xFFFFFFFF;
-	switch (gstate.FrameBufFormat()) {
+	switch (regs.FrameBufFormat()) {
 	case GE_FORMAT_565:
 		new_color16 = RGBA8888ToRGB565(new_color);
-		if (gstate.isClearModeColorMask())
+		if (regs.isClearModeColorMask())
 			keepOldMask = 0;
 		break;
 
 	case GE_FORMAT_5551:
 		new_color16 = RGBA8888ToRGBA5551(new_color);
-		if (gstate.isClearModeColorMask())
+		if (regs.isClearModeColorMask())
 			keepOldMask &= 0x00008000;
-		if (gstate.isClearModeAlphaMask())
+		if (regs.isClearModeAlphaMask())
 			keepOldMask &= 0x00007FFF;
 		break;
 
 	case GE_FORMAT_4444:
 		new_color16 = RGBA8888ToRGBA4444(new_color);
-		if (gstate.isClearModeColorMask())
+		if (regs.isClearModeColorMask())
 			keepOldMask &= 0x0000F000;
-		if (gstate.isClearModeAlphaMask())
+		if (regs.isClearModeAlphaMask())
 			keepOldMask &= 0x00000FFF;
 		break;
 
 	case GE_FORMAT_8888:
-		if (gstate.isClearModeColorMask())
+		if (regs.isClearModeColorMask())
 			keepOldMask &= 0xFF000000;
-		if (gstate.isClearModeAlphaMask())
+		if (regs.isClearModeAlphaMask())
 			keepOldMask &= 0x00FFFFFF;
 		break;
 
@@ -1553,65 +1008,75 @@ void ClearRectangle(const VertexData &v0, const VertexData &v1)
 	}
 
 	// The pixel write masks are respected in clear mode.
-	keepOldMask &= ~gstate.getColorMask();
+	keepOldMask &= ~regs.getColorMask();
 
 	if (keepOldMask == 0) {
 		ScreenCoords pprime(minX, minY, 0);
-		const int stride = gstate.FrameBufStride();
+		const int stride = regs.FrameBufStride();
 
-		if (gstate.FrameBufFormat() == GE_FORMAT_8888) {
+		if (regs.FrameBufFormat() == GE_FORMAT_8888) {
 			for (pprime.y = minY; pprime.y < maxY; pprime.y += 16) {
-				DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
+				DrawingCoords p = ScreenToDrawing(regs, pprime);
+				if (!range.ContainsY(p.y))
+					continue;
 				if ((new_color & 0xFF) == (new_color >> 8) && (new_color & 0xFFFF) == (new_color >> 16)) {
-					u32 *row = &fb.as32[p.x + p.y * stride];
+					u32 *row = &fb.as32[x1 + p.y * stride];
 					memset(row, new_color, w * 4);
 				} else {
 					for (int x = 0; x < w; ++x) {
-						fb.Set32(p.x + x, p.y, stride, new_color);
+						fb.Set32(x1 + x, p.y, stride, new_color);
 					}
 				}
 			}
 		} else {
 			for (pprime.y = minY; pprime.y < maxY; pprime.y += 16) {
-				DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
+				DrawingCoords p = ScreenToDrawing(regs, pprime);
+				if (!range.ContainsY(p.y))
+					continue;
 				if ((new_color16 & 0xFF) == (new_color16 >> 8)) {
-					u16 *row = &fb.as16[p.x + p.y * stride];
+					u16 *row = &fb.as16[x1 + p.y * stride];
 					memset(row, new_color16, w * 2);
 				} else {
 					for (int x = 0; x < w; ++x) {
-						fb.Set16(p.x + x, p.y, stride, new_color16);
+						fb.Set16(x1 + x, p.y, stride, new_color16);
 					}
 				}
 			}
 		}
 	} else if (keepOldMask != 0xFFFFFFFF) {
 		ScreenCoords pprime(minX, minY, 0);
-		const int stride = gstate.FrameBufStride();
+		const int stride = regs.FrameBufStride();
 
-		if (gstate.FrameBufFormat() == GE_FORMAT_8888) {
+		if (regs.FrameBufFormat() == GE_FORMAT_8888) {
 			for (pprime.y = minY; pprime.y < maxY; pprime.y += 16) {
-				DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
+				DrawingCoords p = ScreenToDrawing(regs, pprime);
+				if (!range.ContainsY(p.y))
+					continue;
 				for (int x = 0; x < w; ++x) {
-					const u32 old_color = fb.Get32(p.x + x, p.y, stride);
+					const u32 old_color = fb.Get32(x1 + x, p.y, stride);
 					const u32 c = (old_color & keepOldMask) | (new_color & ~keepOldMask);
-					fb.Set32(p.x + x, p.y, stride, c);
+					fb.Set32(x1 + x, p.y, stride, c);
 				}
 			}
 		} else {
 			for (pprime.y = minY; pprime.y < maxY; pprime.y += 16) {
-				DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
+				DrawingCoords p = ScreenToDrawing(regs, pprime);
+				if (!range.ContainsY(p.y))
+					continue;
 				for (int x = 0; x < w; ++x) {
-					const u16 old_color = fb.Get16(p.x + x, p.y, stride);
+					const u16 old_color = fb.Get16(x1 + x, p.y, stride);
 					const u16 c = (old_color & keepOldMask) | (new_color16 & ~keepOldMask);
-					fb.Set16(p.x + x, p.y, stride, c);
+					fb.Set16(x1 + x, p.y, stride, c);
 				}
 			}
 		}
 	}
 }
 
-void DrawLine(const VertexData &v0, const VertexData &v1)
+void DrawLine(const VertexData &v0, const VertexData &v1, const RasterizerState &state, const TileRange &range)
 {
+	const GPUgstate &regs = state.regs;
+
 	// TODO: Use a proper line drawing algorithm that handles fractional endpoints correctly.
 	Vec3<int> a(v0.screenpos.x, v0.screenpos.y, v0.screenpos.z);
 	Vec3<int> b(v1.screenpos.x, v1.screenpos.y, v0.screenpos.z);
@@ -1630,41 +1095,22 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 	float yinc = (float)dy / steps;
 	float zinc = (float)dz / steps;
 
-	ScreenCoords scissorTL(TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX1(), gstate.getScissorY1(), 0)));
-	ScreenCoords scissorBR(TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX2(), gstate.getScissorY2(), 0)));
-	bool clearMode = gstate.isModeClear();
-
-	int texbufw[8] = {0};
-
-	int maxTexLevel = gstate.getTextureMaxLevel();
-	u8 *texptr[8] = {NULL};
-
-	if (!gstate.isMipmapEnabled()) {
-		// No mipmapping enabled
-		maxTexLevel = 0;
-	}
-
-	if (gstate.isTextureMapEnabled() && !clearMode) {
-		GETextureFormat texfmt = gstate.getTextureFormat();
-		for (int i = 0; i <= maxTexLevel; i++) {
-			u32 texaddr = gstate.getTextureAddress(i);
-			texbufw[i] = GetTextureBufw(i, texaddr, texfmt);
-			texptr[i] = Memory::GetPointer(texaddr);
-		}
-	}
-
-	Sampler::Funcs sampler = Sampler::GetFuncs();
+	ScreenCoords scissorTL(DrawingToScreen(regs, DrawingCoords(regs.getScissorX1(), regs.getScissorY1(), 0)));
+	ScreenCoords scissorBR(DrawingToScreen(regs, DrawingCoords(regs.getScissorX2(), regs.getScissorY2(), 0)));
+	bool clearMode = regs.isModeClear();
 
 	float x = a.x > b.x ? a.x - 1 : a.x;
 	float y = a.y > b.y ? a.y - 1 : a.y;
 	float z = a.z;
 	const int steps1 = steps == 0 ? 1 : steps;
 	for (int i = 0; i < steps; i++) {
-		if (x >= scissorTL.x && y >= scissorTL.y && x <= scissorBR.x && y <= scissorBR.y) {
+		const DrawingCoords rangeP = ScreenToDrawing(regs, ScreenCoords((int)x, (int)y, 0));
+		const bool inRange = range.Contains(rangeP.x, rangeP.y);
+		if (x >= scissorTL.x && y >= scissorTL.y && x <= scissorBR.x && y <= scissorBR.y && inRange) {
 			// Interpolate between the two points.
 			Vec4<int> prim_color;
 			Vec3<int> sec_color;
-			if (gstate.getShadeMode() == GE_SHADE_GOURAUD) {
+			if (regs.getShadeMode() == GE_SHADE_GOURAUD) {
 				prim_color = (v0.color0 * (steps - i) + v1.color0 * i) / steps1;
 				sec_color = (v0.color1 * (steps - i) + v1.color1 * i) / steps1;
 			} else {
@@ -1673,31 +1119,31 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 			}
 
 			u8 fog = 255;
-			if (gstate.isFogEnabled() && !clearMode) {
+			if (regs.isFogEnabled() && !clearMode) {
 				fog = ClampFogDepth((v0.fogdepth * (float)(steps - i) + v1.fogdepth * (float)i) / steps1);
 			}
 
-			if (gstate.isAntiAliasEnabled()) {
+			if (regs.isAntiAliasEnabled()) {
 				// TODO: Clearmode?
 				// TODO: Calculate.
 				prim_color.a() = 0x7F;
 			}
 
-			if (gstate.isTextureMapEnabled() && !clearMode) {
+			if (regs.isTextureMapEnabled() && !clearMode) {
 				float s, s1;
 				float t, t1;
-				if (gstate.isModeThrough()) {
+				if (regs.isModeThrough()) {
 					Vec2<float> tc = (v0.texturecoords * (float)(steps - i) + v1.texturecoords * (float)i) / steps1;
 					Vec2<float> tc1 = (v0.texturecoords * (float)(steps - i - 1) + v1.texturecoords * (float)(i + 1)) / steps1;
 
-					s = tc.s() * (1.0f / (float)gstate.getTextureWidth(0));
-					s1 = tc1.s() * (1.0f / (float)gstate.getTextureWidth(0));
-					t = tc.t() * (1.0f / (float)gstate.getTextureHeight(0));
-					t1 = tc1.t() * (1.0f / (float)gstate.getTextureHeight(0));
+					s = tc.s() * (1.0f / (float)regs.getTextureWidth(0));
+					s1 = tc1.s() * (1.0f / (float)regs.getTextureWidth(0));
+					t = tc.t() * (1.0f / (float)regs.getTextureHeight(0));
+					t1 = tc1.t() * (1.0f / (float)regs.getTextureHeight(0));
 				} else {
 					// Texture coordinate interpolation must definitely be perspective-correct.
-					GetTextureCoordinates(v0, v1, (float)(steps - i) / steps1, s, t);
-					GetTextureCoordinates(v0, v1, (float)(steps - i - 1) / steps1, s1, t1);
+					GetTextureCoordinates(regs, v0, v1, (float)(steps - i) / steps1, s, t);
+					GetTextureCoordinates(regs, v0, v1, (float)(steps - i - 1) / steps1, s1, t1);
 				}
 
 				// If inc is 0, force the delta to zero.
@@ -1707,19 +1153,19 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 				int texLevel;
 				int texLevelFrac;
 				bool texBilinear;
-				CalculateSamplingParams(ds, dt, maxTexLevel, texLevel, texLevelFrac, texBilinear);
+				CalculateSamplingParams(regs, ds, dt, state.maxTexLevel, texLevel, texLevelFrac, texBilinear);
 
-				if (gstate.isAntiAliasEnabled()) {
+				if (regs.isAntiAliasEnabled()) {
 					// TODO: This is a niave and wrong implementation.
-					DrawingCoords p0 = TransformUnit::ScreenToDrawing(ScreenCoords((int)x, (int)y, (int)z));
-					DrawingCoords p1 = TransformUnit::ScreenToDrawing(ScreenCoords((int)(x + xinc), (int)(y + yinc), (int)(z + zinc)));
+					DrawingCoords p0 = ScreenToDrawing(regs, ScreenCoords((int)x, (int)y, (int)z));
+					DrawingCoords p1 = ScreenToDrawing(regs, ScreenCoords((int)(x + xinc), (int)(y + yinc), (int)(z + zinc)));
 					s = ((float)p0.x + xinc / 32.0f) / 512.0f;
 					t = ((float)p0.y + yinc / 32.0f) / 512.0f;
 
 					texBilinear = true;
 				}
 
-				ApplyTexturing(sampler, prim_color, s, t, texLevel, texLevelFrac, texBilinear, texptr, texbufw);
+				ApplyTexturing(state, prim_color, s, t, texLevel, texLevelFrac, texBilinear);
 			}
 
 			if (!clearMode)
@@ -1727,12 +1173,10 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 
 			ScreenCoords pprime = ScreenCoords((int)x, (int)y, (int)z);
 
-			DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
-			if (clearMode) {
-				DrawSinglePixel<true>(p, z, fog, prim_color);
-			} else {
-				DrawSinglePixel<false>(p, z, fog, prim_color);
-			}
+			DrawingCoords p = ScreenToDrawing(regs, pprime);
+			state.drawPixel(p.x, p.y, z, fog, prim_color, state);
+			if (state.depth.marksWrites)
+				coarseDepth.MarkWritten(p.x, p.y);
 		}
 
 		x += xinc;
@@ -1750,7 +1194,7 @@ bool GetCurrentStencilbuffer(GPUDebugBuffer &buffer)
 	u8 *row = buffer.GetData();
 	for (int y = gstate.getRegionY1(); y <= gstate.getRegionY2(); ++y) {
 		for (int x = gstate.getRegionX1(); x <= gstate.getRegionX2(); ++x) {
-			row[x - gstate.getRegionX1()] = GetPixelStencil(x, y);
+			row[x - gstate.getRegionX1()] = GetPixelStencil(gstate, x, y);
 		}
 		row += w;
 	}
@@ -1776,11 +1220,16 @@ bool GetCurrentTexture(GPUDebugBuffer &buffer, int level)
 
 	Sampler::Funcs sampler = Sampler::GetFuncs();
 
+	// The sampler only reads the registers and the CLUT from the state.
+	RasterizerState state;
+	state.regs = gstate;
+	state.clut = clut;
+
 	u8 *texptr = Memory::GetPointer(texaddr);
 	u32 *row = (u32 *)buffer.GetData();
 	for (int y = 0; y < h; ++y) {
 		for (int x = 0; x < w; ++x) {
-			row[x] = sampler.nearest(x, y, texptr, texbufw, level);
+			row[x] = sampler.nearest(x, y, texptr, texbufw, level, state);
 		}
 		row += w;
 	}
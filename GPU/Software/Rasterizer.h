@@ -17,17 +17,58 @@
 
 #pragma once
 
+#include "GPU/GPUState.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Sampler.h"
 #include "TransformUnit.h" // for DrawingCoords
 
 struct GPUDebugBuffer;
 
 namespace Rasterizer {
 
+// Everything the drawing threads need about the state a primitive was queued with.  They never
+// read gstate, which has usually moved on by the time the bins are drawn.
+struct RasterizerState {
+	GPUgstate regs;
+	// The CLUT as of queueing, only read for indexed textures.
+	const u32 *clut;
+	SingleFunc drawPixel;
+	Sampler::Funcs sampler;
+	int maxTexLevel;
+	u8 *texptr[8];
+	int texbufw[8];
+	CoarseDepthBuffer::DrawState depth;
+};
+
+// Snapshots gstate into state, and picks the funcs and textures to draw it with.  clut must stay
+// unchanged until the state has been drawn.  Call on the GPU thread.
+void ComputeRasterizerState(RasterizerState *state, const u32 *clut);
+
+// Only pixels with x1 <= x < x2 and y1 <= y < y2 (drawing coordinates) are written, so threads
+// can split the screen.
+struct TileRange {
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+
+	bool ContainsX(int x) const {
+		return x >= x1 && x < x2;
+	}
+	bool ContainsY(int y) const {
+		return y >= y1 && y < y2;
+	}
+	bool Contains(int x, int y) const {
+		return ContainsX(x) && ContainsY(y);
+	}
+};
+
 // Draws a triangle if its vertices are specified in counter-clockwise order
-void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData& v2);
-void DrawPoint(const VertexData &v0);
-void DrawLine(const VertexData &v0, const VertexData &v1);
-void ClearRectangle(const VertexData &v0, const VertexData &v1);
+void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData& v2, const RasterizerState &state, const TileRange &range);
+void DrawPoint(const VertexData &v0, const RasterizerState &state, const TileRange &range);
+void DrawLine(const VertexData &v0, const VertexData &v1, const RasterizerState &state, const TileRange &range);
+void ClearRectangle(const VertexData &v0, const VertexData &v1, const RasterizerState &state, const TileRange &range);
 
 bool GetCurrentStencilbuffer(GPUDebugBuffer &buffer);
 bool GetCurrentTexture(GPUDebugBuffer &buffer, int level);
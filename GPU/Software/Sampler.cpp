@@ -21,6 +21,7 @@
 #include "Core/Reporting.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/GPUState.h"
+#include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 
 #if defined(_M_SSE)
@@ -28,13 +29,14 @@
 #endif
 
 using namespace Math3D;
-
-extern u32 clut[4096];
+using namespace Rasterizer;
 
 namespace Sampler {
 
-static u32 SampleNearest(int u, int v, const u8 *tptr, int bufw, int level);
-static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level);
+static u32 SampleNearest(int u, int v, const u8 *tptr, int bufw, int level, const RasterizerState &state);
+static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level, const RasterizerState &state);
+static u32 SampleNearestDecoded(int u, int v, const u8 *tptr, int bufw, int level, const RasterizerState &state);
+static u32 SampleLinearDecoded(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level, const RasterizerState &state);
 
 std::mutex jitCacheLock;
 SamplerJitCache *jitCache = nullptr;
@@ -48,6 +50,17 @@ void Shutdown() {
 	jitCache = nullptr;
 }
 
+bool JitCacheFull() {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	// Plenty for everything one state compiles.
+	return jitCache->GetSpaceLeft() < 65536;
+}
+
+void ClearJitCache() {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	jitCache->Clear();
+}
+
 bool DescribeCodePtr(const u8 *ptr, std::string &name) {
 	if (!jitCache->IsInSpace(ptr)) {
 		return false;
@@ -57,26 +70,26 @@ bool DescribeCodePtr(const u8 *ptr, std::string &name) {
 	return true;
 }
 
-NearestFunc GetNearestFunc() {
+NearestFunc GetNearestFunc(bool decoded) {
 	SamplerID id;
-	jitCache->ComputeSamplerID(&id, false);
+	jitCache->ComputeSamplerID(&id, false, decoded);
 	NearestFunc jitted = jitCache->GetNearest(id);
 	if (jitted) {
 		return jitted;
 	}
 
-	return &SampleNearest;
+	return decoded ? &SampleNearestDecoded : &SampleNearest;
 }
 
-LinearFunc GetLinearFunc() {
+LinearFunc GetLinearFunc(bool decoded) {
 	SamplerID id;
-	jitCache->ComputeSamplerID(&id, true);
+	jitCache->ComputeSamplerID(&id, true, decoded);
 	LinearFunc jitted = jitCache->GetLinear(id);
 	if (jitted) {
 		return jitted;
 	}
 
-	return &SampleLinear;
+	return decoded ? &SampleLinearDecoded : &SampleLinear;
 }
 
 SamplerJitCache::SamplerJitCache()
@@ -106,9 +119,18 @@ void SamplerJitCache::Clear() {
 	addresses_.clear();
 }
 
-void SamplerJitCache::ComputeSamplerID(SamplerID *id_out, bool linear) {
+void SamplerJitCache::ComputeSamplerID(SamplerID *id_out, bool linear, bool decoded) {
 	SamplerID id{};
 
+	if (decoded) {
+		// Swizzle, CLUT, and format were all handled while decoding, so this is a plain 32-bit fetch.
+		id.texfmt = GE_TFMT_8888;
+		id.useSharedClut = true;
+		id.linear = linear;
+		*id_out = id;
+		return;
+	}
+
 	id.texfmt = gstate.getTextureFormat();
 	id.swizzle = gstate.isTextureSwizzled();
 	// Only CLUT4 can use separate CLUTs per mimap.
@@ -250,9 +272,9 @@ LinearFunc SamplerJitCache::GetLinear(const SamplerID &id) {
 }
 
 template <unsigned int texel_size_bits>
-static inline int GetPixelDataOffset(unsigned int row_pitch_pixels, unsigned int u, unsigned int v)
+static inline int GetPixelDataOffset(bool swizzled, unsigned int row_pitch_pixels, unsigned int u, unsigned int v)
 {
-	if (!gstate.isTextureSwizzled())
+	if (!swizzled)
 		return (v * (row_pitch_pixels * texel_size_bits >> 3)) + (u * texel_size_bits >> 3);
 
 	const int tile_size_bits = 32;
@@ -270,26 +292,27 @@ static inline int GetPixelDataOffset(unsigned int row_pitch_pixels, unsigned int
 	return tile_idx * (tile_size_bits / 8) + ((u % texels_per_tile) * texel_size_bits) / 8;
 }
 
-static inline u32 LookupColor(unsigned int index, unsigned int level)
+static inline u32 LookupColor(unsigned int index, unsigned int level, const RasterizerState &state)
 {
-	const bool mipmapShareClut = gstate.isClutSharedForMipmaps();
+	const bool mipmapShareClut = state.regs.isClutSharedForMipmaps();
 	const int clutSharingOffset = mipmapShareClut ? 0 : level * 16;
+	const u32 *clut = state.clut;
 
-	switch (gstate.getClutPaletteFormat()) {
+	switch (state.regs.getClutPaletteFormat()) {
 	case GE_CMODE_16BIT_BGR5650:
-		return RGB565ToRGBA8888(reinterpret_cast<u16*>(clut)[index + clutSharingOffset]);
+		return RGB565ToRGBA8888(reinterpret_cast<const u16 *>(clut)[index + clutSharingOffset]);
 
 	case GE_CMODE_16BIT_ABGR5551:
-		return RGBA5551ToRGBA8888(reinterpret_cast<u16*>(clut)[index + clutSharingOffset]);
+		return RGBA5551ToRGBA8888(reinterpret_cast<const u16 *>(clut)[index + clutSharingOffset]);
 
 	case GE_CMODE_16BIT_ABGR4444:
-		return RGBA4444ToRGBA8888(reinterpret_cast<u16*>(clut)[index + clutSharingOffset]);
+		return RGBA4444ToRGBA8888(reinterpret_cast<const u16 *>(clut)[index + clutSharingOffset]);
 
 	case GE_CMODE_32BIT_ABGR8888:
 		return clut[index + clutSharingOffset];
 
 	default:
-		ERROR_LOG_REPORT(G3D, "Software: Unsupported palette format: %x", gstate.getClutPaletteFormat());
+		ERROR_LOG_REPORT(G3D, "Software: Unsupported palette format: %x", state.regs.getClutPaletteFormat());
 		return 0;
 	}
 }
@@ -303,7 +326,7 @@ struct Nearest4 {
 };
 
 template <int N>
-inline static Nearest4 SampleNearest(int u[N], int v[N], const u8 *srcptr, int texbufw, int level)
+inline static Nearest4 SampleNearest(int u[N], int v[N], const u8 *srcptr, int texbufw, int level, const RasterizerState &state)
 {
 	Nearest4 res;
 	if (!srcptr) {
@@ -311,69 +334,71 @@ inline static Nearest4 SampleNearest(int u[N], int v[N], const u8 *srcptr, int t
 		return res;
 	}
 
-	GETextureFormat texfmt = gstate.getTextureFormat();
+	const GPUgstate &regs = state.regs;
+	GETextureFormat texfmt = regs.getTextureFormat();
+	const bool swizzled = regs.isTextureSwizzled();
 
 	// TODO: Should probably check if textures are aligned properly...
 
 	switch (texfmt) {
 	case GE_TFMT_4444:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<16>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<16>(swizzled, texbufw, u[i], v[i]);
 			res.v[i] = RGBA4444ToRGBA8888(*(const u16 *)src);
 		}
 		return res;
 	
 	case GE_TFMT_5551:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<16>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<16>(swizzled, texbufw, u[i], v[i]);
 			res.v[i] = RGBA5551ToRGBA8888(*(const u16 *)src);
 		}
 		return res;
 
 	case GE_TFMT_5650:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<16>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<16>(swizzled, texbufw, u[i], v[i]);
 			res.v[i] = RGB565ToRGBA8888(*(const u16 *)src);
 		}
 		return res;
 
 	case GE_TFMT_8888:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<32>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<32>(swizzled, texbufw, u[i], v[i]);
 			res.v[i] = *(const u32 *)src;
 		}
 		return res;
 
 	case GE_TFMT_CLUT32:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<32>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<32>(swizzled, texbufw, u[i], v[i]);
 			u32 val = src[0] + (src[1] << 8) + (src[2] << 16) + (src[3] << 24);
-			res.v[i] = LookupColor(gstate.transformClutIndex(val), 0);
+			res.v[i] = LookupColor(regs.transformClutIndex(val), 0, state);
 		}
 		return res;
 
 	case GE_TFMT_CLUT16:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<16>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<16>(swizzled, texbufw, u[i], v[i]);
 			u16 val = src[0] + (src[1] << 8);
-			res.v[i] = LookupColor(gstate.transformClutIndex(val), 0);
+			res.v[i] = LookupColor(regs.transformClutIndex(val), 0, state);
 		}
 		return res;
 
 	case GE_TFMT_CLUT8:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<8>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<8>(swizzled, texbufw, u[i], v[i]);
 			u8 val = *src;
-			res.v[i] = LookupColor(gstate.transformClutIndex(val), 0);
+			res.v[i] = LookupColor(regs.transformClutIndex(val), 0, state);
 		}
 		return res;
 
 	case GE_TFMT_CLUT4:
 		for (int i = 0; i < N; ++i) {
-			const u8 *src = srcptr + GetPixelDataOffset<4>(texbufw, u[i], v[i]);
+			const u8 *src = srcptr + GetPixelDataOffset<4>(swizzled, texbufw, u[i], v[i]);
 			u8 val = (u[i] & 1) ? (src[0] >> 4) : (src[0] & 0xF);
 			// Only CLUT4 uses separate mipmap palettes.
-			res.v[i] = LookupColor(gstate.transformClutIndex(val), level);
+			res.v[i] = LookupColor(regs.transformClutIndex(val), level, state);
 		}
 		return res;
 
@@ -411,13 +436,15 @@ inline static Nearest4 SampleNearest(int u[N], int v[N], const u8 *srcptr, int t
 	}
 }
 
-static u32 SampleNearest(int u, int v, const u8 *tptr, int bufw, int level) {
-	return SampleNearest<1>(&u, &v, tptr, bufw, level);
+static u32 SampleNearest(int u, int v, const u8 *tptr, int bufw, int level, const RasterizerState &state) {
+	return SampleNearest<1>(&u, &v, tptr, bufw, level, state);
 }
 
-static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int texlevel) {
-	Nearest4 c = SampleNearest<4>(u, v, tptr, bufw, texlevel);
+static u32 SampleNearestDecoded(int u, int v, const u8 *tptr, int bufw, int level, const RasterizerState &state) {
+	return ((const u32 *)tptr)[v * bufw + u];
+}
 
+static inline u32 LerpTexels(const Nearest4 &c, int frac_u, int frac_v) {
 	Vec4<int> texcolor_tl = Vec4<int>::FromRGBA(c.v[0]);
 	Vec4<int> texcolor_tr = Vec4<int>::FromRGBA(c.v[1]);
 	Vec4<int> texcolor_bl = Vec4<int>::FromRGBA(c.v[2]);
@@ -427,4 +454,18 @@ static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tp
 	return ((t * (0x100 - frac_v) + b * frac_v) / (256 * 256)).ToRGBA();
 }
 
+static u32 SampleLinear(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int texlevel, const RasterizerState &state) {
+	Nearest4 c = SampleNearest<4>(u, v, tptr, bufw, texlevel, state);
+	return LerpTexels(c, frac_u, frac_v);
+}
+
+static u32 SampleLinearDecoded(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int texlevel, const RasterizerState &state) {
+	const u32 *src = (const u32 *)tptr;
+	Nearest4 c;
+	for (int i = 0; i < 4; ++i) {
+		c.v[i] = src[v[i] * bufw + u[i]];
+	}
+	return LerpTexels(c, frac_u, frac_v);
+}
+
 };
@@ -69,28 +69,41 @@ struct hash<SamplerID> {
 
 };
 
+namespace Rasterizer {
+struct RasterizerState;
+};
+
 namespace Sampler {
 
-typedef u32 (*NearestFunc)(int u, int v, const u8 *tptr, int bufw, int level);
-NearestFunc GetNearestFunc();
+// The funcs are picked for the current gstate, but read the format and CLUT from state, which
+// is the copy a primitive was queued with.
+// When decoded is true, the texture data has already been expanded to unswizzled 8888
+// (see SoftTextureCache), and bufw is in those texels.
+typedef u32 (*NearestFunc)(int u, int v, const u8 *tptr, int bufw, int level, const Rasterizer::RasterizerState &state);
+NearestFunc GetNearestFunc(bool decoded = false);
 
-typedef u32 (*LinearFunc)(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level);
-LinearFunc GetLinearFunc();
+typedef u32 (*LinearFunc)(int u[4], int v[4], int frac_u, int frac_v, const u8 *tptr, int bufw, int level, const Rasterizer::RasterizerState &state);
+LinearFunc GetLinearFunc(bool decoded = false);
 
 struct Funcs {
 	NearestFunc nearest;
 	LinearFunc linear;
 };
-static inline Funcs GetFuncs() {
+static inline Funcs GetFuncs(bool decoded = false) {
 	Funcs f;
-	f.nearest = GetNearestFunc();
-	f.linear = GetLinearFunc();
+	f.nearest = GetNearestFunc(decoded);
+	f.linear = GetLinearFunc(decoded);
 	return f;
 }
 
 void Init();
 void Shutdown();
 
+// Compiling clears the cache when it runs out of space, which frees funcs already handed out.
+// This is true well before then, so queued draws can be finished and ClearJitCache() called.
+bool JitCacheFull();
+void ClearJitCache();
+
 bool DescribeCodePtr(const u8 *ptr, std::string &name);
 
 #if PPSSPP_ARCH(ARM)
@@ -107,7 +120,7 @@ class SamplerJitCache : public FakeGen::FakeXCodeBlock {
 public:
 	SamplerJitCache();
 
-	void ComputeSamplerID(SamplerID *id_out, bool linear);
+	void ComputeSamplerID(SamplerID *id_out, bool linear, bool decoded = false);
 
 	// Returns a pointer to the code to run.
 	NearestFunc GetNearest(const SamplerID &id);
@@ -128,6 +141,9 @@ class SamplerJitCache : public FakeGen::FakeXCodeBlock {
 	bool Jit_Decode5650();
 	bool Jit_Decode5551();
 	bool Jit_Decode4444();
+#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+	void LoadStatePtr(const SamplerID &id, Gen::X64Reg dest);
+#endif
 	bool Jit_TransformClutIndex(const SamplerID &id, int bitsPerIndex);
 	bool Jit_ReadClutColor(const SamplerID &id);
 
@@ -18,16 +18,17 @@
 #include "ppsspp_config.h"
 #if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
 
+#include <cstddef>
 #include <emmintrin.h>
 #include "Common/x64Emitter.h"
 #include "Common/CPUDetect.h"
 #include "GPU/GPUState.h"
+#include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/ge_constants.h"
 
 using namespace Gen;
-
-extern u32 clut[4096];
+using namespace Rasterizer;
 
 namespace Sampler {
 
@@ -46,6 +47,7 @@ static const X64Reg arg5Reg = R8;
 static const X64Reg arg6Reg = R9;
 
 static const X64Reg levelReg = arg5Reg;
+static const X64Reg stateReg = arg6Reg;
 #endif
 
 static const X64Reg resultReg = RAX;
@@ -116,10 +118,10 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 	const u8 *start = AlignCode16();
 
 	// NOTE: This doesn't use the general register mapping.
-	// POSIX: arg1=uptr, arg2=vptr, arg3=frac_u, arg4=frac_v, arg5=src, arg6=bufw, stack+8=level
-	// Win64: arg1=uptr, arg2=vptr, arg3=frac_u, arg4=frac_v, stack+40=src, stack+48=bufw, stack+56=level
+	// POSIX: arg1=uptr, arg2=vptr, arg3=frac_u, arg4=frac_v, arg5=src, arg6=bufw, stack+8=level, stack+16=state
+	// Win64: arg1=uptr, arg2=vptr, arg3=frac_u, arg4=frac_v, stack+40=src, stack+48=bufw, stack+56=level, stack+64=state
 	//
-	// We map these to nearest CALLs, with order: u, v, src, bufw, level
+	// We map these to nearest CALLs, with order: u, v, src, bufw, level, state
 
 	// Let's start by saving a bunch of registers.
 	PUSH(R15);
@@ -140,11 +142,11 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 	const int argOffset = 24 + 48 + 8 + 32;
 	MOV(64, R(R14), MDisp(RSP, argOffset));
 	MOV(32, R(R15), MDisp(RSP, argOffset + 8));
-	// level is at argOffset + 16.
+	// level is at argOffset + 16, and state at argOffset + 24.
 #else
 	MOV(64, R(R14), R(arg5Reg));
 	MOV(32, R(R15), R(arg6Reg));
-	// level is at 24 + 48 + 8.
+	// level is at 24 + 48 + 8, and state at 24 + 48 + 16.
 #endif
 
 	// Early exit on !srcPtr.
@@ -165,7 +167,7 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 		MOV(32, R(vReg), MDisp(R13, off));
 		MOV(64, R(srcReg), R(R14));
 		MOV(32, R(bufwReg), R(R15));
-		// Leave level, we just always load from RAM.  Separate CLUTs is uncommon.
+		// Leave level and state, we just always load from RAM.  Separate CLUTs is uncommon.
 
 		CALL(nearest);
 		MOV(32, MDisp(RSP, off), R(resultReg));
@@ -588,6 +590,25 @@ bool SamplerJitCache::Jit_Decode4444() {
 	return true;
 }
 
+void SamplerJitCache::LoadStatePtr(const SamplerID &id, X64Reg dest) {
+	if (id.linear) {
+#ifdef _WIN32
+		const int argOffset = 24 + 48 + 8 + 32;
+		// Extra 8 to account for CALL.
+		MOV(PTRBITS, R(dest), MDisp(RSP, argOffset + 24 + 8));
+#else
+		// Extra 8 to account for CALL.
+		MOV(PTRBITS, R(dest), MDisp(RSP, 24 + 48 + 16 + 8));
+#endif
+	} else {
+#ifdef _WIN32
+		MOV(PTRBITS, R(dest), MDisp(RSP, 48));
+#else
+		MOV(PTRBITS, R(dest), R(stateReg));
+#endif
+	}
+}
+
 bool SamplerJitCache::Jit_TransformClutIndex(const SamplerID &id, int bitsPerIndex) {
 	GEPaletteFormat fmt = (GEPaletteFormat)id.clutfmt;
 	if (!id.hasClutShift && !id.hasClutMask && !id.hasClutOffset) {
@@ -598,8 +619,8 @@ bool SamplerJitCache::Jit_TransformClutIndex(const SamplerID &id, int bitsPerInd
 		return true;
 	}
 
-	MOV(PTRBITS, R(tempReg1), ImmPtr(&gstate.clutformat));
-	MOV(32, R(tempReg1), MatR(tempReg1));
+	LoadStatePtr(id, tempReg1);
+	MOV(32, R(tempReg1), MDisp(tempReg1, (int)(offsetof(RasterizerState, regs) + offsetof(GPUgstate, clutformat))));
 
 	// Shift = (clutformat >> 2) & 0x1F
 	if (id.hasClutShift) {
@@ -663,7 +684,8 @@ bool SamplerJitCache::Jit_ReadClutColor(const SamplerID &id) {
 		LEA(64, resultReg, MComplex(resultReg, tempReg2, SCALE_4, 0));
 	}
 
-	MOV(PTRBITS, R(tempReg1), ImmPtr(clut));
+	LoadStatePtr(id, tempReg1);
+	MOV(PTRBITS, R(tempReg1), MDisp(tempReg1, (int)offsetof(RasterizerState, clut)));
 
 	switch ((GEPaletteFormat)id.clutfmt) {
 	case GE_CMODE_16BIT_BGR5650:
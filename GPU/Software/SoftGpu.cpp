@@ -32,9 +32,12 @@
 #include "profiler/profiler.h"
 #include "thin3d/thin3d.h"
 
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/Software/SoftGpu.h"
+#include "GPU/Software/SoftTextureCache.h"
 #include "GPU/Software/TransformUnit.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/FramebufferCommon.h"
@@ -104,6 +107,7 @@ SoftGPU::SoftGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	displayFormat_ = GE_FORMAT_8888;
 
 	Sampler::Init();
+	Rasterizer::Init();
 	drawEngine_ = new SoftwareDrawEngine();
 	drawEngineCommon_ = drawEngine_;
 }
@@ -134,6 +138,8 @@ SoftGPU::~SoftGPU() {
 	samplerLinear = nullptr;
 
 	Sampler::Shutdown();
+	Rasterizer::Shutdown();
+	softTexCache.Clear();
 }
 
 void SoftGPU::SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) {
@@ -293,6 +299,8 @@ void SoftGPU::CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight) {
 }
 
 void SoftGPU::CopyDisplayToOutput() {
+	drawEngine_->transformUnit.Flush();
+	softTexCache.Decimate();
 	// The display always shows 480x272.
 	CopyToCurrentFboFromDisplayRam(FB_WIDTH, FB_HEIGHT);
 	framebufferDirty_ = false;
@@ -307,6 +315,13 @@ void SoftGPU::CopyDisplayToOutput() {
 	}
 }
 
+void SoftGPU::FinishDeferred() {
+	// The CPU may look at or change anything once the list stops, so draw what's queued.
+	drawEngine_->transformUnit.Flush();
+	// It might also write to the depth buffer directly.
+	coarseDepth.InvalidateAll();
+}
+
 void SoftGPU::FastRunLoop(DisplayList &list) {
 	PROFILE_THIS_SCOPE("soft_runloop");
 	for (; downcount > 0; --downcount) {
@@ -321,10 +336,137 @@ void SoftGPU::FastRunLoop(DisplayList &list) {
 	}
 }
 
+// Whether this command changes state the rasterizer reads, so queued primitives need a new one.
+static bool CommandAffectsRasterizer(u32 cmd, u32 diff) {
+	switch (cmd) {
+	case GE_CMD_NOP:
+	case GE_CMD_VADDR:
+	case GE_CMD_IADDR:
+	case GE_CMD_PRIM:
+	case GE_CMD_BEZIER:
+	case GE_CMD_SPLINE:
+	case GE_CMD_BOUNDINGBOX:
+	case GE_CMD_JUMP:
+	case GE_CMD_BJUMP:
+	case GE_CMD_CALL:
+	case GE_CMD_RET:
+	case GE_CMD_END:
+	case GE_CMD_SIGNAL:
+	case GE_CMD_FINISH:
+	case GE_CMD_BASE:
+	case GE_CMD_OFFSETADDR:
+	case GE_CMD_ORIGIN:
+	case GE_CMD_LIGHTINGENABLE:
+	case GE_CMD_LIGHTENABLE0:
+	case GE_CMD_LIGHTENABLE1:
+	case GE_CMD_LIGHTENABLE2:
+	case GE_CMD_LIGHTENABLE3:
+	case GE_CMD_DEPTHCLAMPENABLE:
+	case GE_CMD_CULLFACEENABLE:
+	case GE_CMD_PATCHCULLENABLE:
+	case GE_CMD_DITHERENABLE:
+	case GE_CMD_BONEMATRIXNUMBER:
+	case GE_CMD_BONEMATRIXDATA:
+	case GE_CMD_MORPHWEIGHT0:
+	case GE_CMD_MORPHWEIGHT1:
+	case GE_CMD_MORPHWEIGHT2:
+	case GE_CMD_MORPHWEIGHT3:
+	case GE_CMD_MORPHWEIGHT4:
+	case GE_CMD_MORPHWEIGHT5:
+	case GE_CMD_MORPHWEIGHT6:
+	case GE_CMD_MORPHWEIGHT7:
+	case GE_CMD_PATCHDIVISION:
+	case GE_CMD_PATCHPRIMITIVE:
+	case GE_CMD_PATCHFACING:
+	case GE_CMD_WORLDMATRIXNUMBER:
+	case GE_CMD_WORLDMATRIXDATA:
+	case GE_CMD_VIEWMATRIXNUMBER:
+	case GE_CMD_VIEWMATRIXDATA:
+	case GE_CMD_PROJMATRIXNUMBER:
+	case GE_CMD_PROJMATRIXDATA:
+	case GE_CMD_TGENMATRIXNUMBER:
+	case GE_CMD_VIEWPORTXSCALE:
+	case GE_CMD_VIEWPORTYSCALE:
+	case GE_CMD_VIEWPORTZSCALE:
+	case GE_CMD_VIEWPORTXCENTER:
+	case GE_CMD_VIEWPORTYCENTER:
+	case GE_CMD_VIEWPORTZCENTER:
+	case GE_CMD_TEXSCALEU:
+	case GE_CMD_TEXSCALEV:
+	case GE_CMD_TEXOFFSETU:
+	case GE_CMD_TEXOFFSETV:
+	case GE_CMD_REVERSENORMAL:
+	case GE_CMD_MATERIALUPDATE:
+	case GE_CMD_MATERIALEMISSIVE:
+	case GE_CMD_MATERIALAMBIENT:
+	case GE_CMD_MATERIALDIFFUSE:
+	case GE_CMD_MATERIALSPECULAR:
+	case GE_CMD_MATERIALALPHA:
+	case GE_CMD_MATERIALSPECULARCOEF:
+	case GE_CMD_AMBIENTCOLOR:
+	case GE_CMD_AMBIENTALPHA:
+	case GE_CMD_LIGHTMODE:
+	case GE_CMD_LIGHTTYPE0:
+	case GE_CMD_LIGHTTYPE1:
+	case GE_CMD_LIGHTTYPE2:
+	case GE_CMD_LIGHTTYPE3:
+	case GE_CMD_LX0: case GE_CMD_LY0: case GE_CMD_LZ0:
+	case GE_CMD_LX1: case GE_CMD_LY1: case GE_CMD_LZ1:
+	case GE_CMD_LX2: case GE_CMD_LY2: case GE_CMD_LZ2:
+	case GE_CMD_LX3: case GE_CMD_LY3: case GE_CMD_LZ3:
+	case GE_CMD_LDX0: case GE_CMD_LDY0: case GE_CMD_LDZ0:
+	case GE_CMD_LDX1: case GE_CMD_LDY1: case GE_CMD_LDZ1:
+	case GE_CMD_LDX2: case GE_CMD_LDY2: case GE_CMD_LDZ2:
+	case GE_CMD_LDX3: case GE_CMD_LDY3: case GE_CMD_LDZ3:
+	case GE_CMD_LKA0: case GE_CMD_LKB0: case GE_CMD_LKC0:
+	case GE_CMD_LKA1: case GE_CMD_LKB1: case GE_CMD_LKC1:
+	case GE_CMD_LKA2: case GE_CMD_LKB2: case GE_CMD_LKC2:
+	case GE_CMD_LKA3: case GE_CMD_LKB3: case GE_CMD_LKC3:
+	case GE_CMD_LKS0: case GE_CMD_LKS1: case GE_CMD_LKS2: case GE_CMD_LKS3:
+	case GE_CMD_LKO0: case GE_CMD_LKO1: case GE_CMD_LKO2: case GE_CMD_LKO3:
+	case GE_CMD_LAC0: case GE_CMD_LDC0: case GE_CMD_LSC0:
+	case GE_CMD_LAC1: case GE_CMD_LDC1: case GE_CMD_LSC1:
+	case GE_CMD_LAC2: case GE_CMD_LDC2: case GE_CMD_LSC2:
+	case GE_CMD_LAC3: case GE_CMD_LDC3: case GE_CMD_LSC3:
+	case GE_CMD_CULL:
+	case GE_CMD_TEXSHADELS:
+	case GE_CMD_FOG1:
+	case GE_CMD_FOG2:
+	case GE_CMD_TRANSFERSRC:
+	case GE_CMD_TRANSFERSRCW:
+	case GE_CMD_TRANSFERDST:
+	case GE_CMD_TRANSFERDSTW:
+	case GE_CMD_TRANSFERSRCPOS:
+	case GE_CMD_TRANSFERDSTPOS:
+	case GE_CMD_TRANSFERSIZE:
+	case GE_CMD_TEXFLUSH:
+	case GE_CMD_TEXSYNC:
+	case GE_CMD_CLUTADDR:
+	case GE_CMD_CLUTADDRUPPER:
+	case GE_CMD_DITH0:
+	case GE_CMD_DITH1:
+	case GE_CMD_DITH2:
+	case GE_CMD_DITH3:
+		return false;
+
+	case GE_CMD_VERTEXTYPE:
+		// Only through mode matters after transform.
+		return (diff & GE_VTYPE_THROUGH_MASK) != 0;
+
+	default:
+		return true;
+	}
+}
+
 void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 	u32 cmd = op >> 24;
 	u32 data = op & 0xFFFFFF;
 
+	TransformUnit &transformUnit = drawEngine_->transformUnit;
+	if (diff != 0 && CommandAffectsRasterizer(cmd, diff)) {
+		transformUnit.MarkDirty();
+	}
+
 	// Handle control and drawing commands here directly. The others we delegate.
 	switch (cmd) {
 	case GE_CMD_BASE:
@@ -361,7 +503,7 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 
 			cyclesExecuted += EstimatePerVertexCost() * count;
 			int bytesRead;
-			drawEngine_->transformUnit.SubmitPrimitive(verts, indices, prim, count, gstate.vertType, &bytesRead, drawEngine_);
+			transformUnit.SubmitPrimitive(verts, indices, prim, count, gstate.vertType, &bytesRead, drawEngine_);
 			framebufferDirty_ = true;
 
 			// After drawing, we advance the vertexAddr (when non indexed) or indexAddr (when indexed).
@@ -558,14 +700,13 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 		break;
 
 	case GE_CMD_FRAMEBUFPTR:
-		fb.data = Memory::GetPointer(gstate.getFrameBufAddress());
-		break;
-
 	case GE_CMD_FRAMEBUFWIDTH:
-		fb.data = Memory::GetPointer(gstate.getFrameBufAddress());
-		break;
-
 	case GE_CMD_FRAMEBUFPIXFORMAT:
+		// Queued primitives draw through fb, and threads only own separate memory while the
+		// layout stays the same.  So let them finish first.
+		if (diff != 0)
+			transformUnit.Flush();
+		fb.data = Memory::GetPointer(gstate.getFrameBufAddress());
 		break;
 
 	case GE_CMD_TEXADDR0:
@@ -596,6 +737,9 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 		{
 			u32 clutAddr = gstate.getClutAddress();
 			u32 clutTotalBytes = gstate.getClutLoadBytes();
+			// Queued primitives have their own copy, but might be drawing the new one.
+			if (transformUnit.HasPendingWrite(clutAddr, clutTotalBytes))
+				transformUnit.Flush();
 
 			if (Memory::IsValidAddress(clutAddr)) {
 				u32 validSize = Memory::ValidSize(clutAddr, clutTotalBytes);
@@ -609,6 +753,8 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 				DEBUG_LOG(G3D, "Software: Invalid CLUT address, filling with garbage instead of crashing");
 				memset(clut, 0x00, clutTotalBytes);
 			}
+			softTexCache.NotifyClutLoaded(clut);
+			transformUnit.MarkClutDirty();
 		}
 		break;
 
@@ -624,6 +770,7 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 
 	case GE_CMD_TRANSFERSTART:
 		{
+			transformUnit.Flush();
 			u32 srcBasePtr = gstate.getTransferSrcAddress();
 			u32 srcStride = gstate.getTransferSrcStride();
 
@@ -648,6 +795,8 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 				u8 *dst = Memory::GetPointer(dstBasePtr + ((y + dstY) * dstStride + dstX) * bpp);
 				memcpy(dst, src, width * bpp);
 			}
+			softTexCache.Invalidate(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp, GPU_INVALIDATE_HINT);
+			coarseDepth.Invalidate(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp, GPU_INVALIDATE_HINT);
 
 			CBreakPoints::ExecMemCheck(srcBasePtr + (srcY * srcStride + srcX) * bpp, false, height * srcStride * bpp, currentMIPS->pc);
 			CBreakPoints::ExecMemCheck(dstBasePtr + (srcY * dstStride + srcX) * bpp, true, height * dstStride * bpp, currentMIPS->pc);
@@ -671,10 +820,9 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 		break;
 
 	case GE_CMD_ZBUFPTR:
-		depthbuf.data = Memory::GetPointer(gstate.getDepthBufAddress());
-		break;
-
 	case GE_CMD_ZBUFWIDTH:
+		if (diff != 0)
+			transformUnit.Flush();
 		depthbuf.data = Memory::GetPointer(gstate.getDepthBufAddress());
 		break;
 
@@ -843,6 +991,7 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 			int num = gstate.texmtxnum & 0xF;
 			if (num < 12) {
 				gstate.tgenMatrix[num] = getFloat24(data);
+				transformUnit.MarkDirty();
 			}
 			gstate.texmtxnum = (++num) & 0xF;
 		}
@@ -872,9 +1021,10 @@ void SoftGPU::GetStats(char *buffer, size_t bufsize) {
 	snprintf(buffer, bufsize, "SoftGPU: (N/A)");
 }
 
-void SoftGPU::InvalidateCache(u32 addr, int size, GPUInvalidationType type)
+void SoftGPU::InvalidateCacheInternal(u32 addr, int size, GPUInvalidationType type)
 {
-	// Nothing to invalidate.
+	softTexCache.Invalidate(addr, size, type);
+	coarseDepth.Invalidate(addr, size, type);
 }
 
 void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
@@ -884,6 +1034,8 @@ void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
 
 bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size)
 {
+	// The caller does the memory op, so queued draws must be done with it first.
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyMemcpy(dest, src, size);
@@ -894,6 +1046,8 @@ bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size)
 
 bool SoftGPU::PerformMemorySet(u32 dest, u8 v, int size)
 {
+	// The caller does the memory op, so queued draws must be done with it first.
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyMemset(dest, v, size);
@@ -904,6 +1058,8 @@ bool SoftGPU::PerformMemorySet(u32 dest, u8 v, int size)
 
 bool SoftGPU::PerformMemoryDownload(u32 dest, int size)
 {
+	// The caller does the memory op, so queued draws must be done with it first.
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	return false;
@@ -911,6 +1067,8 @@ bool SoftGPU::PerformMemoryDownload(u32 dest, int size)
 
 bool SoftGPU::PerformMemoryUpload(u32 dest, int size)
 {
+	// The caller does the memory op, so queued draws must be done with it first.
+	SyncThread();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyUpload(dest, size);
@@ -932,6 +1090,7 @@ bool SoftGPU::FramebufferDirty() {
 }
 
 bool SoftGPU::GetCurrentFramebuffer(GPUDebugBuffer &buffer, GPUDebugFramebufferType type, int maxRes) {
+	drawEngine_->transformUnit.Flush();
 	int x1 = gstate.getRegionX1();
 	int y1 = gstate.getRegionY1();
 	int x2 = gstate.getRegionX2() + 1;
@@ -968,6 +1127,7 @@ bool SoftGPU::GetOutputFramebuffer(GPUDebugBuffer &buffer) {
 
 bool SoftGPU::GetCurrentDepthbuffer(GPUDebugBuffer &buffer)
 {
+	drawEngine_->transformUnit.Flush();
 	const int w = gstate.getRegionX2() - gstate.getRegionX1() + 1;
 	const int h = gstate.getRegionY2() - gstate.getRegionY1() + 1;
 	buffer.Allocate(w, h, GPU_DBG_FORMAT_16BIT);
@@ -985,11 +1145,13 @@ bool SoftGPU::GetCurrentDepthbuffer(GPUDebugBuffer &buffer)
 
 bool SoftGPU::GetCurrentStencilbuffer(GPUDebugBuffer &buffer)
 {
+	drawEngine_->transformUnit.Flush();
 	return Rasterizer::GetCurrentStencilbuffer(buffer);
 }
 
 bool SoftGPU::GetCurrentTexture(GPUDebugBuffer &buffer, int level)
 {
+	drawEngine_->transformUnit.Flush();
 	return Rasterizer::GetCurrentTexture(buffer, level);
 }
 
@@ -1014,5 +1176,9 @@ bool SoftGPU::DescribeCodePtr(const u8 *ptr, std::string &name) {
 		name = "SamplerJit:" + subname;
 		return true;
 	}
+	if (Rasterizer::DescribeCodePtr(ptr, subname)) {
+		name = "PixelJit:" + subname;
+		return true;
+	}
 	return false;
 }
@@ -60,7 +60,7 @@ class SoftGPU : public GPUCommon {
 	void SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) override;
 	void CopyDisplayToOutput() override;
 	void GetStats(char *buffer, size_t bufsize) override;
-	void InvalidateCache(u32 addr, int size, GPUInvalidationType type) override;
+	void InvalidateCacheInternal(u32 addr, int size, GPUInvalidationType type) override;
 	void NotifyVideoUpload(u32 addr, int size, int width, int format) override;
 	bool PerformMemoryCopy(u32 dest, u32 src, int size) override;
 	bool PerformMemorySet(u32 dest, u8 v, int size) override;
@@ -96,6 +96,7 @@ class SoftGPU : public GPUCommon {
 
 protected:
 	void FastRunLoop(DisplayList &list) override;
+	void FinishDeferred() override;
 	void CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight);
 
 private:
@@ -0,0 +1,185 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+
+#include "profiler/profiler.h"
+
+#include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "GPU/GPU.h"
+#include "GPU/GPUState.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/SoftTextureCache.h"
+
+// Same as the hardware texture cache.
+static const int DECODED_KILL_AGE = 200;
+// Largest texture we might need to find when invalidating.
+static const u32 LARGEST_TEXTURE_SIZE = 512 * 512 * 4;
+// Covers every entry transformClutIndex() and the mipmap CLUT offsets can reach.
+static const u32 CLUT_HASH_BYTES = 1024 * sizeof(u32);
+
+SoftTextureCache softTexCache;
+
+bool SoftTextureCache::Entry::Matches(int w2, int h2, int bufw2, GETextureFormat format2, int level2, bool swizzle2, bool sharedClut2) const {
+	return w == w2 && h == h2 && bufw == bufw2 && format == format2 && level == level2 && swizzle == swizzle2 && sharedClut == sharedClut2;
+}
+
+bool SoftTextureCache::Prepare(Rasterizer::RasterizerState *state) {
+	if (!g_Config.bSoftwareTextureCache || !gstate.isTextureMapEnabled() || gstate.isModeClear()) {
+		return false;
+	}
+
+	const int maxLevel = state->maxTexLevel;
+	// This is the regular sampler for the current state, which does all the hard work.
+	Sampler::NearestFunc decode = Sampler::GetNearestFunc();
+
+	lookups_++;
+	u8 *texptr[8];
+	int texbufw[8];
+	for (int i = 0; i <= maxLevel; ++i) {
+		const Entry *entry = LookupLevel(i, decode, *state);
+		if (!entry) {
+			return false;
+		}
+		texptr[i] = (u8 *)entry->data.data();
+		texbufw[i] = entry->w;
+	}
+
+	for (int i = 0; i <= maxLevel; ++i) {
+		state->texptr[i] = texptr[i];
+		state->texbufw[i] = texbufw[i];
+	}
+	return true;
+}
+
+void SoftTextureCache::Flushed() {
+	flushedLookups_ = lookups_;
+}
+
+const SoftTextureCache::Entry *SoftTextureCache::LookupLevel(int level, Sampler::NearestFunc decode, const Rasterizer::RasterizerState &state) {
+	const u32 texaddr = gstate.getTextureAddress(level) & 0x3FFFFFFF;
+	const GETextureFormat format = gstate.getTextureFormat();
+	const int bufw = GetTextureBufw(level, texaddr, format);
+	const int w = gstate.getTextureWidth(level);
+	const int h = gstate.getTextureHeight(level);
+	const bool swizzle = gstate.isTextureSwizzled();
+	const bool sharedClut = gstate.isClutSharedForMipmaps();
+
+	// Swizzled textures are stored in whole blocks of 8 rows.
+	const int rowsInRAM = swizzle ? (h + 7) & ~7 : h;
+	const u32 sizeInRAM = (textureBitsPerPixel[format] * bufw * rowsInRAM) / 8;
+	// Textures wider than their stride wrap in odd ways, leave those to the regular sampler.
+	if (texaddr == 0 || w > bufw || Memory::IsVRAMAddress(texaddr) || !Memory::IsValidRange(texaddr, sizeInRAM)) {
+		return nullptr;
+	}
+
+	u32 cluthash = 0;
+	if (gstate.isTextureFormatIndexed()) {
+		cluthash = clutHash_ ^ gstate.clutformat;
+	}
+	const u64 cachekey = ((u64)texaddr << 32) | cluthash;
+
+	std::unique_ptr<Entry> &slot = cache_[cachekey];
+	if (slot && slot->lastLookup > flushedLookups_) {
+		// Already checked since the last flush, so queued draws may still be reading it.  If it's
+		// changed, or another level with the same address, we can't replace the data.
+		if (slot->invalid || !slot->Matches(w, h, bufw, format, level, swizzle, sharedClut))
+			return nullptr;
+		slot->lastLookup = lookups_;
+		return slot.get();
+	}
+	if (!slot) {
+		slot.reset(new Entry());
+		slot->invalid = true;
+	}
+
+	Entry *entry = slot.get();
+	const bool match = !entry->invalid && entry->Matches(w, h, bufw, format, level, swizzle, sharedClut);
+	const u8 *texptr = Memory::GetPointerUnchecked(texaddr);
+	if (!match || entry->lastFrame != gpuStats.numFlips) {
+		const u32 texhash = DoQuickTexHash(texptr, sizeInRAM);
+		if (!match || texhash != entry->hash) {
+			PROFILE_THIS_SCOPE("softtexdecode");
+
+			entry->addr = texaddr;
+			entry->sizeInRAM = sizeInRAM;
+			entry->hash = texhash;
+			entry->w = w;
+			entry->h = h;
+			entry->bufw = bufw;
+			entry->format = format;
+			entry->level = level;
+			entry->swizzle = swizzle;
+			entry->sharedClut = sharedClut;
+
+			entry->data.resize(w * h);
+			u32 *dst = entry->data.data();
+			for (int y = 0; y < h; ++y) {
+				for (int x = 0; x < w; ++x) {
+					*dst++ = decode(x, y, texptr, bufw, level, state);
+				}
+			}
+		}
+	}
+
+	entry->invalid = false;
+	entry->lastFrame = gpuStats.numFlips;
+	entry->lastLookup = lookups_;
+	return entry;
+}
+
+void SoftTextureCache::NotifyClutLoaded(const u32 *clut) {
+	clutHash_ = DoQuickTexHash(clut, CLUT_HASH_BYTES);
+}
+
+void SoftTextureCache::Invalidate(u32 addr, int size, GPUInvalidationType type) {
+	if (type == GPU_INVALIDATE_ALL) {
+		for (auto &it : cache_) {
+			it.second->invalid = true;
+		}
+		return;
+	}
+
+	addr &= 0x3FFFFFFF;
+	const u32 addr_end = addr + size;
+
+	// Entries are sorted by address, so only look at those that could overlap.
+	const u64 startKey = addr < LARGEST_TEXTURE_SIZE ? 0 : (u64)(addr - LARGEST_TEXTURE_SIZE) << 32;
+	const u64 endKey = (u64)addr_end << 32;
+	for (auto it = cache_.lower_bound(startKey), end = cache_.lower_bound(endKey); it != end; ++it) {
+		Entry *entry = it->second.get();
+		if (entry->addr < addr_end && addr < entry->addr + entry->sizeInRAM) {
+			entry->invalid = true;
+		}
+	}
+}
+
+void SoftTextureCache::Decimate() {
+	for (auto it = cache_.begin(); it != cache_.end(); ) {
+		if (it->second->lastFrame + DECODED_KILL_AGE < gpuStats.numFlips) {
+			it = cache_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void SoftTextureCache::Clear() {
+	cache_.clear();
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "GPU/GPUInterface.h"
+#include "GPU/Software/Sampler.h"
+
+// Optionally keeps unswizzled, linear RGBA8888 copies of texture levels, so that sampling
+// them is a plain 32-bit fetch instead of a swizzle, unpack, and CLUT lookup per texel.
+//
+// Entries are keyed by address and CLUT like TexCacheEntry.  They're rehashed the first time
+// they're used each frame, and after being invalidated.  VRAM is never cached, since render
+// targets get drawn to without any invalidation.
+//
+// Queued draws keep pointers into entries, so an entry looked up since the last Flushed() is
+// never replaced.  If it would need to be, the draw just samples the original instead.
+class SoftTextureCache {
+public:
+	// Looks up or decodes the current texture, for a state that's being queued.  Call on the
+	// GPU thread.  If found, points state's texptr and texbufw at the decoded levels and returns
+	// true.  Those must then be sampled with Sampler::GetFuncs(true).
+	bool Prepare(Rasterizer::RasterizerState *state);
+	// Call on the GPU thread once every prepared draw has finished.
+	void Flushed();
+
+	// Call after LOADCLUT, since CLUT textures are keyed by the palette contents.
+	void NotifyClutLoaded(const u32 *clut);
+	void Invalidate(u32 addr, int size, GPUInvalidationType type);
+	// Frees entries that haven't been used in a while.  Call once per frame, with nothing queued.
+	void Decimate();
+	void Clear();
+
+private:
+	struct Entry {
+		u32 addr;
+		u32 sizeInRAM;
+		u32 hash;
+		int lastFrame;
+		u64 lastLookup;
+		u16 w;
+		u16 h;
+		u16 bufw;
+		u8 format;
+		u8 level;
+		bool swizzle;
+		bool sharedClut;
+		bool invalid;
+		// w * h texels.
+		std::vector<u32> data;
+
+		bool Matches(int w, int h, int bufw, GETextureFormat format, int level, bool swizzle, bool sharedClut) const;
+	};
+
+	const Entry *LookupLevel(int level, Sampler::NearestFunc decode, const Rasterizer::RasterizerState &state);
+
+	std::map<u64, std::unique_ptr<Entry>> cache_;
+	u32 clutHash_ = 0;
+	// Counts calls to Prepare(), so an entry is only checked and decoded once for each.
+	u64 lookups_ = 0;
+	// The value of lookups_ at the last Flushed().  Entries looked up since may be in use.
+	u64 flushedLookups_ = 0;
+};
+
+extern SoftTextureCache softTexCache;
@@ -15,27 +15,37 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cmath>
 #include "math/math_util.h"
 #include "Common/MemoryUtil.h"
+#include "Common/ThreadPools.h"
 #include "Core/Config.h"
 #include "GPU/GPUState.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/VertexDecoderCommon.h"
 #include "GPU/Common/SplineCommon.h"
 #include "GPU/Debugger/Debugger.h"
+#include "GPU/Software/BinManager.h"
 #include "GPU/Software/TransformUnit.h"
 #include "GPU/Software/Clipper.h"
 #include "GPU/Software/Lighting.h"
 
 #define TRANSFORM_BUF_SIZE (65536 * 48)
 
+// Below this, it's not worth waking up the other threads.
+static const int MIN_THREADED_VERTICES = 1024;
+// Positions are transformed this many at a time, so they're still in cache for lighting.
+static const int TRANSFORM_BATCH_SIZE = 16;
+
 TransformUnit::TransformUnit() {
 	buf = (u8 *)AllocateMemoryPages(TRANSFORM_BUF_SIZE, MEM_PROT_READ | MEM_PROT_WRITE);
+	binner_ = new BinManager();
 }
 
 TransformUnit::~TransformUnit() {
 	FreeMemoryPages(buf, DECODED_VERTEX_BUFFER_SIZE);
+	delete binner_;
 }
 
 SoftwareDrawEngine::SoftwareDrawEngine() {
@@ -152,10 +162,39 @@ ScreenCoords TransformUnit::DrawingToScreen(const DrawingCoords& coords)
 	return ret;
 }
 
-VertexData TransformUnit::ReadVertex(VertexReader& vreader)
-{
-	VertexData vertex;
+// Parameters that are the same for every vertex in a draw.
+struct VertexState {
+	bool throughMode;
+	bool fogEnabled;
+	float fogEnd;
+	float fogSlope;
+	Lighting::State lighting;
+};
+
+static void ComputeVertexState(VertexState *state, const VertexReader &vreader) {
+	state->throughMode = gstate.isModeThrough();
+	state->fogEnabled = gstate.isFogEnabled();
+	if (state->fogEnabled) {
+		float fog_end = getFloat24(gstate.fog1);
+		float fog_slope = getFloat24(gstate.fog2);
+		// Same fixup as in ShaderManagerGLES.cpp
+		if (my_isnanorinf(fog_end)) {
+			// Not really sure what a sensible value might be, but let's try 64k.
+			fog_end = std::signbit(fog_end) ? -65535.0f : 65535.0f;
+		}
+		if (my_isnanorinf(fog_slope)) {
+			fog_slope = std::signbit(fog_slope) ? -65535.0f : 65535.0f;
+		}
+		state->fogEnd = fog_end;
+		state->fogSlope = fog_slope;
+	}
+	if (!state->throughMode) {
+		Lighting::ComputeState(&state->lighting, vreader.hasColor0());
+	}
+}
 
+// Reads and skins everything, leaving the position in modelpos for the transform.
+static inline void ReadVertexAttributes(VertexReader &vreader, VertexData &vertex) {
 	float pos[3];
 	// VertexDecoder normally scales z, but we want it unscaled.
 	vreader.ReadPosThroughZ16(pos);
@@ -212,46 +251,152 @@ VertexData TransformUnit::ReadVertex(VertexReader& vreader)
 		vertex.color1 = Vec3<int>(0, 0, 0);
 	}
 
-	if (!gstate.isModeThrough()) {
-		vertex.modelpos = ModelCoords(pos[0], pos[1], pos[2]);
-		vertex.worldpos = WorldCoords(TransformUnit::ModelToWorld(vertex.modelpos));
-		ModelCoords viewpos = TransformUnit::WorldToView(vertex.worldpos);
-		vertex.clippos = ClipCoords(TransformUnit::ViewToClip(viewpos));
-		if (gstate.isFogEnabled()) {
-			float fog_end = getFloat24(gstate.fog1);
-			float fog_slope = getFloat24(gstate.fog2);
-			// Same fixup as in ShaderManagerGLES.cpp
-			if (my_isnanorinf(fog_end)) {
-				// Not really sure what a sensible value might be, but let's try 64k.
-				fog_end = std::signbit(fog_end) ? -65535.0f : 65535.0f;
-			}
-			if (my_isnanorinf(fog_slope)) {
-				fog_slope = std::signbit(fog_slope) ? -65535.0f : 65535.0f;
-			}
-			vertex.fogdepth = (viewpos.z + fog_end) * fog_slope;
-		} else {
-			vertex.fogdepth = 1.0f;
+	vertex.modelpos = ModelCoords(pos[0], pos[1], pos[2]);
+}
+
+static inline void TransformPosition(VertexData &vertex, float *viewz) {
+	vertex.worldpos = WorldCoords(TransformUnit::ModelToWorld(vertex.modelpos));
+	ModelCoords viewpos = TransformUnit::WorldToView(vertex.worldpos);
+	vertex.clippos = ClipCoords(TransformUnit::ViewToClip(viewpos));
+	*viewz = viewpos.z;
+}
+
+#if defined(_M_SSE)
+// One row of a 4x3 matrix times four vectors, in the same order as Mat3x3 * Vec3 plus the
+// translation, so that the results match the scalar path exactly (checked by TestSoftwareTransform.)
+static inline __m128 TransformRow4x3(const float *m, int row, __m128 x, __m128 y, __m128 z) {
+	__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[row]), x), _mm_mul_ps(_mm_set1_ps(m[row + 3]), y));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m[row + 6]), z));
+	return _mm_add_ps(r, _mm_set1_ps(m[row + 9]));
+}
+
+// Same for Mat4x4 * Vec4 with w = 1.
+static inline __m128 TransformRow4x4(const float *m, int row, __m128 x, __m128 y, __m128 z) {
+	__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[row]), x), _mm_mul_ps(_mm_set1_ps(m[row + 4]), y));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m[row + 8]), z));
+	return _mm_add_ps(r, _mm_set1_ps(m[row + 12]));
+}
+
+// Transforms four vertices at once, with x, y, and z each in their own register.
+static inline void TransformPositions4(VertexData *verts, float viewz[4]) {
+	__m128 x = _mm_setr_ps(verts[0].modelpos.x, verts[1].modelpos.x, verts[2].modelpos.x, verts[3].modelpos.x);
+	__m128 y = _mm_setr_ps(verts[0].modelpos.y, verts[1].modelpos.y, verts[2].modelpos.y, verts[3].modelpos.y);
+	__m128 z = _mm_setr_ps(verts[0].modelpos.z, verts[1].modelpos.z, verts[2].modelpos.z, verts[3].modelpos.z);
+
+	__m128 worldx = TransformRow4x3(gstate.worldMatrix, 0, x, y, z);
+	__m128 worldy = TransformRow4x3(gstate.worldMatrix, 1, x, y, z);
+	__m128 worldz = TransformRow4x3(gstate.worldMatrix, 2, x, y, z);
+
+	__m128 viewx = TransformRow4x3(gstate.viewMatrix, 0, worldx, worldy, worldz);
+	__m128 viewy = TransformRow4x3(gstate.viewMatrix, 1, worldx, worldy, worldz);
+	__m128 viewzv = TransformRow4x3(gstate.viewMatrix, 2, worldx, worldy, worldz);
+
+	__m128 clipx = TransformRow4x4(gstate.projMatrix, 0, viewx, viewy, viewzv);
+	__m128 clipy = TransformRow4x4(gstate.projMatrix, 1, viewx, viewy, viewzv);
+	__m128 clipz = TransformRow4x4(gstate.projMatrix, 2, viewx, viewy, viewzv);
+	__m128 clipw = TransformRow4x4(gstate.projMatrix, 3, viewx, viewy, viewzv);
+
+	// Back to one vertex per register.
+	_MM_TRANSPOSE4_PS(clipx, clipy, clipz, clipw);
+	__m128 worldw = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(worldx, worldy, worldz, worldw);
+
+	verts[0].clippos = ClipCoords(clipx);
+	verts[1].clippos = ClipCoords(clipy);
+	verts[2].clippos = ClipCoords(clipz);
+	verts[3].clippos = ClipCoords(clipw);
+	verts[0].worldpos = WorldCoords(worldx);
+	verts[1].worldpos = WorldCoords(worldy);
+	verts[2].worldpos = WorldCoords(worldz);
+	verts[3].worldpos = WorldCoords(worldw);
+	_mm_storeu_ps(viewz, viewzv);
+}
+#endif
+
+void TransformUnit::TransformPositions(VertexData *verts, float *viewz, int count) {
+	int i = 0;
+#if defined(_M_SSE)
+	for (; i + 4 <= count; i += 4) {
+		TransformPositions4(verts + i, viewz + i);
+	}
+#endif
+	for (; i < count; ++i) {
+		TransformPosition(verts[i], &viewz[i]);
+	}
+}
+
+// Everything after the position transform.
+static inline void FinishVertex(VertexData &vertex, float viewz, const VertexState &state, bool hasNormal, bool *outside_range_flag) {
+	if (state.fogEnabled) {
+		vertex.fogdepth = (viewz + state.fogEnd) * state.fogSlope;
+	} else {
+		vertex.fogdepth = 1.0f;
+	}
+	vertex.screenpos = ClipToScreenInternal(vertex.clippos, outside_range_flag);
+
+	if (hasNormal) {
+		vertex.worldnormal = TransformUnit::ModelToWorldNormal(vertex.normal);
+		// TODO: Isn't there a flag that controls whether to normalize the normal?
+		vertex.worldnormal /= vertex.worldnormal.Length();
+	} else {
+		vertex.worldnormal = Vec3<float>(0.0f, 0.0f, 1.0f);
+	}
+
+	Lighting::Process(vertex, state.lighting);
+}
+
+static void ReadVertexRange(VertexReader &vreader, const VertexState &state, VertexData *verts, u8 *outside, int lower, int upper) {
+	for (int i = lower; i < upper; ++i) {
+		vreader.Goto(i);
+		ReadVertexAttributes(vreader, verts[i]);
+	}
+
+	if (state.throughMode) {
+		for (int i = lower; i < upper; ++i) {
+			VertexData &vertex = verts[i];
+			vertex.screenpos.x = (int)(vertex.modelpos.x * 16) + gstate.getOffsetX16();
+			vertex.screenpos.y = (int)(vertex.modelpos.y * 16) + gstate.getOffsetY16();
+			vertex.screenpos.z = vertex.modelpos.z;
+			vertex.clippos.w = 1.f;
+			vertex.fogdepth = 1.f;
+			outside[i] = 0;
 		}
-		vertex.screenpos = ClipToScreenInternal(vertex.clippos, &outside_range_flag);
+		return;
+	}
 
-		if (vreader.hasNormal()) {
-			vertex.worldnormal = TransformUnit::ModelToWorldNormal(vertex.normal);
-			// TODO: Isn't there a flag that controls whether to normalize the normal?
-			vertex.worldnormal /= vertex.worldnormal.Length();
-		} else {
-			vertex.worldnormal = Vec3<float>(0.0f, 0.0f, 1.0f);
+	const bool hasNormal = vreader.hasNormal();
+	for (int i = lower; i < upper; i += TRANSFORM_BATCH_SIZE) {
+		const int count = std::min(upper - i, TRANSFORM_BATCH_SIZE);
+		float viewz[TRANSFORM_BATCH_SIZE];
+		TransformUnit::TransformPositions(verts + i, viewz, count);
+		for (int j = 0; j < count; ++j) {
+			bool outside_range_flag = false;
+			FinishVertex(verts[i + j], viewz[j], state, hasNormal, &outside_range_flag);
+			outside[i + j] = outside_range_flag ? 1 : 0;
 		}
+	}
+}
 
-		Lighting::Process(vertex, vreader.hasColor0());
-	} else {
-		vertex.screenpos.x = (int)(pos[0] * 16) + gstate.getOffsetX16();
-		vertex.screenpos.y = (int)(pos[1] * 16) + gstate.getOffsetY16();
-		vertex.screenpos.z = pos[2];
-		vertex.clippos.w = 1.f;
-		vertex.fogdepth = 1.f;
+void TransformUnit::ReadVertices(const DecVtxFormat &vtxfmt, u32 vertex_type, int count) {
+	if ((int)vertices_.size() < count) {
+		vertices_.resize(count);
+		outside_.resize(count);
 	}
 
-	return vertex;
+	VertexReader vreader(buf, vtxfmt, vertex_type);
+	VertexState state;
+	ComputeVertexState(&state, vreader);
+
+	VertexData *verts = vertices_.data();
+	u8 *outside = outside_.data();
+	if (count >= MIN_THREADED_VERTICES) {
+		GlobalThreadPool::Loop([&](int lower, int upper) {
+			VertexReader threadReader(buf, vtxfmt, vertex_type);
+			ReadVertexRange(threadReader, state, verts, outside, lower, upper);
+		}, 0, count);
+	} else {
+		ReadVertexRange(vreader, state, verts, outside, 0, count);
+	}
 }
 
 #define START_OPEN_U 1
@@ -286,7 +431,15 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 		GetIndexBounds(indices, vertex_count, vertex_type, &index_lower_bound, &index_upper_bound);
 	vdecoder.DecodeVerts(buf, vertices, index_lower_bound, index_upper_bound);
 
-	VertexReader vreader(buf, vtxfmt, vertex_type);
+	// Transform each vertex once, even if the indices or strips use it several times.
+	if (vertex_count > 0)
+		ReadVertices(vtxfmt, vertex_type, index_upper_bound - index_lower_bound + 1);
+	auto readVertex = [&](int vtx) -> const VertexData & {
+		const int index = indices ? idxConv.convert(vtx) - index_lower_bound : vtx;
+		if (outside_[index])
+			outside_range_flag = true;
+		return vertices_[index];
+	};
 
 	const int max_vtcs_per_prim = 3;
 	static VertexData data[max_vtcs_per_prim];
@@ -310,9 +463,6 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 	default: vtcs_per_prim = 0; break;
 	}
 
-	// TODO: Do this in two passes - first process the vertices (before indexing/stripping),
-	// then resolve the indices. This lets us avoid transforming shared vertices twice.
-
 	switch (prim_type) {
 	case GE_PRIM_POINTS:
 	case GE_PRIM_LINES:
@@ -320,13 +470,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 	case GE_PRIM_RECTANGLES:
 		{
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(idxConv.convert(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[data_index++] = ReadVertex(vreader);
+				data[data_index++] = readVertex(vtx);
 				if (data_index < vtcs_per_prim) {
 					// Keep reading.  Note: an incomplete prim will stay read for GE_PRIM_KEEP_PREVIOUS.
 					continue;
@@ -344,26 +488,26 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 				case GE_PRIM_TRIANGLES:
 				{
 					if (!gstate.isCullEnabled() || gstate.isModeClear()) {
-						Clipper::ProcessTriangle(data[0], data[1], data[2]);
-						Clipper::ProcessTriangle(data[2], data[1], data[0]);
+						Clipper::ProcessTriangle(data[0], data[1], data[2], *binner_);
+						Clipper::ProcessTriangle(data[2], data[1], data[0], *binner_);
 					} else if (!gstate.getCullMode()) {
-						Clipper::ProcessTriangle(data[2], data[1], data[0]);
+						Clipper::ProcessTriangle(data[2], data[1], data[0], *binner_);
 					} else {
-						Clipper::ProcessTriangle(data[0], data[1], data[2]);
+						Clipper::ProcessTriangle(data[0], data[1], data[2], *binner_);
 					}
 					break;
 				}
 
 				case GE_PRIM_RECTANGLES:
-					Clipper::ProcessRect(data[0], data[1]);
+					Clipper::ProcessRect(data[0], data[1], *binner_);
 					break;
 
 				case GE_PRIM_LINES:
-					Clipper::ProcessLine(data[0], data[1]);
+					Clipper::ProcessLine(data[0], data[1], *binner_);
 					break;
 
 				case GE_PRIM_POINTS:
-					Clipper::ProcessPoint(data[0]);
+					Clipper::ProcessPoint(data[0], *binner_);
 					break;
 
 				default:
@@ -379,13 +523,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 			// If data_index is 1 or 2, etc., it means we're continuing a line strip.
 			int skip_count = data_index == 0 ? 1 : 0;
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(idxConv.convert(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[(data_index++) & 1] = ReadVertex(vreader);
+				data[(data_index++) & 1] = readVertex(vtx);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -397,7 +535,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 					--skip_count;
 				} else {
 					// We already incremented data_index, so data_index & 1 is previous one.
-					Clipper::ProcessLine(data[data_index & 1], data[(data_index & 1) ^ 1]);
+					Clipper::ProcessLine(data[data_index & 1], data[(data_index & 1) ^ 1], *binner_);
 				}
 			}
 			break;
@@ -409,13 +547,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 			int skip_count = data_index >= 2 ? 0 : 2 - data_index;
 
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(idxConv.convert(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[(data_index++) % 3] = ReadVertex(vreader);
+				data[(data_index++) % 3] = readVertex(vtx);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -429,14 +561,14 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 				}
 
 				if (!gstate.isCullEnabled() || gstate.isModeClear()) {
-					Clipper::ProcessTriangle(data[0], data[1], data[2]);
-					Clipper::ProcessTriangle(data[2], data[1], data[0]);
+					Clipper::ProcessTriangle(data[0], data[1], data[2], *binner_);
+					Clipper::ProcessTriangle(data[2], data[1], data[0], *binner_);
 				} else if ((!gstate.getCullMode()) ^ ((data_index - 1) % 2)) {
 					// We need to reverse the vertex order for each second primitive,
 					// but we additionally need to do that for every primitive if CCW cullmode is used.
-					Clipper::ProcessTriangle(data[2], data[1], data[0]);
+					Clipper::ProcessTriangle(data[2], data[1], data[0], *binner_);
 				} else {
-					Clipper::ProcessTriangle(data[0], data[1], data[2]);
+					Clipper::ProcessTriangle(data[0], data[1], data[2], *binner_);
 				}
 			}
 			break;
@@ -451,24 +583,13 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 
 			// Only read the central vertex if we're not continuing.
 			if (data_index == 0) {
-				if (indices) {
-					vreader.Goto(idxConv.convert(0) - index_lower_bound);
-				} else {
-					vreader.Goto(0);
-				}
-				data[0] = ReadVertex(vreader);
+				data[0] = readVertex(0);
 				data_index++;
 				start_vtx = 1;
 			}
 
 			for (int vtx = start_vtx; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(idxConv.convert(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[2 - ((data_index++) % 2)] = ReadVertex(vreader);
+				data[2 - ((data_index++) % 2)] = readVertex(vtx);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -482,14 +603,14 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 				}
 
 				if (!gstate.isCullEnabled() || gstate.isModeClear()) {
-					Clipper::ProcessTriangle(data[0], data[1], data[2]);
-					Clipper::ProcessTriangle(data[2], data[1], data[0]);
+					Clipper::ProcessTriangle(data[0], data[1], data[2], *binner_);
+					Clipper::ProcessTriangle(data[2], data[1], data[0], *binner_);
 				} else if ((!gstate.getCullMode()) ^ ((data_index - 1) % 2)) {
 					// We need to reverse the vertex order for each second primitive,
 					// but we additionally need to do that for every primitive if CCW cullmode is used.
-					Clipper::ProcessTriangle(data[2], data[1], data[0]);
+					Clipper::ProcessTriangle(data[2], data[1], data[0], *binner_);
 				} else {
-					Clipper::ProcessTriangle(data[0], data[1], data[2]);
+					Clipper::ProcessTriangle(data[0], data[1], data[2], *binner_);
 				}
 			}
 			break;
@@ -503,6 +624,26 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 	GPUDebug::NotifyDraw();
 }
 
+void TransformUnit::Flush() {
+	binner_->Flush();
+}
+
+bool TransformUnit::HasPendingWork() const {
+	return binner_->HasPendingWork();
+}
+
+bool TransformUnit::HasPendingWrite(u32 addr, u32 size) const {
+	return binner_->HasPendingWrite(addr, size);
+}
+
+void TransformUnit::MarkDirty() {
+	binner_->MarkDirty();
+}
+
+void TransformUnit::MarkClutDirty() {
+	binner_->MarkClutDirty();
+}
+
 // TODO: This probably is not the best interface.
 // Also, we should try to merge this into the similar function in DrawEngineCommon.
 bool TransformUnit::GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices) {
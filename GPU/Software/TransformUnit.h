@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "CommonTypes.h"
 #include "GPU/Common/DrawEngineCommon.h"
 #include "GPU/Common/GPUDebugInterface.h"
@@ -112,9 +114,8 @@ struct VertexData
 	float fogdepth;
 };
 
-class VertexReader;
-
 class SoftwareDrawEngine;
+class BinManager;
 
 class TransformUnit {
 public:
@@ -125,6 +126,9 @@ class TransformUnit {
 	static WorldCoords ModelToWorld(const ModelCoords& coords);
 	static ViewCoords WorldToView(const WorldCoords& coords);
 	static ClipCoords ViewToClip(const ViewCoords& coords);
+	// Sets worldpos and clippos from modelpos, and the view space z (for fog) in viewz.
+	// Batched where possible, but the same as the functions above one vertex at a time.
+	static void TransformPositions(VertexData *verts, float *viewz, int count);
 	static ScreenCoords ClipToScreen(const ClipCoords& coords);
 	static DrawingCoords ScreenToDrawing(const ScreenCoords& coords);
 	static ScreenCoords DrawingToScreen(const DrawingCoords& coords);
@@ -132,10 +136,27 @@ class TransformUnit {
 	void SubmitPrimitive(void* vertices, void* indices, GEPrimitiveType prim_type, int vertex_count, u32 vertex_type, int *bytesRead, SoftwareDrawEngine *drawEngine);
 
 	bool GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices);
-	VertexData ReadVertex(VertexReader& vreader);
+
+	// Rasterizes any queued primitives.  Must happen before fb, depthbuf, or memory they use changes.
+	void Flush();
+	bool HasPendingWork() const;
+	bool HasPendingWrite(u32 addr, u32 size) const;
+	// Call after gstate or the CLUT change in a way the rasterizer reads.  Queued primitives keep
+	// the old state.
+	void MarkDirty();
+	void MarkClutDirty();
 
 	bool outside_range_flag = false;
 	u8 *buf;
+
+private:
+	// Transforms and lights the decoded vertices in buf into vertices_, on several threads if there are many.
+	void ReadVertices(const DecVtxFormat &vtxfmt, u32 vertex_type, int count);
+
+	BinManager *binner_;
+	std::vector<VertexData> vertices_;
+	// Whether each vertex in vertices_ is outside the screen or depth range.
+	std::vector<u8> outside_;
 };
 
 class SoftwareDrawEngine : public DrawEngineCommon {
@@ -56,10 +56,8 @@ enum {
 	VERTEX_CACHE_SIZE = 8192 * 1024
 };
 
-#define VERTEXCACHE_DECIMATION_INTERVAL 17
 #define DESCRIPTORSET_DECIMATION_INTERVAL 1  // Temporarily cut to 1. Handle reuse breaks this when textures get deleted.
 
-enum { VAI_KILL_AGE = 120, VAI_UNRELIABLE_KILL_AGE = 240, VAI_UNRELIABLE_KILL_MAX = 4 };
 
 enum {
 	DRAW_BINDING_TEXTURE = 0,
@@ -78,8 +76,7 @@ enum {
 DrawEngineVulkan::DrawEngineVulkan(VulkanContext *vulkan, Draw::DrawContext *draw)
 	:	vulkan_(vulkan),
 		draw_(draw),
-		stats_{},
-		vai_(1024) {
+		stats_{} {
 	decOptions_.expandAllWeightsToFloat = false;
 	decOptions_.expand8BitNormalsToFloat = false;
 
@@ -221,10 +218,7 @@ void DrawEngineVulkan::DestroyDeviceObjects() {
 		vertexCache_ = nullptr;
 	}
 	// Need to clear this to get rid of all remaining references to the dead buffers.
-	vai_.Iterate([](uint32_t hash, VertexArrayInfoVulkan *vai) {
-		delete vai;
-	});
-	vai_.Clear();
+	ClearTrackedVertexArrays();
 }
 
 void DrawEngineVulkan::DeviceLost() {
@@ -267,7 +261,7 @@ void DrawEngineVulkan::BeginFrame() {
 		vertexCache_->Destroy(vulkan_);
 		delete vertexCache_;  // orphans the buffers, they'll get deleted once no longer used by an in-flight frame.
 		vertexCache_ = new VulkanPushBuffer(vulkan_, VERTEX_CACHE_SIZE);
-		vai_.Clear();
+		ClearTrackedVertexArrays();
 	}
 
 	vertexCache_->BeginNoReset();
@@ -280,28 +274,7 @@ void DrawEngineVulkan::BeginFrame() {
 		descDecimationCounter_ = DESCRIPTORSET_DECIMATION_INTERVAL;
 	}
 
-	if (--decimationCounter_ <= 0) {
-		decimationCounter_ = VERTEXCACHE_DECIMATION_INTERVAL;
-
-		const int threshold = gpuStats.numFlips - VAI_KILL_AGE;
-		const int unreliableThreshold = gpuStats.numFlips - VAI_UNRELIABLE_KILL_AGE;
-		int unreliableLeft = VAI_UNRELIABLE_KILL_MAX;
-		vai_.Iterate([&](uint32_t hash, VertexArrayInfoVulkan *vai) {
-			bool kill;
-			if (vai->status == VertexArrayInfoVulkan::VAI_UNRELIABLE) {
-				// We limit killing unreliable so we don't rehash too often.
-				kill = vai->lastFrame < unreliableThreshold && --unreliableLeft >= 0;
-			} else {
-				kill = vai->lastFrame < threshold;
-			}
-			if (kill) {
-				// This is actually quite safe.
-				vai_.Remove(hash);
-				delete vai;
-			}
-		});
-	}
-	vai_.Maintain();
+	DecimateTrackedVertexArrays();
 }
 
 void DrawEngineVulkan::EndFrame() {
@@ -541,10 +514,14 @@ void DrawEngineVulkan::DirtyAllUBOs() {
 	gstate_c.Dirty(DIRTY_TEXTURE_IMAGE);
 }
 
-void MarkUnreliable(VertexArrayInfoVulkan *vai) {
-	vai->status = VertexArrayInfoVulkan::VAI_UNRELIABLE;
+void DrawEngineVulkan::FreeVertexArray(VertexArrayInfo *vai) {
+	VertexArrayInfoVulkan *vaiVulkan = static_cast<VertexArrayInfoVulkan *>(vai);
 	// TODO: If we change to a real allocator, free the data here.
-	// For now we just leave it in the pushbuffer.
+	// For now we just leave it in the pushbuffer, which gets wiped when it grows too large.
+	vaiVulkan->vb = VK_NULL_HANDLE;
+	vaiVulkan->ib = VK_NULL_HANDLE;
+	vaiVulkan->vbOffset = 0;
+	vaiVulkan->ibOffset = 0;
 }
 
 // The inline wrapper in the header checks for numDrawCalls == 0
@@ -604,141 +581,51 @@ void DrawEngineVulkan::DoFlush() {
 
 		if (useCache) {
 			PROFILE_THIS_SCOPE("vcache");
-			u32 id = dcid_ ^ gstate.getUVGenMode();  // This can have an effect on which UV decoder we need to use! And hence what the decoded data will look like. See #9263
-			VertexArrayInfoVulkan *vai = vai_.Get(id);
-			if (!vai) {
-				vai = new VertexArrayInfoVulkan();
-				vai_.Insert(id, vai);
-			}
+			VertexArrayInfo *info;
+			VertexCacheAction action = LookupVertexCache(&info);
+			VertexArrayInfoVulkan *vai = static_cast<VertexArrayInfoVulkan *>(info);
 
-			switch (vai->status) {
-			case VertexArrayInfoVulkan::VAI_NEW:
-			{
-				// Haven't seen this one before. We don't actually upload the vertex data yet.
-				ReliableHashType dataHash = ComputeHash();
-				vai->hash = dataHash;
-				vai->minihash = ComputeMiniHash();
-				vai->status = VertexArrayInfoVulkan::VAI_HASHING;
-				vai->drawsUntilNextFullHash = 0;
+			switch (action) {
+			case VertexCacheAction::DECODE:
 				DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);  // writes to indexGen
-				vai->numVerts = indexGen.VertexCount();
-				vai->prim = indexGen.Prim();
-				vai->maxIndex = indexGen.MaxIndex();
-				vai->flags = gstate_c.vertexFullAlpha ? VAIVULKAN_FLAG_VERTEXFULLALPHA : 0;
 				goto rotateVBO;
-			}
 
-			// Hashing - still gaining confidence about the buffer.
-			// But if we get this far it's likely to be worth uploading the data.
-			case VertexArrayInfoVulkan::VAI_HASHING:
+			case VertexCacheAction::UPLOAD:
 			{
-				PROFILE_THIS_SCOPE("vcachehash");
-				vai->numDraws++;
-				if (vai->lastFrame != gpuStats.numFlips) {
-					vai->numFrames++;
+				// Directly push to the vertex cache.
+				DecodeVertsToPushBuffer(vertexCache_, &vai->vbOffset, &vai->vb);
+				_dbg_assert_msg_(G3D, gstate_c.vertBounds.minV >= gstate_c.vertBounds.maxV, "Should not have checked UVs when caching.");
+				StoreVertexArrayDrawInfo(vai);
+				u32 uploadedBytes = (u32)dec_->GetDecVtxFmt().stride * (indexGen.MaxIndex() + 1);
+				useElements = !indexGen.SeenOnlyPurePrims();
+				if (!useElements && indexGen.PureCount()) {
+					vai->numVerts = indexGen.PureCount();
 				}
-				if (vai->drawsUntilNextFullHash == 0) {
-					// Let's try to skip a full hash if mini would fail.
-					const u32 newMiniHash = ComputeMiniHash();
-					ReliableHashType newHash = vai->hash;
-					if (newMiniHash == vai->minihash) {
-						newHash = ComputeHash();
-					}
-					if (newMiniHash != vai->minihash || newHash != vai->hash) {
-						MarkUnreliable(vai);
-						DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
-						goto rotateVBO;
-					}
-					if (vai->numVerts > 64) {
-						// exponential backoff up to 16 draws, then every 24
-						vai->drawsUntilNextFullHash = std::min(24, vai->numFrames);
-					} else {
-						// Lower numbers seem much more likely to change.
-						vai->drawsUntilNextFullHash = 0;
-					}
-					// TODO: tweak
-					//if (vai->numFrames > 1000) {
-					//	vai->status = VertexArrayInfo::VAI_RELIABLE;
-					//}
+				if (useElements) {
+					u32 size = sizeof(uint16_t) * indexGen.VertexCount();
+					void *dest = vertexCache_->Push(size, &vai->ibOffset, &vai->ib);
+					memcpy(dest, decIndex, size);
+					uploadedBytes += size;
 				} else {
-					vai->drawsUntilNextFullHash--;
-					u32 newMiniHash = ComputeMiniHash();
-					if (newMiniHash != vai->minihash) {
-						MarkUnreliable(vai);
-						DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
-						goto rotateVBO;
-					}
+					vai->ib = VK_NULL_HANDLE;
+					vai->ibOffset = 0;
 				}
-
-				if (!vai->vb) {
-					// Directly push to the vertex cache.
-					DecodeVertsToPushBuffer(vertexCache_, &vai->vbOffset, &vai->vb);
-					_dbg_assert_msg_(G3D, gstate_c.vertBounds.minV >= gstate_c.vertBounds.maxV, "Should not have checked UVs when caching.");
-					vai->numVerts = indexGen.VertexCount();
-					vai->prim = indexGen.Prim();
-					vai->maxIndex = indexGen.MaxIndex();
-					vai->flags = gstate_c.vertexFullAlpha ? VAIVULKAN_FLAG_VERTEXFULLALPHA : 0;
-					useElements = !indexGen.SeenOnlyPurePrims();
-					if (!useElements && indexGen.PureCount()) {
-						vai->numVerts = indexGen.PureCount();
-					}
-					if (useElements) {
-						u32 size = sizeof(uint16_t) * indexGen.VertexCount();
-						void *dest = vertexCache_->Push(size, &vai->ibOffset, &vai->ib);
-						memcpy(dest, decIndex, size);
-					} else {
-						vai->ib = VK_NULL_HANDLE;
-						vai->ibOffset = 0;
-					}
-				} else {
-					gpuStats.numCachedDrawCalls++;
-					useElements = vai->ib ? true : false;
-					gpuStats.numCachedVertsDrawn += vai->numVerts;
-					gstate_c.vertexFullAlpha = vai->flags & VAIVULKAN_FLAG_VERTEXFULLALPHA;
-				}
-				vbuf = vai->vb;
-				ibuf = vai->ib;
-				vbOffset = vai->vbOffset;
-				ibOffset = vai->ibOffset;
-				vertexCount = vai->numVerts;
-				maxIndex = vai->maxIndex;
-				prim = static_cast<GEPrimitiveType>(vai->prim);
+				NotifyVertexArrayUploaded(vai, uploadedBytes);
 				break;
 			}
 
-			// Reliable - we don't even bother hashing anymore. Right now we don't go here until after a very long time.
-			case VertexArrayInfoVulkan::VAI_RELIABLE:
-			{
-				vai->numDraws++;
-				if (vai->lastFrame != gpuStats.numFlips) {
-					vai->numFrames++;
-				}
-				gpuStats.numCachedDrawCalls++;
-				gpuStats.numCachedVertsDrawn += vai->numVerts;
-				vbuf = vai->vb;
-				ibuf = vai->ib;
-				vbOffset = vai->vbOffset;
-				ibOffset = vai->ibOffset;
-				vertexCount = vai->numVerts;
-				maxIndex = vai->maxIndex;
-				prim = static_cast<GEPrimitiveType>(vai->prim);
-
-				gstate_c.vertexFullAlpha = vai->flags & VAIVULKAN_FLAG_VERTEXFULLALPHA;
+			case VertexCacheAction::DRAW_CACHED:
+				useElements = vai->ib != VK_NULL_HANDLE;
 				break;
 			}
 
-			case VertexArrayInfoVulkan::VAI_UNRELIABLE:
-			{
-				vai->numDraws++;
-				if (vai->lastFrame != gpuStats.numFlips) {
-					vai->numFrames++;
-				}
-				DecodeVertsToPushBuffer(frame->pushVertex, &vbOffset, &vbuf);
-				goto rotateVBO;
-			}
-			default:
-				break;
-			}
+			vbuf = vai->vb;
+			ibuf = vai->ib;
+			vbOffset = vai->vbOffset;
+			ibOffset = vai->ibOffset;
+			vertexCount = vai->numVerts;
+			maxIndex = vai->maxIndex;
+			prim = static_cast<GEPrimitiveType>(vai->prim);
 		} else {
 			if (g_Config.bSoftwareSkinning && (lastVType_ & GE_VTYPE_WEIGHT_MASK)) {
 				// If software skinning, we've already predecoded into "decoded". So push that content.
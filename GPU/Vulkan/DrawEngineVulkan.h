@@ -72,47 +72,14 @@ struct DrawEngineVulkanStats {
 	int pushIndexSpaceUsed;
 };
 
-enum {
-	VAIVULKAN_FLAG_VERTEXFULLALPHA = 1,
-};
-
-// Try to keep this POD.
-class VertexArrayInfoVulkan {
+class VertexArrayInfoVulkan : public VertexArrayInfo {
 public:
-	VertexArrayInfoVulkan() {
-		lastFrame = gpuStats.numFlips;
-	}
-	// No destructor needed - we always fully wipe.
-
-	enum VAIStatus : uint8_t {
-		VAI_NEW,
-		VAI_HASHING,
-		VAI_RELIABLE,  // cache, don't hash
-		VAI_UNRELIABLE,  // never cache
-	};
-
-	ReliableHashType hash;
-	u32 minihash;
-
 	// These will probably always be the same, but whatever.
 	VkBuffer vb = VK_NULL_HANDLE;
 	VkBuffer ib = VK_NULL_HANDLE;
 	// Offsets into the cache buffer.
 	uint32_t vbOffset = 0;
 	uint32_t ibOffset = 0;
-
-	// Precalculated parameter for vkDrawIndexed
-	u16 numVerts = 0;
-	u16 maxIndex = 0;
-	s8 prim = GE_PRIM_INVALID;
-	VAIStatus status = VAI_NEW;
-
-	// ID information
-	int numDraws = 0;
-	int numFrames = 0;
-	int lastFrame;  // So that we can forget.
-	u16 drawsUntilNextFullHash = 0;
-	u8 flags = 0;
 };
 
 class VulkanRenderManager;
@@ -202,6 +169,11 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	void DoFlush();
 	void UpdateUBOs(FrameData *frame);
 
+	VertexArrayInfo *CreateVertexArray() override {
+		return new VertexArrayInfoVulkan();
+	}
+	void FreeVertexArray(VertexArrayInfo *vai) override;
+
 	VkDescriptorSet GetOrCreateDescriptorSet(VkImageView imageView, VkSampler sampler, VkBuffer base, VkBuffer light, VkBuffer bone, bool tess);
 
 	VulkanContext *vulkan_;
@@ -218,9 +190,7 @@ class DrawEngineVulkan : public DrawEngineCommon {
 	VkImageView boundDepal_ = VK_NULL_HANDLE;
 	VkSampler samplerSecondary_ = VK_NULL_HANDLE;  // This one is actually never used since we use fetch.
 
-	PrehashMap<VertexArrayInfoVulkan *, nullptr> vai_;
 	VulkanPushBuffer *vertexCache_;
-	int decimationCounter_ = 0;
 	int descDecimationCounter_ = 0;
 
 	struct DescriptorSetKey {
@@ -269,6 +269,7 @@ void TextureCacheVulkan::StartFrame() {
 			slabPressureLimit *= g_Config.iTexScalingLevel;
 		}
 		Decimate(allocator_->GetSlabCount() > slabPressureLimit);
+		ProcessScaledTextures();
 	}
 
 	allocator_->Begin();
@@ -282,6 +283,10 @@ void TextureCacheVulkan::EndFrame() {
 	}
 }
 
+TextureScalerCommon *TextureCacheVulkan::CreateScaler() {
+	return new TextureScalerVulkan();
+}
+
 void TextureCacheVulkan::UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBase, bool clutIndexIsSimple) {
 	const u32 clutBaseBytes = clutFormat == GE_CMODE_32BIT_ABGR8888 ? (clutBase * sizeof(u32)) : (clutBase * sizeof(u16));
 	// Technically, these extra bytes weren't loaded, but hopefully it was loaded earlier.
@@ -555,10 +560,9 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		scaleFactor = scaleFactor > 4 ? 4 : (scaleFactor > 2 ? 2 : 1);
 	}
 
-	u64 cachekey = replacer_.Enabled() ? entry->CacheKey() : 0;
 	int w = gstate.getTextureWidth(0);
 	int h = gstate.getTextureHeight(0);
-	ReplacedTexture &replaced = replacer_.FindReplacement(cachekey, entry->fullhash, w, h);
+	ReplacedTexture &replaced = FindReplacement(entry, w, h);
 	if (replaced.GetSize(0, w, h)) {
 		// We're replacing, so we won't scale.
 		scaleFactor = 1;
@@ -576,16 +580,7 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		scaleFactor = 1;
 	}
 
-	if (scaleFactor != 1) {
-		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED) {
-			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
-			scaleFactor = 1;
-		} else {
-			entry->status &= ~TexCacheEntry::STATUS_TO_SCALE;
-			entry->status |= TexCacheEntry::STATUS_IS_SCALED;
-			texelsScaledThisFrame_ += w * h;
-		}
-	}
+	scaleFactor = ThrottleScaleFactor(entry, scaleFactor, w, h);
 
 	// TODO
 	if (scaleFactor > 1) {
@@ -655,13 +650,15 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	}
 	lastBoundTexture = entry->vkTex;
 
+	// While the replacement is still loading, there is one, so don't save the original.
+	const bool saveReplacement = replacer_.Enabled() && !replaced.Valid() && !(entry->status & TexCacheEntry::STATUS_TO_REPLACE);
 	ReplacedTextureDecodeInfo replacedInfo;
-	if (replacer_.Enabled() && !replaced.Valid()) {
-		replacedInfo.cachekey = cachekey;
+	if (saveReplacement) {
+		replacedInfo.cachekey = entry->CacheKey();
 		replacedInfo.hash = entry->fullhash;
 		replacedInfo.addr = entry->addr;
 		replacedInfo.isVideo = videos_.find(entry->addr & 0x3FFFFFFF) != videos_.end();
-		replacedInfo.isFinal = (entry->status & TexCacheEntry::STATUS_TO_SCALE) == 0;
+		replacedInfo.isFinal = (entry->status & (TexCacheEntry::STATUS_TO_SCALE | TexCacheEntry::STATUS_SCALING_ASYNC)) == 0;
 		replacedInfo.scaleFactor = scaleFactor;
 		replacedInfo.fmt = FromVulkanFormat(actualFmt);
 	}
@@ -695,7 +692,7 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 				} else {
 					LoadTextureLevel(*entry, (uint8_t *)data, stride, i, scaleFactor, dstFmt);
 				}
-				if (replacer_.Enabled()) {
+				if (saveReplacement) {
 					replacer_.NotifyTextureDecoded(replacedInfo, data, stride, i, mipWidth, mipHeight);
 				}
 			}
@@ -795,9 +792,11 @@ void TextureCacheVulkan::LoadTextureLevel(TexCacheEntry &entry, uint8_t *writePt
 			entry.SetAlphaStatus(TexCacheEntry::STATUS_ALPHA_UNKNOWN);
 		}
 
+		QueueAsyncScale(&entry, level, pixelData, decPitch, bpp, dstFmt, w, h);
+
 		if (scaleFactor > 1) {
 			u32 fmt = dstFmt;
-			scaler.ScaleAlways((u32 *)writePtr, pixelData, fmt, w, h, scaleFactor);
+			ScaleLevel(scaler, &entry, (u32 *)writePtr, pixelData, fmt, w, h, scaleFactor);
 			pixelData = (u32 *)writePtr;
 			dstFmt = (VkFormat)fmt;
 
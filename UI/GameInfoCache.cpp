@@ -27,6 +27,8 @@
 #include "base/stringutil.h"
 #include "file/file_util.h"
 #include "file/zip_read.h"
+#include "image/png_load.h"
+#include "image/zim_load.h"
 #include "thin3d/thin3d.h"
 #include "thread/prioritizedworkqueue.h"
 #include "Common/FileUtil.h"
@@ -216,6 +218,7 @@ bool GameInfo::LoadFromPath(const std::string &gamePath) {
 	std::lock_guard<std::mutex> guard(lock);
 	// No need to rebuild if we already have it loaded.
 	if (filePath_ != gamePath) {
+		std::lock_guard<std::mutex> loaderGuard(fileLoaderLock);
 		fileLoader.reset(ConstructFileLoader(gamePath));
 		if (!fileLoader)
 			return false;
@@ -229,6 +232,7 @@ bool GameInfo::LoadFromPath(const std::string &gamePath) {
 }
 
 std::shared_ptr<FileLoader> GameInfo::GetFileLoader() {
+	std::lock_guard<std::mutex> guard(fileLoaderLock);
 	if (!fileLoader) {
 		fileLoader.reset(ConstructFileLoader(filePath_));
 	}
@@ -236,6 +240,7 @@ std::shared_ptr<FileLoader> GameInfo::GetFileLoader() {
 }
 
 void GameInfo::DisposeFileLoader() {
+	std::lock_guard<std::mutex> guard(fileLoaderLock);
 	fileLoader.reset();
 }
 
@@ -342,21 +347,72 @@ static bool ReadVFSToString(const char *filename, std::string *contents, std::mu
 }
 
 
+// Queued items that haven't been asked for in this long are dropped.
+static const double STALE_SECONDS = 5.0;
+// Loading is mostly I/O bound, so a few workers help even on few cores.
+static const int GAMEINFO_WORKER_THREADS = 4;
+
+static bool IsRemotePath(const std::string &path) {
+	return startsWith(path, "http://") || startsWith(path, "https://");
+}
+
 class GameInfoWorkItem : public PrioritizedWorkQueueItem {
 public:
-	GameInfoWorkItem(const std::string &gamePath, std::shared_ptr<GameInfo> &info)
-		: gamePath_(gamePath), info_(info) {
+	// Only loads for drawing may be dropped, others have a caller waiting on the result.
+	GameInfoWorkItem(GameInfoCache *cache, const std::string &gamePath, std::shared_ptr<GameInfo> &info, bool mayDrop)
+		: cache_(cache), gamePath_(gamePath), info_(info), isRemote_(IsRemotePath(gamePath)), mayDrop_(mayDrop) {
 	}
 
-	~GameInfoWorkItem() override {
+	void run() override {
+		{
+			std::lock_guard<std::mutex> lock(info_->lock);
+			info_->queuedLoads--;
+		}
+
+		// With several workers, another item for the same game might be running.
+		// The file loader is only used (and disposed) while holding this.
+		std::lock_guard<std::mutex> loadGuard(info_->loadLock);
+		Load();
 		info_->DisposeFileLoader();
 	}
 
-	void run() override {
+	// Called from any worker while popping, so this must not touch the file.
+	float priority() override {
+		// Whatever was drawn most recently (likely on screen) goes first.
+		float prio = -(float)info_->lastAccessedTime;
+		if (isRemote_) {
+			// Increase the value so remote info loads after non-remote.
+			prio += 1000.0f;
+		}
+		return prio;
+	}
+
+	bool stale() override {
+		// Not drawn in a while, probably scrolled away.
+		return mayDrop_ && time_now_d() - info_->lastAccessedTime > STALE_SECONDS;
+	}
+
+	void cancel() override {
+		// If nothing else is queued, let the next GetInfo() queue it again.
+		std::lock_guard<std::mutex> lock(info_->lock);
+		if (--info_->queuedLoads == 0) {
+			info_->loadDropped = true;
+			info_->pending = false;
+		}
+	}
+
+private:
+	void Load() {
 		if (!info_->LoadFromPath(gamePath_)) {
 			info_->pending = false;
 			return;
 		}
+		// Usually nothing changed since last time, so we can skip opening the file.
+		// Backgrounds and sounds are too big to keep around, those still need the file.
+		if ((info_->wantFlags & (GAMEINFO_WANTBG | GAMEINFO_WANTSND)) == 0 && cache_->LoadFromDiskCache(gamePath_, info_)) {
+			Finish();
+			return;
+		}
 		// In case of a remote file, check if it actually exists before locking.
 		if (!info_->GetFileLoader()->Exists()) {
 			info_->pending = false;
@@ -631,6 +687,12 @@ class GameInfoWorkItem : public PrioritizedWorkQueueItem {
 				break;
 		}
 
+		cache_->SaveToDiskCache(gamePath_, info_);
+		Finish();
+		// ILOG("Completed writing info for %s", info_->GetTitle().c_str());
+	}
+
+	void Finish() {
 		info_->hasConfig = g_Config.hasGameConfig(info_->id);
 
 		if (info_->wantFlags & GAMEINFO_WANTSIZE) {
@@ -642,21 +704,13 @@ class GameInfoWorkItem : public PrioritizedWorkQueueItem {
 
 		info_->pending = false;
 		info_->working = false;
-		// ILOG("Completed writing info for %s", info_->GetTitle().c_str());
 	}
 
-	float priority() override {
-		auto fl = info_->GetFileLoader();
-		if (fl && fl->IsRemote()) {
-			// Increase the value so remote info loads after non-remote.
-			return info_->lastAccessedTime + 1000.0f;
-		}
-		return info_->lastAccessedTime;
-	}
-
-private:
+	GameInfoCache *cache_;
 	std::string gamePath_;
 	std::shared_ptr<GameInfo> info_;
+	bool isRemote_;
+	bool mayDrop_;
 	DISALLOW_COPY_AND_ASSIGN(GameInfoWorkItem);
 };
 
@@ -670,8 +724,9 @@ GameInfoCache::~GameInfoCache() {
 }
 
 void GameInfoCache::Init() {
+	LoadDiskCache();
 	gameInfoWQ_ = new PrioritizedWorkQueue();
-	ProcessWorkQueueOnThreadWhile(gameInfoWQ_);
+	ProcessWorkQueueOnThreadWhile(gameInfoWQ_, GAMEINFO_WORKER_THREADS);
 }
 
 void GameInfoCache::Shutdown() {
@@ -682,6 +737,7 @@ void GameInfoCache::Shutdown() {
 		delete gameInfoWQ_;
 		gameInfoWQ_ = nullptr;
 	}
+	SaveDiskCache();
 }
 
 void GameInfoCache::Clear() {
@@ -752,7 +808,7 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 	}
 
 	// If wantFlags don't match, we need to start over.  We'll just queue the work item again.
-	if (info && (info->wantFlags & wantFlags) == wantFlags) {
+	if (info && (info->wantFlags & wantFlags) == wantFlags && !info->loadDropped) {
 		if (draw && info->icon.dataLoaded && !info->icon.texture) {
 			SetupTexture(info, draw, info->icon);
 		}
@@ -781,9 +837,12 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 		std::lock_guard<std::mutex> lock(info->lock);
 		info->wantFlags |= wantFlags;
 		info->pending = true;
+		info->lastAccessedTime = time_now_d();
+		info->queuedLoads++;
+		info->loadDropped = false;
 	}
 
-	GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info);
+	GameInfoWorkItem *item = new GameInfoWorkItem(this, gamePath, info, draw != nullptr);
 	gameInfoWQ_->Add(item);
 
 	// Don't re-insert if we already have it.
@@ -809,3 +868,222 @@ void GameInfoCache::SetupTexture(std::shared_ptr<GameInfo> &info, Draw::DrawCont
 		}
 	}
 }
+
+static const char *DISKCACHE_MAGIC = "ppssppGI";
+static const u32 DISKCACHE_VERSION = 1;
+
+static std::string DiskCacheFilename() {
+	return GetSysDirectory(DIRECTORY_APP_CACHE) + "gameinfo.cache";
+}
+
+// Only plain local files can be validated cheaply, by size and modification time.
+static bool GetDiskCacheKey(const std::string &gamePath, u64 *fileSize, u64 *mtime) {
+	if (IsRemotePath(gamePath)) {
+		return false;
+	}
+
+	File::FileDetails details;
+	if (!File::GetFileDetails(gamePath, &details)) {
+		return false;
+	}
+	// For a PBP directory, the EBOOT.PBP is what matters.
+	if (details.isDirectory && (!File::GetFileDetails(ResolvePBPFile(gamePath), &details) || details.isDirectory)) {
+		return false;
+	}
+	*fileSize = details.size;
+	*mtime = details.mtime;
+	return true;
+}
+
+// Decodes a PNG icon into an uncompressed ZIM, which loads with just a copy.
+static std::string PreDecodeIcon(const std::string &data) {
+	int width = 0, height = 0;
+	unsigned char *image = nullptr;
+	if (data.size() < 4 || memcmp(data.data(), "\x89\x50\x4E\x47", 4) != 0) {
+		return data;
+	}
+	if (pngLoadPtr((const unsigned char *)data.data(), data.size(), &width, &height, &image, false) != 1 || !image) {
+		return data;
+	}
+
+	std::string zim;
+	zim.resize(16 + width * height * 4);
+	u32 header[4];
+	memcpy(&header[0], "ZIMG", 4);
+	header[1] = width;
+	header[2] = height;
+	header[3] = ZIM_RGBA8888;
+	memcpy(&zim[0], header, sizeof(header));
+	memcpy(&zim[16], image, width * height * 4);
+	free(image);
+	return zim;
+}
+
+bool GameInfoCache::LoadFromDiskCache(const std::string &gamePath, std::shared_ptr<GameInfo> &info) {
+	u64 fileSize, mtime;
+	if (!GetDiskCacheKey(gamePath, &fileSize, &mtime)) {
+		return false;
+	}
+
+	DiskCacheEntry entry;
+	{
+		std::lock_guard<std::mutex> guard(diskCacheLock_);
+		auto iter = diskCache_.find(gamePath);
+		if (iter == diskCache_.end()) {
+			return false;
+		}
+		if (iter->second.fileSize != fileSize || iter->second.mtime != mtime) {
+			// Changed, so it'll be reloaded and replaced.
+			diskCache_.erase(iter);
+			diskCacheDirty_ = true;
+			return false;
+		}
+		entry = iter->second;
+	}
+
+	std::lock_guard<std::mutex> lock(info->lock);
+	info->fileType = entry.fileType;
+	if (!entry.paramSFO.empty()) {
+		info->paramSFO.ReadSFO((const u8 *)entry.paramSFO.data(), entry.paramSFO.size());
+		info->ParseParamSFO();
+	}
+	// These may have been faked for homebrew.
+	info->id = entry.id;
+	info->id_version = entry.id_version;
+	info->region = entry.region;
+	info->paramSFOLoaded = true;
+	info->icon.data = entry.iconData;
+	info->icon.dataLoaded = true;
+	return true;
+}
+
+void GameInfoCache::SaveToDiskCache(const std::string &gamePath, std::shared_ptr<GameInfo> &info) {
+	switch (info->fileType) {
+	case IdentifiedFileType::PSP_ISO:
+	case IdentifiedFileType::PSP_PBP:
+	case IdentifiedFileType::PSP_PBP_DIRECTORY:
+		break;
+	default:
+		return;
+	}
+
+	DiskCacheEntry entry;
+	if (!GetDiskCacheKey(gamePath, &entry.fileSize, &entry.mtime)) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(info->lock);
+		if (!info->paramSFOLoaded || !info->icon.dataLoaded) {
+			return;
+		}
+		entry.fileType = info->fileType;
+		u8 *sfoData = nullptr;
+		size_t sfoSize = 0;
+		if (info->paramSFO.WriteSFO(&sfoData, &sfoSize)) {
+			entry.paramSFO.assign((const char *)sfoData, sfoSize);
+		}
+		delete[] sfoData;
+		entry.id = info->id;
+		entry.id_version = info->id_version;
+		entry.region = info->region;
+		entry.iconData = info->icon.data;
+	}
+	entry.iconData = PreDecodeIcon(entry.iconData);
+
+	std::lock_guard<std::mutex> guard(diskCacheLock_);
+	diskCache_[gamePath] = entry;
+	diskCacheDirty_ = true;
+}
+
+static void WriteDiskCacheString(FILE *f, const std::string &str) {
+	u32 size = (u32)str.size();
+	fwrite(&size, sizeof(size), 1, f);
+	if (size != 0) {
+		fwrite(str.data(), 1, size, f);
+	}
+}
+
+static bool ReadDiskCacheString(FILE *f, std::string *str) {
+	u32 size;
+	if (fread(&size, sizeof(size), 1, f) != 1 || size > 0x01000000) {
+		return false;
+	}
+	str->resize(size);
+	return size == 0 || fread(&(*str)[0], 1, size, f) == size;
+}
+
+void GameInfoCache::LoadDiskCache() {
+	FILE *f = File::OpenCFile(DiskCacheFilename(), "rb");
+	if (!f) {
+		return;
+	}
+
+	char magic[8];
+	u32 version = 0, count = 0;
+	bool valid = fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, DISKCACHE_MAGIC, sizeof(magic)) == 0;
+	valid = valid && fread(&version, sizeof(version), 1, f) == 1 && version == DISKCACHE_VERSION;
+	valid = valid && fread(&count, sizeof(count), 1, f) == 1;
+
+	std::lock_guard<std::mutex> guard(diskCacheLock_);
+	for (u32 i = 0; valid && i < count; ++i) {
+		std::string path;
+		DiskCacheEntry entry;
+		s32 fileType, region;
+		valid = ReadDiskCacheString(f, &path);
+		valid = valid && fread(&entry.fileSize, sizeof(entry.fileSize), 1, f) == 1;
+		valid = valid && fread(&entry.mtime, sizeof(entry.mtime), 1, f) == 1;
+		valid = valid && fread(&fileType, sizeof(fileType), 1, f) == 1;
+		valid = valid && ReadDiskCacheString(f, &entry.paramSFO);
+		valid = valid && ReadDiskCacheString(f, &entry.id);
+		valid = valid && ReadDiskCacheString(f, &entry.id_version);
+		valid = valid && fread(&region, sizeof(region), 1, f) == 1;
+		valid = valid && ReadDiskCacheString(f, &entry.iconData);
+		if (valid) {
+			entry.fileType = (IdentifiedFileType)fileType;
+			entry.region = region;
+			diskCache_[path] = entry;
+		}
+	}
+	fclose(f);
+
+	if (!valid) {
+		WARN_LOG(LOADER, "Game info cache is corrupt, ignoring the rest");
+	}
+	diskCacheDirty_ = false;
+}
+
+void GameInfoCache::SaveDiskCache() {
+	std::lock_guard<std::mutex> guard(diskCacheLock_);
+	if (!diskCacheDirty_) {
+		return;
+	}
+
+	FILE *f = File::OpenCFile(DiskCacheFilename(), "wb");
+	if (!f) {
+		ERROR_LOG(LOADER, "Unable to save game info cache");
+		return;
+	}
+
+	u32 version = DISKCACHE_VERSION;
+	u32 count = (u32)diskCache_.size();
+	fwrite(DISKCACHE_MAGIC, 8, 1, f);
+	fwrite(&version, sizeof(version), 1, f);
+	fwrite(&count, sizeof(count), 1, f);
+	for (const auto &it : diskCache_) {
+		const DiskCacheEntry &entry = it.second;
+		s32 fileType = (s32)entry.fileType;
+		s32 region = entry.region;
+		WriteDiskCacheString(f, it.first);
+		fwrite(&entry.fileSize, sizeof(entry.fileSize), 1, f);
+		fwrite(&entry.mtime, sizeof(entry.mtime), 1, f);
+		fwrite(&fileType, sizeof(fileType), 1, f);
+		WriteDiskCacheString(f, entry.paramSFO);
+		WriteDiskCacheString(f, entry.id);
+		WriteDiskCacheString(f, entry.id_version);
+		fwrite(&region, sizeof(region), 1, f);
+		WriteDiskCacheString(f, entry.iconData);
+	}
+	fclose(f);
+	diskCacheDirty_ = false;
+}
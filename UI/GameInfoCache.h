@@ -113,6 +113,8 @@ class GameInfo {
 	// and obviously also not when creating it and holding the only pointer
 	// to it.
 	std::mutex lock;
+	// Held while a work item loads this info, so loads don't overlap.
+	std::mutex loadLock;
 
 	std::string id;
 	std::string id_version;
@@ -133,8 +135,13 @@ class GameInfo {
 	std::atomic<bool> sndDataLoaded{};
 
 	int wantFlags = 0;
+	// Work items queued for this info that haven't run or been dropped yet.  Protected by lock.
+	int queuedLoads = 0;
+	// The only queued load was dropped, so the next GetInfo() has to queue it again.
+	std::atomic<bool> loadDropped{};
 
-	double lastAccessedTime = 0.0;
+	// Read by the work queue when sorting, so it's atomic.
+	std::atomic<double> lastAccessedTime{ 0.0 };
 
 	u64 gameSize = 0;
 	u64 saveDataSize = 0;
@@ -146,7 +153,9 @@ class GameInfo {
 	// Note: this can change while loading, use GetTitle().
 	std::string title;
 
+	// Created and disposed from the worker threads, so guarded by fileLoaderLock.
 	std::shared_ptr<FileLoader> fileLoader;
+	std::mutex fileLoaderLock;
 	std::string filePath_;
 
 private:
@@ -174,10 +183,29 @@ class GameInfoCache {
 	void CancelAll();
 	void WaitUntilDone(std::shared_ptr<GameInfo> &info);
 
+	// Metadata persisted across runs, validated by file size and modification time.
+	// Called from the work queue.
+	bool LoadFromDiskCache(const std::string &gamePath, std::shared_ptr<GameInfo> &info);
+	void SaveToDiskCache(const std::string &gamePath, std::shared_ptr<GameInfo> &info);
+
 private:
+	struct DiskCacheEntry {
+		u64 fileSize;
+		u64 mtime;
+		IdentifiedFileType fileType;
+		std::string paramSFO;
+		std::string id;
+		std::string id_version;
+		int region;
+		// Pre-decoded to an uncompressed ZIM when possible, so it's quick to upload.
+		std::string iconData;
+	};
+
 	void Init();
 	void Shutdown();
 	void SetupTexture(std::shared_ptr<GameInfo> &info, Draw::DrawContext *draw, GameInfoTex &tex);
+	void LoadDiskCache();
+	void SaveDiskCache();
 
 	// Maps ISO path to info. Need to use shared_ptr as we can return these pointers - 
 	// and if they get destructed while being in use, that's bad.
@@ -185,6 +213,10 @@ class GameInfoCache {
 
 	// Work queue and management
 	PrioritizedWorkQueue *gameInfoWQ_;
+
+	std::map<std::string, DiskCacheEntry> diskCache_;
+	std::mutex diskCacheLock_;
+	bool diskCacheDirty_ = false;
 };
 
 // This one can be global, no good reason not to.
@@ -367,6 +367,13 @@ void GameSettingsScreen::CreateViews() {
 	CheckBox *texBackoff = graphicsSettings->Add(new CheckBox(&g_Config.bTextureBackoffCache, gr->T("Lazy texture caching", "Lazy texture caching (speedup)")));
 	texBackoff->SetDisabledPtr(&g_Config.bSoftwareRendering);
 
+	CheckBox *softTexCache = graphicsSettings->Add(new CheckBox(&g_Config.bSoftwareTextureCache, gr->T("Software texture cache", "Software texture cache (speedup)")));
+	softTexCache->OnClick.Add([=](EventParams &e) {
+		settingInfo_->Show(gr->T("SoftwareTextureCache Tip", "Faster software rendering, but may miss some texture changes"), e.v);
+		return UI::EVENT_CONTINUE;
+	});
+	softTexCache->SetEnabledPtr(&g_Config.bSoftwareRendering);
+
 	CheckBox *texSecondary_ = graphicsSettings->Add(new CheckBox(&g_Config.bTextureSecondaryCache, gr->T("Retain changed textures", "Retain changed textures (speedup, mem hog)")));
 	texSecondary_->OnClick.Add([=](EventParams &e) {
 		settingInfo_->Show(gr->T("RetainChangedTextures Tip", "Makes many games slower, but some games a lot faster"), e.v);
@@ -703,6 +710,7 @@ void GameSettingsScreen::CreateViews() {
 	static const char *ioTimingMethods[] = { "Fast (lag on slow storage)", "Host (bugs, less lag)", "Simulate UMD delays" };
 	View *ioTimingMethod = systemSettings->Add(new PopupMultiChoice(&g_Config.iIOTimingMethod, sy->T("IO timing method"), ioTimingMethods, 0, ARRAY_SIZE(ioTimingMethods), sy->GetName(), screenManager()));
 	ioTimingMethod->SetEnabledPtr(&g_Config.bSeparateIOThread);
+	systemSettings->Add(new CheckBox(&g_Config.bSeparateGEThread, sy->T("GE on thread (experimental)")))->SetEnabled(!PSP_IsInited());
 	systemSettings->Add(new CheckBox(&g_Config.bForceLagSync, sy->T("Force real clock sync (slower, less lag)")));
 	PopupSliderChoice *lockedMhz = systemSettings->Add(new PopupSliderChoice(&g_Config.iLockedCPUSpeed, 0, 1000, sy->T("Change CPU Clock", "Change CPU Clock (unstable)"), screenManager(), sy->T("MHz, 0:default")));
 	lockedMhz->SetZeroLabel(sy->T("Auto"));
@@ -1325,6 +1333,11 @@ void DeveloperToolsScreen::CreateViews() {
 	if (!PSP_IsInited()) {
 		createTextureIni->SetEnabled(false);
 	}
+	Choice *createTexturePack = list->Add(new Choice(dev->T("Create texture pack for current game")));
+	createTexturePack->OnClick.Handle(this, &DeveloperToolsScreen::OnCreateTexturePack);
+	if (!PSP_IsInited()) {
+		createTexturePack->SetEnabled(false);
+	}
 #endif
 }
 
@@ -1388,6 +1401,20 @@ UI::EventReturn DeveloperToolsScreen::OnOpenTexturesIniFile(UI::EventParams &e)
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn DeveloperToolsScreen::OnCreateTexturePack(UI::EventParams &e) {
+	I18NCategory *dev = GetI18NCategory("Developer");
+	std::string gameID = g_paramSFO.GetDiscID();
+	std::string generatedFilename;
+	if (TextureReplacer::GeneratePack(gameID, &generatedFilename)) {
+		// Reloads the pack, swapping in the new one.
+		NativeMessageReceived("gpu_clearCache", "");
+		host->NotifyUserMessage(dev->T("Texture pack created"), 3.0f);
+	} else {
+		host->NotifyUserMessage(dev->T("Could not create texture pack"), 3.0f);
+	}
+	return UI::EVENT_DONE;
+}
+
 UI::EventReturn DeveloperToolsScreen::OnLogConfig(UI::EventParams &e) {
 	screenManager()->push(new LogConfigScreen());
 	return UI::EVENT_DONE;
@@ -155,6 +155,7 @@ class DeveloperToolsScreen : public UIDialogScreenWithBackground {
 	UI::EventReturn OnLoadLanguageIni(UI::EventParams &e);
 	UI::EventReturn OnSaveLanguageIni(UI::EventParams &e);
 	UI::EventReturn OnOpenTexturesIniFile(UI::EventParams &e);
+	UI::EventReturn OnCreateTexturePack(UI::EventParams &e);
 	UI::EventReturn OnLogConfig(UI::EventParams &e);
 	UI::EventReturn OnJitAffectingSetting(UI::EventParams &e);
 	UI::EventReturn OnRemoteDebugger(UI::EventParams &e);
@@ -15,6 +15,7 @@
 #endif
 
 #include <cmath>
+#include <cstring>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -73,7 +74,7 @@ bool Connection::Resolve(const char *host, int port, DNSType type) {
 	return true;
 }
 
-bool Connection::Connect(int maxTries, double timeout, bool *cancelConnect) {
+bool Connection::Connect(int maxTries, double timeout, std::atomic<bool> *cancelConnect) {
 	if (port_ <= 0) {
 		ELOG("Bad port");
 		return false;
@@ -168,6 +169,7 @@ namespace http {
 Client::Client() {
 	httpVersion_ = "1.1";
 	userAgent_ = USERAGENT;
+	keepAlive_ = false;
 }
 
 Client::~Client() {
@@ -273,7 +275,7 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 		"%s %s HTTP/%s\r\n"
 		"Host: %s\r\n"
 		"User-Agent: %s\r\n"
-		"Connection: close\r\n"
+		"Connection: %s\r\n"
 		"%s"
 		"\r\n";
 
@@ -281,6 +283,7 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 		method, resource, httpVersion_,
 		host_.c_str(),
 		userAgent_,
+		keepAlive_ ? "keep-alive" : "close",
 		otherHeaders ? otherHeaders : "");
 	buffer.Append(data);
 	bool flushed = buffer.FlushSocket(sock());
@@ -290,9 +293,29 @@ int Client::SendRequestWithData(const char *method, const char *resource, const
 	return 0;
 }
 
+// With keep-alive, the socket won't close after the response, so we can't block on a fixed size.
+static bool ReadUntilHeadersEnd(uintptr_t sock, Buffer *readbuf) {
+	char buf[1024];
+	std::string peek;
+	while (true) {
+		readbuf->PeekAll(&peek);
+		if (peek.find("\r\n\r\n") != peek.npos)
+			return true;
+		int retval = recv(sock, buf, sizeof(buf), 0);
+		if (retval <= 0)
+			return false;
+		memcpy(readbuf->Append((size_t)retval), buf, retval);
+	}
+}
+
 int Client::ReadResponseHeaders(Buffer *readbuf, std::vector<std::string> &responseHeaders, float *progress) {
-	// Snarf all the data we can into RAM. A little unsafe but hey.
-	if (readbuf->Read(sock(), 4096) < 0) {
+	if (keepAlive_) {
+		if (!ReadUntilHeadersEnd(sock(), readbuf)) {
+			ELOG("Failed to read HTTP headers :(");
+			return -1;
+		}
+	} else if (readbuf->Read(sock(), 4096) < 0) {
+		// Snarf all the data we can into RAM. A little unsafe but hey.
 		ELOG("Failed to read HTTP headers :(");
 		return -1;
 	}
@@ -361,7 +384,15 @@ int Client::ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &
 		*progress = 0.1f;
 	}
 
-	if (!contentLength || !progress) {
+	if (keepAlive_ && contentLength && !chunked) {
+		// The server may keep the socket open, so we can't wait for it to close.
+		// Read exactly the entity, some of which may already be in readbuf.
+		if (readbuf->size() < (size_t)contentLength) {
+			readbuf->Read(sock(), (size_t)contentLength - readbuf->size());
+		}
+		if (readbuf->size() < (size_t)contentLength)
+			return -1;
+	} else if (!contentLength || !progress) {
 		// No way to know how far along we are. Let's just not update the progress counter.
 		if (!readbuf->ReadAll(sock(), contentLength))
 			return -1;
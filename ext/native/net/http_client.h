@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -31,7 +32,7 @@ class Connection {
 	// Inits the sockaddr_in.
 	bool Resolve(const char *host, int port, DNSType type = DNSType::ANY);
 
-	bool Connect(int maxTries = 2, double timeout = 20.0f, bool *cancelConnect = nullptr);
+	bool Connect(int maxTries = 2, double timeout = 20.0f, std::atomic<bool> *cancelConnect = nullptr);
 	void Disconnect();
 
 	// Only to be used for bring-up and debugging.
@@ -75,8 +76,17 @@ class Client : public net::Connection {
 	// If your response contains a response, you must read it.
 	int ReadResponseEntity(Buffer *readbuf, const std::vector<std::string> &responseHeaders, Buffer *output, float *progress = nullptr, bool *cancelled = nullptr);
 
+	// When set, asks the server to keep the connection open after the response.
+	// Entities are then read by Content-Length rather than until the socket closes.
+	void SetKeepAlive(bool keepAlive) {
+		keepAlive_ = keepAlive;
+	}
+
 	const char *userAgent_;
 	const char *httpVersion_;
+
+protected:
+	bool keepAlive_;
 };
 
 // Not particularly efficient, but hey - it's a background download, that's pretty cool :P
@@ -11,28 +11,36 @@ PrioritizedWorkQueue::~PrioritizedWorkQueue() {
 	}
 }
 
+// Items gain this much priority per second spent waiting, so nothing starves.
+static const float PRIORITY_AGING_PER_SECOND = 1.0f;
+
 void PrioritizedWorkQueue::Add(PrioritizedWorkQueueItem *item) {
 	std::lock_guard<std::mutex> guard(mutex_);
-	queue_.push_back(item);
+	queue_.push_back(QueuedItem{ item, time_now_d() });
 	notEmpty_.notify_one();
 }
 
 void PrioritizedWorkQueue::Stop() {
 	std::lock_guard<std::mutex> guard(mutex_);
 	done_ = true;
-	notEmpty_.notify_one();
+	notEmpty_.notify_all();
 }
 
 void PrioritizedWorkQueue::Flush() {
-	std::lock_guard<std::mutex> guard(mutex_);
-	int flush_count = 0;
-	for (auto iter = queue_.begin(); iter != queue_.end(); ++iter) {
-		delete *iter;
-		flush_count++;
+	std::vector<QueuedItem> flushed;
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		flushed.swap(queue_);
 	}
-	queue_.clear();
-	if (flush_count > 0) {
-		ILOG("PrioritizedWorkQueue: Flushed %d un-executed tasks", flush_count);
+
+	// Like Pop(), don't hold the lock while cancelling.
+	for (auto iter = flushed.begin(); iter != flushed.end(); ++iter) {
+		iter->item->cancel();
+		delete iter->item;
+	}
+	if (!flushed.empty()) {
+		ILOG("PrioritizedWorkQueue: Flushed %d un-executed tasks", (int)flushed.size());
+		NotifyDrain();
 	}
 }
 
@@ -56,60 +64,76 @@ bool PrioritizedWorkQueue::WaitUntilDone(bool all) {
 
 void PrioritizedWorkQueue::NotifyDrain() {
 	std::lock_guard<std::mutex> guard(drainMutex_);
-	drain_.notify_one();
+	drain_.notify_all();
 }
 
 bool PrioritizedWorkQueue::AllItemsDone() {
 	std::lock_guard<std::mutex> guard(mutex_);
-	return queue_.empty() && !working_;
+	return queue_.empty() && working_ == 0;
 }
 
 // The worker should simply call this in a loop. Will block when appropriate.
 PrioritizedWorkQueueItem *PrioritizedWorkQueue::Pop() {
+	std::vector<PrioritizedWorkQueueItem *> dropped;
+	PrioritizedWorkQueueItem *poppedItem = nullptr;
 	{
-		std::lock_guard<std::mutex> guard(mutex_);
-		working_ = false;  // The thread only calls Pop if it's done.
-	}
-
-	// Important: make sure mutex_ is not locked while draining.
-	NotifyDrain();
-
-	std::unique_lock<std::mutex> guard(mutex_);
-	if (done_) {
-		return 0;
-	}
-
-	while (queue_.empty()) {
-		notEmpty_.wait(guard);
-		if (done_) {
-			return 0;
+		std::unique_lock<std::mutex> guard(mutex_);
+		while (!done_ && !poppedItem) {
+			while (queue_.empty() && !done_) {
+				notEmpty_.wait(guard);
+			}
+			if (done_) {
+				break;
+			}
+
+			// Drop anything nobody wants anymore, then find the top priority item (lowest value.)
+			// The longer an item has waited, the higher its priority.
+			double now = time_now_d();
+			float best_prio = std::numeric_limits<float>::infinity();
+			auto best = queue_.end();
+			for (auto iter = queue_.begin(); iter != queue_.end(); ) {
+				if (iter->item->stale()) {
+					dropped.push_back(iter->item);
+					iter = queue_.erase(iter);
+					continue;
+				}
+				float prio = iter->item->priority() - (float)(now - iter->queuedTime) * PRIORITY_AGING_PER_SECOND;
+				if (best == queue_.end() || prio < best_prio) {
+					best = iter;
+					best_prio = prio;
+				}
+				++iter;
+			}
+
+			if (best != queue_.end()) {
+				poppedItem = best->item;
+				queue_.erase(best);
+				working_++;  // This will be worked on.
+			}
 		}
 	}
 
-	// Find the top priority item (lowest value).
-	float best_prio = std::numeric_limits<float>::infinity();
-	std::vector<PrioritizedWorkQueueItem *>::iterator best = queue_.end();
-	for (auto iter = queue_.begin(); iter != queue_.end(); ++iter) {
-		if ((*iter)->priority() < best_prio) {
-			best = iter;
-			best_prio = (*iter)->priority();
-		}
+	// Don't hold the lock while cancelling, it may take locks of its own.
+	for (auto item : dropped) {
+		item->cancel();
+		delete item;
 	}
-
-	if (best != queue_.end()) {
-		PrioritizedWorkQueueItem *poppedItem = *best;
-		queue_.erase(best);
-		working_ = true;  // This will be worked on.
-		return poppedItem;
-	} else {
-		// Not really sure how this can happen, but let's be safe.
-		return 0;
+	if (!dropped.empty()) {
+		NotifyDrain();
 	}
+	return poppedItem;
 }
 
-// TODO: This feels ugly. Revisit later.
+void PrioritizedWorkQueue::Complete(PrioritizedWorkQueueItem *item) {
+	delete item;
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		working_--;
+	}
 
-static std::thread *workThread;
+	// Important: make sure mutex_ is not locked while draining.
+	NotifyDrain();
+}
 
 static void threadfunc(PrioritizedWorkQueue *wq) {
 	setCurrentThreadName("PrioQueue");
@@ -120,20 +144,31 @@ static void threadfunc(PrioritizedWorkQueue *wq) {
 				break;
 		} else {
 			item->run();
-			delete item;
+			wq->Complete(item);
 		}
 	}
 }
 
-void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq) {
-	workThread = new std::thread([=](){threadfunc(wq);});
+void PrioritizedWorkQueue::StartWorkers(int count) {
+	for (int i = 0; i < count; ++i) {
+		workers_.push_back(std::thread([=](){threadfunc(this);}));
+	}
 }
 
-void StopProcessingWorkQueue(PrioritizedWorkQueue *wq) {
-	wq->Stop();
-	if (workThread) {
-		workThread->join();
-		delete workThread;
+void PrioritizedWorkQueue::StopWorkers() {
+	Stop();
+	for (auto &worker : workers_) {
+		worker.join();
 	}
-	workThread = nullptr;
+	workers_.clear();
+}
+
+// TODO: This feels ugly. Revisit later.
+
+void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq, int threads) {
+	wq->StartWorkers(threads);
+}
+
+void StopProcessingWorkQueue(PrioritizedWorkQueue *wq) {
+	wq->StopWorkers();
 }
@@ -4,6 +4,7 @@
 #include <limits>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
 
 #include "base/basictypes.h"
 #include "thread/threadutil.h"
@@ -17,6 +18,10 @@ class PrioritizedWorkQueueItem {
 	virtual ~PrioritizedWorkQueueItem() {}
 	virtual void run() = 0;
 	virtual float priority() = 0;  // Low priority value = high priority!
+	// If this returns true, the item is no longer wanted and is dropped without running.
+	virtual bool stale() { return false; }
+	// Called instead of run() when the item is dropped.
+	virtual void cancel() {}
 
 private:
 	DISALLOW_COPY_AND_ASSIGN(PrioritizedWorkQueueItem);
@@ -24,13 +29,15 @@ class PrioritizedWorkQueueItem {
 
 class PrioritizedWorkQueue {
 public:
-	PrioritizedWorkQueue() : done_(false), working_(false) {}
+	PrioritizedWorkQueue() : done_(false), working_(0) {}
 	~PrioritizedWorkQueue();
 	// Takes ownership.
 	void Add(PrioritizedWorkQueueItem *item);
 
-	// The worker should simply call this in a loop. Will block when appropriate.
+	// The workers should simply call this in a loop, then Complete() the item. Will block when appropriate.
 	PrioritizedWorkQueueItem *Pop();
+	// Deletes the item, call after running it.
+	void Complete(PrioritizedWorkQueueItem *item);
 
 	void Flush();
 	bool Done() { return done_; }
@@ -38,27 +45,37 @@ class PrioritizedWorkQueue {
 	bool WaitUntilDone(bool all = true);
 
 	bool IsWorking() {
-		return working_;
+		return working_ != 0;
 	}
 
+	// Starts worker threads that keep running this queue until Stop().
+	void StartWorkers(int count);
+	void StopWorkers();
+
 private:
+	struct QueuedItem {
+		PrioritizedWorkQueueItem *item;
+		double queuedTime;
+	};
+
 	void NotifyDrain();
 	bool AllItemsDone();
 
 	bool done_;
-	bool working_;
+	int working_;
 	std::mutex mutex_;
 	std::mutex drainMutex_;
 	std::condition_variable notEmpty_;
 	std::condition_variable drain_;
 
-	std::vector<PrioritizedWorkQueueItem *> queue_;
+	std::vector<QueuedItem> queue_;
+	std::vector<std::thread> workers_;
 
 	DISALLOW_COPY_AND_ASSIGN(PrioritizedWorkQueue);
 };
 
 
-// Starts up a thread that keeps trying to run this workqueue.
+// Starts up threads that keep trying to run this workqueue.
 // TODO: This feels ugly. Revisit later.
-void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq);
+void ProcessWorkQueueOnThreadWhile(PrioritizedWorkQueue *wq, int threads = 1);
 void StopProcessingWorkQueue(PrioritizedWorkQueue *wq);
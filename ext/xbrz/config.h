@@ -27,13 +27,15 @@ struct ScalerCfg
         equalColorTolerance(30),
         dominantDirectionThreshold(3.6),
         steepDirectionThreshold(2.2),
-        newTestAttribute(0) {}
+        newTestAttribute(0),
+        vectorize(true) {}
 
     double luminanceWeight;
     double equalColorTolerance;
     double dominantDirectionThreshold;
     double steepDirectionThreshold;
     double newTestAttribute; //unused; test new parameters
+    bool vectorize; //SSE2 kernels where built in, and color distances shared between neighbouring kernels; same output either way
 };
 }
 
@@ -20,6 +20,11 @@
 #include <limits>
 #include <vector>
 
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XBRZ_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace
 {
 template <uint32_t N> inline
@@ -72,6 +77,34 @@ uint32_t gradientARGB(uint32_t pixFront, uint32_t pixBack) //find intermediate c
 }
 
 
+#ifdef XBRZ_SSE2
+template <unsigned int M, unsigned int N> inline
+uint32_t gradientARGBSSE2(uint32_t pixFront, uint32_t pixBack) //same result as gradientARGB(), all channels at once
+{
+	static_assert(0 < M && M < N && N <= 1000, "");
+
+	const unsigned int weightFront = getAlpha(pixFront) * M;
+	const unsigned int weightBack  = getAlpha(pixBack) * (N - M);
+	const unsigned int weightSum   = weightFront + weightBack;
+	if (weightSum == 0)
+		return 0;
+	if (N > 256) //sums must stay below 2^24 to be exact in float
+		return gradientARGB<M, N>(pixFront, pixBack);
+
+	//the integer quotient is at least 1 / weightSum away from the next integer, more than the rounding error of the float division
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 front = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixFront), zero), zero));
+	const __m128 back  = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixBack),  zero), zero));
+	const __m128 sum = _mm_add_ps(_mm_mul_ps(front, _mm_set1_ps(static_cast<float>(weightFront))), _mm_mul_ps(back, _mm_set1_ps(static_cast<float>(weightBack))));
+	__m128i col = _mm_cvttps_epi32(_mm_div_ps(sum, _mm_set1_ps(static_cast<float>(weightSum))));
+	col = _mm_packs_epi32(col, col);
+	col = _mm_packus_epi16(col, col);
+
+	return (static_cast<uint32_t>(_mm_cvtsi128_si32(col)) & 0x00ffffff) | ((weightSum / N) << 24);
+}
+#endif
+
+
 //inline
 //double fastSqrt(double n)
 //{
@@ -210,15 +243,22 @@ struct DistYCbCrBuffer //30% perf boost compared to distYCbCr()!
 {
 public:
 	static double dist(uint32_t pix1, uint32_t pix2)
+	{
+		return instance().distImpl(pix1, pix2);
+	}
+
+	static const float* table() { return instance().buffer.data(); } //for the row kernels, indexed like distImpl()
+
+private:
+	static const DistYCbCrBuffer& instance()
 	{
 #if defined _MSC_VER && _MSC_VER < 1900
 #error function scope static initialization is not yet thread-safe!
 #endif
 		static const DistYCbCrBuffer inst;
-		return inst.distImpl(pix1, pix2);
+		return inst;
 	}
 
-private:
 	DistYCbCrBuffer() : buffer(256 * 256 * 256)
 	{
 		for (uint32_t i = 0; i < 256 * 256 * 256; ++i) //startup time: 114 ms on Intel Core i5 (four cores)
@@ -262,6 +302,30 @@ struct DistYCbCrBuffer //30% perf boost compared to distYCbCr()!
 };
 
 
+#ifdef XBRZ_SSE2
+inline
+__m128 distYCbCrSSE2(const float* table, __m128i pix1, __m128i pix2) //DistYCbCrBuffer::dist() for four pixel pairs
+{
+	const __m128i mask = _mm_set1_epi32(0xff);
+	const __m128i bias = _mm_set1_epi32(255);
+	auto halfDiff = [&](int shift) //(diff + 255) / 2, never negative
+	{
+		const __m128i c1 = _mm_and_si128(_mm_srli_epi32(pix1, shift), mask);
+		const __m128i c2 = _mm_and_si128(_mm_srli_epi32(pix2, shift), mask);
+		return _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(c1, c2), bias), 1);
+	};
+	const __m128i index = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(halfDiff(0), 16), _mm_slli_epi32(halfDiff(8), 8)), halfDiff(16));
+
+	//no gather in SSE2, but at least the lookups are independent
+	const uint32_t i0 = _mm_cvtsi128_si32(index);
+	const uint32_t i1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(index, _MM_SHUFFLE(1, 1, 1, 1)));
+	const uint32_t i2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(index, _MM_SHUFFLE(2, 2, 2, 2)));
+	const uint32_t i3 = _mm_cvtsi128_si32(_mm_shuffle_epi32(index, _MM_SHUFFLE(3, 3, 3, 3)));
+	return _mm_setr_ps(table[i0], table[i1], table[i2], table[i3]);
+}
+#endif
+
+
 enum BlendType
 {
 	BLEND_NONE = 0,
@@ -299,23 +363,19 @@ input kernel area naming convention:
 | M | N | O | P |
 -----------------
 */
-template <class ColorDistance>
-FORCE_INLINE //detect blend direction
-BlendResult preProcessCorners(const Kernel_4x4& ker, const xbrz::ScalerCfg& cfg) //result: F, G, J, K corners of "GradientType"
+inline
+bool cornersTrivial(const Kernel_4x4& ker) //nothing to blend between F, G, J, K
 {
-	BlendResult result = {};
-
-	if ((ker.f == ker.g &&
-		 ker.j == ker.k) ||
-		(ker.f == ker.j &&
-		 ker.g == ker.k))
-		return result;
-
-	auto dist = [&](uint32_t pix1, uint32_t pix2) { return ColorDistance::dist(pix1, pix2, cfg.luminanceWeight); };
+	return (ker.f == ker.g &&
+			ker.j == ker.k) ||
+		   (ker.f == ker.j &&
+			ker.g == ker.k);
+}
 
-	const int weight = 4;
-	double jg = dist(ker.i, ker.f) + dist(ker.f, ker.c) + dist(ker.n, ker.k) + dist(ker.k, ker.h) + weight * dist(ker.j, ker.g);
-	double fk = dist(ker.e, ker.j) + dist(ker.j, ker.o) + dist(ker.b, ker.g) + dist(ker.g, ker.l) + weight * dist(ker.f, ker.k);
+FORCE_INLINE //detect blend direction from the summed distances along both diagonals
+BlendResult classifyCorners(const Kernel_4x4& ker, double jg, double fk, const xbrz::ScalerCfg& cfg)
+{
+	BlendResult result = {};
 
 	if (jg < fk) //test sample: 70% of values max(jg, fk) / min(jg, fk) are between 1.1 and 3.7 with median being 1.8
 	{
@@ -338,6 +398,105 @@ BlendResult preProcessCorners(const Kernel_4x4& ker, const xbrz::ScalerCfg& cfg)
 	return result;
 }
 
+template <class ColorDistance>
+FORCE_INLINE //detect blend direction
+BlendResult preProcessCorners(const Kernel_4x4& ker, const xbrz::ScalerCfg& cfg) //result: F, G, J, K corners of "GradientType"
+{
+	if (cornersTrivial(ker))
+		return BlendResult();
+
+	auto dist = [&](uint32_t pix1, uint32_t pix2) { return ColorDistance::dist(pix1, pix2, cfg.luminanceWeight); };
+
+	const int weight = 4;
+	double jg = dist(ker.i, ker.f) + dist(ker.f, ker.c) + dist(ker.n, ker.k) + dist(ker.k, ker.h) + weight * dist(ker.j, ker.g);
+	double fk = dist(ker.e, ker.j) + dist(ker.j, ker.o) + dist(ker.b, ker.g) + dist(ker.g, ker.l) + weight * dist(ker.f, ker.k);
+
+	return classifyCorners(ker, jg, fk, cfg);
+}
+
+
+/*
+Each distance in preProcessCorners() is between diagonal neighbours, and is shared by up to five kernels.
+With cfg.vectorize, whole rows of them are computed up front with ColorDistance::distRow() and looked up:
+	rise[y][x] = dist(src[y][x], src[y - 1][x + 1])
+	fall[y][x] = dist(src[y][x], src[y + 1][x + 1])
+Kernels touching the image border still use preProcessCorners(), as their neighbours are clamped.
+*/
+template <class ColorDistance>
+class CornerPreProcessor
+{
+public:
+	CornerPreProcessor(const uint32_t* src, int srcWidth, int srcHeight, const xbrz::ScalerCfg& cfg) :
+		src_(src),
+		srcWidth_(srcWidth),
+		srcHeight_(srcHeight),
+		cfg_(cfg)
+	{
+		if (cfg.vectorize && srcWidth >= 4 && srcHeight >= 4)
+			distBuffer_.resize(6 * (srcWidth - 1));
+	}
+
+	void setRow(int y) //prepare for the kernels with input pixel F in row y
+	{
+		rowCached_ = !distBuffer_.empty() && y >= 1 && y + 2 < srcHeight_;
+		if (!rowCached_)
+			return;
+
+		rise_0_  = distRow(y,     0);
+		rise_p1_ = distRow(y + 1, 0);
+		rise_p2_ = distRow(y + 2, 0);
+		fall_m1_ = distRow(y - 1, 1);
+		fall_0_  = distRow(y,     1);
+		fall_p1_ = distRow(y + 1, 1);
+	}
+
+	FORCE_INLINE
+	BlendResult process(const Kernel_4x4& ker, int x) const
+	{
+		if (!rowCached_ || x < 1 || x + 2 >= srcWidth_)
+			return preProcessCorners<ColorDistance>(ker, cfg_);
+
+		if (cornersTrivial(ker))
+			return BlendResult();
+
+		//same terms in the same order as preProcessCorners(), so the sums are bit-identical
+		const int weight = 4;
+		double jg = rise_p1_[x - 1] + rise_0_[x] + rise_p2_[x] + rise_p1_[x + 1] + weight * rise_p1_[x];
+		double fk = fall_0_[x - 1] + fall_p1_[x] + fall_m1_[x] + fall_0_[x + 1] + weight * fall_0_[x];
+
+		return classifyCorners(ker, jg, fk, cfg_);
+	}
+
+private:
+	const double* distRow(int y, int fall) //rows are kept in a ring of three per direction, as setRow() moves down by one
+	{
+		const int slot = fall * 3 + y % 3;
+		double* row = &distBuffer_[slot * (srcWidth_ - 1)];
+		if (cachedRow_[slot] != y)
+		{
+			const uint32_t* next = src_ + srcWidth_ * (fall ? y + 1 : y - 1) + 1;
+			ColorDistance::distRow(src_ + srcWidth_ * y, next, row, srcWidth_ - 1, cfg_.luminanceWeight);
+			cachedRow_[slot] = y;
+		}
+		return row;
+	}
+
+	const uint32_t* src_;
+	const int srcWidth_;
+	const int srcHeight_;
+	const xbrz::ScalerCfg& cfg_;
+
+	std::vector<double> distBuffer_;
+	int cachedRow_[6] = { -1, -1, -1, -1, -1, -1 };
+	bool rowCached_ = false;
+	const double* rise_0_  = nullptr;
+	const double* rise_p1_ = nullptr;
+	const double* rise_p2_ = nullptr;
+	const double* fall_m1_ = nullptr;
+	const double* fall_0_  = nullptr;
+	const double* fall_p1_ = nullptr;
+};
+
 struct Kernel_3x3
 {
 	uint32_t
@@ -516,6 +675,8 @@ void scaleImage(const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight,
 	std::fill(preProcBuffer, preProcBuffer + bufferSize, 0);
 	static_assert(BLEND_NONE == 0, "");
 
+	CornerPreProcessor<ColorDistance> preProcessor(src, srcWidth, srcHeight, cfg);
+
 	//initialize preprocessing buffer for first row of current stripe: detect upper left and right corner blending
 	//this cannot be optimized for adjacent processing stripes; we must not allow for a memory race condition!
 	if (yFirst > 0)
@@ -527,6 +688,7 @@ void scaleImage(const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight,
 		const uint32_t* s_p1 = src + srcWidth * std::min(y + 1, srcHeight - 1);
 		const uint32_t* s_p2 = src + srcWidth * std::min(y + 2, srcHeight - 1);
 
+		preProcessor.setRow(y);
 		for (int x = 0; x < srcWidth; ++x)
 		{
 			const int x_m1 = std::max(x - 1, 0);
@@ -554,7 +716,7 @@ void scaleImage(const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight,
 			ker.o = s_p2[x_p1];
 			ker.p = s_p2[x_p2];
 
-			const BlendResult res = preProcessCorners<ColorDistance>(ker, cfg);
+			const BlendResult res = preProcessor.process(ker, x);
 			/*
 			preprocessing blend result:
 			---------
@@ -582,6 +744,7 @@ void scaleImage(const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight,
 
 		unsigned char blend_xy1 = 0; //corner blending for current (x, y + 1) position
 
+		preProcessor.setRow(y);
 		for (int x = 0; x < srcWidth; ++x, out += Scaler::scale)
 		{
 #ifdef _DEBUG
@@ -617,7 +780,7 @@ void scaleImage(const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight,
 			//evaluate the four corners on bottom-right of current pixel
 			unsigned char blend_xy = 0; //for current (x, y) position
 			{
-				const BlendResult res = preProcessCorners<ColorDistance>(ker4, cfg);
+				const BlendResult res = preProcessor.process(ker4, x);
 				/*
 				preprocessing blend result:
 				---------
@@ -1041,6 +1204,22 @@ struct ColorDistanceRGB
 		//	return 0;
 		//return distYCbCr(pix1, pix2, luminanceWeight);
 	}
+
+	static void distRow(const uint32_t* pix1, const uint32_t* pix2, double* out, int n, double luminanceWeight) //out[x] = dist(pix1[x], pix2[x])
+	{
+		int x = 0;
+#ifdef XBRZ_SSE2
+		const float* table = DistYCbCrBuffer::table();
+		for (; x + 4 <= n; x += 4)
+		{
+			const __m128 d = distYCbCrSSE2(table, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix1 + x)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix2 + x)));
+			_mm_storeu_pd(out + x,     _mm_cvtps_pd(d));
+			_mm_storeu_pd(out + x + 2, _mm_cvtps_pd(_mm_movehl_ps(d, d)));
+		}
+#endif
+		for (; x < n; ++x)
+			out[x] = dist(pix1[x], pix2[x], luminanceWeight);
+	}
 };
 
 struct ColorDistanceARGB
@@ -1067,6 +1246,37 @@ struct ColorDistanceARGB
 
 		//alternative? return std::sqrt(a1 * a2 * square(DistYCbCrBuffer::dist(pix1, pix2)) + square(255 * (a1 - a2)));
 	}
+
+	static void distRow(const uint32_t* pix1, const uint32_t* pix2, double* out, int n, double luminanceWeight) //out[x] = dist(pix1[x], pix2[x])
+	{
+		int x = 0;
+#ifdef XBRZ_SSE2
+		const float* table = DistYCbCrBuffer::table();
+		const __m128d alphaScale = _mm_set1_pd(255.0);
+		for (; x + 4 <= n; x += 4)
+		{
+			const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix1 + x));
+			const __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix2 + x));
+			const __m128 d = distYCbCrSSE2(table, p1, p2);
+			const __m128i alpha1 = _mm_srli_epi32(p1, 24);
+			const __m128i alpha2 = _mm_srli_epi32(p2, 24);
+
+			//two pixels per step in double, like dist(): min(a1, a2) * d + 255 * |a1 - a2|
+			for (int half = 0; half < 2; ++half)
+			{
+				const int shift = half * 8;
+				const __m128d a1 = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(alpha1, shift)), alphaScale);
+				const __m128d a2 = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(alpha2, shift)), alphaScale);
+				const __m128d dd = _mm_cvtps_pd(half ? _mm_movehl_ps(d, d) : d);
+				const __m128d aMin = _mm_min_pd(a1, a2);
+				const __m128d aDiff = _mm_sub_pd(_mm_max_pd(a1, a2), aMin);
+				_mm_storeu_pd(out + x + half * 2, _mm_add_pd(_mm_mul_pd(aMin, dd), _mm_mul_pd(alphaScale, aDiff)));
+			}
+		}
+#endif
+		for (; x < n; ++x)
+			out[x] = dist(pix1[x], pix2[x], luminanceWeight);
+	}
 };
 
 
@@ -1087,6 +1297,37 @@ struct ColorGradientARGB
 		pixBack = gradientARGB<M, N>(pixFront, pixBack);
 	}
 };
+
+#ifdef XBRZ_SSE2
+struct ColorGradientARGBSSE2
+{
+	template <unsigned int M, unsigned int N>
+	static void alphaGrad(uint32_t& pixBack, uint32_t pixFront)
+	{
+		pixBack = gradientARGBSSE2<M, N>(pixFront, pixBack);
+	}
+};
+#endif
+
+
+template <class ColorGradient, class ColorDistance>
+void scaleWith(size_t factor, const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight, const xbrz::ScalerCfg& cfg, int yFirst, int yLast)
+{
+	switch (factor)
+	{
+		case 2:
+			return scaleImage<Scaler2x<ColorGradient>, ColorDistance>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
+		case 3:
+			return scaleImage<Scaler3x<ColorGradient>, ColorDistance>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
+		case 4:
+			return scaleImage<Scaler4x<ColorGradient>, ColorDistance>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
+		case 5:
+			return scaleImage<Scaler5x<ColorGradient>, ColorDistance>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
+		case 6:
+			return scaleImage<Scaler6x<ColorGradient>, ColorDistance>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
+	}
+	assert(false);
+}
 }
 
 
@@ -1095,36 +1336,14 @@ void xbrz::scale(size_t factor, const uint32_t* src, uint32_t* trg, int srcWidth
 	switch (colFmt)
 	{
 		case ColorFormat::ARGB:
-			switch (factor)
-			{
-				case 2:
-					return scaleImage<Scaler2x<ColorGradientARGB>, ColorDistanceARGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 3:
-					return scaleImage<Scaler3x<ColorGradientARGB>, ColorDistanceARGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 4:
-					return scaleImage<Scaler4x<ColorGradientARGB>, ColorDistanceARGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 5:
-					return scaleImage<Scaler5x<ColorGradientARGB>, ColorDistanceARGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 6:
-					return scaleImage<Scaler6x<ColorGradientARGB>, ColorDistanceARGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-			}
-			break;
+#ifdef XBRZ_SSE2
+			if (cfg.vectorize)
+				return scaleWith<ColorGradientARGBSSE2, ColorDistanceARGB>(factor, src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
+#endif
+			return scaleWith<ColorGradientARGB, ColorDistanceARGB>(factor, src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
 
 		case ColorFormat::RGB:
-			switch (factor)
-			{
-				case 2:
-					return scaleImage<Scaler2x<ColorGradientRGB>, ColorDistanceRGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 3:
-					return scaleImage<Scaler3x<ColorGradientRGB>, ColorDistanceRGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 4:
-					return scaleImage<Scaler4x<ColorGradientRGB>, ColorDistanceRGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 5:
-					return scaleImage<Scaler5x<ColorGradientRGB>, ColorDistanceRGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-				case 6:
-					return scaleImage<Scaler6x<ColorGradientRGB>, ColorDistanceRGB>(src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
-			}
-			break;
+			return scaleWith<ColorGradientRGB, ColorDistanceRGB>(factor, src, trg, srcWidth, srcHeight, cfg, yFirst, yLast);
 	}
 	assert(false);
 }
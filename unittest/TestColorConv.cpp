@@ -0,0 +1,155 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdlib>
+#include <vector>
+
+#include "Common/ColorConv.h"
+#include "Common/Common.h"
+#include "unittest/UnitTest.h"
+
+static const int BENCH_WIDTH = 480;
+static const int BENCH_HEIGHT = 272;
+
+static u32 SwapRB(u32 c) {
+	return (c & 0xFF00FF00) | ((c >> 16) & 0xFF) | ((c & 0xFF) << 16);
+}
+
+// The reference conversions, one pixel at a time.
+static u32 RefBGRA8888ToRGBA8888(u32 c) {
+	return SwapRB(c);
+}
+static u16 RefBGRA8888ToRGBA5551(u32 c) {
+	return RGBA8888ToRGBA5551(SwapRB(c));
+}
+static u16 RefBGRA8888ToRGB565(u32 c) {
+	return RGBA8888ToRGB565(SwapRB(c));
+}
+static u16 RefBGRA8888ToRGBA4444(u32 c) {
+	return RGBA8888ToRGBA4444(SwapRB(c));
+}
+static u32 RefRGBA4444ToBGRA8888(u16 c) {
+	return SwapRB(RGBA4444ToRGBA8888(c));
+}
+static u32 RefRGBA5551ToBGRA8888(u16 c) {
+	return SwapRB(RGBA5551ToRGBA8888(c));
+}
+static u32 RefRGB565ToBGRA8888(u16 c) {
+	return SwapRB(RGB565ToRGBA8888(c));
+}
+
+// Runs func over src at a few offsets and lengths (to cover misaligned pointers and the
+// leftover pixels after each SIMD block) and compares each pixel against ref.
+template <typename DstT, typename SrcT>
+static bool CheckConv(const char *title, void (*func)(DstT *, const SrcT *, u32), DstT (*ref)(SrcT), const std::vector<u8> &rand) {
+	static const int lengths[] = { 1, 7, 8, 9, 15, 16, 17, 33, 480 };
+	const SrcT *src = (const SrcT *)rand.data();
+	std::vector<DstT> dst(512 + 2);
+
+	for (int offset = 0; offset < 2; ++offset) {
+		for (int length : lengths) {
+			// Catch any writes past the end.
+			dst[offset + length] = (DstT)0xDEADBEEF;
+			func(dst.data() + offset, src + offset, length);
+
+			for (int i = 0; i < length; ++i) {
+				const DstT expected = ref(src[offset + i]);
+				if (dst[offset + i] != expected) {
+					printf("%s: pixel %d of %d (offset %d): %08x != expected %08x\n", title, i, length, offset, (u32)dst[offset + i], (u32)expected);
+					return false;
+				}
+			}
+			if (dst[offset + length] != (DstT)0xDEADBEEF) {
+				printf("%s: wrote past %d pixels (offset %d)\n", title, length, offset);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static double BenchMPixels(const std::function<void()> &func) {
+	return BenchRunsPerSecond(func) * BENCH_WIDTH * BENCH_HEIGHT / 1000000.0;
+}
+
+template <typename DstT, typename SrcT>
+static void BenchConv(const char *title, void (*func)(DstT *, const SrcT *, u32), const std::vector<u8> &rand) {
+	std::vector<DstT> dst(BENCH_WIDTH * BENCH_HEIGHT);
+	double mpix = BenchMPixels([&] {
+		func(dst.data(), (const SrcT *)rand.data(), BENCH_WIDTH * BENCH_HEIGHT);
+	});
+	printf("  %-10s %8.1f MPixels/s\n", title, mpix);
+}
+
+#define CHECK_CONV(func, ref) \
+	if (!CheckConv(#func, func, &ref, src)) \
+		return false;
+
+#define BENCH_CONV(title, func) \
+	BenchConv(title, func, src);
+
+static std::vector<u8> RandomPixels() {
+	std::vector<u8> src(BENCH_WIDTH * BENCH_HEIGHT * 4);
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] = rand() & 0xFF;
+	}
+	return src;
+}
+
+bool TestColorConv() {
+	SetupColorConv();
+	const std::vector<u8> src = RandomPixels();
+
+	CHECK_CONV(ConvertBGRA8888ToRGBA8888, RefBGRA8888ToRGBA8888);
+	CHECK_CONV(ConvertRGBA8888ToRGBA5551, RGBA8888ToRGBA5551);
+	CHECK_CONV(ConvertRGBA8888ToRGB565, RGBA8888ToRGB565);
+	CHECK_CONV(ConvertRGBA8888ToRGBA4444, RGBA8888ToRGBA4444);
+	CHECK_CONV(ConvertBGRA8888ToRGBA5551, RefBGRA8888ToRGBA5551);
+	CHECK_CONV(ConvertBGRA8888ToRGB565, RefBGRA8888ToRGB565);
+	CHECK_CONV(ConvertBGRA8888ToRGBA4444, RefBGRA8888ToRGBA4444);
+	CHECK_CONV(ConvertRGBA565ToRGBA8888, RGB565ToRGBA8888);
+	CHECK_CONV(ConvertRGBA5551ToRGBA8888, RGBA5551ToRGBA8888);
+	CHECK_CONV(ConvertRGBA4444ToRGBA8888, RGBA4444ToRGBA8888);
+	CHECK_CONV(ConvertRGB565ToBGRA8888, RefRGB565ToBGRA8888);
+	CHECK_CONV(ConvertRGBA5551ToBGRA8888, RefRGBA5551ToBGRA8888);
+	CHECK_CONV(ConvertRGBA4444ToBGRA8888, RefRGBA4444ToBGRA8888);
+
+	return true;
+}
+
+bool TestColorConvBench() {
+	SetupColorConv();
+	const std::vector<u8> src = RandomPixels();
+
+	// These are the conversions used to display and read back framebuffers.
+	printf("Color conversion, %dx%d:\n", BENCH_WIDTH, BENCH_HEIGHT);
+	BENCH_CONV("BGRA->RGBA", ConvertBGRA8888ToRGBA8888);
+	BENCH_CONV("8888->5551", ConvertRGBA8888ToRGBA5551);
+	BENCH_CONV("8888->565", ConvertRGBA8888ToRGB565);
+	BENCH_CONV("8888->4444", ConvertRGBA8888ToRGBA4444);
+	BENCH_CONV("BGRA->5551", ConvertBGRA8888ToRGBA5551);
+	BENCH_CONV("BGRA->565", ConvertBGRA8888ToRGB565);
+	BENCH_CONV("BGRA->4444", ConvertBGRA8888ToRGBA4444);
+	BENCH_CONV("565->8888", ConvertRGBA565ToRGBA8888);
+	BENCH_CONV("5551->8888", ConvertRGBA5551ToRGBA8888);
+	BENCH_CONV("4444->8888", ConvertRGBA4444ToRGBA8888);
+	BENCH_CONV("565->BGRA", ConvertRGB565ToBGRA8888);
+	BENCH_CONV("5551->BGRA", ConvertRGBA5551ToBGRA8888);
+	BENCH_CONV("4444->BGRA", ConvertRGBA4444ToBGRA8888);
+
+	return true;
+}
@@ -0,0 +1,211 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Common/Common.h"
+#include "Core/MemMap.h"
+#include "GPU/Common/DrawEngineCommon.h"
+#include "GPU/GPUState.h"
+#include "GPU/Null/NullGpu.h"
+#include "GPU/ge_constants.h"
+#include "unittest/UnitTest.h"
+
+static const u32 LIST_ADDR = 0x08800000;
+
+// Just counts draws, so flushes can be checked without a backend.
+class RunLoopDrawEngine : public DrawEngineCommon {
+public:
+	void DispatchFlush() override {
+		if (numDrawCalls != 0) {
+			numDrawCalls = 0;
+			// Pending dirty flags must have been applied before a flush.
+			flushedDirty.push_back(gstate_c.dirty);
+		}
+	}
+	void AddDraw() {
+		numDrawCalls++;
+	}
+
+	std::vector<uint64_t> flushedDirty;
+};
+
+// Runs the real GPUCommon::FastRunLoop(), with PRIM replaced by a draw counter.
+class RunLoopGPU : public NullGPU {
+public:
+	RunLoopGPU() {
+		delete drawEngineCommon_;
+		drawEngineCommon_ = &drawEngine_;
+		cmdInfo_[GE_CMD_PRIM].func = (GPUCommon::CmdFunc)&RunLoopGPU::Execute_CountPrim;
+	}
+	~RunLoopGPU() {
+		drawEngineCommon_ = nullptr;
+	}
+
+	void Run(u32 pc, int count) {
+		DisplayList list{};
+		list.pc = pc;
+		downcount = count;
+		GPUCommon::FastRunLoop(list);
+	}
+
+	static uint64_t Flags(u32 cmd) {
+		return cmdInfo_[cmd].flags;
+	}
+
+	void Execute_CountPrim(u32 op, u32 diff) {
+		drawEngine_.AddDraw();
+	}
+
+	RunLoopDrawEngine drawEngine_;
+};
+
+// State commands that only store a value and dirty flags, the bulk of a typical list.
+static std::vector<u32> PlainStateCommands() {
+	std::vector<u32> cmds;
+	for (u32 cmd = GE_CMD_VERTEXTYPE; cmd < GE_CMD_NOP_FF; ++cmd) {
+		const uint64_t flags = RunLoopGPU::Flags(cmd);
+		if ((flags >> 8) != 0 && !(flags & (FLAG_EXECUTE | FLAG_EXECUTEONCHANGE)))
+			cmds.push_back(cmd);
+	}
+	return cmds;
+}
+
+// Runs of state commands, each followed by a PRIM.  changePct is how many of them set a new value.
+static std::vector<u32> BuildList(const std::vector<u32> &cmds, int draws, int runLength, int changePct) {
+	std::vector<u32> ops;
+	size_t next = 0;
+	for (int d = 0; d < draws; ++d) {
+		for (int i = 0; i < runLength; ++i) {
+			const u32 cmd = cmds[next++ % cmds.size()];
+			const u32 data = (rand() % 100) < changePct ? (rand() & 0xFFFFFF) : 0x001234;
+			ops.push_back((cmd << 24) | data);
+		}
+		ops.push_back((GE_CMD_PRIM << 24) | (GE_PRIM_TRIANGLES << 16) | 3);
+	}
+	return ops;
+}
+
+static void CopyList(const std::vector<u32> &ops) {
+	memcpy(Memory::GetPointer(LIST_ADDR), ops.data(), ops.size() * sizeof(u32));
+}
+
+static bool CheckRunLoop(RunLoopGPU &gpu, const std::vector<u32> &ops) {
+	// Work out what the loop should have done, one command at a time.
+	u32 cmdmem[256];
+	memcpy(cmdmem, gstate.cmdmem, sizeof(cmdmem));
+	uint64_t expectedDirty = 0;
+	std::vector<uint64_t> expectedFlushes;
+	// The last PRIM of the previous list is still waiting for a flush.
+	int draws = gpu.drawEngine_.GetNumDrawCalls();
+	for (u32 op : ops) {
+		const u32 cmd = op >> 24;
+		const uint64_t flags = RunLoopGPU::Flags(cmd);
+		const bool changed = op != cmdmem[cmd];
+		if (changed && (flags & FLAG_FLUSHBEFOREONCHANGE) && draws != 0) {
+			expectedFlushes.push_back(expectedDirty);
+			draws = 0;
+		}
+		cmdmem[cmd] = op;
+		if (cmd == GE_CMD_PRIM) {
+			draws++;
+		} else if (changed) {
+			expectedDirty |= flags >> 8;
+		}
+	}
+
+	CopyList(ops);
+	gstate_c.dirty = 0;
+	gpu.drawEngine_.flushedDirty.clear();
+	gpu.Run(LIST_ADDR, (int)ops.size());
+
+	if (memcmp(cmdmem, gstate.cmdmem, sizeof(cmdmem)) != 0) {
+		printf("Run loop: state differs from the list\n");
+		return false;
+	}
+	if (gstate_c.dirty != expectedDirty) {
+		printf("Run loop: dirty %016llx != expected %016llx\n", (unsigned long long)gstate_c.dirty, (unsigned long long)expectedDirty);
+		return false;
+	}
+	const std::vector<uint64_t> &flushes = gpu.drawEngine_.flushedDirty;
+	if (flushes.size() != expectedFlushes.size()) {
+		printf("Run loop: %d flushes != expected %d\n", (int)flushes.size(), (int)expectedFlushes.size());
+		return false;
+	}
+	for (size_t i = 0; i < flushes.size(); ++i) {
+		if (flushes[i] != expectedFlushes[i]) {
+			printf("Run loop: flush %d with dirty %016llx != expected %016llx\n", (int)i, (unsigned long long)flushes[i], (unsigned long long)expectedFlushes[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void BenchRunLoop(RunLoopGPU &gpu, const std::vector<u32> &cmds, int runLength, int changePct) {
+	const std::vector<u32> ops = BuildList(cmds, 2000, runLength, changePct);
+	CopyList(ops);
+	double runs = BenchRunsPerSecond([&] {
+		gpu.drawEngine_.flushedDirty.clear();
+		gpu.Run(LIST_ADDR, (int)ops.size());
+	});
+	printf("  run of %2d, %2d%% changed %8.2f ns per command\n", runLength, changePct, 1000000000.0 / (runs * ops.size()));
+}
+
+static void SetupMemory() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init();
+}
+
+bool TestGPURunLoop() {
+	SetupMemory();
+	bool passed = true;
+	{
+		RunLoopGPU gpu;
+		const std::vector<u32> cmds = PlainStateCommands();
+		static const int runLengths[] = { 1, 3, 6, 24 };
+		static const int changePcts[] = { 0, 5, 30, 100 };
+		for (int runLength : runLengths) {
+			for (int changePct : changePcts) {
+				if (!CheckRunLoop(gpu, BuildList(cmds, 200, runLength, changePct))) {
+					printf("  (run of %d, %d%% changed)\n", runLength, changePct);
+					passed = false;
+				}
+			}
+		}
+	}
+	Memory::Shutdown();
+	return passed;
+}
+
+bool TestGPURunLoopBench() {
+	SetupMemory();
+	{
+		RunLoopGPU gpu;
+		const std::vector<u32> cmds = PlainStateCommands();
+
+		printf("GE run loop, state commands between draws:\n");
+		BenchRunLoop(gpu, cmds, 3, 30);
+		BenchRunLoop(gpu, cmds, 6, 5);
+		BenchRunLoop(gpu, cmds, 6, 30);
+		BenchRunLoop(gpu, cmds, 12, 30);
+		BenchRunLoop(gpu, cmds, 24, 30);
+	}
+	Memory::Shutdown();
+	return true;
+}
@@ -0,0 +1,233 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdlib>
+#include <vector>
+
+#include "Common/Common.h"
+#include "GPU/Common/IndexGenerator.h"
+#include "GPU/ge_constants.h"
+#include "unittest/UnitTest.h"
+
+static const int MAX_INDICES = 65536;
+
+static const char *const primNames[] = { "points", "lines", "line strip", "triangles", "strip", "fan", "rects" };
+
+// The reference output, one primitive at a time.  src maps each vertex to its index.
+template <typename T>
+static std::vector<u16> RefIndices(int prim, int count, const T *src, int offset, bool clockwise) {
+	std::vector<u16> out;
+	auto add = [&](int i) {
+		out.push_back((u16)(src[i] + offset));
+	};
+	const int v1 = clockwise ? 1 : 2;
+	const int v2 = clockwise ? 2 : 1;
+	switch (prim) {
+	case GE_PRIM_POINTS:
+		for (int i = 0; i < count; ++i)
+			add(i);
+		break;
+	case GE_PRIM_LINES:
+	case GE_PRIM_RECTANGLES:
+		for (int i = 0; i + 1 < count; i += 2) {
+			add(i);
+			add(i + 1);
+		}
+		break;
+	case GE_PRIM_LINE_STRIP:
+		for (int i = 0; i + 1 < count; ++i) {
+			add(i);
+			add(i + 1);
+		}
+		break;
+	case GE_PRIM_TRIANGLES:
+		for (int i = 0; i + 2 < count; i += 3) {
+			add(i);
+			add(i + v1);
+			add(i + v2);
+		}
+		break;
+	case GE_PRIM_TRIANGLE_STRIP:
+		for (int i = 0; i + 2 < count; ++i) {
+			const bool flip = (i & 1) != 0;
+			add(i);
+			add(i + (flip ? v2 : v1));
+			add(i + (flip ? v1 : v2));
+		}
+		break;
+	case GE_PRIM_TRIANGLE_FAN:
+		for (int i = 0; i + 2 < count; ++i) {
+			add(0);
+			add(i + v1);
+			add(i + v2);
+		}
+		break;
+	}
+	return out;
+}
+
+static bool CompareIndices(const char *title, int prim, int count, bool clockwise, const std::vector<u16> &expected, const u16 *actual, int actualCount) {
+	if ((int)expected.size() != actualCount) {
+		printf("%s %s (%d, %s): %d indices != expected %d\n", title, primNames[prim], count, clockwise ? "cw" : "ccw", actualCount, (int)expected.size());
+		return false;
+	}
+	for (int i = 0; i < actualCount; ++i) {
+		if (actual[i] != expected[i]) {
+			printf("%s %s (%d, %s): index %d: %d != expected %d\n", title, primNames[prim], count, clockwise ? "cw" : "ccw", i, actual[i], expected[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T>
+static bool CheckTranslate(const char *title, std::vector<u16> &buf, const std::vector<u8> &rand, int indexMask) {
+	// Covers the leftovers after each SIMD block, and partial primitives.
+	static const int counts[] = { 3, 7, 8, 9, 16, 23, 24, 25, 26, 47, 48, 49, 50, 300 };
+	std::vector<T> src(512);
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] = (T)((rand[i * 2] | (rand[i * 2 + 1] << 8)) & indexMask);
+	}
+
+	IndexGenerator gen;
+	for (int prim = GE_PRIM_POINTS; prim <= GE_PRIM_RECTANGLES; ++prim) {
+		for (int count : counts) {
+			for (int cw = 0; cw < 2; ++cw) {
+				// The offset is relative to the current vertex, so start somewhere else too.
+				for (int lowerBound = 0; lowerBound < 2; ++lowerBound) {
+					gen.Setup(buf.data());
+					gen.SetIndex(100);
+					gen.TranslatePrim(prim, count, src.data(), lowerBound, cw != 0);
+
+					std::vector<u16> expected = RefIndices(prim, count, src.data(), 100 - lowerBound, cw != 0);
+					if (!CompareIndices(title, prim, count, cw != 0, expected, buf.data(), gen.VertexCount()))
+						return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static bool CheckGenerate(std::vector<u16> &buf) {
+	static const int counts[] = { 3, 7, 8, 9, 10, 16, 17, 23, 24, 25, 26, 47, 48, 49, 50, 300 };
+	std::vector<int> seq(512);
+	for (size_t i = 0; i < seq.size(); ++i) {
+		seq[i] = (int)i;
+	}
+
+	IndexGenerator gen;
+	for (int prim = GE_PRIM_POINTS; prim <= GE_PRIM_RECTANGLES; ++prim) {
+		for (int count : counts) {
+			// Whole prims only, AddList and AddLineList don't bother rounding.
+			if (prim == GE_PRIM_TRIANGLES)
+				count -= count % 3;
+			else if (prim == GE_PRIM_LINES)
+				count &= ~1;
+			for (int cw = 0; cw < 2; ++cw) {
+				gen.Setup(buf.data());
+				gen.SetIndex(65000);
+				gen.AddPrim(prim, count, cw != 0);
+
+				std::vector<u16> expected = RefIndices(prim, count, seq.data(), 65000, cw != 0);
+				if (!CompareIndices("Generate", prim, count, cw != 0, expected, buf.data(), gen.VertexCount()))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Every run generates the same number of indices.
+static double BenchMIndices(IndexGenerator &gen, const std::function<void()> &func) {
+	func();
+	const int perRun = gen.VertexCount();
+	return BenchRunsPerSecond(func) * perRun / 1000000.0;
+}
+
+// A typical flush worth of draws: many small indexed or sequential prims.
+template <typename T>
+static void BenchTranslate(const char *title, int prim, std::vector<u16> &buf, const std::vector<u8> &rand) {
+	std::vector<T> src(MAX_INDICES / 4);
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] = (T)rand[i];
+	}
+
+	IndexGenerator gen;
+	double mind = BenchMIndices(gen, [&] {
+		gen.Setup(buf.data());
+		for (size_t i = 0; i + 96 <= src.size(); i += 96) {
+			gen.TranslatePrim(prim, 96, src.data() + i, 0, true);
+			gen.Advance(256);
+		}
+	});
+	printf("  %-16s %8.1f MIndices/s\n", title, mind);
+}
+
+static void BenchGenerate(const char *title, int prim, bool clockwise, std::vector<u16> &buf) {
+	IndexGenerator gen;
+	double mind = BenchMIndices(gen, [&] {
+		gen.Setup(buf.data());
+		for (int i = 0; i < 128; ++i) {
+			gen.AddPrim(prim, 96, clockwise);
+		}
+	});
+	printf("  %-16s %8.1f MIndices/s\n", title, mind);
+}
+
+static std::vector<u8> RandomBytes() {
+	std::vector<u8> rand(MAX_INDICES);
+	for (size_t i = 0; i < rand.size(); ++i) {
+		rand[i] = ::rand() & 0xFF;
+	}
+	return rand;
+}
+
+bool TestIndexGenerator() {
+	// Strips and fans write three indices per vertex, plus some slack for overruns.
+	std::vector<u16> buf(MAX_INDICES * 3 + 64);
+	const std::vector<u8> rand = RandomBytes();
+
+	if (!CheckGenerate(buf))
+		return false;
+	if (!CheckTranslate<u8>("Translate u8", buf, rand, 0xFF))
+		return false;
+	if (!CheckTranslate<u16_le>("Translate u16", buf, rand, 0xFFFF))
+		return false;
+	if (!CheckTranslate<u32_le>("Translate u32", buf, rand, 0xFFFF))
+		return false;
+
+	return true;
+}
+
+bool TestIndexGeneratorBench() {
+	std::vector<u16> buf(MAX_INDICES * 3 + 64);
+	const std::vector<u8> rand = RandomBytes();
+
+	printf("Index generation, 96 verts per prim:\n");
+	BenchGenerate("triangles", GE_PRIM_TRIANGLES, true, buf);
+	BenchGenerate("triangles ccw", GE_PRIM_TRIANGLES, false, buf);
+	BenchGenerate("strip", GE_PRIM_TRIANGLE_STRIP, true, buf);
+	BenchGenerate("fan", GE_PRIM_TRIANGLE_FAN, true, buf);
+	BenchGenerate("rects", GE_PRIM_RECTANGLES, true, buf);
+	BenchTranslate<u8>("u8 triangles", GE_PRIM_TRIANGLES, buf, rand);
+	BenchTranslate<u16_le>("u16 triangles", GE_PRIM_TRIANGLES, buf, rand);
+	BenchTranslate<u16_le>("u16 strip", GE_PRIM_TRIANGLE_STRIP, buf, rand);
+	BenchTranslate<u8>("u8 rects", GE_PRIM_RECTANGLES, buf, rand);
+
+	return true;
+}
@@ -0,0 +1,208 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Common/CPUDetect.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/SoftGpu.h"
+#include "GPU/Software/TransformUnit.h"
+#include "unittest/UnitTest.h"
+
+static const int BUF_SIZE = 16;
+
+static u32 RandomBits() {
+	return ((u32)rand() << 16) ^ (u32)rand();
+}
+
+// Mostly random, but with edge values often enough that equality tests pass sometimes.
+static u32 RandomValue(u32 mask) {
+	static const u32 interesting[] = { 0, 1, 0x10, 0x7F, 0x80, 0xF0, 0xFF, 0x7FFF, 0x8000, 0xFFFF, 0xFFFFFFFF };
+	if ((rand() & 3) == 0)
+		return interesting[rand() % ARRAY_SIZE(interesting)] & mask;
+	return RandomBits() & mask;
+}
+
+static void RandomizeState() {
+	// The top byte is the command, which should be ignored anyway.
+	gstate.clearmode = RandomBits() & 0xFF000701;
+	gstate.framebufpixformat = rand() & 3;
+	gstate.fbwidth = BUF_SIZE;
+	gstate.zbwidth = BUF_SIZE;
+	gstate.vertType = (rand() & 1) ? GE_VTYPE_THROUGH : 0;
+
+	gstate.minz = (rand() & 1) ? 0 : RandomValue(0xFFFF);
+	gstate.maxz = (rand() & 1) ? 0xFFFF : RandomValue(0xFFFF);
+
+	gstate.alphaTestEnable = rand() & 1;
+	gstate.alphatest = RandomValue(0xFFFFFFFF);
+	gstate.fogEnable = rand() & 1;
+	gstate.fogcolor = RandomBits();
+	gstate.colorTestEnable = rand() & 1;
+	gstate.colortest = RandomBits();
+	gstate.colorref = RandomValue(0xFFFFFFFF);
+	gstate.colortestmask = RandomValue(0xFFFFFFFF);
+
+	gstate.stencilTestEnable = rand() & 1;
+	gstate.stenciltest = RandomValue(0xFFFFFFFF);
+	gstate.stencilop = RandomBits();
+	gstate.zTestEnable = rand() & 1;
+	gstate.ztestfunc = RandomBits();
+	gstate.zmsk = RandomBits();
+
+	gstate.alphaBlendEnable = rand() & 1;
+	// Keep to valid equations most of the time, but not factors.
+	gstate.blend = RandomBits() & ((rand() & 7) == 0 ? 0xFFFFFFFF : 0xFFFFF3FF);
+	gstate.blendfixa = RandomBits();
+	gstate.blendfixb = RandomBits();
+	gstate.logicOpEnable = rand() & 1;
+	gstate.lop = RandomBits();
+
+	gstate.pmskc = (rand() & 1) ? 0 : RandomValue(0xFFFFFFFF);
+	gstate.pmska = (rand() & 1) ? 0 : RandomValue(0xFFFFFFFF);
+}
+
+bool TestSoftwarePixel() {
+	static u32 fbExpected[BUF_SIZE * BUF_SIZE];
+	static u32 fbActual[BUF_SIZE * BUF_SIZE];
+	static u16 depthExpected[BUF_SIZE * BUF_SIZE];
+	static u16 depthActual[BUF_SIZE * BUF_SIZE];
+	static Rasterizer::RasterizerState state;
+
+	const GPUgstate savedState = gstate;
+	const FormatBuffer savedFb = fb;
+	const FormatBuffer savedDepth = depthbuf;
+
+	Rasterizer::PixelJitCache cache;
+	bool success = true;
+	int compiled = 0;
+
+	for (int i = 0; i < 20000 && success; ++i) {
+		RandomizeState();
+
+		PixelFuncID id;
+		cache.ComputePixelFuncID(&id);
+		Rasterizer::SingleFunc jitted = cache.GetSingle(id);
+		if (!jitted)
+			continue;
+		compiled++;
+
+		// Both only read registers from the state, so scramble gstate to catch any that don't.
+		state.regs = gstate;
+		RandomizeState();
+
+		for (int j = 0; j < BUF_SIZE * BUF_SIZE; ++j) {
+			fbExpected[j] = RandomValue(0xFFFFFFFF);
+			depthExpected[j] = RandomValue(0xFFFF);
+		}
+		memcpy(fbActual, fbExpected, sizeof(fbActual));
+		memcpy(depthActual, depthExpected, sizeof(depthActual));
+
+		for (int j = 0; j < 8; ++j) {
+			int x = rand() % BUF_SIZE;
+			int y = rand() % BUF_SIZE;
+			int z = RandomValue(0xFFFF);
+			int fog = rand() & 0xFF;
+			// Go a bit out of range to check clamping.
+			Math3D::Vec4<int> color(rand() % 320 - 32, rand() % 320 - 32, rand() % 320 - 32, rand() % 320 - 32);
+
+			fb.data = (u8 *)fbExpected;
+			depthbuf.data = (u8 *)depthExpected;
+			if (id.clearMode)
+				Rasterizer::DrawSinglePixel<true>(x, y, z, fog, color, state);
+			else
+				Rasterizer::DrawSinglePixel<false>(x, y, z, fog, color, state);
+
+			fb.data = (u8 *)fbActual;
+			depthbuf.data = (u8 *)depthActual;
+			jitted(x, y, z, fog, color, state);
+		}
+
+		if (memcmp(fbActual, fbExpected, sizeof(fbActual)) != 0 || memcmp(depthActual, depthExpected, sizeof(depthActual)) != 0) {
+			printf("Pixel func %s doesn't match the fallback\n", cache.DescribePixelFuncID(id).c_str());
+			success = false;
+		}
+	}
+
+#if PPSSPP_ARCH(AMD64)
+	if (compiled == 0 && cpu_info.bSSE4_1) {
+		printf("No pixel funcs were compiled\n");
+		success = false;
+	}
+#endif
+
+	gstate = savedState;
+	fb = savedFb;
+	depthbuf = savedDepth;
+	return success;
+}
+
+static float RandomFloat(float range) {
+	return ((float)rand() / RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+static bool SameFloat(float a, float b) {
+	return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+bool TestSoftwareTransform() {
+	static const int MAX_VERTS = 37;
+	static VertexData verts[MAX_VERTS];
+	static float viewz[MAX_VERTS];
+
+	const GPUgstate savedState = gstate;
+	bool success = true;
+
+	for (int i = 0; i < 1000 && success; ++i) {
+		for (int j = 0; j < 12; ++j) {
+			gstate.worldMatrix[j] = RandomFloat(4.0f);
+			gstate.viewMatrix[j] = RandomFloat(4.0f);
+		}
+		for (int j = 0; j < 16; ++j) {
+			gstate.projMatrix[j] = RandomFloat(4.0f);
+		}
+
+		// Usually not a multiple of 4, so some go through the scalar path too.
+		const int count = rand() % (MAX_VERTS + 1);
+		for (int j = 0; j < count; ++j) {
+			verts[j].modelpos = ModelCoords(RandomFloat(1000.0f), RandomFloat(1000.0f), RandomFloat(1000.0f));
+		}
+		TransformUnit::TransformPositions(verts, viewz, count);
+
+		for (int j = 0; j < count && success; ++j) {
+			const WorldCoords worldpos = TransformUnit::ModelToWorld(verts[j].modelpos);
+			const ViewCoords viewpos = TransformUnit::WorldToView(worldpos);
+			const ClipCoords clippos = TransformUnit::ViewToClip(viewpos);
+			const VertexData &v = verts[j];
+
+			// Fog is computed from viewz alone, so it matches if viewz does.
+			bool same = SameFloat(v.worldpos.x, worldpos.x) && SameFloat(v.worldpos.y, worldpos.y) && SameFloat(v.worldpos.z, worldpos.z);
+			same = same && SameFloat(v.clippos.x, clippos.x) && SameFloat(v.clippos.y, clippos.y) && SameFloat(v.clippos.z, clippos.z) && SameFloat(v.clippos.w, clippos.w);
+			same = same && SameFloat(viewz[j], viewpos.z);
+			if (!same) {
+				printf("Transform of vertex %d of %d doesn't match one at a time\n", j, count);
+				success = false;
+			}
+		}
+	}
+
+	gstate = savedState;
+	return success;
+}
@@ -0,0 +1,189 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "Common/ColorConv.h"
+#include "Common/Common.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/ge_constants.h"
+#include "GPU/GPUState.h"
+#include "unittest/UnitTest.h"
+
+static const int BENCH_WIDTH = 512;
+static const int BENCH_HEIGHT = 512;
+
+template <typename ClutT>
+static bool CheckDeIndex(const char *title, const u8 *indices, const ClutT *clut, int length) {
+	std::vector<ClutT> dest4(length + 1), dest8(length);
+	DeIndexTexture4Naked(dest4.data(), indices, length, clut);
+	DeIndexTexture8Naked(dest8.data(), indices, length, clut);
+
+	for (int i = 0; i < length; ++i) {
+		u8 index4 = (indices[i / 2] >> ((i & 1) * 4)) & 0xF;
+		if (dest4[i] != clut[index4]) {
+			printf("%s: CLUT4 pixel %d of %d: %08x != expected %08x\n", title, i, length, (u32)dest4[i], (u32)clut[index4]);
+			return false;
+		}
+		if (dest8[i] != clut[indices[i]]) {
+			printf("%s: CLUT8 pixel %d of %d: %08x != expected %08x\n", title, i, length, (u32)dest8[i], (u32)clut[indices[i]]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// The SIMD paths handle 8 or 16 pixels at a time, so try lengths around those.
+static bool TestDeIndex(const u8 *indices, const u32 *clut) {
+	static const int lengths[] = { 2, 8, 14, 16, 18, 32, 50, 512 };
+	for (int length : lengths) {
+		if (!CheckDeIndex("DeIndex16", indices, (const u16 *)clut, length))
+			return false;
+		if (!CheckDeIndex("DeIndex32", indices, clut, length))
+			return false;
+	}
+	return true;
+}
+
+// Decodes one level to 32-bit, using the same helpers as TextureCacheCommon.
+static void DecodeLevel(GETextureFormat format, u32 *dst, const u8 *src, const u32 *clut) {
+	const int w = BENCH_WIDTH;
+	const int h = BENCH_HEIGHT;
+	switch (format) {
+	case GE_TFMT_5650:
+		ConvertRGBA565ToRGBA8888(dst, (const u16 *)src, w * h);
+		break;
+	case GE_TFMT_5551:
+		ConvertRGBA5551ToRGBA8888(dst, (const u16 *)src, w * h);
+		break;
+	case GE_TFMT_4444:
+		ConvertRGBA4444ToRGBA8888(dst, (const u16 *)src, w * h);
+		break;
+	case GE_TFMT_8888:
+		ConvertRGBA8888ToBGRA8888(dst, (const u32 *)src, w * h);
+		break;
+	case GE_TFMT_CLUT4:
+		for (int y = 0; y < h; ++y)
+			DeIndexTexture4(dst + w * y, src + (w * y) / 2, w, clut);
+		break;
+	case GE_TFMT_CLUT8:
+		for (int y = 0; y < h; ++y)
+			DeIndexTexture(dst + w * y, src + w * y, w, clut);
+		break;
+	case GE_TFMT_CLUT16:
+		for (int y = 0; y < h; ++y)
+			DeIndexTexture(dst + w * y, (const u16_le *)src + w * y, w, clut);
+		break;
+	case GE_TFMT_CLUT32:
+		for (int y = 0; y < h; ++y)
+			DeIndexTexture(dst + w * y, (const u32_le *)src + w * y, w, clut);
+		break;
+	case GE_TFMT_DXT1:
+	case GE_TFMT_DXT3:
+	case GE_TFMT_DXT5:
+		for (int y = 0; y < h; y += 4) {
+			for (int x = 0; x < w; x += 4) {
+				int blockIndex = (y / 4) * (w / 4) + x / 4;
+				if (format == GE_TFMT_DXT1)
+					DecodeDXT1Block(dst + w * y + x, (const DXT1Block *)src + blockIndex, w, 4, false);
+				else if (format == GE_TFMT_DXT3)
+					DecodeDXT3Block(dst + w * y + x, (const DXT3Block *)src + blockIndex, w, 4);
+				else
+					DecodeDXT5Block(dst + w * y + x, (const DXT5Block *)src + blockIndex, w, 4);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static double BenchMPixels(const std::function<void()> &func) {
+	return BenchRunsPerSecond(func) * BENCH_WIDTH * BENCH_HEIGHT / 1000000.0;
+}
+
+// Enough for the largest format (32-bit), with random contents.
+static void FillRandom(std::vector<u8> &src, std::vector<u32> &clut) {
+	src.resize(BENCH_WIDTH * BENCH_HEIGHT * 4);
+	// 16-bit indices only see the bottom 8 bits, so 256 entries is enough.
+	clut.resize(256);
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] = rand() & 0xFF;
+	}
+	for (size_t i = 0; i < clut.size(); ++i) {
+		clut[i] = ((u32)rand() << 16) ^ (u32)rand();
+	}
+}
+
+bool TestTextureDecoder() {
+	SetupTextureDecoder();
+
+	// Start with all CLUT index modifiers (shift, mask, offset) off.
+	const u32 oldClutFormat = gstate.clutformat;
+	gstate.clutformat = 0xC500FF00 | GE_CMODE_32BIT_ABGR8888;
+
+	std::vector<u8> src;
+	std::vector<u32> clut;
+	FillRandom(src, clut);
+	bool pass = TestDeIndex(src.data(), clut.data());
+
+	gstate.clutformat = oldClutFormat;
+	return pass;
+}
+
+bool TestTextureDecoderBench() {
+	SetupTextureDecoder();
+
+	const u32 oldClutFormat = gstate.clutformat;
+	gstate.clutformat = 0xC500FF00 | GE_CMODE_32BIT_ABGR8888;
+
+	std::vector<u8> src;
+	std::vector<u32> clut;
+	FillRandom(src, clut);
+	std::vector<u32> dst(BENCH_WIDTH * BENCH_HEIGHT);
+
+	static const GETextureFormat formats[] = {
+		GE_TFMT_5650, GE_TFMT_5551, GE_TFMT_4444, GE_TFMT_8888,
+		GE_TFMT_CLUT4, GE_TFMT_CLUT8, GE_TFMT_CLUT16, GE_TFMT_CLUT32,
+		GE_TFMT_DXT1, GE_TFMT_DXT3, GE_TFMT_DXT5,
+	};
+	static const char *const formatNames[] = {
+		"5650", "5551", "4444", "8888",
+		"CLUT4", "CLUT8", "CLUT16", "CLUT32",
+		"DXT1", "DXT3", "DXT5",
+	};
+
+	printf("Texture decode, %dx%d:\n", BENCH_WIDTH, BENCH_HEIGHT);
+	for (size_t i = 0; i < ARRAY_SIZE(formats); ++i) {
+		double mpix = BenchMPixels([&] {
+			DecodeLevel(formats[i], dst.data(), src.data(), clut.data());
+		});
+		printf("  %-8s %8.1f MPixels/s\n", formatNames[i], mpix);
+	}
+
+	// Swizzled textures are unswizzled first, measure that separately (as 32-bit.)
+	double mpix = BenchMPixels([&] {
+		DoUnswizzleTex16(src.data(), dst.data(), BENCH_WIDTH * 4 / 16, BENCH_HEIGHT / 8, BENCH_WIDTH * 4);
+	});
+	printf("  %-8s %8.1f MPixels/s\n", "unswizzle", mpix);
+
+	gstate.clutformat = oldClutFormat;
+	return true;
+}
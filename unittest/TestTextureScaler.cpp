@@ -0,0 +1,135 @@
+// Copyright (c) 2018- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Common/CPUDetect.h"
+#include "GPU/Common/TextureScalerCommon.h"
+#include "thread/threadpool.h"
+#include "unittest/UnitTest.h"
+
+// Only works with 8888, which is all the scaling functions see anyway.
+class TestScaler : public TextureScalerCommon {
+public:
+	using TextureScalerCommon::ScaleBicubicBSpline;
+	using TextureScalerCommon::ScaleBicubicMitchell;
+	using TextureScalerCommon::ScaleHybrid;
+	using TextureScalerCommon::ScaleXBRZ;
+
+protected:
+	void ConvertTo8888(u32 format, u32 *source, u32 *&dest, int width, int height) override {
+		dest = source;
+	}
+	int BytesPerPixel(u32 format) override {
+		return 4;
+	}
+	u32 Get8888Format() override {
+		return 0;
+	}
+};
+
+enum ScaleKind {
+	SCALE_BSPLINE,
+	SCALE_MITCHELL,
+	SCALE_HYBRID,
+	SCALE_HYBRID_BICUBIC,
+	SCALE_XBRZ,
+};
+
+static const char *const scaleKindNames[] = {
+	"BSpline", "Mitchell", "Hybrid", "HybridBicubic", "xBRZ",
+};
+
+static void RunScale(TestScaler &scaler, ScaleKind kind, int factor, u32 *src, u32 *dst, int w, int h) {
+	switch (kind) {
+	case SCALE_BSPLINE: scaler.ScaleBicubicBSpline(factor, src, dst, w, h); break;
+	case SCALE_MITCHELL: scaler.ScaleBicubicMitchell(factor, src, dst, w, h); break;
+	case SCALE_HYBRID: scaler.ScaleHybrid(factor, src, dst, w, h, false); break;
+	case SCALE_HYBRID_BICUBIC: scaler.ScaleHybrid(factor, src, dst, w, h, true); break;
+	case SCALE_XBRZ: scaler.ScaleXBRZ(factor, src, dst, w, h); break;
+	}
+}
+
+// Some flat areas and hard alpha, so the hybrid mask isn't just noise.
+static void FillImage(std::vector<u32> &img, int w, int h) {
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			u32 color = ((u32)rand() << 16) ^ (u32)rand();
+			if ((x / 5 + y / 3) & 1) {
+				color = 0xFF306090;
+			} else if ((x + y) % 7 == 0) {
+				color &= 0x00FFFFFF;
+			}
+			img[y * w + x] = color;
+		}
+	}
+}
+
+bool TestTextureScaler() {
+	const CPUInfo savedInfo = cpu_info;
+	ThreadPool pool(1);
+	TestScaler scaler;
+	scaler.SetThreadPool(&pool);
+
+	// Odd sizes, so the SIMD paths have leftovers to handle.
+	static const int sizes[][2] = { { 64, 64 }, { 37, 23 }, { 3, 2 } };
+	bool success = true;
+	for (const auto &size : sizes) {
+		const int w = size[0];
+		const int h = size[1];
+		std::vector<u32> src(w * h);
+		FillImage(src, w, h);
+
+		for (int factor = 2; factor <= 5; ++factor) {
+			std::vector<u32> expected(w * h * factor * factor);
+			std::vector<u32> actual(w * h * factor * factor);
+
+			for (int kind = SCALE_BSPLINE; kind <= SCALE_XBRZ; ++kind) {
+				cpu_info.bSSE2 = false;
+				cpu_info.bSSE4_1 = false;
+				cpu_info.bAVX2 = false;
+				cpu_info.bNEON = false;
+				RunScale(scaler, (ScaleKind)kind, factor, src.data(), expected.data(), w, h);
+
+				// Try each SIMD level the CPU has, from the top.
+				for (int level = 0; level < 3; ++level) {
+					cpu_info = savedInfo;
+					if (level >= 1)
+						cpu_info.bAVX2 = false;
+					if (level >= 2)
+						cpu_info.bSSE4_1 = false;
+
+					memset(actual.data(), 0, actual.size() * sizeof(u32));
+					RunScale(scaler, (ScaleKind)kind, factor, src.data(), actual.data(), w, h);
+					for (size_t i = 0; i < actual.size(); ++i) {
+						if (actual[i] != expected[i]) {
+							printf("%s %dx%d x%d (level %d): pixel %d,%d is %08x, expected %08x\n", scaleKindNames[kind], w, h, factor, level, (int)(i % (w * factor)), (int)(i / (w * factor)), actual[i], expected[i]);
+							success = false;
+							break;
+						}
+					}
+				}
+				cpu_info = savedInfo;
+			}
+		}
+	}
+
+	cpu_info = savedInfo;
+	return success;
+}
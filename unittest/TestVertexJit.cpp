@@ -15,8 +15,13 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 #include "base/timeutil.h"
 #include "Common/Common.h"
+#include "Common/CPUDetect.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
 #include "GPU/Common/VertexDecoderCommon.h"
@@ -98,6 +103,10 @@ class VertexDecoderTestHarness {
 		return total / elapsed;
 	}
 
+	void SetBatchDecoding(bool enable) {
+		cache_->SetBatchDecoding(enable);
+	}
+
 	void Add8(u8 x) {
 		if (needsReset_) {
 			Reset();
@@ -256,6 +265,15 @@ class VertexDecoderTestHarness {
 		return dst_;
 	}
 
+	const u8 *GetSrcData() {
+		return src_;
+	}
+
+	// So a decoder that skips writing something can't pass on an earlier run's output.
+	void FillData(u8 sentinel) {
+		memset(dst_, sentinel, BUFFER_SIZE);
+	}
+
 	int GetDstStride() {
 		if (dec_) {
 			return dec_->decFmt.stride;
@@ -631,6 +649,120 @@ static bool TestVertexFloatSkin() {
 	return !dec.HasFailed();
 }
 
+static int PSPVertexSize(int vtype, int *coloff = nullptr) {
+	VertexDecoder dec;
+	VertexDecoderOptions options{};
+	dec.SetVertexType(vtype, options, nullptr);
+	if (coloff)
+		*coloff = dec.coloff;
+	return dec.VertexSize();
+}
+
+// Random vertices for comparing decoders.  Floats are kept small so every path stays exact,
+// and u16 values below 32768 so through mode bounds compare the same either way.
+static void AddRandomVertices(VertexDecoderTestHarness &dec, int vtype, int count) {
+	bool hasFloat = (vtype & GE_VTYPE_TC_MASK) == GE_VTYPE_TC_FLOAT || (vtype & GE_VTYPE_POS_MASK) == GE_VTYPE_POS_FLOAT;
+	hasFloat = hasFloat || (vtype & GE_VTYPE_NRM_MASK) == GE_VTYPE_NRM_FLOAT || (vtype & GE_VTYPE_WEIGHT_MASK) == GE_VTYPE_WEIGHT_FLOAT;
+
+	int words = (PSPVertexSize(vtype) * count + 3) / 4;
+	for (int i = 0; i < words; ++i) {
+		if (hasFloat) {
+			dec.AddFloat((float)(rand() % 4096) / 64.0f - 32.0f);
+		} else {
+			dec.Add16(rand() & 0x7FFF, rand() & 0x7FFF);
+		}
+	}
+}
+
+// The batch loop should give exactly the same results as the regular jit loop.
+// 37 vertices means 9 batches of 4 plus a single vertex left over.
+// Each vtype runs with texcoord UV gen (prescaled texcoords, using the stack scale/offset)
+// and with the texture matrix (plain conversion to float.)
+static bool TestVertexBatch() {
+	if (!cpu_info.bAVX2) {
+		return true;
+	}
+
+	static const int vtypes[] = {
+		GE_VTYPE_TC_8BIT | GE_VTYPE_COL_8888 | GE_VTYPE_POS_FLOAT,
+		GE_VTYPE_TC_16BIT | GE_VTYPE_NRM_8BIT | GE_VTYPE_POS_16BIT,
+		GE_VTYPE_TC_FLOAT | GE_VTYPE_COL_8888 | GE_VTYPE_NRM_FLOAT | GE_VTYPE_POS_FLOAT,
+		GE_VTYPE_TC_16BIT | GE_VTYPE_COL_8888 | GE_VTYPE_POS_16BIT | GE_VTYPE_THROUGH,
+		GE_VTYPE_TC_8BIT | GE_VTYPE_POS_8BIT | GE_VTYPE_WEIGHT_8BIT | (1 << GE_VTYPE_WEIGHTCOUNT_SHIFT),
+		GE_VTYPE_TC_16BIT | GE_VTYPE_COL_8888 | GE_VTYPE_POS_FLOAT,
+	};
+	static const GETexMapMode uvGenModes[] = { GE_TEXMAP_TEXTURE_COORDS, GE_TEXMAP_TEXTURE_MATRIX };
+	static const int COUNT = 37;
+	const u32 savedTexMapMode = gstate.texmapmode;
+
+	gstate_c.uv.uScale = 2.0f;
+	gstate_c.uv.vScale = 0.5f;
+	gstate_c.uv.uOff = 0.25f;
+	gstate_c.uv.vOff = -1.0f;
+
+	bool failed = false;
+	for (GETexMapMode uvGenMode : uvGenModes) {
+		for (int vtype : vtypes) {
+			gstate.texmapmode = (savedTexMapMode & ~3) | uvGenMode;
+			VertexDecoderTestHarness dec;
+			AddRandomVertices(dec, vtype, COUNT);
+
+			// Only the last color is translucent, so the alpha check has to catch it in the tail.
+			if (vtype & GE_VTYPE_THROUGH) {
+				int coloff = 0;
+				int vsize = PSPVertexSize(vtype, &coloff);
+				u8 *src = const_cast<u8 *>(dec.GetSrcData());
+				for (int i = 0; i < COUNT; ++i)
+					src[i * vsize + coloff + 3] = i == COUNT - 1 ? 0x7F : 0xFF;
+			}
+
+			std::vector<u8> expected;
+			KnownVertexBounds expectedBounds{};
+			bool expectedFullAlpha = false;
+			for (int batch = 0; batch <= 1; ++batch) {
+				dec.SetBatchDecoding(batch == 1);
+				dec.FillData(0xCD);
+				gstate_c.vertexFullAlpha = true;
+				gstate_c.vertBounds.minU = 0x3FFF;
+				gstate_c.vertBounds.minV = 0x3FFF;
+				gstate_c.vertBounds.maxU = 0;
+				gstate_c.vertBounds.maxV = 0;
+				dec.Execute(vtype, COUNT - 1, true);
+
+				const u8 *data = (const u8 *)dec.GetData();
+				size_t size = dec.GetDstStride() * COUNT;
+				if (batch == 0) {
+					expected.assign(data, data + size);
+					expectedBounds = gstate_c.vertBounds;
+					expectedFullAlpha = gstate_c.vertexFullAlpha;
+					continue;
+				}
+
+				const KnownVertexBounds &bounds = gstate_c.vertBounds;
+				if (memcmp(expected.data(), data, size) != 0) {
+					printf("TestVertexBatch %08x/%d: decoded vertices differ\n", vtype, uvGenMode);
+					failed = true;
+				}
+				if (gstate_c.vertexFullAlpha != expectedFullAlpha) {
+					printf("TestVertexBatch %08x/%d: vertexFullAlpha %d != expected %d\n", vtype, uvGenMode, gstate_c.vertexFullAlpha, expectedFullAlpha);
+					failed = true;
+				}
+				if (memcmp(&bounds, &expectedBounds, sizeof(bounds)) != 0) {
+					printf("TestVertexBatch %08x/%d: bounds %d-%d, %d-%d != expected %d-%d, %d-%d\n", vtype, uvGenMode, bounds.minU, bounds.maxU, bounds.minV, bounds.maxV, expectedBounds.minU, expectedBounds.maxU, expectedBounds.minV, expectedBounds.maxV);
+					failed = true;
+				}
+			}
+		}
+	}
+
+	gstate.texmapmode = savedTexMapMode;
+	gstate_c.uv.uScale = 1.0f;
+	gstate_c.uv.vScale = 1.0f;
+	gstate_c.uv.uOff = 0.0f;
+	gstate_c.uv.vOff = 0.0f;
+	return !failed;
+}
+
 // TODO: Morph (col, pos, nrm), weights (no skin), morph + weights?
 
 typedef bool (*VertexTestFunc)();
@@ -652,6 +784,8 @@ static VertexTestFunc vertdecTestFuncs[] = {
 	&TestVertex8Skin,
 	&TestVertex16Skin,
 	&TestVertexFloatSkin,
+
+	&TestVertexBatch,
 };
 
 bool TestVertexJit() {
@@ -677,6 +811,25 @@ bool TestVertexJit() {
 	printf("Result: %f, %f, %f\n", x, y, z);
 	printf("Jit was %fx faster than steps.\n\n", yesJit / noJit);
 
+	if (cpu_info.bAVX2) {
+		static const int benchTypes[] = {
+			GE_VTYPE_TC_8BIT | GE_VTYPE_COL_8888 | GE_VTYPE_POS_FLOAT,
+			GE_VTYPE_TC_16BIT | GE_VTYPE_NRM_8BIT | GE_VTYPE_POS_16BIT,
+			GE_VTYPE_TC_FLOAT | GE_VTYPE_COL_8888 | GE_VTYPE_POS_FLOAT,
+			GE_VTYPE_TC_16BIT | GE_VTYPE_COL_8888 | GE_VTYPE_POS_16BIT | GE_VTYPE_THROUGH,
+		};
+		for (int benchType : benchTypes) {
+			VertexDecoderTestHarness bench;
+			AddRandomVertices(bench, benchType, 1000);
+			bench.SetBatchDecoding(false);
+			double single = bench.ExecuteTimed(benchType, 999, true);
+			bench.SetBatchDecoding(true);
+			double batched = bench.ExecuteTimed(benchType, 999, true);
+			printf("Batch jit was %fx faster than single for %08x.\n", batched / single, benchType);
+		}
+		printf("\n");
+	}
+
 	bool pass = true;
 	for (size_t i = 0; i < ARRAY_SIZE(vertdecTestFuncs); ++i) {
 		if (!vertdecTestFuncs[i]()) {
@@ -33,6 +33,7 @@
 
 #include "base/NativeApp.h"
 #include "base/logging.h"
+#include "base/timeutil.h"
 #include "input/input_state.h"
 #include "ext/disarm.h"
 #include "math/math_util.h"
@@ -430,23 +431,23 @@ bool TestQuickTexHash() {
 	AlignedMem buf(BUF_SIZE, 16);
 
 	memset(buf, 0, BUF_SIZE);
-	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), 0xaa756edc);
+	EXPECT_EQ_HEX(StableQuickTexHash(buf, BUF_SIZE), 0xaa756edc);
 
 	memset(buf, 1, BUF_SIZE);
-	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), 0x66f81b1c);
+	EXPECT_EQ_HEX(StableQuickTexHash(buf, BUF_SIZE), 0x66f81b1c);
 
 	strncpy(buf, "hello", BUF_SIZE);
-	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), 0xf6028131);
+	EXPECT_EQ_HEX(StableQuickTexHash(buf, BUF_SIZE), 0xf6028131);
 
 	strncpy(buf, "goodbye", BUF_SIZE);
-	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), 0xef81b54f);
+	EXPECT_EQ_HEX(StableQuickTexHash(buf, BUF_SIZE), 0xef81b54f);
 
 	// Simple patterns.
 	for (int i = 0; i < BUF_SIZE; ++i) {
 		char *p = buf;
 		p[i] = i & 0xFF;
 	}
-	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), 0x0d64531c);
+	EXPECT_EQ_HEX(StableQuickTexHash(buf, BUF_SIZE), 0x0d64531c);
 
 	int j = 573;
 	for (int i = 0; i < BUF_SIZE; ++i) {
@@ -454,7 +455,14 @@ bool TestQuickTexHash() {
 		j += ((i * 7) + (i & 3)) * 11;
 		p[i] = j & 0xFF;
 	}
-	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), 0x58de8dbc);
+	EXPECT_EQ_HEX(StableQuickTexHash(buf, BUF_SIZE), 0x58de8dbc);
+
+	// The fast variant may use a different algorithm (like AVX2), but must still tell contents apart.
+	u32 fastHash = DoQuickTexHash(buf, BUF_SIZE);
+	EXPECT_EQ_HEX(DoQuickTexHash(buf, BUF_SIZE), fastHash);
+	char *p = buf;
+	p[BUF_SIZE - 1] ^= 0x80;
+	EXPECT_TRUE(DoQuickTexHash(buf, BUF_SIZE) != fastHash);
 
 	return false;
 }
@@ -467,9 +475,32 @@ struct TestItem {
 
 #define TEST_ITEM(name) { #name, &Test ##name, }
 
+double BenchRunsPerSecond(const std::function<void()> &func) {
+	int total = 0;
+	double st = real_time_now();
+	do {
+		func();
+		++total;
+	} while (real_time_now() - st < 0.25);
+	double elapsed = real_time_now() - st;
+
+	return total / elapsed;
+}
+
 bool TestArmEmitter();
 bool TestArm64Emitter();
 bool TestX64Emitter();
+bool TestTextureDecoder();
+bool TestTextureDecoderBench();
+bool TestColorConv();
+bool TestColorConvBench();
+bool TestIndexGenerator();
+bool TestIndexGeneratorBench();
+bool TestGPURunLoop();
+bool TestGPURunLoopBench();
+bool TestTextureScaler();
+bool TestSoftwarePixel();
+bool TestSoftwareTransform();
 
 TestItem availableTests[] = {
 #if defined(ARM64) || defined(_M_X64) || defined(_M_IX86)
@@ -491,6 +522,21 @@ TestItem availableTests[] = {
 	TEST_ITEM(MatrixTranspose),
 	TEST_ITEM(ParseLBN),
 	TEST_ITEM(QuickTexHash),
+	TEST_ITEM(TextureDecoder),
+	TEST_ITEM(ColorConv),
+	TEST_ITEM(IndexGenerator),
+	TEST_ITEM(GPURunLoop),
+	TEST_ITEM(TextureScaler),
+	TEST_ITEM(SoftwarePixel),
+	TEST_ITEM(SoftwareTransform),
+};
+
+// These only print timings, so "all" skips them.  Run them by name, or with "bench".
+TestItem availableBenchmarks[] = {
+	TEST_ITEM(TextureDecoderBench),
+	TEST_ITEM(ColorConvBench),
+	TEST_ITEM(IndexGeneratorBench),
+	TEST_ITEM(GPURunLoopBench),
 };
 
 int main(int argc, const char *argv[]) {
@@ -512,9 +558,19 @@ int main(int argc, const char *argv[]) {
 				break;
 			}
 		}
+		for (auto f : availableBenchmarks) {
+			if (!strcasecmp(argv[1], f.name)) {
+				testFunc = f.func;
+				break;
+			}
+		}
 	}
 
-	if (allTests) {
+	if (argc >= 2 && !strcasecmp(argv[1], "bench")) {
+		for (auto f : availableBenchmarks) {
+			f.func();
+		}
+	} else if (allTests) {
 		int passes = 0;
 		int fails = 0;
 		for (auto f : availableTests) {
@@ -538,6 +594,11 @@ int main(int argc, const char *argv[]) {
 		for (auto f : availableTests) {
 			fprintf(stderr, "  * %s\n", f.name);
 		}
+		fprintf(stderr, "\n");
+		fprintf(stderr, "Available benchmarks (or \"bench\" for all):\n");
+		for (auto f : availableBenchmarks) {
+			fprintf(stderr, "  * %s\n", f.name);
+		}
 		return 1;
 	} else {
 		if (!testFunc()) {